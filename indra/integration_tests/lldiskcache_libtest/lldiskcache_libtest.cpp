@@ -0,0 +1,262 @@
+/**
+ * @file lldiskcache_libtest.cpp
+ * @brief Benchmark of the asset disk cache layouts
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+#include "llapr.h"
+#include "lldir.h"
+#include "llfilesystem.h"
+#include "lldiskcache.h"
+#include "llpackfilecache.h"
+#include "lltimer.h"
+
+// system libraries
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tlldiskcache_libtest [options]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -d, --dir <path>\n"
+"        Cache folder to use. Default is a folder in the system temp dir.\n"
+" -pack, --pack\n"
+"        Use the pack file layout. Default is one file per asset.\n"
+" -populate, --populate <n>\n"
+"        Fill the cache with <n> assets and exit. Run the benchmark itself in\n"
+"        a second invocation so that the startup measurement is a real cold start\n"
+"        (flush the OS file cache in between for worst case numbers).\n"
+" -size, --asset_size <n>\n"
+"        Average asset size in bytes when populating. Default is 32768.\n"
+" -max, --max_size <n>\n"
+"        Cache size limit in MB. Default is 90% of the populated size so that\n"
+"        the startup purge has something to evict.\n"
+" -reads, --reads <n>\n"
+"        Number of random asset reads to time. Default is 10000.\n"
+"\n"
+"Typical use:\n"
+"    lldiskcache_libtest -d /tmp/c1 -populate 100000\n"
+"    lldiskcache_libtest -d /tmp/c1\n"
+"    lldiskcache_libtest -d /tmp/c2 -pack -populate 100000\n"
+"    lldiskcache_libtest -d /tmp/c2 -pack\n"
+"\n";
+
+// Asset IDs are derived from their index so that the reading run can find
+// the assets written by the populating run.
+static LLUUID asset_id(S32 index)
+{
+    LLUUID id;
+    id.generate(llformat("lldiskcache_libtest asset %d", index));
+    return id;
+}
+
+static S32 asset_size(S32 index, S32 average_size)
+{
+    // Spread sizes between 1/4 and 7/4 of the average, like a real mix of
+    // small sounds, animations and large meshes
+    return average_size / 4 + (S32)(((U32)index * 2654435761U) % (U32)(average_size * 3 / 2));
+}
+
+static void populate(S32 count, S32 average_size)
+{
+    std::vector<U8> buffer(average_size * 2);
+    for (size_t i = 0; i < buffer.size(); ++i)
+    {
+        buffer[i] = (U8)i;
+    }
+
+    LLTimer timer;
+    uintmax_t total = 0;
+    for (S32 i = 0; i < count; ++i)
+    {
+        const S32 size = asset_size(i, average_size);
+        LLFileSystem file(asset_id(i), LLAssetType::AT_OBJECT, LLFileSystem::WRITE);
+        file.write(buffer.data(), size);
+        total += size;
+    }
+    const F32 elapsed = timer.getElapsedTimeF32();
+    std::cout << "Populated " << count << " assets, " << (total >> 20) << " MB in " << elapsed << " s" << std::endl;
+}
+
+static void benchmark_reads(S32 count, S32 reads)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<S32> distribution(0, count - 1);
+
+    std::vector<F64> latencies;
+    latencies.reserve(reads);
+    std::vector<U8> buffer;
+    S32 misses = 0;
+    for (S32 i = 0; i < reads; ++i)
+    {
+        const LLUUID id = asset_id(distribution(generator));
+        LLTimer timer;
+        LLFileSystem file(id, LLAssetType::AT_OBJECT, LLFileSystem::READ);
+        const S32 size = file.getSize();
+        if (size > 0)
+        {
+            buffer.resize(size);
+            file.read(buffer.data(), size);
+        }
+        else
+        {
+            ++misses;
+        }
+        latencies.push_back(timer.getElapsedTimeF64() * 1000000.0);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    F64 sum = 0.0;
+    for (F64 latency : latencies)
+    {
+        sum += latency;
+    }
+    std::cout << "Random reads: " << reads << " (" << misses << " misses)" << std::endl;
+    std::cout << "    mean : " << sum / reads << " us" << std::endl;
+    std::cout << "    p50  : " << latencies[reads / 2] << " us" << std::endl;
+    std::cout << "    p99  : " << latencies[reads * 99 / 100] << " us" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string cache_dir;
+    bool use_pack_files = false;
+    S32 populate_count = 0;
+    S32 average_size = 32768;
+    S32 max_size_mb = 0;
+    S32 reads = 10000;
+
+    // Init whatever is necessary
+    ll_init_apr();
+
+    // Analyze command line arguments
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const bool has_value = (arg + 1) < argc && argv[arg + 1][0] != '-';
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            // Send the usage to standard out
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if (!strcmp(argv[arg], "--pack") || !strcmp(argv[arg], "-pack"))
+        {
+            use_pack_files = true;
+        }
+        else if ((!strcmp(argv[arg], "--dir") || !strcmp(argv[arg], "-d")) && has_value)
+        {
+            cache_dir = argv[++arg];
+        }
+        else if ((!strcmp(argv[arg], "--populate") || !strcmp(argv[arg], "-populate")) && has_value)
+        {
+            populate_count = atoi(argv[++arg]);
+        }
+        else if ((!strcmp(argv[arg], "--asset_size") || !strcmp(argv[arg], "-size")) && has_value)
+        {
+            average_size = llmax(atoi(argv[++arg]), 16);
+        }
+        else if ((!strcmp(argv[arg], "--max_size") || !strcmp(argv[arg], "-max")) && has_value)
+        {
+            max_size_mb = atoi(argv[++arg]);
+        }
+        else if ((!strcmp(argv[arg], "--reads") || !strcmp(argv[arg], "-reads")) && has_value)
+        {
+            reads = llmax(atoi(argv[++arg]), 1);
+        }
+        else
+        {
+            std::cout << "Unknown or incomplete argument " << argv[arg] << ", see --help" << std::endl;
+            return 1;
+        }
+    }
+
+    if (cache_dir.empty())
+    {
+        cache_dir = gDirUtilp->add(LLFile::tmpdir(), "lldiskcache_libtest");
+    }
+
+    // The assets count and size of a populated folder are kept in a small
+    // text file next to the cache.
+    const std::string info_filename = cache_dir + ".info";
+    S32 count = populate_count;
+    if (count)
+    {
+        llofstream info(info_filename);
+        info << populate_count << " " << average_size << std::endl;
+    }
+    else
+    {
+        llifstream info(info_filename);
+        info >> count >> average_size;
+        if (!count)
+        {
+            std::cout << "Nothing to benchmark in " << cache_dir << ", use --populate first" << std::endl;
+            return 1;
+        }
+    }
+
+    uintmax_t max_size = (uintmax_t)max_size_mb << 20;
+    if (!max_size)
+    {
+        uintmax_t total = 0;
+        for (S32 i = 0; i < count; ++i)
+        {
+            total += asset_size(i, average_size);
+        }
+        max_size = populate_count ? total * 2 : total * 9 / 10;
+    }
+
+    std::cout << (use_pack_files ? "Pack file" : "Per file") << " layout in " << cache_dir << std::endl;
+
+    // Startup: what the viewer does in LLAppViewer::initCache()
+    bool enable_cache_debug_info = false;
+    LLTimer startup_timer;
+    LLDiskCache::initParamSingleton(cache_dir, max_size, enable_cache_debug_info, use_pack_files);
+    const F32 init_time = startup_timer.getElapsedTimeF32();
+
+    if (populate_count)
+    {
+        populate(populate_count, average_size);
+    }
+    else
+    {
+        LLTimer purge_timer;
+        LLDiskCache::getInstance()->purge();
+        const F32 purge_time = purge_timer.getElapsedTimeF32();
+        std::cout << "Startup: init " << init_time * 1000.f << " ms, purge " << purge_time * 1000.f << " ms" << std::endl;
+        std::cout << "Cache info: " << LLDiskCache::getInstance()->getCacheInfo() << std::endl;
+
+        benchmark_reads(count, reads);
+    }
+
+    // Cleanup and exit (saves the pack index)
+    LLDiskCache::deleteSingleton();
+    ll_cleanup_apr();
+
+    return 0;
+}
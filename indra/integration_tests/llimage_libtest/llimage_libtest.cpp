@@ -38,13 +38,16 @@
 #include "llimagebmp.h"
 #include "llimagetga.h"
 #include "llimagej2c.h"
+#include "llimagesimd.h"
 #include "lldir.h"
 #include "lldiriterator.h"
+#include "v3color.h"
 #include "v4coloru.h"
 #include "llsdserialize.h"
 #include "llcleanup.h"
 
 // system libraries
+#include <functional>
 #include <iostream>
 
 // doc string provided when invoking the program with --help
@@ -97,6 +100,17 @@ static const char USAGE[] = "\n"
 "        Results in <metric>_report.csv\n"
 " -s, --image-stats\n"
 "        Output stats for each input and output image.\n"
+" -bd, --benchmark-decode <n>\n"
+"        Decode each j2c input file n times at each discard level and print the decode\n"
+"        time in ms per megapixel, with a single thread and with the number of threads\n"
+"        given by -dt. No output file is written.\n"
+" -dt, --decode-threads <n>\n"
+"        Number of threads used to decode each j2c image. Default is 1.\n"
+" -bk, --benchmark-kernels <n>\n"
+"        Run the raw image pixel operations (scaling, compositing, fill, tint...) n times\n"
+"        on synthetic images with each SIMD level supported by the CPU, print the time\n"
+"        in ms per call and check that all levels produce the same pixels. No input\n"
+"        file is needed.\n"
 "\n";
 
 // true when all image loading is done. Used by metric logging thread to know when to stop the thread.
@@ -313,6 +327,156 @@ void store_output_file(std::list<std::string> &output_filenames, std::list<std::
     }
 }
 
+// Time the decoding of a j2c file at each discard level, with 1 and 'decode_threads' threads
+void benchmark_decode(const std::string &src_filename, int iterations, int decode_threads)
+{
+    LLPointer<LLImageFormatted> image = create_image(src_filename);
+    if (image.isNull() || (image->getCodec() != IMG_CODEC_J2C) || !image->load(src_filename))
+    {
+        std::cout << "Decode benchmark: " << src_filename << " is not a valid j2c file" << std::endl;
+        return;
+    }
+    LLImageJ2C* j2c = (LLImageJ2C*)(image.get());
+
+    std::cout << "Decode benchmark for " << src_filename << " (" << (int)(image->getWidth()) << "x" << (int)(image->getHeight())
+              << ", " << iterations << " iterations), ms per megapixel:" << std::endl;
+    std::cout << "    discard     size    1 thread  " << decode_threads << " threads  speedup" << std::endl;
+
+    for (S32 discard = 0; discard <= MAX_DISCARD_LEVEL; discard++)
+    {
+        S32 width = image->getWidth() >> discard;
+        S32 height = image->getHeight() >> discard;
+        if ((width < 1) || (height < 1))
+        {
+            break;
+        }
+        F64 megapixels = (F64)(width * height) / (1024.0 * 1024.0);
+
+        F64 ms_per_mp[2] = { 0.0, 0.0 };
+        int thread_counts[2] = { 1, decode_threads };
+        for (int i = 0; i < 2; i++)
+        {
+            // Threshold at 0 so that every discard level uses the threads
+            LLImageJ2C::setDecodeThreading(thread_counts[i], 0);
+            LLTimer timer;
+            for (int iteration = 0; iteration < iterations; iteration++)
+            {
+                LLPointer<LLImageRaw> raw_image = new LLImageRaw;
+                j2c->initDecode(*raw_image, discard, NULL);
+                if (!j2c->decode(raw_image, 0.0f))
+                {
+                    std::cout << "Decode benchmark: decode failed at discard level " << discard << std::endl;
+                    return;
+                }
+            }
+            ms_per_mp[i] = timer.getElapsedTimeF64() * 1000.0 / ((F64)iterations * megapixels);
+        }
+
+        std::cout << llformat("    %7d  %4dx%-4d  %9.2f  %9.2f  %6.2fx", discard, width, height, ms_per_mp[0], ms_per_mp[1],
+                              ms_per_mp[1] > 0.0 ? ms_per_mp[0] / ms_per_mp[1] : 0.0) << std::endl;
+    }
+}
+
+// A raw image operation timed by benchmark_kernels()
+struct PixelKernel
+{
+    const char* mName;
+    S32 mComponents;        // of the image modified by the operation
+    S32 mSrcComponents;     // of the source image, 0 when there is none
+    S32 mSrcSize;           // of the source image, 0 for the same size
+    std::function<void(LLImageRaw* image, const LLImageRaw* src)> mRun;
+};
+
+// Image of the given size filled with noise, the same for a given seed
+LLPointer<LLImageRaw> create_noise_image(S32 width, S32 height, S32 components, U32 seed)
+{
+    LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+    U8* data = image->getData();
+    for (S32 i = 0; i < image->getDataSize(); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (U8)(seed >> 16);
+    }
+    return image;
+}
+
+// Time the raw image pixel operations at each SIMD level supported by the CPU
+// and check that they all produce the same pixels as the scalar code
+void benchmark_kernels(int iterations)
+{
+    const S32 SIZE = 1024;
+    const LLColor4U fill_color(12, 34, 56, 78);
+    const LLColor3 tint_color(0.9f, 0.5f, 0.25f);
+    const std::vector<PixelKernel> kernels = {
+        { "fill",           3, 0, 0, [&](LLImageRaw* image, const LLImageRaw*) { image->fill(fill_color); } },
+        { "fill",           4, 0, 0, [&](LLImageRaw* image, const LLImageRaw*) { image->fill(fill_color); } },
+        { "tint",           3, 0, 0, [&](LLImageRaw* image, const LLImageRaw*) { image->tint(tint_color); } },
+        { "tint",           4, 0, 0, [&](LLImageRaw* image, const LLImageRaw*) { image->tint(tint_color); } },
+        { "verticalFlip",   1, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->verticalFlip(); } },
+        { "verticalFlip",   3, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->verticalFlip(); } },
+        { "verticalFlip",   4, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->verticalFlip(); } },
+        { "scale down",     1, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->scale(SIZE * 3 / 8, SIZE * 3 / 8); } },
+        { "scale down",     3, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->scale(SIZE * 3 / 8, SIZE * 3 / 8); } },
+        { "scale down",     4, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->scale(SIZE * 3 / 8, SIZE * 3 / 8); } },
+        { "scale up",       1, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->scale(SIZE * 3 / 2, SIZE * 3 / 2); } },
+        { "scale up",       3, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->scale(SIZE * 3 / 2, SIZE * 3 / 2); } },
+        { "scale up",       4, 0, 0, [](LLImageRaw* image, const LLImageRaw*) { image->scale(SIZE * 3 / 2, SIZE * 3 / 2); } },
+        { "composite",      3, 4, 0, [](LLImageRaw* image, const LLImageRaw* src) { image->composite(src); } },
+        { "composite scaled", 3, 4, SIZE / 2, [](LLImageRaw* image, const LLImageRaw* src) { image->composite(src); } },
+        { "alpha mask",     4, 1, 0, [&](LLImageRaw* image, const LLImageRaw* src) { image->copyUnscaledAlphaMask(src, fill_color); } },
+    };
+
+    const S32 levels = LLImageSIMD::getSupportedLevel() + 1;
+    std::cout << "Pixel kernels benchmark (" << SIZE << "x" << SIZE << " images, " << iterations << " iterations), ms per call:" << std::endl;
+    std::string header = "    kernel            components";
+    for (S32 level = 0; level < levels; level++)
+    {
+        header += llformat("%10s", LLImageSIMD::getLevelName((LLImageSIMD::ELevel)level));
+    }
+    std::cout << header << std::endl;
+
+    for (const PixelKernel& kernel : kernels)
+    {
+        LLPointer<LLImageRaw> initial = create_noise_image(SIZE, SIZE, kernel.mComponents, 1);
+        LLPointer<LLImageRaw> src;
+        if (kernel.mSrcComponents)
+        {
+            const S32 src_size = kernel.mSrcSize ? kernel.mSrcSize : SIZE;
+            src = create_noise_image(src_size, src_size, kernel.mSrcComponents, 2);
+        }
+
+        std::string line = llformat("    %-16s  %10d", kernel.mName, kernel.mComponents);
+        LLPointer<LLImageRaw> expected;
+        bool identical = true;
+        for (S32 level = 0; level < levels; level++)
+        {
+            LLImageSIMD::setLevel((LLImageSIMD::ELevel)level);
+            LLPointer<LLImageRaw> result;
+            F64 seconds = 0.0;
+            for (int iteration = 0; iteration < iterations; iteration++)
+            {
+                result = new LLImageRaw(initial->getData(), initial->getWidth(), initial->getHeight(), initial->getComponents());
+                LLTimer timer;
+                kernel.mRun(result, src);
+                seconds += timer.getElapsedTimeF64();
+            }
+            line += llformat("%10.3f", seconds * 1000.0 / iterations);
+
+            if (expected.isNull())
+            {
+                expected = result;
+            }
+            else
+            {
+                identical = identical && (result->getDataSize() == expected->getDataSize()) &&
+                            !memcmp(result->getData(), expected->getData(), result->getDataSize());
+            }
+        }
+        std::cout << line << (identical ? "" : "  MISMATCH") << std::endl;
+    }
+    LLImageSIMD::setLevel(LLImageSIMD::getSupportedLevel());
+}
+
 // Holds the metric gathering output in a thread safe way
 class LogThread : public LLThread
 {
@@ -357,6 +521,9 @@ int main(int argc, char** argv)
     int levels = 0;
     bool reversible = false;
     std::string filter_name = "";
+    int benchmark_iterations = 0;
+    int decode_threads = 1;
+    int kernel_iterations = 0;
 
     // Init whatever is necessary
     ll_init_apr();
@@ -557,6 +724,70 @@ int main(int argc, char** argv)
         {
             image_stats = true;
         }
+        else if (!strcmp(argv[arg], "--benchmark-decode") || !strcmp(argv[arg], "-bd"))
+        {
+            std::string value_str;
+            if ((arg + 1) < argc)
+            {
+                value_str = argv[arg+1];
+            }
+            if (((arg + 1) >= argc) || (value_str[0] == '-'))
+            {
+                std::cout << "No valid --benchmark-decode argument given, decoding once per discard level" << std::endl;
+                benchmark_iterations = 1;
+            }
+            else
+            {
+                benchmark_iterations = llmax(atoi(value_str.c_str()), 1);
+                arg += 1;
+            }
+        }
+        else if (!strcmp(argv[arg], "--benchmark-kernels") || !strcmp(argv[arg], "-bk"))
+        {
+            std::string value_str;
+            if ((arg + 1) < argc)
+            {
+                value_str = argv[arg+1];
+            }
+            if (((arg + 1) >= argc) || (value_str[0] == '-'))
+            {
+                std::cout << "No valid --benchmark-kernels argument given, running each kernel once" << std::endl;
+                kernel_iterations = 1;
+            }
+            else
+            {
+                kernel_iterations = llmax(atoi(value_str.c_str()), 1);
+                arg += 1;
+            }
+        }
+        else if (!strcmp(argv[arg], "--decode-threads") || !strcmp(argv[arg], "-dt"))
+        {
+            std::string value_str;
+            if ((arg + 1) < argc)
+            {
+                value_str = argv[arg+1];
+            }
+            if (((arg + 1) >= argc) || (value_str[0] == '-'))
+            {
+                std::cout << "No valid --decode-threads argument given, decode threads set to 1" << std::endl;
+            }
+            else
+            {
+                decode_threads = llmax(atoi(value_str.c_str()), 1);
+                arg += 1;
+            }
+        }
+    }
+
+    // The kernels benchmark works on synthetic images
+    if (kernel_iterations > 0)
+    {
+        benchmark_kernels(kernel_iterations);
+        if (input_filenames.size() == 0)
+        {
+            SUBSYSTEM_CLEANUP(LLImage);
+            return 0;
+        }
     }
 
     // Check arguments consistency. Exit with proper message if inconsistent.
@@ -572,6 +803,18 @@ int main(int argc, char** argv)
     }
 
 
+    // The decode benchmark does not load nor save the images the usual way
+    if (benchmark_iterations > 0)
+    {
+        for (const std::string& in_file : input_filenames)
+        {
+            benchmark_decode(in_file, benchmark_iterations, decode_threads);
+        }
+        SUBSYSTEM_CLEANUP(LLImage);
+        return 0;
+    }
+    LLImageJ2C::setDecodeThreading(decode_threads, 0);
+
     // Create the logging thread if required
     if (LLFastTimer::sMetricLog)
     {
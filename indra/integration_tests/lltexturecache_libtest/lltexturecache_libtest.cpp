@@ -0,0 +1,458 @@
+/**
+ * @file lltexturecache_libtest.cpp
+ * @brief Benchmark of the texture cache header index
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+#include "llfile.h"
+#include "llmutex.h"
+#include "llshardedmap.h"
+#include "lltimer.h"
+#include "lluuid.h"
+
+// system libraries
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tlltexturecache_libtest [options]\n"
+"\n"
+"Replays the header lookups and updates LLTextureCache workers do when\n"
+"textures stream in, against the former index (one mutex, one header file\n"
+"access per lookup) and the current one (sharded in-memory map, header file\n"
+"written in batches by a background thread).\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -trace, --trace <file>\n"
+"        Access pattern to replay: a viewer log recorded with the debug tag\n"
+"        TextureCacheIndex enabled (e.g. while teleporting), or any file with\n"
+"        'read <uuid>' and 'write <uuid>' lines. Default is a synthetic\n"
+"        teleport: the textures of the new region get read, the ones not in\n"
+"        cache get written, then read again at higher discard levels.\n"
+" -textures, --textures <n>\n"
+"        Number of textures in the synthetic teleport. Default is 4000.\n"
+" -entries, --entries <n>\n"
+"        Number of entries already in the cache. Default is 100000.\n"
+" -threads, --threads <n>\n"
+"        Number of workers replaying the trace in parallel. Default is 8.\n"
+" -d, --dir <path>\n"
+"        Folder for the header file. Default is the system temp dir.\n"
+"\n";
+
+// Same layout as LLTextureCache::Entry
+struct Entry
+{
+    LLUUID mID;
+    S32 mImageSize;
+    S32 mBodySize;
+    U32 mTime;
+};
+
+struct Operation
+{
+    LLUUID mID;
+    bool mWrite;
+};
+
+static const S32 HEADER_SIZE = 48; // sizeof(LLTextureCache::EntriesInfo)
+
+static Entry make_entry(const LLUUID& id)
+{
+    Entry entry;
+    entry.mID = id;
+    entry.mImageSize = 65536;
+    entry.mBodySize = 65536 - 600;
+    entry.mTime = (U32)time(NULL);
+    return entry;
+}
+
+static void write_entry(LLFILE* file, S32 idx, const Entry& entry)
+{
+    fseek(file, HEADER_SIZE + idx * (long)sizeof(Entry), SEEK_SET);
+    fwrite(&entry, sizeof(Entry), 1, file);
+}
+
+// The texture cache index as it used to be: every lookup locks the header
+// mutex and reads the entry back from the header file.
+class OldIndex
+{
+public:
+    OldIndex(const std::string& filename) : mFilename(filename) {}
+
+    void add(const LLUUID& id, S32 idx) { mIDMap[id] = idx; mNextIndex = llmax(mNextIndex, idx + 1); }
+
+    bool read(const LLUUID& id)
+    {
+        LLMutexLock lock(&mMutex);
+        std::map<LLUUID, S32>::iterator it = mIDMap.find(id);
+        if (it == mIDMap.end())
+        {
+            return false;
+        }
+        Entry entry;
+        LLUniqueFile file = LLFile::fopen(mFilename, "rb");
+        fseek(file, HEADER_SIZE + it->second * (long)sizeof(Entry), SEEK_SET);
+        return fread(&entry, sizeof(Entry), 1, file) == 1;
+    }
+
+    void write(const LLUUID& id)
+    {
+        LLMutexLock lock(&mMutex);
+        S32& idx = mIDMap.emplace(id, -1).first->second;
+        if (idx < 0)
+        {
+            idx = mNextIndex++;
+        }
+        LLUniqueFile file = LLFile::fopen(mFilename, "r+b");
+        write_entry(file, idx, make_entry(id));
+    }
+
+    void flush() {}
+
+private:
+    std::string mFilename;
+    LLMutex mMutex;
+    std::map<LLUUID, S32> mIDMap;
+    S32 mNextIndex = 0;
+};
+
+// The current index: lookups only lock the shard of the texture, and dirty
+// entries are written in batches by a background thread.
+class NewIndex
+{
+public:
+    NewIndex(const std::string& filename) : mFilename(filename)
+    {
+        mWriter = std::thread([this]()
+        {
+            while (!mQuitting)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                flush();
+            }
+        });
+    }
+
+    ~NewIndex()
+    {
+        mQuitting = true;
+        mWriter.join();
+    }
+
+    void add(const LLUUID& id, S32 idx) { mIndex.insert(id, { idx, make_entry(id) }); mNextIndex = llmax(mNextIndex, idx + 1); }
+
+    bool read(const LLUUID& id)
+    {
+        return mIndex.update(id, [](Record& record) { record.mEntry.mTime = (U32)time(NULL); });
+    }
+
+    void write(const LLUUID& id)
+    {
+        // Creating entries still goes through the header mutex
+        LLMutexLock lock(&mMutex);
+        Record record;
+        if (!mIndex.find(id, record))
+        {
+            record.mIndex = mNextIndex++;
+        }
+        record.mEntry = make_entry(id);
+        mIndex.insert(id, record);
+        mDirty.insert(record.mIndex, record.mEntry);
+    }
+
+    void flush()
+    {
+        LLMutexLock lock(&mMutex);
+        std::map<S32, Entry> dirty;
+        mDirty.drain([&dirty](const S32& idx, Entry& entry) { dirty[idx] = entry; });
+        if (!dirty.empty())
+        {
+            LLUniqueFile file = LLFile::fopen(mFilename, "r+b");
+            for (const auto& pair : dirty)
+            {
+                write_entry(file, pair.first, pair.second);
+            }
+        }
+    }
+
+private:
+    struct Record
+    {
+        S32 mIndex;
+        Entry mEntry;
+    };
+
+    std::string mFilename;
+    LLMutex mMutex;
+    LLShardedMap<LLUUID, Record> mIndex;
+    LLShardedMap<S32, Entry, 16> mDirty;
+    S32 mNextIndex = 0;
+    std::atomic<bool> mQuitting{ false };
+    std::thread mWriter;
+};
+
+static bool load_trace(const std::string& filename, std::vector<Operation>& trace)
+{
+    llifstream file(filename);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // Matches both the debug log lines and a plain list of operations
+        if (line.find("TextureCacheIndex") == std::string::npos &&
+            line.compare(0, 5, "read ") != 0 && line.compare(0, 6, "write ") != 0)
+        {
+            continue;
+        }
+        for (const char* op : { "read ", "write " })
+        {
+            size_t pos = line.find(op);
+            if (pos != std::string::npos)
+            {
+                Operation operation;
+                if (operation.mID.set(line.substr(pos + strlen(op), UUID_STR_LENGTH - 1), false))
+                {
+                    operation.mWrite = op[0] == 'w';
+                    trace.push_back(operation);
+                }
+                break;
+            }
+        }
+    }
+    return !trace.empty();
+}
+
+static void make_teleport_trace(S32 textures, std::vector<Operation>& trace, std::vector<LLUUID>& cached)
+{
+    std::mt19937 generator(42);
+    std::vector<LLUUID> ids(textures);
+    std::set<LLUUID> missing;
+    for (S32 i = 0; i < textures; ++i)
+    {
+        ids[i].generate();
+        // A third of the region is new to this cache
+        if (i % 3)
+        {
+            cached.push_back(ids[i]);
+        }
+        else
+        {
+            missing.insert(ids[i]);
+        }
+    }
+
+    // First pass at low resolution, where only the missing textures get
+    // written, then a few passes at higher ones as the camera settles, in a
+    // different order each time
+    for (S32 pass = 0; pass < 4; ++pass)
+    {
+        std::shuffle(ids.begin(), ids.end(), generator);
+        for (S32 i = 0; i < textures; ++i)
+        {
+            trace.push_back({ ids[i], false });
+            if (pass || missing.count(ids[i]))
+            {
+                trace.push_back({ ids[i], true });
+            }
+        }
+    }
+}
+
+template <class INDEX>
+static void replay(const char* name, INDEX& index, const std::vector<Operation>& trace, S32 threads)
+{
+    std::vector<std::vector<F64>> latencies(threads);
+    LLTimer timer;
+    std::vector<std::thread> workers;
+    for (S32 t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+        {
+            for (size_t i = t; i < trace.size(); i += threads)
+            {
+                const Operation& operation = trace[i];
+                LLTimer op_timer;
+                if (operation.mWrite)
+                {
+                    index.write(operation.mID);
+                }
+                else
+                {
+                    index.read(operation.mID);
+                }
+                latencies[t].push_back(op_timer.getElapsedTimeF64() * 1000000.0);
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    index.flush();
+    const F64 elapsed = timer.getElapsedTimeF64();
+
+    std::vector<F64> all;
+    for (const std::vector<F64>& thread_latencies : latencies)
+    {
+        all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    std::cout << name << ": " << trace.size() << " operations in " << elapsed * 1000.0 << " ms ("
+              << (S64)(trace.size() / elapsed) << " ops/s)" << std::endl;
+    std::cout << "    p50  : " << all[all.size() / 2] << " us" << std::endl;
+    std::cout << "    p99  : " << all[all.size() * 99 / 100] << " us" << std::endl;
+}
+
+template <class INDEX>
+static void populate(INDEX& index, const std::string& filename, S32 entries, const std::vector<LLUUID>& cached)
+{
+    // Header plus all the entries, like a texture.entries file in use
+    LLUniqueFile file = LLFile::fopen(filename, "wb");
+    std::vector<U8> header(HEADER_SIZE, 0);
+    fwrite(header.data(), header.size(), 1, file);
+    S32 idx = 0;
+    for (; idx < entries; ++idx)
+    {
+        LLUUID id;
+        id.generate();
+        write_entry(file, idx, make_entry(id));
+        index.add(id, idx);
+    }
+    for (const LLUUID& id : cached)
+    {
+        write_entry(file, idx, make_entry(id));
+        index.add(id, idx++);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string trace_filename;
+    std::string dir;
+    S32 textures = 4000;
+    S32 entries = 100000;
+    S32 threads = 8;
+
+    // Analyze command line arguments
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const bool has_value = (arg + 1) < argc && argv[arg + 1][0] != '-';
+        if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+        {
+            // Send the usage to standard out
+            std::cout << USAGE << std::endl;
+            return 0;
+        }
+        else if ((!strcmp(argv[arg], "--trace") || !strcmp(argv[arg], "-trace")) && has_value)
+        {
+            trace_filename = argv[++arg];
+        }
+        else if ((!strcmp(argv[arg], "--textures") || !strcmp(argv[arg], "-textures")) && has_value)
+        {
+            textures = llmax(atoi(argv[++arg]), 1);
+        }
+        else if ((!strcmp(argv[arg], "--entries") || !strcmp(argv[arg], "-entries")) && has_value)
+        {
+            entries = llmax(atoi(argv[++arg]), 0);
+        }
+        else if ((!strcmp(argv[arg], "--threads") || !strcmp(argv[arg], "-threads")) && has_value)
+        {
+            threads = llmax(atoi(argv[++arg]), 1);
+        }
+        else if ((!strcmp(argv[arg], "--dir") || !strcmp(argv[arg], "-d")) && has_value)
+        {
+            dir = argv[++arg];
+        }
+        else
+        {
+            std::cout << "Unknown or incomplete argument " << argv[arg] << ", see --help" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Operation> trace;
+    std::vector<LLUUID> cached;
+    if (!trace_filename.empty())
+    {
+        if (!load_trace(trace_filename, trace))
+        {
+            std::cout << "No texture cache operation found in " << trace_filename << std::endl;
+            return 1;
+        }
+        // Whatever the trace reads before writing it was in cache already
+        std::set<LLUUID> written;
+        for (const Operation& operation : trace)
+        {
+            if (operation.mWrite)
+            {
+                written.insert(operation.mID);
+            }
+            else if (!written.count(operation.mID))
+            {
+                written.insert(operation.mID);
+                cached.push_back(operation.mID);
+            }
+        }
+    }
+    else
+    {
+        make_teleport_trace(textures, trace, cached);
+    }
+
+    if (dir.empty())
+    {
+        dir = LLFile::tmpdir();
+    }
+    else if (dir.back() != '/' && dir.back() != '\\')
+    {
+        dir += '/';
+    }
+    const std::string filename = dir + "lltexturecache_libtest.entries";
+    std::cout << trace.size() << " operations, " << threads << " threads, " << entries + cached.size()
+              << " entries in cache" << std::endl;
+
+    {
+        OldIndex index(filename);
+        populate(index, filename, entries, cached);
+        replay("Single mutex", index, trace, threads);
+    }
+    {
+        NewIndex index(filename);
+        populate(index, filename, entries, cached);
+        replay("Sharded map", index, trace, threads);
+    }
+
+    LLFile::remove(filename);
+    return 0;
+}
@@ -33,6 +33,7 @@
 #include <string>
 
 #include "lljoint.h"
+#include "lljointskeleton.h"
 #include "llmotioncontroller.h"
 #include "llvisualparam.h"
 #include "llstringtable.h"
@@ -152,8 +153,9 @@ public:
     virtual void requestStopMotion( LLMotion* motion );
 
     // periodic update function, steps the motion controller
+    // defer_evaluation is passed on to LLMotionController::updateMotions()
     enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
-    void updateMotions(e_update_t update_type);
+    void updateMotions(e_update_t update_type, bool defer_evaluation = false);
 
     LLAnimPauseRequest requestPause();
     bool areAnimationsPaused() const { return mMotionController.isPaused(); }
@@ -162,6 +164,10 @@ public:
 
     LLMotionController& getMotionController() { return mMotionController; }
 
+    // same as getRootJoint()->updateWorldMatrixChildren(), in one pass over
+    // the flattened skeleton
+    void updateWorldMatrices() { mJointSkeleton.updateWorldMatrices(getRootJoint()); }
+
     // Releases all motion instances which should result in
     // no cached references to character joint data.  This is
     // useful if a character wants to rebuild it's skeleton.
@@ -281,6 +287,7 @@ public:
 
 protected:
     LLMotionController  mMotionController;
+    LLJointSkeleton     mJointSkeleton;
 
     typedef std::map<std::string, void *> animation_data_map_t;
     animation_data_map_t mAnimationData;
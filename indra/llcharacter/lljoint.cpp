@@ -34,8 +34,9 @@
 #include "llmath.h"
 #include <boost/algorithm/string.hpp>
 
-S32 LLJoint::sNumUpdates = 0;
-S32 LLJoint::sNumTouches = 0;
+thread_local S32 LLJoint::sNumUpdates = 0;
+thread_local S32 LLJoint::sNumTouches = 0;
+std::atomic<U32> LLJoint::sTopologySerial(0);
 
 template <class T>
 bool attachment_map_iter_compare_key(const T& a, const T& b)
@@ -272,6 +273,7 @@ void LLJoint::addChild(LLJoint* joint)
     joint->mXform.setParent(&mXform);
     joint->mParent = this;
     joint->touch();
+    sTopologySerial++;
 }
 
 
@@ -288,6 +290,7 @@ void LLJoint::removeChild(LLJoint* joint)
         joint->mXform.setParent(NULL);
         joint->mParent = NULL;
         joint->touch();
+        sTopologySerial++;
     }
 }
 
@@ -308,6 +311,7 @@ void LLJoint::removeAllChildren()
         }
     }
     mChildren.clear();
+    sTopologySerial++;
 }
 
 
@@ -30,6 +30,7 @@
 //-----------------------------------------------------------------------------
 // Header Files
 //-----------------------------------------------------------------------------
+#include <atomic>
 #include <string>
 #include <list>
 
@@ -90,6 +91,7 @@ LL_ALIGN_PREFIX(16)
 class LLJoint
 {
     LL_ALIGN_NEW
+    friend class LLJointSkeleton;
 public:
     // priority levels, from highest to lowest
     enum JointPriority
@@ -148,9 +150,11 @@ public:
     typedef std::vector<LLJoint*> joints_t;
     joints_t mChildren;
 
-    // debug statics
-    static S32      sNumTouches;
-    static S32      sNumUpdates;
+    // debug statics, counted by each thread
+    static thread_local S32 sNumTouches;
+    static thread_local S32 sNumUpdates;
+    // changes whenever a joint is added to or removed from any parent
+    static std::atomic<U32> sTopologySerial;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
@@ -272,6 +276,8 @@ public:
 
     void updateWorldMatrix();
 
+    static U32 getTopologySerial() { return sTopologySerial; }
+
     // get/set skin offset
     const LLVector3 &getSkinOffset();
     void setSkinOffset( const LLVector3 &offset);
@@ -0,0 +1,202 @@
+/**
+ * @file lljointskeleton.cpp
+ * @brief Implementation of LLJointSkeleton class.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "linden_common.h"
+
+#include "lljointskeleton.h"
+
+#include "lljoint.h"
+
+// a * b, as operator*(const LLQuaternion&, const LLQuaternion&) computes it
+static inline LLVector4a quat_mul(const LLVector4a& a, const LLVector4a& b)
+{
+    // flips the sign of w
+    static const LLQuad sign_w = _mm_set_ps(-0.f, 0.f, 0.f, 0.f);
+
+    // (bw * ax, bw * ay, bw * az, bw * aw)
+    LLQuad t0 = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)), a);
+    // (bx * aw, by * aw, bz * aw, -bx * ax)
+    LLQuad t1 = _mm_mul_ps(_mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 2, 1, 0)), sign_w),
+                           _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 3, 3, 3)));
+    // (by * az, bz * ax, bx * ay, -by * ay)
+    LLQuad t2 = _mm_mul_ps(_mm_xor_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 2, 1)), sign_w),
+                           _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 0, 2)));
+    // (bz * ay, bx * az, by * ax, bz * az)
+    LLQuad t3 = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 1, 0, 2)),
+                           _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 0, 2, 1)));
+
+    return _mm_sub_ps(_mm_add_ps(_mm_add_ps(t0, t1), t2), t3);
+}
+
+//-----------------------------------------------------------------------------
+// LLJointSkeleton()
+//-----------------------------------------------------------------------------
+LLJointSkeleton::LLJointSkeleton()
+    : mRoot(NULL),
+      mTopologySerial(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// build()
+//-----------------------------------------------------------------------------
+void LLJointSkeleton::build(LLJoint* root)
+{
+    mRoot = root;
+    mTopologySerial = LLJoint::getTopologySerial();
+
+    mJoints.clear();
+    mParents.clear();
+    mJoints.push_back(root);
+    mParents.push_back(-1);
+
+    // breadth first, so that each parent comes before its children
+    for (S32 i = 0; i < (S32)mJoints.size(); ++i)
+    {
+        for (LLJoint* child : mJoints[i]->mChildren)
+        {
+            if (child)
+            {
+                mJoints.push_back(child);
+                mParents.push_back(i);
+            }
+        }
+    }
+
+    const size_t count = mJoints.size();
+    mStates.resize(count);
+    mLocalPositions.resize(count);
+    mLocalRotations.resize(count);
+    mScales.resize(count);
+    mWorldRotations.resize(count);
+    mWorldMatrices.resize(count);
+}
+
+//-----------------------------------------------------------------------------
+// updateWorldMatrices()
+//-----------------------------------------------------------------------------
+void LLJointSkeleton::updateWorldMatrices(LLJoint* root)
+{
+    if (!root->mUpdateXform)
+    {
+        return;
+    }
+
+    if (root != mRoot || mTopologySerial != LLJoint::getTopologySerial())
+    {
+        build(root);
+    }
+
+    const S32 count = (S32)mJoints.size();
+
+    // The root's parent, if any, is no joint of ours
+    root->updateWorldMatrix();
+    mStates[0] = JOINT_CLEAN;
+    mWorldRotations[0].loadua(root->mXform.getWorldRotation().mQ);
+    mWorldMatrices[0] = root->mWorldMatrix;
+
+    // Gather
+    for (S32 i = 1; i < count; ++i)
+    {
+        LLJoint* joint = mJoints[i];
+        if (mStates[mParents[i]] == JOINT_SKIPPED || !joint->mUpdateXform)
+        {
+            mStates[i] = JOINT_SKIPPED;
+        }
+        else if (joint->mDirtyFlags & LLJoint::MATRIX_DIRTY)
+        {
+            mStates[i] = JOINT_DIRTY;
+            const LLXformMatrix& xform = joint->mXform;
+            mLocalPositions[i].load3(xform.getPosition().mV);
+            mLocalRotations[i].loadua(xform.getRotation().mQ);
+            mScales[i].load3(xform.getScale().mV);
+        }
+        else
+        {
+            // only read by dirty children
+            mStates[i] = JOINT_CLEAN;
+            mWorldRotations[i].loadua(joint->mXform.getWorldRotation().mQ);
+            mWorldMatrices[i] = joint->mWorldMatrix;
+        }
+    }
+
+    // Propagate, as LLXformMatrix::updateMatrix() does for joints, whose
+    // offsets are scaled by their parent's scale: the parent's world matrix
+    // takes a child's local position to its world position.
+    for (S32 i = 1; i < count; ++i)
+    {
+        if (mStates[i] != JOINT_DIRTY)
+        {
+            continue;
+        }
+        const S32 parent = mParents[i];
+
+        LLVector4a rot = quat_mul(mLocalRotations[i], mWorldRotations[parent]);
+        mWorldRotations[i] = rot;
+
+        // as LLMatrix4::initAll()
+        const F32* q = rot.getF32ptr();
+        const F32 xx = q[VX] * q[VX], xy = q[VX] * q[VY], xz = q[VX] * q[VZ], xw = q[VX] * q[VW];
+        const F32 yy = q[VY] * q[VY], yz = q[VY] * q[VZ], yw = q[VY] * q[VW];
+        const F32 zz = q[VZ] * q[VZ], zw = q[VZ] * q[VW];
+
+        LLMatrix4a& mat = mWorldMatrices[i];
+        mat.mMatrix[0].set(1.f - 2.f * (yy + zz), 2.f * (xy + zw), 2.f * (xz - yw));
+        mat.mMatrix[1].set(2.f * (xy - zw), 1.f - 2.f * (xx + zz), 2.f * (yz + xw));
+        mat.mMatrix[2].set(2.f * (xz + yw), 2.f * (yz - xw), 1.f - 2.f * (xx + yy));
+
+        LLVector4a scale;
+        scale.splat(mScales[i], 0);
+        mat.mMatrix[0].mul(scale);
+        scale.splat(mScales[i], 1);
+        mat.mMatrix[1].mul(scale);
+        scale.splat(mScales[i], 2);
+        mat.mMatrix[2].mul(scale);
+
+        mWorldMatrices[parent].affineTransform(mLocalPositions[i], mat.mMatrix[3]);
+    }
+
+    // Scatter
+    for (S32 i = 1; i < count; ++i)
+    {
+        if (mStates[i] != JOINT_DIRTY)
+        {
+            continue;
+        }
+        LLJoint* joint = mJoints[i];
+        const LLMatrix4a& mat = mWorldMatrices[i];
+
+        LLQuaternion rot;
+        memcpy(rot.mQ, mWorldRotations[i].getF32ptr(), sizeof(rot.mQ));
+        joint->mXform.setWorldTransform(LLVector3(mat.mMatrix[3].getF32ptr()), rot, mat.asMatrix4());
+        joint->mWorldMatrix = mat;
+        joint->mDirtyFlags = 0x0;
+        LLJoint::sNumUpdates++;
+    }
+}
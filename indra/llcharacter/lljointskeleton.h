@@ -0,0 +1,96 @@
+/**
+ * @file lljointskeleton.h
+ * @brief Implementation of LLJointSkeleton class.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLJOINTSKELETON_H
+#define LL_LLJOINTSKELETON_H
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "llmath.h"
+#include "llmatrix4a.h"
+
+#include <vector>
+
+class LLJoint;
+
+//-----------------------------------------------------------------------------
+// class LLJointSkeleton
+// A joint hierarchy flattened into arrays, parents before their children, so
+// that world matrices are computed in one linear pass over contiguous data
+// rather than by LLJoint::updateWorldMatrixChildren() recursing through the
+// joints.
+//
+// The joints remain the place where motions, visual params and attachment
+// overrides set local transforms, and where world transforms are read: an
+// update gathers the local transforms of the dirty joints, computes, then
+// hands each joint the world transform and dirty flags updateWorldMatrix()
+// would have left it with. The flattened order is rebuilt when a joint was
+// added or removed anywhere since, see LLJoint::getTopologySerial().
+//-----------------------------------------------------------------------------
+class LLJointSkeleton
+{
+public:
+    LLJointSkeleton();
+
+    // same result as root->updateWorldMatrixChildren()
+    void updateWorldMatrices(LLJoint* root);
+
+    // joints in update order, the root first
+    S32 getNumJoints() const { return (S32)mJoints.size(); }
+    LLJoint* getJoint(S32 index) const { return mJoints[index]; }
+    // -1 for the root
+    S32 getParentIndex(S32 index) const { return mParents[index]; }
+
+private:
+    void build(LLJoint* root);
+
+    enum EJointState
+    {
+        JOINT_CLEAN,
+        JOINT_DIRTY,
+        // not updated, see LLJoint::mUpdateXform
+        JOINT_SKIPPED
+    };
+
+    LLJoint* mRoot;
+    U32 mTopologySerial;
+
+    std::vector<LLJoint*> mJoints;
+    std::vector<S32> mParents;
+    std::vector<U8> mStates;
+
+    // local transforms of the dirty joints
+    std::vector<LLVector4a> mLocalPositions;
+    std::vector<LLVector4a> mLocalRotations;
+    std::vector<LLVector4a> mScales;
+
+    // world rotations as quaternions, and world matrices
+    std::vector<LLVector4a> mWorldRotations;
+    std::vector<LLMatrix4a> mWorldMatrices;
+};
+
+#endif // LL_LLJOINTSKELETON_H
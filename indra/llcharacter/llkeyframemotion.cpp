@@ -48,6 +48,11 @@
 //-----------------------------------------------------------------------------
 LLKeyframeDataCache::keyframe_data_map_t    LLKeyframeDataCache::sKeyframeDataMap;
 
+// A small fraction of a frame, and of the interval between keys
+const F32 LLKeyframeMotion::POSE_SHARING_TOLERANCE = 0.002f;
+std::atomic<bool> LLKeyframeMotion::sSharePoses(true);
+std::atomic<U32> LLKeyframeMotion::sNumSharedPoses(0);
+
 //-----------------------------------------------------------------------------
 // Globals
 //-----------------------------------------------------------------------------
@@ -73,7 +78,9 @@ LLKeyframeMotion::JointMotionList::JointMotionList()
       mEaseOutDuration(0.f),
       mBasePriority(LLJoint::LOW_PRIORITY),
       mHandPose(LLHandMotion::HAND_POSE_SPREAD),
-      mMaxPriority(LLJoint::LOW_PRIORITY)
+      mMaxPriority(LLJoint::LOW_PRIORITY),
+      mNextSharedPose(0),
+      mNumActiveInstances(0)
 {
 }
 
@@ -116,7 +123,7 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
             total_size += joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey);
         }
     }
-    LL_INFOS() << "Size: " << total_size << " bytes" << LL_ENDL;
+    LL_INFOS() << "Size: " << total_size << " bytes, compact curves " << mCompactCurves.getSize() << " bytes" << LL_ENDL;
 
     return total_size;
 }
@@ -372,6 +379,234 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 }
 
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// CompactCurves class
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+// 16 bit key components are fractions of this
+static const F32 KEY_SCALE = 32767.f;
+
+// four 16 bit key components as floats, still scaled by KEY_SCALE
+static inline LLVector4a load_key(const S16* key)
+{
+    __m128i v = _mm_loadl_epi64((const __m128i*)key);
+    return LLVector4a(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)));
+}
+
+//-----------------------------------------------------------------------------
+// CompactCurves::CompactCurves()
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::CompactCurves::CompactCurves()
+    : mTimeScale(0.f)
+{
+}
+
+//-----------------------------------------------------------------------------
+// CompactCurves::build()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::CompactCurves::build(const std::vector<JointMotion*>& joint_motions, F32 duration)
+{
+    mTimeScale = (duration > 0.f) ? (F32)U16MAX / duration : 0.f;
+    mRotationTracks.clear();
+    mPositionTracks.clear();
+    mRotationTimes.clear();
+    mPositionTimes.clear();
+    mRotationKeys.clear();
+    mPositionKeys.clear();
+
+    std::vector<F32> key_times;
+    for (const JointMotion* joint_motion : joint_motions)
+    {
+        key_times.clear();
+        const RotationCurve& rot_curve = joint_motion->mRotationCurve;
+        if (rot_curve.mNumKeys)
+        {
+            LLQuaternion last_rot;
+            for (const auto& key : rot_curve.mKeys)
+            {
+                LLQuaternion rot = key.second.mRotation;
+                if (dot(rot, last_rot) < 0.f)
+                {
+                    rot = rot * -1.f;
+                }
+                last_rot = rot;
+
+                key_times.push_back(key.first);
+                for (S32 i = 0; i < 4; ++i)
+                {
+                    mRotationKeys.push_back((S16)ll_round(llclamp(rot.mQ[i], -1.f, 1.f) * KEY_SCALE));
+                }
+            }
+        }
+        addTrack(mRotationTracks, mRotationTimes, key_times);
+
+        key_times.clear();
+        const PositionCurve& pos_curve = joint_motion->mPositionCurve;
+        if (pos_curve.mNumKeys)
+        {
+            for (const auto& key : pos_curve.mKeys)
+            {
+                key_times.push_back(key.first);
+                for (S32 i = 0; i < 3; ++i)
+                {
+                    F32 value = llclamp(key.second.mPosition.mV[i] / LL_MAX_PELVIS_OFFSET, -1.f, 1.f);
+                    mPositionKeys.push_back((S16)ll_round(value * KEY_SCALE));
+                }
+                mPositionKeys.push_back(0);
+            }
+        }
+        addTrack(mPositionTracks, mPositionTimes, key_times);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// CompactCurves::addTrack()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::CompactCurves::addTrack(std::vector<Track>& tracks, std::vector<U16>& times, const std::vector<F32>& key_times)
+{
+    Track track;
+    track.mFirstKey = (U32)times.size();
+    track.mNumKeys = (U32)key_times.size();
+    track.mInterval = 0.f;
+
+    for (F32 time : key_times)
+    {
+        times.push_back((U16)llclamp(ll_round(time * mTimeScale), 0, (S32)U16MAX));
+    }
+
+    // Exported animations mostly have a key every frame, give or take the
+    // rounding of their times
+    if (track.mNumKeys > 2)
+    {
+        const U16* key_time = &times[track.mFirstKey];
+        const F32 interval = (F32)(key_time[track.mNumKeys - 1] - key_time[0]) / (F32)(track.mNumKeys - 1);
+        bool regular = interval > 0.f;
+        for (U32 k = 1; regular && k < track.mNumKeys; ++k)
+        {
+            regular = fabsf((F32)(key_time[k] - key_time[0]) - interval * k) <= 1.f;
+        }
+        if (regular)
+        {
+            track.mInterval = interval;
+        }
+    }
+
+    tracks.push_back(track);
+}
+
+//-----------------------------------------------------------------------------
+// CompactCurves::findKey()
+//-----------------------------------------------------------------------------
+// static
+U32 LLKeyframeMotion::CompactCurves::findKey(const Track& track, const U16* times, F32 time, F32& u)
+{
+    u = 0.f;
+    const U32 count = track.mNumKeys;
+
+    // first key at or after 'time', as std::map::lower_bound() in getValue()
+    U32 right;
+    if (track.mInterval > 0.f)
+    {
+        // a key or so off at most
+        right = (U32)llclamp(llfloor((time - times[0]) / track.mInterval), 0, (S32)count - 1);
+        while (right < count && times[right] < time)
+        {
+            ++right;
+        }
+        while (right > 0 && times[right - 1] >= time)
+        {
+            --right;
+        }
+    }
+    else
+    {
+        right = (U32)(std::lower_bound(times, times + count, time,
+                                       [](U16 key_time, F32 t) { return key_time < t; }) - times);
+    }
+
+    if (right == count)
+    {
+        // past last key
+        return count - 1;
+    }
+    if (right == 0 || times[right] == time)
+    {
+        // before first key or exactly on a key
+        return right;
+    }
+    u = (time - times[right - 1]) / (F32)(times[right] - times[right - 1]);
+    return right - 1;
+}
+
+//-----------------------------------------------------------------------------
+// CompactCurves::evaluate()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::CompactCurves::evaluate(F32 time, LLVector4a* rotations, LLVector4a* positions) const
+{
+    const F32 key_time = time * mTimeScale;
+
+    for (U32 i = 0; i < (U32)mRotationTracks.size(); ++i)
+    {
+        const Track& track = mRotationTracks[i];
+        if (!track.mNumKeys)
+        {
+            continue;
+        }
+
+        F32 u;
+        U32 key = findKey(track, &mRotationTimes[track.mFirstKey], key_time, u);
+        const S16* keys = &mRotationKeys[(size_t)(track.mFirstKey + key) * 4];
+        LLVector4a rot = load_key(keys);
+        if (u > 0.f)
+        {
+            LLVector4a delta = load_key(keys + 4);
+            delta.sub(rot);
+            delta.mul(u);
+            rot.add(delta);
+        }
+        // which takes care of KEY_SCALE too
+        rot.normalize4();
+        rotations[i] = rot;
+    }
+
+    for (U32 i = 0; i < (U32)mPositionTracks.size(); ++i)
+    {
+        const Track& track = mPositionTracks[i];
+        if (!track.mNumKeys)
+        {
+            continue;
+        }
+
+        F32 u;
+        U32 key = findKey(track, &mPositionTimes[track.mFirstKey], key_time, u);
+        const S16* keys = &mPositionKeys[(size_t)(track.mFirstKey + key) * 4];
+        LLVector4a pos = load_key(keys);
+        if (u > 0.f)
+        {
+            LLVector4a delta = load_key(keys + 4);
+            delta.sub(pos);
+            delta.mul(u);
+            pos.add(delta);
+        }
+        pos.mul(LL_MAX_PELVIS_OFFSET / KEY_SCALE);
+        positions[i] = pos;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// CompactCurves::getSize()
+//-----------------------------------------------------------------------------
+U32 LLKeyframeMotion::CompactCurves::getSize() const
+{
+    return (U32)(sizeof(CompactCurves) +
+                 (mRotationTracks.size() + mPositionTracks.size()) * sizeof(Track) +
+                 (mRotationTimes.size() + mPositionTimes.size()) * sizeof(U16) +
+                 (mRotationKeys.size() + mPositionKeys.size()) * sizeof(S16));
+}
+
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // JointMotion class
@@ -436,7 +671,8 @@ LLKeyframeMotion::LLKeyframeMotion(const LLUUID &id)
         mLastSkeletonSerialNum(0),
         mLastUpdateTime(0.f),
         mLastLoopedTime(0.f),
-        mAssetStatus(ASSET_UNDEFINED)
+        mAssetStatus(ASSET_UNDEFINED),
+        mCountedActive(false)
 {
 
 }
@@ -448,6 +684,11 @@ LLKeyframeMotion::LLKeyframeMotion(const LLUUID &id)
 //-----------------------------------------------------------------------------
 LLKeyframeMotion::~LLKeyframeMotion()
 {
+    // Motion controllers delete their motions without deactivating them
+    if (mCountedActive)
+    {
+        mJointMotionList->mNumActiveInstances--;
+    }
     for_each(mConstraints.begin(), mConstraints.end(), DeletePointer());
     mConstraints.clear();
 }
@@ -675,6 +916,12 @@ bool LLKeyframeMotion::onActivate()
 
     mLastLoopedTime = 0.f;
 
+    if (!mCountedActive)
+    {
+        mJointMotionList->mNumActiveInstances++;
+        mCountedActive = true;
+    }
+
     return true;
 }
 
@@ -730,17 +977,63 @@ bool LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
     return mLastLoopedTime <= mJointMotionList->mDuration;
 }
 
+//-----------------------------------------------------------------------------
+// LLKeyframeMotion::canUpdateOnJobThread()
+//-----------------------------------------------------------------------------
+bool LLKeyframeMotion::canUpdateOnJobThread() const
+{
+    if (mJointMotionList)
+    {
+        // LLCharacter::getGround() looks into the world
+        for (const JointConstraintSharedData* shared_constraintp : mJointMotionList->mConstraints)
+        {
+            if (shared_constraintp->mConstraintTargetType == CONSTRAINT_TARGET_TYPE_GROUND)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // applyKeyframes()
 //-----------------------------------------------------------------------------
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
-    llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
-    for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
+    const U32 num_joint_motions = mJointMotionList->getNumJointMotions();
+    llassert_always (num_joint_motions <= mJointStates.size());
+
+    // Sample all the joints at once, then hand the values out as
+    // JointMotion::update() would. Joint usage, priorities and constraints
+    // are this instance's own even when the samples are shared.
+    const CompactCurves& curves = mJointMotionList->mCompactCurves;
+    sampleKeyframes(time);
+
+    for (U32 i = 0; i < num_joint_motions; i++)
     {
-        mJointMotionList->getJointMotion(i)->update(mJointStates[i],
-                                                      time,
-                                                      mJointMotionList->mDuration );
+        LLJointState* joint_state = mJointStates[i];
+        if (!joint_state)
+        {
+            continue;
+        }
+        U32 usage = joint_state->getUsage();
+
+        if ((usage & LLJointState::ROT) && curves.hasRotation(i))
+        {
+            const F32* rot = mSampledRotations[i].getF32ptr();
+            LLQuaternion rotation;
+            rotation.mQ[VX] = rot[VX];
+            rotation.mQ[VY] = rot[VY];
+            rotation.mQ[VZ] = rot[VZ];
+            rotation.mQ[VW] = rot[VW];
+            joint_state->setRotation(rotation);
+        }
+
+        if ((usage & LLJointState::POS) && curves.hasPosition(i))
+        {
+            joint_state->setPosition(LLVector3(mSampledPositions[i].getF32ptr()));
+        }
     }
 
     LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
@@ -759,6 +1052,59 @@ void LLKeyframeMotion::applyKeyframes(F32 time)
     }
 }
 
+//-----------------------------------------------------------------------------
+// sampleKeyframes()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::sampleKeyframes(F32 time)
+{
+    JointMotionList* joint_motion_list = mJointMotionList;
+    const U32 num_joint_motions = joint_motion_list->getNumJointMotions();
+    mSampledRotations.resize(num_joint_motions);
+    mSampledPositions.resize(num_joint_motions);
+
+    // Dance HUDs start an animation on many avatars at once, which then
+    // sample it at nearly the same time every frame. Avatars are animated
+    // on several threads: rather than wait for the poses, evaluate.
+    const bool share = sSharePoses.load(std::memory_order_relaxed)
+        && joint_motion_list->mNumActiveInstances.load(std::memory_order_relaxed) > 1;
+    if (share)
+    {
+        LLMutexTrylock lock(&joint_motion_list->mSharedPoseMutex);
+        if (lock.isLocked())
+        {
+            for (const JointMotionList::SharedPose& pose : joint_motion_list->mSharedPoses)
+            {
+                // Poses are shared between instances, an instance that
+                // samples the same time again evaluates it again
+                if (pose.mOwner != this && fabsf(pose.mTime - time) <= POSE_SHARING_TOLERANCE)
+                {
+                    mSampledRotations = pose.mRotations;
+                    mSampledPositions = pose.mPositions;
+                    sNumSharedPoses++;
+                    return;
+                }
+            }
+        }
+    }
+
+    joint_motion_list->mCompactCurves.evaluate(time, mSampledRotations.data(), mSampledPositions.data());
+
+    if (!share)
+    {
+        return;
+    }
+    LLMutexTrylock lock(&joint_motion_list->mSharedPoseMutex);
+    if (lock.isLocked())
+    {
+        JointMotionList::SharedPose& pose = joint_motion_list->mSharedPoses[joint_motion_list->mNextSharedPose];
+        joint_motion_list->mNextSharedPose = (joint_motion_list->mNextSharedPose + 1) % JointMotionList::NUM_SHARED_POSES;
+        pose.mTime = time;
+        pose.mOwner = this;
+        pose.mRotations = mSampledRotations;
+        pose.mPositions = mSampledPositions;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // applyConstraints()
 //-----------------------------------------------------------------------------
@@ -788,6 +1134,12 @@ void LLKeyframeMotion::applyConstraints(F32 time, U8* joint_mask)
 //-----------------------------------------------------------------------------
 void LLKeyframeMotion::onDeactivate()
 {
+    if (mCountedActive)
+    {
+        mJointMotionList->mNumActiveInstances--;
+        mCountedActive = false;
+    }
+
     for (JointConstraint* constraintp : mConstraints)
     {
         deactivateConstraint(constraintp);
@@ -2030,6 +2382,8 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         }
     }
 
+    joint_motion_list->mCompactCurves.build(joint_motion_list->mJointMotionArray, joint_motion_list->mDuration);
+
     // *FIX: support cleanup of old keyframe data
     mJointMotionList = joint_motion_list.release(); // release from unique_ptr to member;
     LLKeyframeDataCache::addKeyframeData(getID(),  mJointMotionList);
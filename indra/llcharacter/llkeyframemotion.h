@@ -31,6 +31,7 @@
 // Header files
 //-----------------------------------------------------------------------------
 
+#include <atomic>
 #include <string>
 
 #include "llassetstorage.h"
@@ -38,7 +39,9 @@
 #include "llhandmotion.h"
 #include "lljointstate.h"
 #include "llmotion.h"
+#include "llmutex.h"
 #include "llquaternion.h"
+#include "llvector4a.h"
 #include "v3dmath.h"
 #include "v3math.h"
 #include "llbvhconsts.h"
@@ -144,6 +147,9 @@ public:
     // must return false when the motion is completed.
     virtual bool onUpdate(F32 time, U8* joint_mask);
 
+    // unless a constraint has to look for the ground
+    virtual bool canUpdateOnJobThread() const;
+
     // called when a motion is deactivated
     virtual void onDeactivate();
 
@@ -198,6 +204,14 @@ public:
 
     static void flushKeyframeCache();
 
+    // Instances playing the same animation within this many seconds of one
+    // another reuse a single sampled pose
+    static const F32 POSE_SHARING_TOLERANCE;
+    static std::atomic<bool> sSharePoses;
+    // Poses reused from another instance rather than sampled again, until
+    // the viewer's statistics take and reset the count every frame
+    static std::atomic<U32> sNumSharedPoses;
+
 protected:
     //-------------------------------------------------------------------------
     // JointConstraintSharedData
@@ -261,6 +275,9 @@ protected:
 
     void applyKeyframes(F32 time);
 
+    // fills mSampledRotations and mSampledPositions
+    void sampleKeyframes(F32 time);
+
     void applyConstraints(F32 time, U8* joint_mask);
 
     void activateConstraint(JointConstraint* constraintp);
@@ -390,6 +407,62 @@ public:
         void update(LLJointState* joint_state, F32 time, F32 duration);
     };
 
+    //-------------------------------------------------------------------------
+    // CompactCurves
+    // The rotation and position curves of all the joint motions of an
+    // animation as quantized keys in shared arrays, built once when the asset
+    // is deserialized and only read after, by any number of motions on any
+    // thread. evaluate() samples every joint motion at one time with the
+    // same key lookup as the curves' getValue().
+    //
+    // Key times are 16 bit fractions of the duration. Rotations are 16 bit
+    // quaternions flipped into the hemisphere of the key before, so that
+    // neighbours lerp along the short arc as nlerp() would. Positions are 16
+    // bit within LL_MAX_PELVIS_OFFSET. Curves whose keys come at regular
+    // intervals find their keys without a search. The asset format has no
+    // scale keys.
+    //-------------------------------------------------------------------------
+    class CompactCurves
+    {
+    public:
+        CompactCurves();
+
+        void build(const std::vector<JointMotion*>& joint_motions, F32 duration);
+
+        bool hasRotation(U32 index) const { return mRotationTracks[index].mNumKeys > 0; }
+        bool hasPosition(U32 index) const { return mPositionTracks[index].mNumKeys > 0; }
+
+        // rotations and positions hold an entry per joint motion; those
+        // without such a curve are left alone. Rotations come out normalized.
+        void evaluate(F32 time, LLVector4a* rotations, LLVector4a* positions) const;
+
+        U32 getSize() const;
+
+    private:
+        struct Track
+        {
+            U32 mFirstKey;
+            U32 mNumKeys;
+            // in time units, 0 unless the keys come at regular intervals
+            F32 mInterval;
+        };
+
+        void addTrack(std::vector<Track>& tracks, std::vector<U16>& times, const std::vector<F32>& key_times);
+        // index of the key at or before 'time', and how far towards the next
+        // key, 0 when on a key or outside of the curve
+        static U32 findKey(const Track& track, const U16* times, F32 time, F32& u);
+
+        // time units per second
+        F32                 mTimeScale;
+        std::vector<Track>  mRotationTracks;
+        std::vector<Track>  mPositionTracks;
+        std::vector<U16>    mRotationTimes;
+        std::vector<U16>    mPositionTimes;
+        // 4 per key
+        std::vector<S16>    mRotationKeys;
+        std::vector<S16>    mPositionKeys;
+    };
+
     //-------------------------------------------------------------------------
     // JointMotionList
     //-------------------------------------------------------------------------
@@ -397,6 +470,27 @@ public:
     {
     public:
         std::vector<JointMotion*> mJointMotionArray;
+        // what applyKeyframes() samples
+        CompactCurves           mCompactCurves;
+
+        // The last few poses sampled from mCompactCurves, for instances
+        // playing in step with one another, see sampleKeyframes(). Only
+        // kept while more than one instance is active.
+        struct SharedPose
+        {
+            SharedPose() : mTime(-1.f), mOwner(NULL) {}
+            F32                     mTime;
+            // the instance that sampled it, which does not count as sharing
+            const LLKeyframeMotion* mOwner;
+            std::vector<LLVector4a> mRotations;
+            std::vector<LLVector4a> mPositions;
+        };
+        static const U32        NUM_SHARED_POSES = 4;
+        LLMutex                 mSharedPoseMutex;
+        SharedPose              mSharedPoses[NUM_SHARED_POSES];
+        U32                     mNextSharedPose;
+        std::atomic<S32>        mNumActiveInstances;
+
         F32                     mDuration;
         bool                    mLoop;
         F32                     mLoopInPoint;
@@ -434,6 +528,11 @@ protected:
     F32                             mLastUpdateTime;
     F32                             mLastLoopedTime;
     AssetStatus                     mAssetStatus;
+    // counted in mJointMotionList->mNumActiveInstances
+    bool                            mCountedActive;
+    // mJointMotionList->mCompactCurves sampled by applyKeyframes()
+    std::vector<LLVector4a>         mSampledRotations;
+    std::vector<LLVector4a>         mSampledPositions;
 
 public:
     void setCharacter(LLCharacter* character) { mCharacter = character; }
@@ -66,6 +66,8 @@ public:
     virtual bool onActivate();
     void    onDeactivate();
     virtual bool onUpdate(F32 time, U8* joint_mask);
+    // looks for the ground under the feet
+    virtual bool canUpdateOnJobThread() const { return false; }
 
 public:
     //-------------------------------------------------------------------------
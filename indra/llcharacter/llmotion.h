@@ -156,6 +156,11 @@ public:
     // requires this
     virtual bool canDeprecate();
 
+    // can onUpdate() run on a job thread while the main thread waits?
+    // it may then only change this motion, and its character's joints and
+    // animation data, see LLMotionController::updateMotions()
+    virtual bool canUpdateOnJobThread() const { return false; }
+
     // optional callback routine called when animation deactivated.
     void    setDeactivateCallback( void (*cb)(void *), void* userdata );
 
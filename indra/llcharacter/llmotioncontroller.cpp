@@ -37,6 +37,8 @@
 #include "llanimationstates.h"
 #include "llstl.h"
 
+#include <algorithm>
+
 // This is why LL_CHARACTER_MAX_ANIMATED_JOINTS needs to be a multiple of 4.
 const S32 NUM_JOINT_SIGNATURE_STRIDES = LL_CHARACTER_MAX_ANIMATED_JOINTS / 4;
 const U32 MAX_MOTION_INSTANCES = 32;
@@ -140,6 +142,8 @@ LLMotionController::LLMotionController()
       mTimeStepCount(0),
       mLastInterp(0.f),
       mIsSelf(false),
+      mDeferEvaluation(false),
+      mDeferredBlend(BLEND_NONE),
       mLastCountAfterPurge(0)
 {
 }
@@ -171,6 +175,8 @@ void LLMotionController::deleteAllMotions()
     mLoadingMotions.clear();
     mLoadedMotions.clear();
     mActiveMotions.clear();
+    mDeferredUpdates.clear();
+    mDeferredBlend = BLEND_NONE;
 
     for_each(mAllMotions.begin(), mAllMotions.end(), DeletePairedPointer());
     mAllMotions.clear();
@@ -651,7 +657,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 // if not, let's stop it this time through and deactivate it the next
 
                 posep->setWeight(motionp->getFadeWeight());
-                motionp->onUpdate(motionp->getStopTime() - motionp->mActivationTimestamp, last_joint_signature);
+                updateMotionInstance(motionp, motionp->getStopTime() - motionp->mActivationTimestamp, last_joint_signature);
             }
             else
             {
@@ -683,7 +689,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
             }
 
             // perform motion update
-            update_result = motionp->onUpdate(mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
+            update_result = updateMotionInstance(motionp, mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
         }
 
         //**********************
@@ -707,7 +713,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 
             // perform motion update
             {
-                update_result = motionp->onUpdate(mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
+                update_result = updateMotionInstance(motionp, mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
             }
         }
 
@@ -730,12 +736,12 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 posep->setWeight(motionp->getFadeWeight() * motionp->mResidualWeight + (1.f - motionp->mResidualWeight) * cubic_step((mAnimTime - motionp->mActivationTimestamp) / motionp->getEaseInDuration()));
             }
             // perform motion update
-            update_result = motionp->onUpdate(mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
+            update_result = updateMotionInstance(motionp, mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
         }
         else
         {
             posep->setWeight(0.f);
-            update_result = motionp->onUpdate(0.f, last_joint_signature);
+            update_result = updateMotionInstance(motionp, 0.f, last_joint_signature);
         }
 
         // allow motions to deactivate themselves
@@ -757,6 +763,26 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
     }
 }
 
+//-----------------------------------------------------------------------------
+// updateMotionInstance()
+//-----------------------------------------------------------------------------
+bool LLMotionController::updateMotionInstance(LLMotion* motionp, F32 time, U8* joint_mask)
+{
+    if (!mDeferEvaluation || !motionp->canUpdateOnJobThread())
+    {
+        return motionp->onUpdate(time, joint_mask);
+    }
+
+    // the joint mask is changed by the motions which follow
+    DeferredUpdate update;
+    update.mMotion = motionp;
+    update.mTime = time;
+    update.mResult = true;
+    memcpy(update.mJointMask, joint_mask, sizeof(U8) * LL_CHARACTER_MAX_ANIMATED_JOINTS);
+    mDeferredUpdates.push_back(update);
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 // updateLoadingMotions()
 //-----------------------------------------------------------------------------
@@ -808,7 +834,7 @@ void LLMotionController::updateLoadingMotions()
 //-----------------------------------------------------------------------------
 // updateMotion()
 //-----------------------------------------------------------------------------
-void LLMotionController::updateMotions(bool force_update)
+void LLMotionController::updateMotions(bool force_update, bool defer_evaluation)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     // SL-763: "Distant animated objects run at super fast speed"
@@ -875,6 +901,8 @@ void LLMotionController::updateMotions(bool force_update)
     }
     else
     {
+        mDeferEvaluation = defer_evaluation;
+
         // update additive motions
         updateAdditiveMotions();
 
@@ -883,7 +911,12 @@ void LLMotionController::updateMotions(bool force_update)
         // update all regular motions
         updateRegularMotions();
 
-        if (use_quantum)
+        if (mDeferEvaluation)
+        {
+            mDeferredBlend = use_quantum ? BLEND_AND_CACHE : BLEND_AND_APPLY;
+            mDeferEvaluation = false;
+        }
+        else if (use_quantum)
         {
             mPoseBlender.blendAndCache(true);
         }
@@ -897,6 +930,49 @@ void LLMotionController::updateMotions(bool force_update)
 //  LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
 }
 
+//-----------------------------------------------------------------------------
+// evaluateDeferredMotions()
+// only touches this character's motions and joints
+//-----------------------------------------------------------------------------
+void LLMotionController::evaluateDeferredMotions()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    for (DeferredUpdate& update : mDeferredUpdates)
+    {
+        update.mResult = update.mMotion->onUpdate(update.mTime, update.mJointMask);
+    }
+
+    if (mDeferredBlend == BLEND_AND_CACHE)
+    {
+        mPoseBlender.blendAndCache(true);
+    }
+    else if (mDeferredBlend == BLEND_AND_APPLY)
+    {
+        mPoseBlender.blendAndApply();
+    }
+    mDeferredBlend = BLEND_NONE;
+}
+
+//-----------------------------------------------------------------------------
+// finishDeferredMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::finishDeferredMotions()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    for (const DeferredUpdate& update : mDeferredUpdates)
+    {
+        // as updateMotionsByType() does for the motions it updates itself
+        LLMotion* motionp = update.mMotion;
+        if (!update.mResult && (!motionp->isStopped() || motionp->getStopTime() > mAnimTime))
+        {
+            mCharacter->requestStopMotion(motionp);
+            stopMotionInstance(motionp, false);
+        }
+    }
+    mDeferredUpdates.clear();
+    mDeferredBlend = BLEND_NONE;
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
@@ -988,6 +1064,14 @@ bool LLMotionController::deactivateMotionInstance(LLMotion *motion)
 {
     motion->deactivate();
 
+    if (!mDeferredUpdates.empty())
+    {
+        // stopped before its deferred update
+        mDeferredUpdates.erase(std::remove_if(mDeferredUpdates.begin(), mDeferredUpdates.end(),
+                                              [motion](const DeferredUpdate& update) { return update.mMotion == motion; }),
+                               mDeferredUpdates.end());
+    }
+
     motion_set_t::iterator found_it = mDeprecatedMotions.find(motion);
     if (found_it != mDeprecatedMotions.end())
     {
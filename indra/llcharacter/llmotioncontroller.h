@@ -33,6 +33,7 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include "llmotion.h"
 #include "llpose.h"
@@ -130,7 +131,13 @@ public:
     // invokes the update handlers for each active motion
     // activates sequenced motions
     // deactivates terminated motions`
-    void updateMotions(bool force_update = false);
+    // with defer_evaluation, leaves the update handlers of the motions which
+    // can run on a job thread, and the pose blending, to
+    // evaluateDeferredMotions(), which may then run alongside that of other
+    // characters, and finishDeferredMotions() back on the main thread
+    void updateMotions(bool force_update = false, bool defer_evaluation = false);
+    void evaluateDeferredMotions();
+    void finishDeferredMotions();
 
     // minimal update (e.g. while hidden)
     void updateMotionsMinimal();
@@ -187,6 +194,7 @@ protected:
     void updateAdditiveMotions();
     void resetJointSignatures();
     void updateMotionsByType(LLMotion::LLMotionBlendType motion_type);
+    bool updateMotionInstance(LLMotion* motionp, F32 time, U8* joint_mask);
     void updateIdleMotion(LLMotion* motionp);
     void updateIdleActiveMotions();
     void purgeExcessMotions();
@@ -228,6 +236,19 @@ protected:
     F32                 mLastInterp;
 
     U8                  mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
+
+    // motion updates left to evaluateDeferredMotions()
+    struct DeferredUpdate
+    {
+        LLMotion*       mMotion;
+        F32             mTime;
+        bool            mResult;
+        U8              mJointMask[LL_CHARACTER_MAX_ANIMATED_JOINTS];
+    };
+    std::vector<DeferredUpdate> mDeferredUpdates;
+    bool                mDeferEvaluation;
+    enum EDeferredBlend { BLEND_NONE, BLEND_AND_APPLY, BLEND_AND_CACHE };
+    EDeferredBlend      mDeferredBlend;
 private:
     U32                 mLastCountAfterPurge; //for logging and debugging purposes
 };
@@ -0,0 +1,285 @@
+/**
+ * @file lljointskeleton_test.cpp
+ * @brief LLJointSkeleton test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lljoint.h"
+#include "../lljointskeleton.h"
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <memory>
+
+namespace
+{
+    // About as many joints as an avatar has bones, collision volumes and
+    // attachment points, in chains as deep as a finger's.
+    const S32 NUM_JOINTS = 214;
+
+    class LLTestSkeleton
+    {
+    public:
+        LLTestSkeleton()
+        {
+            // the same made up skeleton every time
+            U32 seed = 1;
+            auto next = [&seed]()
+            {
+                seed = seed * 1664525 + 1013904223;
+                return (F32)(seed >> 8) / (F32)(1 << 24);
+            };
+
+            mRoot.reset(new LLJoint());
+            mRoot->setName("mRoot");
+            for (S32 i = 0; i < NUM_JOINTS; ++i)
+            {
+                LLJoint* joint = new LLJoint();
+                joint->setName(llformat("mJoint%d", i));
+                joint->setPosition(LLVector3(next() - 0.5f, next() - 0.5f, next() - 0.5f) * 0.2f);
+                joint->setRotation(LLQuaternion(next() * F_PI, LLVector3(next(), next(), next() + 0.1f)));
+                joint->setScale(LLVector3(0.8f + 0.4f * next(), 0.8f + 0.4f * next(), 0.8f + 0.4f * next()));
+                joint->setDefaultPosition(joint->getPosition());
+                joint->setDefaultScale(joint->getScale());
+
+                // mostly chains, some branching
+                LLJoint* parent = mRoot.get();
+                if (i > 0)
+                {
+                    parent = (next() < 0.6f) ? mJoints.back().get() : mJoints[(S32)(next() * i)].get();
+                }
+                parent->addChild(joint);
+                mJoints.emplace_back(joint);
+            }
+        }
+
+        LLJoint* getRoot() { return mRoot.get(); }
+        LLJoint* getJoint(S32 i) { return mJoints[i].get(); }
+
+        // as motions do every frame
+        void animate(F32 time)
+        {
+            for (S32 i = 0; i < NUM_JOINTS; ++i)
+            {
+                mJoints[i]->setRotation(LLQuaternion(0.5f * sinf(time + i), LLVector3::z_axis));
+            }
+        }
+
+        // a position and a scale override on every joint, from a few meshes
+        void addOverrides()
+        {
+            bool changed;
+            for (S32 m = 0; m < 3; ++m)
+            {
+                LLUUID mesh_id;
+                mesh_id.generate();
+                for (S32 i = 0; i < NUM_JOINTS; ++i)
+                {
+                    LLJoint* joint = mJoints[i].get();
+                    joint->addAttachmentPosOverride(joint->getDefaultPosition() * (1.1f + 0.1f * m), mesh_id, "", changed);
+                    joint->addAttachmentScaleOverride(joint->getDefaultScale() * (0.9f + 0.1f * m), mesh_id, "");
+                }
+            }
+        }
+
+        // as visual params do when the shape changes
+        void applyDefaults()
+        {
+            for (S32 i = 0; i < NUM_JOINTS; ++i)
+            {
+                LLJoint* joint = mJoints[i].get();
+                joint->setPosition(joint->getDefaultPosition(), true);
+                joint->setScale(joint->getDefaultScale(), true);
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<LLJoint> > mJoints;
+        std::unique_ptr<LLJoint> mRoot;
+    };
+
+    void ensure_same_world_transforms(LLTestSkeleton& expected, LLTestSkeleton& actual)
+    {
+        for (S32 i = 0; i < NUM_JOINTS; ++i)
+        {
+            LLJoint* expected_joint = expected.getJoint(i);
+            LLJoint* actual_joint = actual.getJoint(i);
+            tut::ensure_equals("dirty flags", actual_joint->mDirtyFlags, expected_joint->mDirtyFlags);
+            if (expected_joint->mDirtyFlags)
+            {
+                continue;
+            }
+
+            const std::string msg = llformat("joint %d", i);
+            const LLMatrix4& expected_mat = expected_joint->getWorldMatrix();
+            const LLMatrix4& actual_mat = actual_joint->getWorldMatrix();
+            const LLMatrix4a& actual_mat4a = actual_joint->getWorldMatrix4a();
+            const LLQuaternion expected_rot = expected_joint->getWorldRotation();
+            const LLQuaternion actual_rot = actual_joint->getWorldRotation();
+            const LLVector3 expected_pos = expected_joint->getWorldPosition();
+            const LLVector3 actual_pos = actual_joint->getWorldPosition();
+            for (S32 k = 0; k < 4; ++k)
+            {
+                for (S32 l = 0; l < 4; ++l)
+                {
+                    tut::ensure_approximately_equals(msg, actual_mat.mMatrix[k][l], expected_mat.mMatrix[k][l], 16);
+                    tut::ensure_approximately_equals(msg, actual_mat4a.mMatrix[k][l], expected_mat.mMatrix[k][l], 16);
+                }
+                tut::ensure_approximately_equals(msg, actual_rot.mQ[k], expected_rot.mQ[k], 16);
+            }
+            for (S32 k = 0; k < 3; ++k)
+            {
+                tut::ensure_approximately_equals(msg, actual_pos.mV[k], expected_pos.mV[k], 16);
+            }
+        }
+    }
+
+    // Updates per second, through either path
+    F64 time_updates(LLTestSkeleton& skeleton, LLJointSkeleton* flattened, bool overrides)
+    {
+        const S32 UPDATES = 20000;
+        LLTimer timer;
+        for (S32 n = 0; n < UPDATES; ++n)
+        {
+            skeleton.animate(0.01f * n);
+            if (overrides)
+            {
+                skeleton.applyDefaults();
+            }
+            if (flattened)
+            {
+                flattened->updateWorldMatrices(skeleton.getRoot());
+            }
+            else
+            {
+                skeleton.getRoot()->updateWorldMatrixChildren();
+            }
+        }
+        return UPDATES / timer.getElapsedTimeF64();
+    }
+}
+
+namespace tut
+{
+    struct jointskeleton_data
+    {
+    };
+    typedef test_group<jointskeleton_data> jointskeleton_test;
+    typedef jointskeleton_test::object jointskeleton_object;
+    tut::jointskeleton_test jointskeleton_testcase("LLJointSkeleton");
+
+    template<> template<>
+    void jointskeleton_object::test<1>()
+    {
+        // Whole skeleton, then some joints, as the recursive update does
+        LLTestSkeleton expected, actual;
+        LLJointSkeleton flattened;
+
+        expected.getRoot()->setPosition(LLVector3(1.f, 2.f, 0.5f));
+        actual.getRoot()->setPosition(LLVector3(1.f, 2.f, 0.5f));
+        expected.getRoot()->updateWorldMatrixChildren();
+        flattened.updateWorldMatrices(actual.getRoot());
+        ensure_equals("joints", flattened.getNumJoints(), NUM_JOINTS + 1);
+        ensure_same_world_transforms(expected, actual);
+
+        for (S32 i = 0; i < NUM_JOINTS; i += 7)
+        {
+            expected.getJoint(i)->setRotation(LLQuaternion(0.3f, LLVector3::x_axis));
+            actual.getJoint(i)->setRotation(LLQuaternion(0.3f, LLVector3::x_axis));
+        }
+        expected.getRoot()->updateWorldMatrixChildren();
+        flattened.updateWorldMatrices(actual.getRoot());
+        ensure_same_world_transforms(expected, actual);
+    }
+
+    template<> template<>
+    void jointskeleton_object::test<2>()
+    {
+        // Joints that aren't updated, and their children, stay dirty
+        LLTestSkeleton expected, actual;
+        LLJointSkeleton flattened;
+
+        expected.getJoint(20)->mUpdateXform = false;
+        actual.getJoint(20)->mUpdateXform = false;
+        expected.getRoot()->updateWorldMatrixChildren();
+        flattened.updateWorldMatrices(actual.getRoot());
+        ensure("skipped", actual.getJoint(20)->mDirtyFlags != 0);
+        ensure_same_world_transforms(expected, actual);
+    }
+
+    template<> template<>
+    void jointskeleton_object::test<3>()
+    {
+        // Added joints are picked up
+        LLTestSkeleton expected, actual;
+        LLJointSkeleton flattened;
+        flattened.updateWorldMatrices(actual.getRoot());
+
+        LLJoint expected_joint, actual_joint;
+        expected_joint.setPosition(LLVector3(0.1f, 0.2f, 0.3f));
+        actual_joint.setPosition(LLVector3(0.1f, 0.2f, 0.3f));
+        expected.getJoint(40)->addChild(&expected_joint);
+        actual.getJoint(40)->addChild(&actual_joint);
+
+        expected.getRoot()->updateWorldMatrixChildren();
+        flattened.updateWorldMatrices(actual.getRoot());
+        ensure_equals("joints", flattened.getNumJoints(), NUM_JOINTS + 2);
+        ensure_equals("dirty flags", actual_joint.mDirtyFlags, 0U);
+        const LLVector3 expected_pos = expected_joint.getWorldPosition();
+        const LLVector3 actual_pos = actual_joint.getWorldPosition();
+        for (S32 k = 0; k < 3; ++k)
+        {
+            ensure_approximately_equals("added joint", actual_pos.mV[k], expected_pos.mV[k], 16);
+        }
+
+        expected.getJoint(40)->removeChild(&expected_joint);
+        actual.getJoint(40)->removeChild(&actual_joint);
+        flattened.updateWorldMatrices(actual.getRoot());
+        ensure_equals("joints", flattened.getNumJoints(), NUM_JOINTS + 1);
+    }
+
+    template<> template<>
+    void jointskeleton_object::test<4>()
+    {
+        // Skeleton updates per second, animated, and animated with position
+        // and scale overrides on every joint. Not a pass/fail test.
+        skip_unless_benchmarking();
+        LLTestSkeleton skeleton;
+        LLJointSkeleton flattened;
+
+        LL_INFOS() << "Default skeleton, recursive: "
+                   << llformat("%.0f updates/s", time_updates(skeleton, NULL, false))
+                   << ", flattened: " << llformat("%.0f updates/s", time_updates(skeleton, &flattened, false))
+                   << LL_ENDL;
+
+        skeleton.addOverrides();
+        LL_INFOS() << "Overridden skeleton, recursive: "
+                   << llformat("%.0f updates/s", time_updates(skeleton, NULL, true))
+                   << ", flattened: " << llformat("%.0f updates/s", time_updates(skeleton, &flattened, true))
+                   << LL_ENDL;
+    }
+}
@@ -0,0 +1,218 @@
+/**
+ * @file llkeyframemotion_test.cpp
+ * @brief LLKeyframeMotion test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llkeyframemotion.h"
+
+#include "llquantize.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+    typedef LLKeyframeMotion::JointMotion JointMotion;
+    typedef LLKeyframeMotion::JointMotionList JointMotionList;
+
+    // Keys as LLKeyframeMotion::deserialize() would read them: times that
+    // are 16 bit fractions of the duration, one rotation curve per joint and
+    // a position curve for the first. Irregular curves skip some frames.
+    JointMotionList* make_animation(S32 num_joints, F32 duration, F32 fps, bool irregular)
+    {
+        JointMotionList* list = new JointMotionList();
+        list->mDuration = duration;
+
+        const S32 num_frames = (S32)(duration * fps) + 1;
+        for (S32 j = 0; j < num_joints; ++j)
+        {
+            JointMotion* joint_motion = new JointMotion();
+            joint_motion->mJointName = llformat("mJoint%d", j);
+            joint_motion->mUsage = LLJointState::ROT;
+            const LLVector3 axis(j % 3 == 0 ? 1.f : 0.f, j % 3 == 1 ? 1.f : 0.f, j % 3 == 2 ? 1.f : 0.f);
+            for (S32 f = 0; f < num_frames; ++f)
+            {
+                if (irregular && (f % 7 == 3 || f % 11 == 5))
+                {
+                    continue;
+                }
+                const F32 time = U16_to_F32(F32_to_U16(duration * f / (num_frames - 1), 0.f, duration), 0.f, duration);
+                const F32 angle = 1.2f * sinf(F_TWO_PI * time / duration * 3.f + j);
+                LLKeyframeMotion::RotationKey rot_key(time, LLQuaternion(angle, axis));
+                joint_motion->mRotationCurve.mKeys[time] = rot_key;
+
+                if (j == 0)
+                {
+                    LLVector3 pos(0.1f * sinf(time), 0.f, 0.05f * cosf(F_TWO_PI * time / duration * 2.f));
+                    joint_motion->mPositionCurve.mKeys[time] = LLKeyframeMotion::PositionKey(time, pos);
+                }
+            }
+            joint_motion->mRotationCurve.mNumKeys = (S32)joint_motion->mRotationCurve.mKeys.size();
+            joint_motion->mPositionCurve.mNumKeys = (S32)joint_motion->mPositionCurve.mKeys.size();
+            if (j == 0)
+            {
+                joint_motion->mUsage |= LLJointState::POS;
+            }
+            list->mJointMotionArray.push_back(joint_motion);
+        }
+
+        list->mCompactCurves.build(list->mJointMotionArray, duration);
+        return list;
+    }
+
+    void ensure_same_samples(JointMotionList* list, F32 time)
+    {
+        const U32 count = list->getNumJointMotions();
+        std::vector<LLVector4a> rotations(count), positions(count);
+        list->mCompactCurves.evaluate(time, rotations.data(), positions.data());
+
+        for (U32 i = 0; i < count; ++i)
+        {
+            JointMotion* joint_motion = list->getJointMotion(i);
+            const std::string msg = llformat("joint %d at %f", i, time);
+
+            tut::ensure(msg, list->mCompactCurves.hasRotation(i));
+            LLQuaternion expected = joint_motion->mRotationCurve.getValue(time, list->mDuration);
+            LLQuaternion actual(rotations[i].getF32ptr());
+            // the same rotation, whichever the sign
+            if (dot(expected, actual) < 0.f)
+            {
+                actual = actual * -1.f;
+            }
+            for (S32 k = 0; k < 4; ++k)
+            {
+                tut::ensure_approximately_equals(msg, actual.mQ[k], expected.mQ[k], 12);
+            }
+
+            tut::ensure_equals(msg, list->mCompactCurves.hasPosition(i), joint_motion->mPositionCurve.mNumKeys != 0);
+            if (joint_motion->mPositionCurve.mNumKeys)
+            {
+                LLVector3 expected_pos = joint_motion->mPositionCurve.getValue(time, list->mDuration);
+                LLVector3 actual_pos(positions[i].getF32ptr());
+                for (S32 k = 0; k < 3; ++k)
+                {
+                    tut::ensure_approximately_equals(msg, actual_pos.mV[k], expected_pos.mV[k], 12);
+                }
+            }
+        }
+    }
+}
+
+namespace tut
+{
+    struct keyframemotion_data
+    {
+    };
+    typedef test_group<keyframemotion_data> keyframemotion_test;
+    typedef keyframemotion_test::object keyframemotion_object;
+    tut::keyframemotion_test keyframemotion_testcase("LLKeyframeMotion");
+
+    template<> template<>
+    void keyframemotion_object::test<1>()
+    {
+        // Compact curves sample as the key maps do, between keys, on keys
+        // and outside of the curves
+        for (S32 irregular = 0; irregular < 2; ++irregular)
+        {
+            std::unique_ptr<JointMotionList> list(make_animation(8, 4.f, 30.f, irregular));
+            for (F32 time = -0.5f; time < 4.5f; time += 0.0123f)
+            {
+                ensure_same_samples(list.get(), time);
+            }
+            LLKeyframeMotion::RotationCurve& curve = list->getJointMotion(3)->mRotationCurve;
+            for (const auto& key : curve.mKeys)
+            {
+                ensure_same_samples(list.get(), key.first);
+            }
+        }
+    }
+
+    template<> template<>
+    void keyframemotion_object::test<2>()
+    {
+        // Milliseconds per frame to sample a dance playing on many avatars,
+        // through the key maps and through the compact curves. Set
+        // LL_KEYFRAME_BENCHMARK_INSTANCES for another crowd size. Not a
+        // pass/fail test.
+        skip_unless_benchmarking();
+        S32 instances = 200;
+        if (const char* count = getenv("LL_KEYFRAME_BENCHMARK_INSTANCES"))
+        {
+            instances = llmax(1, atoi(count));
+        }
+        const S32 FRAMES = 100;
+        const F32 DURATION = 30.f;
+
+        std::unique_ptr<JointMotionList> list(make_animation(60, DURATION, 30.f, false));
+        const U32 count = list->getNumJointMotions();
+        U32 map_size = 0;
+        for (U32 i = 0; i < count; ++i)
+        {
+            JointMotion* joint_motion = list->getJointMotion(i);
+            map_size += joint_motion->mRotationCurve.mNumKeys * sizeof(LLKeyframeMotion::RotationKey);
+            map_size += joint_motion->mPositionCurve.mNumKeys * sizeof(LLKeyframeMotion::PositionKey);
+        }
+
+        // each instance at its own point in the dance
+        F32 checksum = 0.f;
+        LLTimer timer;
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            for (S32 n = 0; n < instances; ++n)
+            {
+                const F32 time = fmodf(frame / 60.f + n * 0.37f, DURATION);
+                for (U32 i = 0; i < count; ++i)
+                {
+                    JointMotion* joint_motion = list->getJointMotion(i);
+                    checksum += joint_motion->mRotationCurve.getValue(time, DURATION).mQ[VW];
+                    if (joint_motion->mPositionCurve.mNumKeys)
+                    {
+                        checksum += joint_motion->mPositionCurve.getValue(time, DURATION).mV[VZ];
+                    }
+                }
+            }
+        }
+        const F64 map_ms = timer.getElapsedTimeF64() * 1000.0 / FRAMES;
+
+        std::vector<LLVector4a> rotations(count), positions(count);
+        timer.reset();
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            for (S32 n = 0; n < instances; ++n)
+            {
+                const F32 time = fmodf(frame / 60.f + n * 0.37f, DURATION);
+                list->mCompactCurves.evaluate(time, rotations.data(), positions.data());
+                checksum += rotations[0][VW] + positions[0][VZ];
+            }
+        }
+        const F64 compact_ms = timer.getElapsedTimeF64() * 1000.0 / FRAMES;
+
+        LL_INFOS() << instances << " dancers, " << count << " joints: key maps "
+                   << llformat("%.3f ms/frame", map_ms) << " (" << map_size << " bytes of keys), compact curves "
+                   << llformat("%.3f ms/frame", compact_ms) << " (" << list->mCompactCurves.getSize() << " bytes)"
+                   << " checksum " << checksum << LL_ENDL;
+    }
+}
@@ -0,0 +1,556 @@
+/**
+ * @file llmotioncontroller_test.cpp
+ * @brief LLMotionController test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llcharacter.h"
+#include "../llkeyframemotion.h"
+#include "../llmotioncontroller.h"
+
+#include "lldatapacker.h"
+#include "llframetimer.h"
+#include "llquantize.h"
+#include "lltimer.h"
+#include "threadpool.h"
+
+#include "../test/lltut.h"
+
+#include <memory>
+#include <thread>
+
+namespace
+{
+    // A skeleton of about the size of an avatar's: a spine and head, two
+    // arms with five fingered hands, two legs.
+    class LLTestCharacter : public LLCharacter
+    {
+    public:
+        LLTestCharacter()
+        {
+            mID.generate();
+            mRoot.reset(new LLJoint());
+            mRoot->setName("mRoot");
+            LLJoint* pelvis = addJoint("mPelvis", mRoot.get(), LLVector3::zero);
+            LLJoint* spine = pelvis;
+            for (S32 i = 0; i < 4; ++i)
+            {
+                spine = addJoint(llformat("mSpine%d", i), spine, LLVector3(0.f, 0.f, 0.1f));
+            }
+            addJoint("mHead", addJoint("mNeck", spine, LLVector3(0.f, 0.f, 0.1f)), LLVector3(0.f, 0.f, 0.1f));
+            for (S32 side = 0; side < 2; ++side)
+            {
+                const F32 y = side ? -0.1f : 0.1f;
+                LLJoint* arm = spine;
+                for (S32 i = 0; i < 4; ++i)
+                {
+                    arm = addJoint(llformat("mArm%d_%d", side, i), arm, LLVector3(0.f, y, 0.f));
+                }
+                for (S32 finger = 0; finger < 5; ++finger)
+                {
+                    LLJoint* bone = arm;
+                    for (S32 i = 0; i < 3; ++i)
+                    {
+                        bone = addJoint(llformat("mFinger%d_%d_%d", side, finger, i), bone, LLVector3(0.02f, y * 0.2f, 0.f));
+                    }
+                }
+                LLJoint* leg = pelvis;
+                for (S32 i = 0; i < 4; ++i)
+                {
+                    leg = addJoint(llformat("mLeg%d_%d", side, i), leg, LLVector3(0.f, y * 0.5f, -0.2f));
+                }
+            }
+        }
+
+        const char* getAnimationPrefix() override { return "avatar"; }
+        LLJoint* getRootJoint() override { return mRoot.get(); }
+        LLVector3 getCharacterPosition() override { return LLVector3::zero; }
+        LLQuaternion getCharacterRotation() override { return LLQuaternion::DEFAULT; }
+        LLVector3 getCharacterVelocity() override { return LLVector3::zero; }
+        LLVector3 getCharacterAngularVelocity() override { return LLVector3::zero; }
+        void getGround(const LLVector3& inPos, LLVector3& outPos, LLVector3& outNorm) override
+        {
+            outPos = inPos;
+            outNorm = LLVector3::z_axis;
+        }
+        LLJoint* getCharacterJoint(U32 i) override { return i < mJoints.size() ? mJoints[i].get() : NULL; }
+        F32 getTimeDilation() override { return 1.f; }
+        F32 getPixelArea() const override { return 100000.f; }
+        LLPolyMesh* getHeadMesh() override { return NULL; }
+        LLPolyMesh* getUpperBodyMesh() override { return NULL; }
+        LLVector3d getPosGlobalFromAgent(const LLVector3& position) override { return LLVector3d(position); }
+        LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override { return LLVector3(position); }
+        void addDebugText(const std::string& text) override {}
+        const LLUUID& getID() const override { return mID; }
+
+        S32 getNumJoints() const { return (S32)mJoints.size(); }
+
+    private:
+        LLJoint* addJoint(const std::string& name, LLJoint* parent, const LLVector3& position)
+        {
+            LLJoint* joint = new LLJoint((S32)mJoints.size());
+            mJoints.emplace_back(joint);
+            joint->setName(name);
+            joint->setPosition(position);
+            parent->addChild(joint);
+            return joint;
+        }
+
+        LLUUID mID;
+        std::unique_ptr<LLJoint> mRoot;
+        std::vector<std::unique_ptr<LLJoint> > mJoints;
+    };
+
+    // Animation assets as they would arrive from the asset server, made up
+    // from smooth curves sampled at 30 frames per second.
+    std::map<LLUUID, std::vector<U8> > sRecordedAnimations;
+
+    std::vector<U8> record_animation(const LLTestCharacter& character, S32 first_joint, S32 num_joints,
+                                     S32 priority, F32 duration, F32 phase)
+    {
+        const S32 num_keys = (S32)(duration * 30.f) + 1;
+        std::vector<U8> buffer(1024 + num_joints * (64 + num_keys * 8 * 2));
+        LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+
+        dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+        dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+        dp.packS32(priority, "base_priority");
+        dp.packF32(duration, "duration");
+        dp.packString(std::string(), "emote_name");
+        dp.packF32(0.f, "loop_in_point");
+        dp.packF32(duration, "loop_out_point");
+        dp.packS32(1, "loop");
+        dp.packF32(0.3f, "ease_in_duration");
+        dp.packF32(0.3f, "ease_out_duration");
+        dp.packU32(1, "hand_pose");
+        dp.packU32(num_joints, "num_joints");
+
+        LLTestCharacter& nonconst = const_cast<LLTestCharacter&>(character);
+        for (S32 j = first_joint; j < first_joint + num_joints; ++j)
+        {
+            const std::string& name = nonconst.getCharacterJoint(j)->getName();
+            dp.packString(name, "joint_name");
+            dp.packS32(priority, "joint_priority");
+
+            const LLVector3 axis(j % 3 == 0 ? 1.f : 0.f, j % 3 == 1 ? 1.f : 0.f, j % 3 == 2 ? 1.f : 0.f);
+            dp.packS32(num_keys, "num_rot_keys");
+            for (S32 k = 0; k < num_keys; ++k)
+            {
+                const F32 time = duration * k / (num_keys - 1);
+                const F32 angle = 0.5f * sinf(F_TWO_PI * time / duration + phase + j);
+                LLVector3 rot_vec = LLQuaternion(angle, axis).packToVector3();
+                dp.packU16(F32_to_U16(time, 0.f, duration), "time");
+                dp.packU16(F32_to_U16(rot_vec.mV[VX], -1.f, 1.f), "rot_angle_x");
+                dp.packU16(F32_to_U16(rot_vec.mV[VY], -1.f, 1.f), "rot_angle_y");
+                dp.packU16(F32_to_U16(rot_vec.mV[VZ], -1.f, 1.f), "rot_angle_z");
+            }
+
+            const S32 num_pos_keys = (name == "mPelvis") ? num_keys : 0;
+            dp.packS32(num_pos_keys, "num_pos_keys");
+            for (S32 k = 0; k < num_pos_keys; ++k)
+            {
+                const F32 time = duration * k / (num_keys - 1);
+                const F32 z = 0.05f * sinf(F_TWO_PI * time / duration + phase);
+                dp.packU16(F32_to_U16(time, 0.f, duration), "time");
+                dp.packU16(F32_to_U16(0.f, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_x");
+                dp.packU16(F32_to_U16(0.f, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_y");
+                dp.packU16(F32_to_U16(z, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_z");
+            }
+        }
+
+        dp.packS32(0, "num_constraints");
+        buffer.resize(dp.getCurrentSize());
+        return buffer;
+    }
+
+    // LLKeyframeMotion which finds its asset among sRecordedAnimations
+    // rather than fetching it
+    class LLRecordedMotion : public LLKeyframeMotion
+    {
+    public:
+        LLRecordedMotion(const LLUUID& id) : LLKeyframeMotion(id) {}
+
+        static LLMotion* create(const LLUUID& id) { return new LLRecordedMotion(id); }
+
+        LLMotionInitStatus onInitialize(LLCharacter* character) override
+        {
+            if (LLKeyframeDataCache::getKeyframeData(getID()))
+            {
+                return LLKeyframeMotion::onInitialize(character);
+            }
+
+            mCharacter = character;
+            std::vector<U8>& buffer = sRecordedAnimations[getID()];
+            LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+            if (!deserialize(dp, getID()))
+            {
+                return STATUS_FAILURE;
+            }
+            // as LLKeyframeMotion::onInitialize() does with a local file
+            mAssetStatus = ASSET_LOADED;
+            setupPose();
+            return STATUS_SUCCESS;
+        }
+    };
+
+    // Full body loops, and overlays on the arms and hands at a higher
+    // priority
+    const S32 NUM_BODY_ANIMATIONS = 3;
+    std::vector<LLUUID> sBodyAnimations;
+    std::vector<LLUUID> sOverlayAnimations;
+
+    void record_animations(const LLTestCharacter& character)
+    {
+        if (!sBodyAnimations.empty())
+        {
+            return;
+        }
+
+        const S32 first_arm_joint = 7;
+        for (S32 i = 0; i < NUM_BODY_ANIMATIONS; ++i)
+        {
+            LLUUID id;
+            id.generate();
+            sRecordedAnimations[id] = record_animation(character, 0, character.getNumJoints(),
+                                                       LLJoint::LOW_PRIORITY, 2.f + i, 0.5f * i);
+            sBodyAnimations.push_back(id);
+
+            id.generate();
+            sRecordedAnimations[id] = record_animation(character, first_arm_joint, 19 * 2,
+                                                       LLJoint::HIGH_PRIORITY, 1.f + 0.5f * i, 0.3f * i);
+            sOverlayAnimations.push_back(id);
+        }
+    }
+
+    typedef std::vector<std::unique_ptr<LLTestCharacter> > character_list_t;
+
+    // In step avatars each play 'step' seconds ahead of the previous one
+    void create_characters(character_list_t& characters, S32 count, F32 time_factor, bool in_step = false, F32 step = 0.f)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            LLTestCharacter* character = new LLTestCharacter();
+            characters.emplace_back(character);
+            record_animations(*character);
+            for (S32 a = 0; a < NUM_BODY_ANIMATIONS; ++a)
+            {
+                character->registerMotion(sBodyAnimations[a], LLRecordedMotion::create);
+                character->registerMotion(sOverlayAnimations[a], LLRecordedMotion::create);
+            }
+            character->setAnimTimeFactor(time_factor);
+            if (in_step)
+            {
+                // one dance, with either of two overlays
+                character->startMotion(sBodyAnimations[0], 0.4f + step * i);
+                character->startMotion(sOverlayAnimations[i % 2], 0.35f + step * i);
+            }
+            else
+            {
+                // out of step with one another
+                character->startMotion(sBodyAnimations[i % NUM_BODY_ANIMATIONS], 0.4f + 0.11f * i);
+                character->startMotion(sOverlayAnimations[(i / NUM_BODY_ANIMATIONS) % NUM_BODY_ANIMATIONS], 0.35f + 0.07f * i);
+            }
+        }
+    }
+
+    // As LLViewerObjectList::update() and LLVOAvatar::evaluateDeferredMotions() do
+    void update_deferred(character_list_t& characters)
+    {
+        for (auto& character : characters)
+        {
+            character->updateMotions(LLCharacter::NORMAL_UPDATE, true);
+        }
+        LL::runJobs("Jobs", characters.size(), [&characters](size_t i)
+        {
+            characters[i]->getMotionController().evaluateDeferredMotions();
+            characters[i]->getRootJoint()->updateWorldMatrixChildren();
+        });
+        for (auto& character : characters)
+        {
+            character->getMotionController().finishDeferredMotions();
+        }
+    }
+
+    void update_serial(character_list_t& characters)
+    {
+        for (auto& character : characters)
+        {
+            character->updateMotions(LLCharacter::NORMAL_UPDATE);
+            character->getRootJoint()->updateWorldMatrixChildren();
+        }
+    }
+
+    // The animations keep their sampled poses across tests
+    void forget_shared_poses()
+    {
+        for (S32 a = 0; a < NUM_BODY_ANIMATIONS; ++a)
+        {
+            for (const LLUUID& id : { sBodyAnimations[a], sOverlayAnimations[a] })
+            {
+                if (LLKeyframeMotion::JointMotionList* list = LLKeyframeDataCache::getKeyframeData(id))
+                {
+                    LLMutexLock lock(&list->mSharedPoseMutex);
+                    for (LLKeyframeMotion::JointMotionList::SharedPose& pose : list->mSharedPoses)
+                    {
+                        pose.mTime = -1.f;
+                    }
+                }
+            }
+        }
+    }
+}
+
+namespace tut
+{
+    struct motioncontroller_data
+    {
+    };
+    typedef test_group<motioncontroller_data> motioncontroller_test;
+    typedef motioncontroller_test::object motioncontroller_object;
+    tut::motioncontroller_test motioncontroller_testcase("LLMotionController");
+
+    template<> template<>
+    void motioncontroller_object::test<1>()
+    {
+        // Deferred evaluation on a thread pool poses the skeletons as the
+        // serial update does. Time stands still so that both see the same
+        // animation times.
+        const S32 COUNT = 12;
+        character_list_t serial, deferred;
+        create_characters(serial, COUNT, 0.f);
+        create_characters(deferred, COUNT, 0.f);
+
+        LL::ThreadPool pool("Jobs", 3);
+        pool.start();
+        for (S32 frame = 0; frame < 3; ++frame)
+        {
+            update_serial(serial);
+            update_deferred(deferred);
+        }
+
+        for (S32 i = 0; i < COUNT; ++i)
+        {
+            ensure_equals("active motions", deferred[i]->getMotionController().getActiveMotions().size(),
+                          serial[i]->getMotionController().getActiveMotions().size());
+            for (S32 j = 0; j < serial[i]->getNumJoints(); ++j)
+            {
+                const LLMatrix4& expected = serial[i]->getCharacterJoint(j)->getWorldMatrix();
+                const LLMatrix4& actual = deferred[i]->getCharacterJoint(j)->getWorldMatrix();
+                for (S32 k = 0; k < 4; ++k)
+                {
+                    for (S32 l = 0; l < 4; ++l)
+                    {
+                        ensure_approximately_equals(llformat("avatar %d joint %d", i, j).c_str(),
+                                                    actual.mMatrix[k][l], expected.mMatrix[k][l], 16);
+                    }
+                }
+            }
+        }
+        ensure("animated", serial[0]->getCharacterJoint(1)->getWorldMatrix().mMatrix[3][2] != 0.1f);
+    }
+
+    template<> template<>
+    void motioncontroller_object::test<2>()
+    {
+        // Milliseconds per frame to animate a crowd, serially and with
+        // increasing numbers of threads. Set LL_MOTION_BENCHMARK_AVATARS for
+        // another crowd size. Not a pass/fail test.
+        skip_unless_benchmarking();
+        S32 count = 60;
+        if (const char* avatars = getenv("LL_MOTION_BENCHMARK_AVATARS"))
+        {
+            count = llmax(1, atoi(avatars));
+        }
+        const S32 FRAMES = 200;
+
+        character_list_t characters;
+        create_characters(characters, count, 1.f);
+
+        LLTimer timer;
+        for (S32 frame = 0; frame < FRAMES; ++frame)
+        {
+            update_serial(characters);
+        }
+        LL_INFOS() << count << " avatars, serial: "
+                   << llformat("%.3f ms/frame", timer.getElapsedTimeF64() * 1000.0 / FRAMES) << LL_ENDL;
+
+        const S32 max_threads = llmax(1, (S32)std::thread::hardware_concurrency());
+        for (S32 threads = 1; threads <= max_threads; threads *= 2)
+        {
+            // the calling thread takes its share
+            std::unique_ptr<LL::ThreadPool> pool;
+            if (threads > 1)
+            {
+                pool.reset(new LL::ThreadPool("Jobs", threads - 1));
+                pool->start();
+            }
+
+            update_deferred(characters);
+            timer.reset();
+            for (S32 frame = 0; frame < FRAMES; ++frame)
+            {
+                update_deferred(characters);
+            }
+            LL_INFOS() << count << " avatars, " << threads << " threads: "
+                       << llformat("%.3f ms/frame", timer.getElapsedTimeF64() * 1000.0 / FRAMES) << LL_ENDL;
+        }
+    }
+
+    template<> template<>
+    void motioncontroller_object::test<3>()
+    {
+        // Avatars playing in step share sampled poses while their clocks are
+        // within POSE_SHARING_TOLERANCE of one another, and come out posed
+        // about as when each samples its own. Half of them layer another
+        // overlay.
+        const S32 COUNT = 8;
+        const F32 TOLERANCE = LLKeyframeMotion::POSE_SHARING_TOLERANCE;
+        for (F32 step : { 0.f, TOLERANCE / COUNT, TOLERANCE * 2.f })
+        {
+            const std::string msg = llformat("%.4f s apart", step);
+            character_list_t expected, actual;
+            create_characters(expected, COUNT, 1.f, true, step);
+            create_characters(actual, COUNT, 1.f, true, step);
+
+            // Both crowds read the same frame time, as avatars do during a
+            // frame, and animate without sharing until all motions are on
+            LLKeyframeMotion::sSharePoses = false;
+            for (S32 frame = 0; frame < 3; ++frame)
+            {
+                LLFrameTimer::updateFrameTime();
+                update_serial(expected);
+                update_serial(actual);
+            }
+            LLFrameTimer::updateFrameTime();
+            update_serial(expected);
+
+            // Only poses sampled during this frame to share
+            forget_shared_poses();
+            LLKeyframeMotion::sSharePoses = true;
+            LLKeyframeMotion::sNumSharedPoses = 0;
+            update_serial(actual);
+
+            const bool in_step = step * (COUNT - 1) <= TOLERANCE;
+            // the first avatar of the dance and of each overlay samples,
+            // those less than the tolerance behind share
+            ensure_equals(msg + " shared", (U32)LLKeyframeMotion::sNumSharedPoses,
+                          in_step ? (U32)(COUNT - 1 + 2 * (COUNT / 2 - 1)) : 0U);
+            for (S32 i = 0; i < COUNT; ++i)
+            {
+                for (S32 j = 0; j < expected[i]->getNumJoints(); ++j)
+                {
+                    const LLMatrix4& expected_mat = expected[i]->getCharacterJoint(j)->getWorldMatrix();
+                    const LLMatrix4& actual_mat = actual[i]->getCharacterJoint(j)->getWorldMatrix();
+                    const std::string joint_msg = llformat("%s, avatar %d joint %d", msg.c_str(), i, j);
+                    for (S32 k = 0; k < 4; ++k)
+                    {
+                        for (S32 l = 0; l < 4; ++l)
+                        {
+                            if (step == 0.f || !in_step)
+                            {
+                                ensure_approximately_equals(joint_msg, actual_mat.mMatrix[k][l], expected_mat.mMatrix[k][l], 16);
+                            }
+                            else
+                            {
+                                // a pose sampled up to the tolerance earlier
+                                ensure_approximately_equals_range(joint_msg, actual_mat.mMatrix[k][l], expected_mat.mMatrix[k][l], 0.01f);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // An avatar time stands still for samples the same pose every
+        // frame, which is not sharing
+        character_list_t still;
+        create_characters(still, 1, 0.f, true);
+        forget_shared_poses();
+        LLKeyframeMotion::sNumSharedPoses = 0;
+        for (S32 frame = 0; frame < 3; ++frame)
+        {
+            update_serial(still);
+        }
+        ensure_equals("own pose not shared", (U32)LLKeyframeMotion::sNumSharedPoses, 0U);
+
+        // nor kept for others, once the crowds above are gone
+        LLKeyframeMotion::JointMotionList* list = LLKeyframeDataCache::getKeyframeData(sBodyAnimations[0]);
+        ensure_equals("single instance", (S32)list->mNumActiveInstances, 1);
+        for (const LLKeyframeMotion::JointMotionList::SharedPose& pose : list->mSharedPoses)
+        {
+            ensure("pose not kept", pose.mTime < 0.f);
+        }
+    }
+
+    template<> template<>
+    void motioncontroller_object::test<4>()
+    {
+        // Milliseconds per frame to animate a crowd dancing in step, each
+        // avatar sampling its own poses and sharing them, serially and on
+        // a thread pool, where the avatars contend for the shared poses.
+        // Not a pass/fail test.
+        skip_unless_benchmarking();
+        S32 count = 60;
+        if (const char* avatars = getenv("LL_MOTION_BENCHMARK_AVATARS"))
+        {
+            count = llmax(1, atoi(avatars));
+        }
+        const S32 FRAMES = 200;
+
+        character_list_t characters;
+        create_characters(characters, count, 1.f, true);
+
+        const S32 threads = llmax(2, (S32)std::thread::hardware_concurrency());
+        for (bool deferred : { false, true })
+        {
+            // the calling thread takes its share
+            std::unique_ptr<LL::ThreadPool> pool;
+            if (deferred)
+            {
+                pool.reset(new LL::ThreadPool("Jobs", threads - 1));
+                pool->start();
+            }
+
+            for (S32 share = 0; share < 2; ++share)
+            {
+                LLKeyframeMotion::sSharePoses = share;
+                LLFrameTimer::updateFrameTime();
+                deferred ? update_deferred(characters) : update_serial(characters);
+                LLKeyframeMotion::sNumSharedPoses = 0;
+                LLTimer timer;
+                for (S32 frame = 0; frame < FRAMES; ++frame)
+                {
+                    LLFrameTimer::updateFrameTime();
+                    deferred ? update_deferred(characters) : update_serial(characters);
+                }
+                LL_INFOS() << count << " avatars in step, " << (deferred ? threads : 1) << " threads, "
+                           << (share ? "shared" : "own") << " poses: "
+                           << llformat("%.3f ms/frame", timer.getElapsedTimeF64() * 1000.0 / FRAMES)
+                           << ", " << LLKeyframeMotion::sNumSharedPoses / FRAMES << " shared/frame" << LL_ENDL;
+            }
+        }
+        LLKeyframeMotion::sSharePoses = true;
+    }
+}
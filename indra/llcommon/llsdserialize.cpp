@@ -1296,6 +1296,311 @@ bool LLSDBinaryParser::parseString(
 }
 
 
+/**
+ * Binary LLSD parsing out of a buffer, see LLSDSerialize::fromBinary()
+ */
+namespace
+{
+    class LLSDBinaryBufferParser
+    {
+    public:
+        LLSDBinaryBufferParser(const U8* data, size_t size)
+        :   mPos(data), mEnd(data + size)
+        {
+        }
+
+        // Same contract as LLSDBinaryParser::doParse()
+        S32 parse(LLSD& data, S32 max_depth)
+        {
+            if (mPos == mEnd)
+            {
+                return 0;
+            }
+            S32 parse_count = max_depth == 0 ? LLSDParser::PARSE_FAILURE : parseValue(data, max_depth);
+            if (parse_count == LLSDParser::PARSE_FAILURE)
+            {
+                data.clear();
+            }
+            return parse_count;
+        }
+
+        const U8* getPos() const { return mPos; }
+
+    private:
+        bool has(size_t bytes) const { return (size_t)(mEnd - mPos) >= bytes; }
+
+        bool readU32(U32& value)
+        {
+            if (!has(sizeof(U32)))
+            {
+                return false;
+            }
+            U32 value_nbo;
+            memcpy(&value_nbo, mPos, sizeof(U32));
+            mPos += sizeof(U32);
+            value = ntohl(value_nbo);
+            return true;
+        }
+
+        // A 4 byte size followed by that many bytes, which must all be there
+        bool readSized(const U8*& bytes, size_t& size)
+        {
+            U32 value;
+            if (!readU32(value) || (S32)value < 0 || !has(value))
+            {
+                return false;
+            }
+            bytes = mPos;
+            size = value;
+            mPos += value;
+            return true;
+        }
+
+        // Notation style string, the delimiter already read
+        bool readDelimited(std::string& value, char d)
+        {
+            boost::iostreams::stream<boost::iostreams::array_source> istr((const char*)mPos, mEnd - mPos);
+            if (deserialize_string_delim(istr, value, d) == LLSDParser::PARSE_FAILURE || istr.fail())
+            {
+                return false;
+            }
+            mPos += (size_t)istr.tellg();
+            return true;
+        }
+
+        S32 parseValue(LLSD& data, S32 max_depth)
+        {
+            const char c = (char)*mPos++;
+            switch (c)
+            {
+            case '{':
+                return parseMap(data, max_depth - 1);
+
+            case '[':
+                return parseArray(data, max_depth - 1);
+
+            case '!':
+                data.clear();
+                return 1;
+
+            case '0':
+                data = false;
+                return 1;
+
+            case '1':
+                data = true;
+                return 1;
+
+            case 'i':
+            {
+                U32 value;
+                if (!readU32(value))
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                data = (S32)value;
+                return 1;
+            }
+
+            case 'r':
+            case 'd':
+            {
+                if (!has(sizeof(F64)))
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                F64 real;
+                memcpy(&real, mPos, sizeof(F64));
+                mPos += sizeof(F64);
+                // dates are written in host order
+                if (c == 'r')
+                {
+                    data = ll_ntohd(real);
+                }
+                else
+                {
+                    data = LLDate(real);
+                }
+                return 1;
+            }
+
+            case 'u':
+            {
+                if (!has(UUID_BYTES))
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                LLUUID id;
+                memcpy(id.mData, mPos, UUID_BYTES);
+                mPos += UUID_BYTES;
+                data = id;
+                return 1;
+            }
+
+            case '\'':
+            case '"':
+            {
+                std::string value;
+                if (!readDelimited(value, c))
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                data = std::move(value);
+                return 1;
+            }
+
+            case 's':
+            case 'l':
+            case 'b':
+            {
+                const U8* bytes;
+                size_t size;
+                if (!readSized(bytes, size))
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                if (c == 's')
+                {
+                    data = LLSD::String((const char*)bytes, size);
+                }
+                else if (c == 'l')
+                {
+                    data = LLURI(std::string((const char*)bytes, size));
+                }
+                else
+                {
+                    data = LLSD::Binary(bytes, bytes + size);
+                }
+                return 1;
+            }
+
+            default:
+                LL_INFOS() << "Unrecognized character while parsing: int(" << int(c)
+                    << ")" << LL_ENDL;
+                return LLSDParser::PARSE_FAILURE;
+            }
+        }
+
+        S32 parseMap(LLSD& map, S32 max_depth)
+        {
+            map = LLSD::emptyMap();
+            U32 size;
+            if (!readU32(size))
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+
+            S32 parse_count = 1;
+            std::string name;
+            for (U32 count = 0; count < size; ++count)
+            {
+                if (mPos == mEnd)
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                // an unknown key type stands for an empty key, as in
+                // LLSDBinaryParser::parseMap()
+                const char c = (char)*mPos++;
+                name.clear();
+                if (c == 'k')
+                {
+                    const U8* bytes;
+                    size_t length;
+                    if (!readSized(bytes, length))
+                    {
+                        return LLSDParser::PARSE_FAILURE;
+                    }
+                    name.assign((const char*)bytes, length);
+                }
+                else if (c == '\'' || c == '"')
+                {
+                    if (!readDelimited(name, c))
+                    {
+                        return LLSDParser::PARSE_FAILURE;
+                    }
+                }
+                else if (c == '}')
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+
+                if (mPos == mEnd || max_depth == 0)
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                LLSD child;
+                S32 child_count = parseValue(child, max_depth);
+                if (child_count == LLSDParser::PARSE_FAILURE)
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                parse_count += child_count;
+                // the first of duplicate keys wins
+                map.insert(name, child);
+            }
+
+            if (mPos == mEnd || *mPos++ != '}')
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            return parse_count;
+        }
+
+        S32 parseArray(LLSD& array, S32 max_depth)
+        {
+            array = LLSD::emptyArray();
+            U32 size;
+            // every element takes a byte at least
+            if (!readU32(size) || !has(size))
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+
+            S32 parse_count = 1;
+            if (size > 0)
+            {
+                // size the array once and parse into it in place
+                array.set(size - 1, LLSD());
+            }
+            for (U32 count = 0; count < size; ++count)
+            {
+                if (mPos == mEnd || *mPos == ']' || max_depth == 0)
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                S32 child_count = parseValue(array[count], max_depth);
+                if (child_count == LLSDParser::PARSE_FAILURE)
+                {
+                    return LLSDParser::PARSE_FAILURE;
+                }
+                parse_count += child_count;
+            }
+
+            if (mPos == mEnd || *mPos++ != ']')
+            {
+                return LLSDParser::PARSE_FAILURE;
+            }
+            return parse_count;
+        }
+
+        const U8* mPos;
+        const U8* mEnd;
+    };
+}
+
+// static
+S32 LLSDSerialize::fromBinary(LLSD& sd, const U8* data, size_t size, S32 max_depth, size_t* parsed_bytes)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
+    LLSDBinaryBufferParser parser(data, size);
+    S32 parse_count = parser.parse(sd, max_depth);
+    if (parsed_bytes)
+    {
+        *parsed_bytes = parser.getPos() - data;
+    }
+    return parse_count;
+}
+
 /**
  * LLSDFormatter
  */
@@ -2253,18 +2558,36 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is,
 
 LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32 size)
 {
-    U8* result = NULL;
-    llssize cur_size = 0;
-    z_stream strm;
-
-    constexpr U32 CHUNK = 1024 * 512;
+    std::vector<U8> result;
+    EZipRresult zip_result = unzip(result, in, size);
+    if (zip_result != ZR_OK)
+    {
+        return zip_result;
+    }
 
-    static thread_local std::unique_ptr<U8[]> out;
-    if (!out)
+    //result now holds the decompressed LLSD block
     {
-        out = std::unique_ptr<U8[]>(new(std::nothrow) U8[CHUNK]);
+        llssize cur_size = result.size();
+        char* result_ptr = strip_deprecated_header((char*)result.data(), cur_size);
+
+        if (LLSDSerialize::fromBinary(data, (const U8*)result_ptr, cur_size, UNZIP_LLSD_MAX_DEPTH) <= 0)
+        {
+            return ZR_PARSE_ERROR;
+        }
     }
 
+    return ZR_OK;
+}
+
+LLUZipHelper::EZipRresult LLUZipHelper::unzip(std::vector<U8>& out, const U8* in, S32 size)
+{
+    // inflate straight into out, growing it as needed
+    constexpr size_t CHUNK = 1024 * 64;
+
+    size_t cur_size = 0;
+    out.clear();
+
+    z_stream strm;
     strm.zalloc = Z_NULL;
     strm.zfree = Z_NULL;
     strm.opaque = Z_NULL;
@@ -2272,11 +2595,28 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32
     strm.next_in = const_cast<U8*>(in);
 
     S32 ret = inflateInit(&strm);
+    if (ret != Z_OK)
+    {
+        return ZR_MEM_ERROR;
+    }
 
     do
     {
-        strm.avail_out = CHUNK;
-        strm.next_out = out.get();
+        try
+        {
+            // compressed mesh and LLSD data typically inflates to a few times its size
+            out.resize(llmax(out.size() * 2, cur_size + llmax(CHUNK, (size_t)size * 4)));
+        }
+        catch (const std::bad_alloc&)
+        {
+            inflateEnd(&strm);
+            out.clear();
+            return ZR_MEM_ERROR;
+        }
+
+        const U32 avail = (U32)llmin(out.size() - cur_size, (size_t)U32_MAX);
+        strm.avail_out = avail;
+        strm.next_out = out.data() + cur_size;
         ret = inflate(&strm, Z_NO_FLUSH);
         switch (ret)
         {
@@ -2284,40 +2624,26 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32
         case Z_DATA_ERROR:
         {
             inflateEnd(&strm);
-            free(result);
+            out.clear();
             return ZR_DATA_ERROR;
         }
         case Z_STREAM_ERROR:
         case Z_BUF_ERROR:
         {
             inflateEnd(&strm);
-            free(result);
+            out.clear();
             return ZR_BUFFER_ERROR;
         }
 
         case Z_MEM_ERROR:
         {
             inflateEnd(&strm);
-            free(result);
+            out.clear();
             return ZR_MEM_ERROR;
         }
         }
 
-        U32 have = CHUNK-strm.avail_out;
-
-        U8* new_result = (U8*)realloc(result, cur_size + have);
-        if (new_result == NULL)
-        {
-            inflateEnd(&strm);
-            if (result)
-            {
-                free(result);
-            }
-            return ZR_MEM_ERROR;
-        }
-        result = new_result;
-        memcpy(result+cur_size, out.get(), have);
-        cur_size += have;
+        cur_size += avail - strm.avail_out;
 
     } while (ret == Z_OK && ret != Z_STREAM_END);
 
@@ -2325,26 +2651,14 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32
 
     if (ret != Z_STREAM_END)
     {
-        free(result);
+        out.clear();
         return ZR_DATA_ERROR;
     }
 
-    //result now points to the decompressed LLSD block
-    {
-        char* result_ptr = strip_deprecated_header((char*)result, cur_size);
-
-        boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
-
-        if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
-        {
-            free(result);
-            return ZR_PARSE_ERROR;
-        }
-    }
-
-    free(result);
+    out.resize(cur_size);
     return ZR_OK;
 }
+
 //This unzip function will only work with a gzip header and trailer - while the contents
 //of the actual compressed data is the same for either format (gzip vs zlib ), the headers
 //and trailers are different for the formats.
@@ -290,6 +290,46 @@ private:
     bool parseBinary(std::istream& istr, LLSD& data) const;
 };
 
+/**
+ * @class LLSDXMLVisitor
+ * @brief Receives LLSD-XML as it is parsed, in place of an LLSD tree.
+ *
+ * Maps and arrays are reported by begin and end calls, and every value in
+ * a map follows a key() call. Scalars are handed to value() as they end.
+ * beginMap() and beginArray() can instead ask for the whole container as
+ * one value, which suits the small records of a large response.
+ */
+class LL_COMMON_API LLSDXMLVisitor
+{
+public:
+    virtual ~LLSDXMLVisitor() {}
+
+    /**
+     * @brief A map starts.
+     * @return Return true to get the complete map in value() rather
+     * than key() and value() calls for its content.
+     */
+    virtual bool beginMap() { return false; }
+    virtual void endMap() {}
+
+    /**
+     * @brief An array starts.
+     * @return Return true to get the complete array in value().
+     */
+    virtual bool beginArray() { return false; }
+    virtual void endArray() {}
+
+    /**
+     * @brief The key of the next value, in the current map.
+     */
+    virtual void key(const std::string& name) {}
+
+    /**
+     * @brief A scalar, or a map or array asked for as a whole.
+     */
+    virtual void value(const LLSD& value) {}
+};
+
 /**
  * @class LLSDXMLParser
  * @brief Parser which handles XML format LLSD.
@@ -308,6 +348,14 @@ public:
      */
     LLSDXMLParser(bool emit_errors=true);
 
+    /**
+     * @brief Hands what is parsed to a visitor instead of building an LLSD.
+     *
+     * The parsed data is left undefined while a visitor is set.
+     * @param visitor The visitor, or NULL to build an LLSD again.
+     */
+    void setVisitor(LLSDXMLVisitor* visitor);
+
 protected:
     /**
      * @brief Call this method to parse a stream for LLSD.
@@ -825,6 +873,15 @@ public:
         return fromXMLEmbedded(sd, str, emit_errors);
 //      return fromXMLDocument(sd, str, emit_errors);
     }
+    // Streams the document to a visitor instead of building an LLSD, see
+    // LLSDXMLVisitor
+    static S32 fromXML(LLSDXMLVisitor& visitor, std::istream& str, bool emit_errors=true)
+    {
+        LLPointer<LLSDXMLParser> p = new LLSDXMLParser(emit_errors);
+        p->setVisitor(&visitor);
+        LLSD unused;
+        return p->parse(str, unused, LLSDSerialize::SIZE_UNLIMITED);
+    }
 
     /*
      * Binary Methods
@@ -846,6 +903,23 @@ public:
         (void)p->parse(str, sd, max_bytes, max_depth);
         return sd;
     }
+    /**
+     * @brief Parses one binary LLSD object out of a buffer.
+     *
+     * Reads the buffer directly rather than through a stream, copying
+     * strings and binaries in one go and sizing arrays up front. Gives
+     * the same result as the stream version for well formed data, while
+     * truncated or otherwise malformed data always fails.
+     * @param sd [out] The parsed data, undefined on failure.
+     * @param data The buffer.
+     * @param size The size of the buffer.
+     * @param max_depth Max depth parser will check before exiting
+     *  with parse error, -1 - unlimited.
+     * @param parsed_bytes [out] If not null, the number of bytes read.
+     * @return Returns the number of LLSD objects parsed into sd, or
+     * LLSDParser::PARSE_FAILURE.
+     */
+    static S32 fromBinary(LLSD& sd, const U8* data, size_t size, S32 max_depth = -1, size_t* parsed_bytes = nullptr);
 };
 
 class LL_COMMON_API LLUZipHelper : public LLRefCount
@@ -864,6 +938,8 @@ public:
     // return OK or reason for failure
     static EZipRresult unzip_llsd(LLSD& data, std::istream& is, S32 size);
     static EZipRresult unzip_llsd(LLSD& data, const U8* in, S32 size);
+    // inflates a zlib block into out, for callers parsing it themselves
+    static EZipRresult unzip(std::vector<U8>& out, const U8* in, S32 size);
 };
 
 //dirty little zip functions -- yell at davep
@@ -264,6 +264,8 @@ public:
 
     void reset();
 
+    void setVisitor(LLSDXMLVisitor* visitor) { mVisitor = visitor; }
+
 private:
     void startElementHandler(const XML_Char* name, const XML_Char** attributes);
     void endElementHandler(const XML_Char* name);
@@ -277,6 +279,8 @@ private:
         void* userData, const XML_Char* data, int length);
 
     void startSkipping();
+    void startVisitedElement(int element);
+    bool inVisitedMap() const { return mVisitor && !mVisitedMaps.empty() && mVisitedMaps.back(); }
 
     enum Element {
         ELEMENT_LLSD,
@@ -317,11 +321,18 @@ private:
 
     std::string mCurrentKey;        // Current XML <tag>
     std::string mCurrentContent;    // String data between <tag> and </tag>
+
+    // When set, gets the content instead of mResult. mStack is then only
+    // used for the values handed to it.
+    LLSDXMLVisitor* mVisitor;
+    std::vector<bool> mVisitedMaps; // Maps and arrays being visited, true for maps
+    LLSD mVisitValue;
 };
 
 
 LLSDXMLParser::Impl::Impl(bool emit_errors)
-    : mEmitErrors(emit_errors)
+    : mEmitErrors(emit_errors),
+      mVisitor(NULL)
 {
     mParser = XML_ParserCreate(NULL);
     reset();
@@ -522,6 +533,9 @@ void LLSDXMLParser::Impl::reset()
 
     mCurrentKey.clear();
 
+    mVisitedMaps.clear();
+    mVisitValue.clear();
+
     XML_ParserReset(mParser, "utf-8");
     XML_SetUserData(mParser, this);
     XML_SetElementHandler(mParser, sStartElementHandler, sEndElementHandler);
@@ -535,6 +549,50 @@ void LLSDXMLParser::Impl::startSkipping()
     mSkipThrough = mDepth;
 }
 
+// A value outside of any value the visitor asked for
+void LLSDXMLParser::Impl::startVisitedElement(int element)
+{
+    if (inVisitedMap())
+    {
+        if (mCurrentKey.empty()) { return startSkipping(); }
+
+        mVisitor->key(mCurrentKey);
+        mCurrentKey.clear();
+    }
+
+    ++mParseCount;
+    bool whole = true;
+    if (element == ELEMENT_MAP)
+    {
+        whole = mVisitor->beginMap();
+    }
+    else if (element == ELEMENT_ARRAY)
+    {
+        whole = mVisitor->beginArray();
+    }
+    if (!whole)
+    {
+        mVisitedMaps.push_back(element == ELEMENT_MAP);
+        return;
+    }
+
+    mStack.push_back(&mVisitValue);
+    switch (element)
+    {
+        case ELEMENT_MAP:
+            mVisitValue = LLSD::emptyMap();
+            break;
+
+        case ELEMENT_ARRAY:
+            mVisitValue = LLSD::emptyArray();
+            break;
+
+        default:
+            // scalars will be set in the end element handler
+            ;
+    }
+}
+
 const XML_Char*
 LLSDXMLParser::Impl::findAttribute(const XML_Char* name, const XML_Char** pairs)
 {
@@ -615,7 +673,7 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
             return;
 
         case ELEMENT_KEY:
-            if (mStack.empty()  ||  !(mStack.back()->isMap()))
+            if (mStack.empty() ? !inVisitedMap() : !(mStack.back()->isMap()))
             {
                 return startSkipping();
             }
@@ -636,6 +694,11 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 
     if (!mInLLSDElement) { return startSkipping(); }
 
+    if (mVisitor && mStack.empty())
+    {
+        return startVisitedElement(element);
+    }
+
     if (mStack.empty())
     {
         mStack.push_back(&mResult);
@@ -719,6 +782,25 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 
     if (!mInLLSDElement) { return; }
 
+    if (mVisitor && mStack.empty())
+    {
+        // end of a visited map or array
+        if (!mVisitedMaps.empty())
+        {
+            const bool is_map = mVisitedMaps.back();
+            mVisitedMaps.pop_back();
+            if (is_map)
+            {
+                mVisitor->endMap();
+            }
+            else
+            {
+                mVisitor->endArray();
+            }
+        }
+        return;
+    }
+
     LLSD& value = *mStack.back();
     mStack.pop_back();
 
@@ -808,6 +890,12 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
             break;
     }
 
+    if (mVisitor && mStack.empty())
+    {
+        mVisitor->value(mVisitValue);
+        mVisitValue.clear();
+    }
+
     mCurrentContent.clear();
 }
 
@@ -927,6 +1015,11 @@ void LLSDXMLParser::parsePart(const char *buf, llssize len)
     impl.parsePart(buf, len);
 }
 
+void LLSDXMLParser::setVisitor(LLSDXMLVisitor* visitor)
+{
+    impl.setVisitor(visitor);
+}
+
 // virtual
 S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data, S32 max_depth) const
 {
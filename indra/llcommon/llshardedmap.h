@@ -0,0 +1,182 @@
+/**
+ * @file llshardedmap.h
+ * @brief Hash map split in independently locked shards
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSHARDEDMAP_H
+#define LL_LLSHARDEDMAP_H
+
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+//
+// Thread safe hash map for lookups coming from many threads at once. The keys
+// are spread over SHARDS unordered_maps, each with its own reader/writer lock,
+// so that threads only contend when they hit the same shard, and readers of a
+// shard never block each other.
+//
+// Note: std::shared_mutex is used rather than LLSharedMutex, since the latter
+// serializes all lockers on an internal mutex to track the locking threads.
+//
+// All the callbacks below run with the shard of the key locked: they must be
+// short and must not access the same map again (other than via a different
+// LLShardedMap, always in the same order to avoid deadlocks).
+//
+
+template <typename KEY, typename VALUE, size_t SHARDS = 64, typename HASH = std::hash<KEY>>
+class LLShardedMap
+{
+public:
+    typedef std::unordered_map<KEY, VALUE, HASH> map_t;
+
+    // Copy the value for 'key' if present
+    bool find(const KEY& key, VALUE& value) const
+    {
+        const Shard& shard = getShard(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mMutex);
+        typename map_t::const_iterator it = shard.mMap.find(key);
+        if (it == shard.mMap.end())
+        {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    bool contains(const KEY& key) const
+    {
+        const Shard& shard = getShard(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mMutex);
+        return shard.mMap.find(key) != shard.mMap.end();
+    }
+
+    // Call fn(VALUE&) with the shard exclusively locked if 'key' is present.
+    // Returns false when it is not.
+    template <typename FUNC>
+    bool update(const KEY& key, FUNC&& fn)
+    {
+        Shard& shard = getShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mMutex);
+        typename map_t::iterator it = shard.mMap.find(key);
+        if (it == shard.mMap.end())
+        {
+            return false;
+        }
+        fn(it->second);
+        return true;
+    }
+
+    void insert(const KEY& key, const VALUE& value)
+    {
+        Shard& shard = getShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mMutex);
+        shard.mMap[key] = value;
+    }
+
+    bool erase(const KEY& key)
+    {
+        Shard& shard = getShard(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mMutex);
+        return shard.mMap.erase(key) > 0;
+    }
+
+    void clear()
+    {
+        for (Shard& shard : mShards)
+        {
+            std::unique_lock<std::shared_mutex> lock(shard.mMutex);
+            shard.mMap.clear();
+        }
+    }
+
+    // Not a snapshot: other threads may modify the shards while counting
+    size_t size() const
+    {
+        size_t count = 0;
+        for (const Shard& shard : mShards)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mMutex);
+            count += shard.mMap.size();
+        }
+        return count;
+    }
+
+    bool empty() const
+    {
+        for (const Shard& shard : mShards)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mMutex);
+            if (!shard.mMap.empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Remove all the entries, calling fn(const KEY&, VALUE&) for each of them.
+    // Each shard is swapped out under its lock and walked after unlocking it,
+    // so fn() may be slow.
+    template <typename FUNC>
+    void drain(FUNC&& fn)
+    {
+        for (Shard& shard : mShards)
+        {
+            map_t drained;
+            {
+                std::unique_lock<std::shared_mutex> lock(shard.mMutex);
+                drained.swap(shard.mMap);
+            }
+            for (auto& pair : drained)
+            {
+                fn(pair.first, pair.second);
+            }
+        }
+    }
+
+private:
+    // Aligned so that two shards never share a cache line
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mMutex;
+        map_t mMap;
+    };
+
+    Shard& getShard(const KEY& key)
+    {
+        return mShards[HASH()(key) % SHARDS];
+    }
+
+    const Shard& getShard(const KEY& key) const
+    {
+        return mShards[HASH()(key) % SHARDS];
+    }
+
+private:
+    std::array<Shard, SHARDS> mShards;
+};
+
+#endif // LL_LLSHARDEDMAP_H
@@ -48,7 +48,10 @@ typedef U32 uint32_t;
 #include "llsdserialize.h"
 #include "llsdutil.h"
 #include "llformat.h"
+#include "llmemory.h"
 #include "llmemorystream.h"
+#include "lltimer.h"
+#include "lluuid.h"
 
 #include "hexdump.h"
 #include "StringVec.h"
@@ -640,6 +643,58 @@ namespace tut
     };
 
 
+    /**
+     * @class LLSDRebuildVisitor
+     * @brief Builds back the parsed LLSD from the visitor calls.
+     */
+    class LLSDRebuildVisitor : public LLSDXMLVisitor
+    {
+    public:
+        // whole: ask for the content of the root container as whole values
+        LLSDRebuildVisitor(bool whole) : mWhole(whole) {}
+
+        virtual bool beginMap() { return begin(LLSD::emptyMap()); }
+        virtual void endMap() { mStack.pop_back(); }
+        virtual bool beginArray() { return begin(LLSD::emptyArray()); }
+        virtual void endArray() { mStack.pop_back(); }
+        virtual void key(const std::string& name) { mKey = name; }
+        virtual void value(const LLSD& value) { next() = value; }
+
+        LLSD mResult;
+
+    private:
+        bool begin(const LLSD& container)
+        {
+            if (mWhole && !mStack.empty())
+            {
+                return true;
+            }
+            LLSD& value = next();
+            value = container;
+            mStack.push_back(&value);
+            return false;
+        }
+
+        LLSD& next()
+        {
+            if (mStack.empty())
+            {
+                return mResult;
+            }
+            LLSD& top = *mStack.back();
+            if (top.isMap())
+            {
+                return top[mKey];
+            }
+            top.append(LLSD());
+            return top[top.size() - 1];
+        }
+
+        bool mWhole;
+        std::vector<LLSD*> mStack;
+        std::string mKey;
+    };
+
     /**
      * @class TestLLSDXMLParsing
      * @brief Concrete instance of a parse tester.
@@ -648,6 +703,33 @@ namespace tut
     {
     public:
         TestLLSDXMLParsing() {}
+
+        // Parses through a visitor as well, which must see the same values
+        void ensureVisit(const std::string& msg, const std::string& in)
+        {
+            LLSD expected;
+            std::istringstream input(in);
+            mParser->reset();
+            S32 expected_count = mParser->parse(input, expected, in.size());
+
+            for (bool whole : { false, true })
+            {
+                std::string visit_msg(msg);
+                visit_msg += whole ? " (whole)" : " (visited)";
+
+                LLSDRebuildVisitor visitor(whole);
+                std::istringstream visited(in);
+                mParser->reset();
+                mParser->setVisitor(&visitor);
+                LLSD parsed;
+                S32 count = mParser->parse(visited, parsed, in.size());
+                mParser->setVisitor(NULL);
+
+                ensure_equals(visit_msg + " result", visitor.mResult, expected);
+                ensure_equals(visit_msg + " count", count, expected_count);
+                ensure(visit_msg + " no tree", parsed.isUndefined());
+            }
+        }
     };
 
     typedef tut::test_group<TestLLSDXMLParsing> TestLLSDXMLParsingGroup;
@@ -855,6 +937,211 @@ namespace tut
             8);
     }
 
+    template<> template<>
+    void TestLLSDXMLParsingObject::test<6>()
+    {
+        // test parsing through a visitor
+        ensureVisit("scalar", "<llsd><string>ha ha</string></llsd>");
+        ensureVisit("empty map", "<llsd><map /></llsd>");
+        ensureVisit("empty array", "<llsd><array></array></llsd>");
+        ensureVisit(
+            "all types",
+            "<llsd><map>"
+                "<key>undef</key><undef />"
+                "<key>bool</key><boolean>true</boolean>"
+                "<key>int</key><integer>-42</integer>"
+                "<key>real</key><real>1.5</real>"
+                "<key>string</key><string>&lt;ha ha&gt;</string>"
+                "<key>uuid</key><uuid>d7f4aeca-88f1-42a1-b385-b9db18abb255</uuid>"
+                "<key>date</key><date>2006-02-01T14:29:53Z</date>"
+                "<key>uri</key><uri>http://secondlife.com</uri>"
+                "<key>binary</key><binary encoding=\"base64\">aGVsbG8=</binary>"
+                "<key>empty</key><map></map>"
+            "</map></llsd>");
+        ensureVisit(
+            "nested",
+            "<llsd><map>"
+                "<key>folders</key><array>"
+                    "<map><key>id</key><integer>1</integer>"
+                        "<key>items</key><array><map><key>name</key><string>a</string></map>"
+                            "<map><key>name</key><string>b</string></map></array></map>"
+                    "<map><key>id</key><integer>2</integer>"
+                        "<key>items</key><array /></map>"
+                "</array>"
+                "<key>dup</key><integer>1</integer>"
+                "<key>dup</key><integer>2</integer>"
+            "</map></llsd>");
+        ensureVisit(
+            "map with html",
+            "<llsd><map>"
+                "<key>amy</key><integer>23</integer>"
+                "<html><body>ha ha</body></html>"
+                "<key>bob</key><map><html><body>ha ha</body></html></map>"
+                "<string>no key</string>"
+                "<key>cam</key><real>1.23</real>"
+            "</map></llsd>");
+        ensureVisit(
+            "array with html",
+            "<llsd><array>"
+                "<integer>23</integer>"
+                "<html><body>ha ha</body></html>"
+                "<key>not in a map</key>"
+                "<map><html><body>ha ha</body></html></map>"
+                "<real>1.23</real>"
+            "</array></llsd>");
+        ensureVisit("unknown data type",
+            "<llsd><map><key>bob</key><bigint>99999999999999999</bigint></map></llsd>");
+    }
+
+    template<> template<>
+    void TestLLSDXMLParsingObject::test<7>()
+    {
+        // Latency and memory of a large inventory fetch response, parsed to
+        // an LLSD and visited into compact records.  Not a pass/fail test,
+        // beyond both finding every item.
+        skip_unless_benchmarking();
+        const S32 FOLDERS = 100;
+        const S32 ITEMS_PER_FOLDER = 500;
+
+        LLSD folders = LLSD::emptyArray();
+        for (S32 i = 0; i < FOLDERS; ++i)
+        {
+            LLSD folder;
+            folder["folder_id"] = LLUUID::generateNewID();
+            folder["owner_id"] = LLUUID::generateNewID();
+            folder["version"] = i;
+            folder["descendents"] = ITEMS_PER_FOLDER;
+            folder["categories"] = LLSD::emptyArray();
+            LLSD items = LLSD::emptyArray();
+            for (S32 j = 0; j < ITEMS_PER_FOLDER; ++j)
+            {
+                LLSD item;
+                item["item_id"] = LLUUID::generateNewID();
+                item["parent_id"] = folder["folder_id"];
+                item["asset_id"] = LLUUID::generateNewID();
+                item["name"] = llformat("Item %d of folder %d", j, i);
+                item["desc"] = "(No Description)";
+                item["type"] = 0;
+                item["inv_type"] = 0;
+                item["flags"] = 0;
+                item["created_at"] = 1700000000 + j;
+                LLSD permissions;
+                permissions["creator_id"] = folder["owner_id"];
+                permissions["owner_id"] = folder["owner_id"];
+                permissions["group_id"] = LLUUID::null;
+                permissions["base_mask"] = 0x7fffffff;
+                permissions["owner_mask"] = 0x7fffffff;
+                permissions["group_mask"] = 0;
+                permissions["everyone_mask"] = 0;
+                permissions["next_owner_mask"] = 0x82000;
+                item["permissions"] = permissions;
+                LLSD sale_info;
+                sale_info["sale_price"] = 10;
+                sale_info["sale_type"] = 0;
+                item["sale_info"] = sale_info;
+                items.append(item);
+            }
+            folder["items"] = items;
+            folders.append(folder);
+        }
+        LLSD response;
+        response["folders"] = folders;
+        std::ostringstream out;
+        LLSDSerialize::toXML(response, out);
+        const std::string xml = out.str();
+        response.clear();
+        folders.clear();
+
+        // What a caller would keep of each item
+        struct Item
+        {
+            LLUUID mID;
+            LLUUID mParentID;
+            LLUUID mAssetID;
+            std::string mName;
+            S32 mType;
+        };
+
+        class ItemVisitor : public LLSDXMLVisitor
+        {
+        public:
+            ItemVisitor(std::vector<Item>& items) : mItems(items), mDepth(0) {}
+
+            virtual bool beginMap()
+            {
+                if (mDepth == 2)
+                {
+                    ++mDepth;
+                    return false;   // folder
+                }
+                if (mDepth == 0)
+                {
+                    ++mDepth;
+                    return false;   // root
+                }
+                return true;        // item
+            }
+            virtual void endMap() { --mDepth; }
+            virtual bool beginArray() { ++mDepth; return false; }
+            virtual void endArray() { --mDepth; }
+            virtual void value(const LLSD& value)
+            {
+                if (mDepth == 4)
+                {
+                    Item item;
+                    item.mID = value["item_id"].asUUID();
+                    item.mParentID = value["parent_id"].asUUID();
+                    item.mAssetID = value["asset_id"].asUUID();
+                    item.mName = value["name"].asString();
+                    item.mType = value["type"].asInteger();
+                    mItems.push_back(item);
+                }
+            }
+
+        private:
+            std::vector<Item>& mItems;
+            S32 mDepth;
+        };
+
+        // Visitor first, since the RSS hardly goes back down once the
+        // tree has been allocated
+        std::vector<Item> visited_items;
+        visited_items.reserve(FOLDERS * ITEMS_PER_FOLDER);
+        U64 rss_before = LLMemory::getCurrentRSS();
+        LLTimer timer;
+        {
+            ItemVisitor visitor(visited_items);
+            std::istringstream input(xml);
+            LLSDSerialize::fromXML(visitor, input);
+        }
+        const F64 visit_seconds = timer.getElapsedTimeF64();
+        const S64 visit_rss = (S64)LLMemory::getCurrentRSS() - (S64)rss_before;
+
+        rss_before = LLMemory::getCurrentRSS();
+        timer.reset();
+        LLSD tree;
+        {
+            std::istringstream input(xml);
+            LLSDSerialize::fromXML(tree, input);
+        }
+        size_t tree_items = 0;
+        for (LLSD::array_const_iterator it = tree["folders"].beginArray(); it != tree["folders"].endArray(); ++it)
+        {
+            tree_items += (*it)["items"].size();
+        }
+        const F64 tree_seconds = timer.getElapsedTimeF64();
+        const S64 tree_rss = (S64)LLMemory::getCurrentRSS() - (S64)rss_before;
+
+        ensure_equals("visited items", visited_items.size(), (size_t)(FOLDERS * ITEMS_PER_FOLDER));
+        ensure_equals("tree items", tree_items, visited_items.size());
+
+        LL_INFOS() << "inventory response of " << tree_items << " items (" << xml.size() << " bytes): "
+                   << llformat("tree %.0f ms, %lld KB; visitor %.0f ms, %lld KB",
+                               tree_seconds * 1000.0, (long long)(tree_rss / 1024),
+                               visit_seconds * 1000.0, (long long)(visit_rss / 1024))
+                   << LL_ENDL;
+    }
+
 
     /*
     TODO:
@@ -1582,12 +1869,161 @@ namespace tut
             1);
     }
 
-/*
+    // Binary LLSD shaped like an AIS inventory fetch, a mesh header and an
+    // ObjectMedia response
+    static std::vector<std::string> binary_payloads()
+    {
+        std::vector<LLSD> values;
+
+        LLSD inventory;
+        inventory["category_id"] = LLUUID::generateNewID();
+        inventory["version"] = 42;
+        for (S32 i = 0; i < 500; ++i)
+        {
+            LLSD item;
+            item["item_id"] = LLUUID::generateNewID();
+            item["parent_id"] = inventory["category_id"];
+            item["asset_id"] = LLUUID::generateNewID();
+            item["name"] = llformat("Object %d", i);
+            item["desc"] = "2024-01-01 12:00:00 note card";
+            item["type"] = 7;
+            item["inv_type"] = 7;
+            item["flags"] = 0;
+            item["created_at"] = 1700000000 + i;
+            item["permissions"]["owner_id"] = LLUUID::generateNewID();
+            item["permissions"]["creator_id"] = LLUUID::generateNewID();
+            item["permissions"]["base_mask"] = (S32)0x7fffffff;
+            item["permissions"]["owner_mask"] = (S32)0x7fffffff;
+            item["permissions"]["is_owner_group"] = false;
+            item["sale_info"]["sale_price"] = 10;
+            item["sale_info"]["sale_type"] = "not";
+            inventory["items"].append(item);
+        }
+        values.push_back(inventory);
+
+        LLSD mesh_header;
+        mesh_header["version"] = 1;
+        mesh_header["creator"] = LLUUID::generateNewID();
+        mesh_header["date"] = LLDate::now();
+        S32 offset = 0;
+        for (const char* lod : { "lowest_lod", "low_lod", "medium_lod", "high_lod", "skin", "physics_convex" })
+        {
+            mesh_header[lod]["offset"] = offset;
+            mesh_header[lod]["size"] = 4096;
+            offset += 4096;
+        }
+        values.push_back(mesh_header);
+
+        LLSD media;
+        media["object_id"] = LLUUID::generateNewID();
+        media["object_media_version"] = "x-mv:0000000003/00000000-0000-0000-0000-000000000000";
+        for (S32 i = 0; i < 8; ++i)
+        {
+            LLSD entry;
+            entry["current_url"] = LLURI("https://example.com/page");
+            entry["home_url"] = "https://example.com/";
+            entry["auto_play"] = true;
+            entry["auto_scale"] = true;
+            entry["controls"] = 0;
+            entry["width_pixels"] = 1024;
+            entry["height_pixels"] = 1024;
+            entry["whitelist"].append("example.com");
+            entry["texture_key"] = LLSD::Binary(32, (U8)i);
+            entry["scale"] = 1.5;
+            media["object_media_data"].append(entry);
+        }
+        values.push_back(media);
+
+        std::vector<std::string> payloads;
+        for (const LLSD& value : values)
+        {
+            std::ostringstream stream;
+            LLSDSerialize::toBinary(value, stream);
+            payloads.push_back(stream.str());
+        }
+        return payloads;
+    }
+
     template<> template<>
     void TestLLSDBinaryParsingObject::test<11>()
     {
+        // parsing a buffer agrees with parsing a stream
+        std::vector<std::string> payloads = binary_payloads();
+        // notation style strings, duplicate keys, nesting
+        payloads.push_back(std::string("{\0\0\0\2'a'\"b\\\"c\"k\0\0\0\1a1}", 22));
+        payloads.push_back(std::string("[\0\0\0\3[\0\0\0\0]!{\0\0\0\0}]", 19));
+
+        for (const std::string& payload : payloads)
+        {
+            std::istringstream stream(payload);
+            LLSD expected;
+            S32 expected_count = LLSDSerialize::fromBinary(expected, stream, payload.size());
+
+            LLSD actual;
+            size_t parsed_bytes = 0;
+            S32 count = LLSDSerialize::fromBinary(actual, (const U8*)payload.data(), payload.size(), -1, &parsed_bytes);
+            ensure_equals("buffer parse count", count, expected_count);
+            ensure_equals("buffer parse", actual, expected);
+            ensure_equals("buffer parse bytes", parsed_bytes, payload.size());
+        }
+        LLSD first;
+        LLSDSerialize::fromBinary(first, (const U8*)payloads[3].data(), payloads[3].size());
+        ensure_equals("first key", first["a"].asString(), "b\"c");
+
+        // any truncation fails
+        const std::string& media = payloads[2];
+        for (size_t size = 0; size < media.size(); size += 7)
+        {
+            LLSD value;
+            S32 count = LLSDSerialize::fromBinary(value, (const U8*)media.data(), size);
+            ensure(llformat("truncated to %d", (S32)size), count <= 0 && value.isUndefined());
+        }
+
+        // depth limit
+        LLSD value;
+        ensure_equals("depth", LLSDSerialize::fromBinary(value, (const U8*)payloads[4].data(), payloads[4].size(), 1),
+                      LLSDParser::PARSE_FAILURE);
+        ensure_equals("depth ok", LLSDSerialize::fromBinary(value, (const U8*)payloads[4].data(), payloads[4].size(), 2), 4);
+    }
+
+    template<> template<>
+    void TestLLSDBinaryParsingObject::test<12>()
+    {
+        // Parse rate of the stream and buffer parsers over representative
+        // payloads.  Not a pass/fail test.
+        skip_unless_benchmarking();
+        const std::vector<std::string> payloads = binary_payloads();
+        const char* names[] = { "inventory", "mesh header", "object media" };
+        for (size_t i = 0; i < payloads.size(); ++i)
+        {
+            const std::string& payload = payloads[i];
+            const S32 PARSES = llmax(10, (S32)(8 * 1024 * 1024 / payload.size()));
+
+            LLTimer timer;
+            for (S32 j = 0; j < PARSES; ++j)
+            {
+                LLMemoryStream stream((const U8*)payload.data(), (S32)payload.size());
+                LLSD value;
+                LLSDSerialize::fromBinary(value, stream, payload.size());
+            }
+            const F64 stream_seconds = timer.getElapsedTimeF64();
+
+            timer.reset();
+            for (S32 j = 0; j < PARSES; ++j)
+            {
+                LLSD value;
+                LLSDSerialize::fromBinary(value, (const U8*)payload.data(), payload.size());
+            }
+            const F64 buffer_seconds = timer.getElapsedTimeF64();
+
+            const F64 megabytes = (F64)PARSES * payload.size() / (1024.0 * 1024.0);
+            LL_INFOS() << names[i] << " (" << payload.size() << " bytes): "
+                       << llformat("stream %.1f MB/s, buffer %.1f MB/s",
+                                   megabytes / llmax(stream_seconds, 1e-6),
+                                   megabytes / llmax(buffer_seconds, 1e-6))
+                       << LL_ENDL;
+        }
     }
-*/
 
    /**
      * @class TestLLSDCrossCompatible
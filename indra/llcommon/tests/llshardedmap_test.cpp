@@ -0,0 +1,110 @@
+/**
+ * @file   llshardedmap_test.cpp
+ * @brief  Test for llshardedmap.h.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llshardedmap.h"
+// STL headers
+#include <map>
+// std headers
+#include <thread>
+#include <vector>
+// other Linden headers
+#include "../test/lltut.h"
+
+namespace tut
+{
+    struct llshardedmap_data
+    {
+        LLShardedMap<S32, S32, 8> map;
+    };
+    typedef test_group<llshardedmap_data> llshardedmap_group;
+    typedef llshardedmap_group::object object;
+    llshardedmap_group llshardedmapgrp("llshardedmap");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("insert, find, update and erase");
+        ensure("empty", map.empty());
+        for (S32 i = 0; i < 100; ++i)
+        {
+            map.insert(i, i * 2);
+        }
+        ensure_equals("size", map.size(), (size_t)100);
+
+        S32 value = 0;
+        ensure("find", map.find(42, value));
+        ensure_equals("found value", value, 84);
+        ensure("find missing", !map.find(1000, value));
+
+        ensure("update", map.update(42, [](S32& v) { v = -1; }));
+        ensure("update missing", !map.update(1000, [](S32& v) { v = -1; }));
+        ensure("find updated", map.find(42, value));
+        ensure_equals("updated value", value, -1);
+
+        ensure("erase", map.erase(42));
+        ensure("erase missing", !map.erase(42));
+        ensure("erased", !map.contains(42));
+        ensure_equals("size after erase", map.size(), (size_t)99);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("drain");
+        for (S32 i = 0; i < 100; ++i)
+        {
+            map.insert(i, i);
+        }
+        std::map<S32, S32> drained;
+        map.drain([&drained](const S32& key, S32& value) { drained[key] = value; });
+        ensure("drained", map.empty());
+        ensure_equals("drained count", drained.size(), (size_t)100);
+        ensure_equals("drained value", drained[57], 57);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("concurrent updates");
+        const S32 KEYS = 64;
+        const S32 INCREMENTS = 10000;
+        for (S32 i = 0; i < KEYS; ++i)
+        {
+            map.insert(i, 0);
+        }
+
+        std::vector<std::thread> threads;
+        for (S32 t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([this, KEYS, INCREMENTS]()
+            {
+                for (S32 i = 0; i < INCREMENTS; ++i)
+                {
+                    map.update(i % KEYS, [](S32& v) { ++v; });
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        S32 total = 0;
+        for (S32 i = 0; i < KEYS; ++i)
+        {
+            S32 value = 0;
+            ensure("find", map.find(i, value));
+            total += value;
+        }
+        ensure_equals("no lost update", total, 4 * INCREMENTS);
+    }
+}
@@ -26,6 +26,10 @@
 
 #include <boost/fiber/algo/round_robin.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 /*****************************************************************************
 *   Custom fiber scheduler for worker threads
 *****************************************************************************/
@@ -199,3 +203,69 @@ size_t LL::ThreadPoolBase::getWidth(const std::string& name, size_t dft)
         return getConfiguredWidth(name, dft);
     }
 }
+
+/*****************************************************************************
+*   runJobs()
+*****************************************************************************/
+void LL::runJobs(const std::string& name, size_t count, const std::function<void(size_t)>& job)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    WorkQueue::ptr_t queue = count > 1 ? WorkQueue::getInstance(name) : WorkQueue::ptr_t();
+    const size_t helpers = queue ? std::min(count - 1, ThreadPoolBase::getWidth(name, 1)) : 0;
+    if (!helpers)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    // Each thread takes the next job until there are none left. A helper
+    // which only starts once the others are done simply has nothing to do.
+    struct Batch
+    {
+        std::atomic<size_t> mNext { 0 };
+        size_t mRunning { 0 };
+        std::mutex mMutex;
+        std::condition_variable mDone;
+    } batch;
+
+    auto run = [&batch, &job, count]()
+        {
+            for (size_t i = batch.mNext++; i < count; i = batch.mNext++)
+            {
+                job(i);
+            }
+        };
+
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(batch.mMutex);
+            ++batch.mRunning;
+        }
+        bool posted = queue->post([&batch, &run]()
+            {
+                LL_PROFILE_ZONE_NAMED("runJobs helper");
+                run();
+                std::lock_guard<std::mutex> lock(batch.mMutex);
+                if (--batch.mRunning == 0)
+                {
+                    batch.mDone.notify_one();
+                }
+            });
+        if (!posted)
+        {
+            std::lock_guard<std::mutex> lock(batch.mMutex);
+            --batch.mRunning;
+            break;
+        }
+    }
+
+    run();
+
+    std::unique_lock<std::mutex> lock(batch.mMutex);
+    batch.mDone.wait(lock, [&batch]() { return batch.mRunning == 0; });
+}
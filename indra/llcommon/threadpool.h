@@ -16,6 +16,7 @@
 #include "llcoros.h"
 #include "threadpool_fwd.h"
 #include "workqueue.h"
+#include <functional>
 #include <memory>                   // std::unique_ptr
 #include <string>
 #include <thread>
@@ -138,6 +139,15 @@ namespace LL
     /// ThreadPool is shorthand for using the simpler WorkQueue
     using ThreadPool = ThreadPoolUsing<WorkQueue>;
 
+    /**
+     * Runs job(0) to job(count - 1) on the named ThreadPool, the calling
+     * thread taking its share, and returns once they are all done. Without
+     * such a ThreadPool (headless use, shutdown) they simply run in order on
+     * the calling thread. This is meant for short jobs whose results the
+     * caller needs right away, on a ThreadPool which does nothing else.
+     */
+    void runJobs(const std::string& name, size_t count, const std::function<void(size_t)>& job);
+
 } // namespace LL
 
 #endif /* ! defined(LL_THREADPOOL_H) */
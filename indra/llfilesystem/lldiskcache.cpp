@@ -38,6 +38,8 @@
 #include <chrono>
 
 #include "lldiskcache.h"
+#include "lldiskcachejournal.h"
+#include "llpackfilecache.h"
 
  /**
   * The prefix inserted at the start of a cache file filename to
@@ -49,16 +51,88 @@
   */
 static const std::string CACHE_FILENAME_PREFIX("sl_cache");
 
+// Purges between two rescans of the cache folder by the journal
+static constexpr U32 JOURNAL_RESCAN_PURGES = 60;
+
 std::string LLDiskCache::sCacheDir;
+LLPackFileCache* LLDiskCache::sPackFileCache = nullptr;
+LLDiskCacheJournal* LLDiskCache::sJournal = nullptr;
 
 LLDiskCache::LLDiskCache(const std::string& cache_dir,
                          const uintmax_t max_size_bytes,
-                         const bool enable_cache_debug_info) :
+                         const bool enable_cache_debug_info,
+                         const bool use_pack_files,
+                         const bool read_only) :
     mMaxSizeBytes(max_size_bytes),
+    mEvictionCount(0),
+    mEvictionsPerSecond(0.f),
+    mLastPurgeTime(std::chrono::steady_clock::now()),
+    mPurgesSinceRescan(0),
     mEnableCacheDebugInfo(enable_cache_debug_info)
 {
     sCacheDir = cache_dir;
     LLFile::mkdir(cache_dir);
+
+    if (read_only)
+    {
+        // The pack files and the journal can only have a single writer: a
+        // second instance uses one file per asset and scans the folder
+        return;
+    }
+
+    if (use_pack_files)
+    {
+        LLPackFileCache* pack_cache = new LLPackFileCache(cache_dir, max_size_bytes);
+        if (pack_cache->open())
+        {
+            // Migrate whatever the per-file layout left behind
+            pack_cache->importLegacyFiles(CACHE_FILENAME_PREFIX);
+            sPackFileCache = pack_cache;
+        }
+        else
+        {
+            LL_WARNS() << "Unable to open the pack file cache, using one file per asset" << LL_ENDL;
+            delete pack_cache;
+        }
+    }
+
+    if (sPackFileCache)
+    {
+        // The files it describes were just imported
+        LLDiskCacheJournal::removeFile(cache_dir);
+    }
+    else
+    {
+        LLDiskCacheJournal* journal = new LLDiskCacheJournal(cache_dir, CACHE_FILENAME_PREFIX);
+        if (journal->open())
+        {
+            sJournal = journal;
+        }
+        else
+        {
+            LL_WARNS() << "Unable to open the disk cache journal, purges will scan the cache folder" << LL_ENDL;
+            delete journal;
+        }
+    }
+}
+
+LLDiskCache::~LLDiskCache()
+{
+    if (sPackFileCache)
+    {
+        LLPackFileCache* pack_cache = sPackFileCache;
+        sPackFileCache = nullptr;
+        pack_cache->close();
+        delete pack_cache;
+    }
+
+    if (sJournal)
+    {
+        LLDiskCacheJournal* journal = sJournal;
+        sJournal = nullptr;
+        journal->close();
+        delete journal;
+    }
 }
 
 // WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
@@ -91,6 +165,59 @@ LLDiskCache::LLDiskCache(const std::string& cache_dir,
 // asset will have to be re-requested.
 void LLDiskCache::purge()
 {
+    if (sPackFileCache)
+    {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        U32 evicted = sPackFileCache->purge();
+        sPackFileCache->saveIndex();
+        if (mEnableCacheDebugInfo)
+        {
+            auto end_time = std::chrono::high_resolution_clock::now();
+            auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+            LL_INFOS() << "Pack cache purge took " << execute_time << " ms to evict " << evicted << " entries" << LL_ENDL;
+        }
+        updatePurgeStats(evicted);
+        return;
+    }
+
+    if (sJournal)
+    {
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        // Pick up the files the journal has no record of (written by a read
+        // only instance) once in a while, an hour at the purge thread pace
+        if (++mPurgesSinceRescan >= JOURNAL_RESCAN_PURGES)
+        {
+            mPurgesSinceRescan = 0;
+            sJournal->rescan();
+        }
+
+        // Only the evicted files get touched
+        const std::vector<LLUUID> evicted = sJournal->collectEvictions(mMaxSizeBytes);
+        boost::system::error_code ec;
+        for (const LLUUID& id : evicted)
+        {
+            const std::string file_path = metaDataToFilepath(id, LLAssetType::AT_NONE);
+            boost::filesystem::remove(file_path, ec);
+            if (ec.failed())
+            {
+                LL_WARNS() << "Failed to delete cache file " << file_path << ": " << ec.message() << LL_ENDL;
+            }
+        }
+
+        updatePurgeStats((U32)evicted.size());
+
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        if (mEnableCacheDebugInfo || !evicted.empty())
+        {
+            LL_INFOS() << "Cache purge evicted " << evicted.size() << " files in " << execute_time << " ms: "
+                       << sJournal->getEntryCount() << " entries, " << sJournal->getTotalBytes() << "/" << mMaxSizeBytes
+                       << " bytes, " << mEvictionsPerSecond << " evictions/s" << LL_ENDL;
+        }
+        return;
+    }
+
     if (mEnableCacheDebugInfo)
     {
         LL_INFOS() << "Total dir size before purge is " << dirFileSize(sCacheDir) << LL_ENDL;
@@ -196,6 +323,16 @@ void LLDiskCache::purge()
     }
 }
 
+void LLDiskCache::updatePurgeStats(U32 evicted)
+{
+    // Only ever called by the purging thread
+    const auto now = std::chrono::steady_clock::now();
+    const F32 elapsed = std::chrono::duration<F32>(now - mLastPurgeTime).count();
+    mLastPurgeTime = now;
+    mEvictionCount += evicted;
+    mEvictionsPerSecond = elapsed > 0.f ? (F32)evicted / elapsed : 0.f;
+}
+
 const std::string LLDiskCache::metaDataToFilepath(const LLUUID& id, LLAssetType::EType at)
 {
     return llformat("%s%s%s_%s_0.asset", sCacheDir.c_str(), gDirUtilp->getDirDelimiter().c_str(), CACHE_FILENAME_PREFIX.c_str(), id.asString().c_str());
@@ -206,18 +343,47 @@ const std::string LLDiskCache::getCacheInfo()
     std::ostringstream cache_info;
 
     F32 max_in_mb = (F32)mMaxSizeBytes / (1024.0f * 1024.0f);
-    F32 percent_used = ((F32)dirFileSize(sCacheDir) / (F32)mMaxSizeBytes) * 100.0f;
+    uintmax_t used_bytes = 0;
+    if (sPackFileCache)
+    {
+        used_bytes = sPackFileCache->getUsedBytes();
+    }
+    else if (sJournal)
+    {
+        used_bytes = sJournal->getTotalBytes();
+    }
+    else
+    {
+        used_bytes = dirFileSize(sCacheDir);
+    }
+    F32 percent_used = ((F32)used_bytes / (F32)mMaxSizeBytes) * 100.0f;
 
     cache_info << std::fixed;
     cache_info << std::setprecision(1);
     cache_info << "Max size " << max_in_mb << " MB ";
     cache_info << "(" << percent_used << "% used)";
+    if (sPackFileCache)
+    {
+        cache_info << ", " << sPackFileCache->getEntryCount() << " packed assets";
+    }
+    else if (sJournal)
+    {
+        cache_info << ", " << sJournal->getEntryCount() << " assets";
+        cache_info << ", journal loaded in " << sJournal->getReplayTime() * 1000.f << " ms";
+    }
+    cache_info << ", " << mEvictionCount << " evictions (" << mEvictionsPerSecond << "/s)";
 
     return cache_info.str();
 }
 
 void LLDiskCache::clearCache()
 {
+    if (sPackFileCache)
+    {
+        sPackFileCache->clear();
+        sPackFileCache->saveIndex();
+    }
+
     /**
      * See notes on performance in dirFileSize(..) - there may be
      * a quicker way to do this by operating on the parent dir vs
@@ -249,6 +415,11 @@ void LLDiskCache::clearCache()
             iter.increment(ec);
         }
     }
+
+    if (sJournal)
+    {
+        sJournal->clear();
+    }
 }
 
 void LLDiskCache::removeOldVFSFiles()
@@ -285,6 +456,23 @@ void LLDiskCache::removeOldVFSFiles()
     }
 }
 
+void LLDiskCache::removePackFiles()
+{
+    if (!sPackFileCache)
+    {
+        LLPackFileCache::removeFiles(sCacheDir);
+    }
+}
+
+// static
+void LLDiskCache::flushJournal()
+{
+    if (sJournal)
+    {
+        sJournal->flush();
+    }
+}
+
 uintmax_t LLDiskCache::dirFileSize(const std::string& dir)
 {
     uintmax_t total_file_size = 0;
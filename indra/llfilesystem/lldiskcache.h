@@ -28,6 +28,10 @@
  *    directory, sorts them by date of last access (write) and then
  *    deletes any files based on age until the total size of all
  *    the files is less than the maximum size specified.
+ *    When the access journal is available (see lldiskcachejournal.h),
+ *    the sizes and access order are tracked as files get written and
+ *    read instead, and the purge only deletes what is needed without
+ *    listing the directory.
  * 4/ An LLSingleton idiom is used since there will only ever be
  *    a single cache and we want to access it from numerous places.
  * 5/ Performance on my modest system seems very acceptable. For
@@ -64,6 +68,12 @@
 
 #include "llsingleton.h"
 
+#include <atomic>
+#include <chrono>
+
+class LLDiskCacheJournal;
+class LLPackFileCache;
+
 class LLDiskCache :
     public LLParamSingleton<LLDiskCache>
 {
@@ -92,9 +102,20 @@ class LLDiskCache :
                      * if there are bugs, we can ask uses to enable this
                      * setting and send us their logs
                      */
-                    const bool enable_cache_debug_info);
+                    const bool enable_cache_debug_info,
+                    /**
+                     * When set, assets are stored in a few large memory-mapped
+                     * pack files (see llpackfilecache.h) instead of one file per
+                     * asset. Defined by the setting at 'DiskCacheUsePackFiles'
+                     */
+                    const bool use_pack_files = false,
+                    /**
+                     * Set for a second viewer instance, which must not modify
+                     * the pack files nor the access journal of the first one
+                     */
+                    const bool read_only = false);
 
-        virtual ~LLDiskCache() = default;
+        virtual ~LLDiskCache();
 
     public:
         /**
@@ -108,7 +129,8 @@ class LLDiskCache :
 
         /**
          * Purge the oldest items in the cache so that the combined size of all files
-         * is no bigger than mMaxSizeBytes.
+         * is no bigger than mMaxSizeBytes. With the pack file backend, this only
+         * walks the evicted entries and also saves the pack index.
          *
          * WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
          * NOT touch any LLDiskCache data without introducing and locking a mutex!
@@ -133,6 +155,32 @@ class LLDiskCache :
 
         void removeOldVFSFiles();
 
+        /**
+         * Remove the files left by the pack file backend once it has been
+         * disabled. Must not be called by a second (read only) instance.
+         */
+        void removePackFiles();
+
+        /**
+         * The pack file backend, or nullptr when the cache uses one file
+         * per asset. LLFileSystem forwards all its operations to it when set.
+         */
+        static LLPackFileCache* getPackFileCache() { return sPackFileCache; }
+
+        /**
+         * The access journal, or nullptr when purging has to scan the cache
+         * folder (pack files, read only instance or unwritable journal).
+         * LLFileSystem records its writes, reads and removals in it.
+         */
+        static LLDiskCacheJournal* getJournal() { return sJournal; }
+
+        /**
+         * Hand the journal records of the last frame to the OS. Called once
+         * per frame by the viewer, closing the journal at shutdown writes
+         * the rest.
+         */
+        static void flushJournal();
+
     private:
         /**
          * Utility function to gather the total size the files in a given
@@ -141,6 +189,11 @@ class LLDiskCache :
          */
         uintmax_t dirFileSize(const std::string& dir);
 
+        /**
+         * Update the eviction counters after a purge
+         */
+        void updatePurgeStats(U32 evicted);
+
     private:
         /**
          * The maximum size of the cache in bytes. After purge is called, the
@@ -157,6 +210,29 @@ class LLDiskCache :
          */
         static std::string sCacheDir;
 
+        /**
+         * The pack file backend, when enabled and successfully opened
+         */
+        static LLPackFileCache* sPackFileCache;
+
+        /**
+         * The access journal of the one file per asset layout, when in use
+         */
+        static LLDiskCacheJournal* sJournal;
+
+        /**
+         * Purge statistics, updated by LLPurgeDiskCacheThread and displayed
+         * in the About box
+         */
+        std::atomic<U32> mEvictionCount;
+        std::atomic<F32> mEvictionsPerSecond;
+        std::chrono::steady_clock::time_point mLastPurgeTime;
+
+        /**
+         * Purges since the journal last rescanned the cache folder
+         */
+        std::atomic<U32> mPurgesSinceRescan;
+
         /**
          * When enabled, displays additional debugging information in
          * various parts of the code
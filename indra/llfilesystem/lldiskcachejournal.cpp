@@ -0,0 +1,499 @@
+/**
+ * @file lldiskcachejournal.cpp
+ * @brief Incremental LRU bookkeeping for the one file per asset disk cache.
+ *
+ * See the header for a description of how this is supposed to work.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lldiskcachejournal.h"
+
+#include "lldir.h"
+#include "lltimer.h"
+#include <boost/filesystem.hpp>
+
+static const std::string JOURNAL_FILENAME("disk_cache.journal");
+
+static constexpr U32 JOURNAL_MAGIC = 0x4E524A4C;   // "LJRN"
+static constexpr U32 JOURNAL_VERSION = 1;
+
+// Same threshold as LLFileSystem::updateFileAccessTime(), see SL-14582
+static constexpr U32 ACCESS_TIME_THRESHOLD = 60 * 60;
+
+struct LLJournalHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U32 mClean;         // set when the journal was written at shutdown
+    U32 mReserved;
+};
+
+struct LLJournalRecord
+{
+    U8 mOp;
+    U8 mPad[3];
+    U32 mTime;
+    U64 mSize;
+    U8 mID[UUID_BYTES];
+};
+static_assert(sizeof(LLJournalRecord) == 32, "Unexpected journal record size");
+
+LLDiskCacheJournal::LLDiskCacheJournal(const std::string& cache_dir, const std::string& filename_prefix) :
+    mCacheDir(cache_dir),
+    mFilenamePrefix(filename_prefix),
+    mJournalFilename(cache_dir + gDirUtilp->getDirDelimiter() + JOURNAL_FILENAME),
+    mUnflushed(false),
+    mTotalBytes(0),
+    mReplayTime(0.f)
+{
+}
+
+LLDiskCacheJournal::~LLDiskCacheJournal()
+{
+    close();
+}
+
+bool LLDiskCacheJournal::open()
+{
+    LLMutexLock lock(&mMutex);
+    LLTimer timer;
+
+    bool clean = false;
+    if (!replay(clean))
+    {
+        // First run, or the journal was lost: rebuild it from the files
+        mEntries.clear();
+        mLRU.clear();
+        mTotalBytes = 0;
+        scanDirectory();
+    }
+    else if (!clean)
+    {
+        // The records still buffered when the previous session died are
+        // lost, the files they described would never get evicted
+        std::vector<FileInfo> files;
+        listFiles(files);
+        mergeFiles(files, (U32)time(nullptr));
+    }
+
+    // Compact the journal and mark it as in use, so that a crash from now on
+    // gets detected by the next session.
+    bool success = rewrite(false);
+    mReplayTime = timer.getElapsedTimeF32();
+
+    LL_INFOS() << "Disk cache journal: " << mEntries.size() << " entries, " << mTotalBytes
+               << " bytes, loaded in " << mReplayTime * 1000.f << " ms" << LL_ENDL;
+    return success;
+}
+
+void LLDiskCacheJournal::close()
+{
+    LLMutexLock lock(&mMutex);
+    if (mJournal)
+    {
+        // Write a compact, clean journal for the next session
+        rewrite(true);
+        mJournal.close();
+    }
+}
+
+bool LLDiskCacheJournal::replay(bool& clean)
+{
+    LLUniqueFile file = LLFile::fopen(mJournalFilename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    LLJournalHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.mMagic != JOURNAL_MAGIC || header.mVersion != JOURNAL_VERSION)
+    {
+        LL_WARNS() << "Ignoring disk cache journal with an unknown format" << LL_ENDL;
+        return false;
+    }
+    clean = header.mClean != 0;
+    if (!clean)
+    {
+        // The records that were not flushed yet are lost, open() rescans
+        LL_INFOS() << "Disk cache journal was not closed cleanly, recovering" << LL_ENDL;
+    }
+
+    constexpr size_t RECORDS_PER_READ = 1024;
+    std::vector<LLJournalRecord> records(RECORDS_PER_READ);
+    size_t count = 0;
+    while ((count = fread(records.data(), sizeof(LLJournalRecord), RECORDS_PER_READ, file)) > 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const LLJournalRecord& record = records[i];
+            LLUUID id;
+            memcpy(id.mData, record.mID, UUID_BYTES);
+            apply((EOperation)record.mOp, id, record.mTime, record.mSize);
+        }
+    }
+    return true;
+}
+
+void LLDiskCacheJournal::listFiles(std::vector<FileInfo>& files) const
+{
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    std::wstring cache_path(utf8str_to_utf16str(mCacheDir));
+#else
+    std::string cache_path(mCacheDir);
+#endif
+    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
+    {
+        boost::filesystem::directory_iterator iter(cache_path, ec);
+        while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+        {
+            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
+            {
+                // File names are <prefix>_<uuid>_<extra>.asset
+                const std::string filename = (*iter).path().filename().string();
+                if (filename.compare(0, mFilenamePrefix.size(), mFilenamePrefix) == 0 &&
+                    filename.size() >= mFilenamePrefix.size() + UUID_STR_LENGTH)
+                {
+                    const std::string id_str = filename.substr(mFilenamePrefix.size() + 1, UUID_STR_LENGTH - 1);
+                    uintmax_t file_size = boost::filesystem::file_size(*iter, ec);
+                    std::time_t file_time = 0;
+                    if (!ec.failed())
+                    {
+                        file_time = boost::filesystem::last_write_time(*iter, ec);
+                    }
+                    if (!ec.failed() && LLUUID::validate(id_str))
+                    {
+                        files.push_back({ file_time, LLUUID(id_str), file_size });
+                    }
+                }
+            }
+            iter.increment(ec);
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](const FileInfo& x, const FileInfo& y)
+    {
+        return x.mTime < y.mTime;
+    });
+}
+
+void LLDiskCacheJournal::scanDirectory()
+{
+    std::vector<FileInfo> files;
+    listFiles(files);
+    // Oldest first, so that the most recent ones end up at the front
+    for (const FileInfo& info : files)
+    {
+        apply(OP_WRITE, info.mID, (U32)info.mTime, info.mSize);
+    }
+}
+
+void LLDiskCacheJournal::mergeFiles(const std::vector<FileInfo>& files, U32 scan_time)
+{
+    std::unordered_map<LLUUID, const FileInfo*> found;
+    found.reserve(files.size());
+    for (const FileInfo& info : files)
+    {
+        found[info.mID] = &info;
+    }
+
+    // Entries without a file, unless recorded since the scan started
+    U32 removed = 0;
+    for (auto it = mEntries.begin(); it != mEntries.end(); )
+    {
+        const LLUUID id = it->first;
+        const bool stale = it->second.mAccessTime < scan_time && !found.count(id);
+        ++it;
+        if (stale)
+        {
+            apply(OP_REMOVE, id, 0, 0);
+            append(OP_REMOVE, id, 0, 0);
+            ++removed;
+        }
+    }
+
+    // Files without an entry, slotted in the LRU list by their last write
+    // time. Newest first, walking the list from its most recent end.
+    U32 added = 0;
+    auto pos = mLRU.begin();
+    for (auto file = files.rbegin(); file != files.rend(); ++file)
+    {
+        if (mEntries.count(file->mID))
+        {
+            continue;
+        }
+        const U32 file_time = (U32)file->mTime;
+        while (pos != mLRU.end() && mEntries[*pos].mAccessTime > file_time)
+        {
+            ++pos;
+        }
+        Entry& entry = mEntries[file->mID];
+        entry.mSize = file->mSize;
+        entry.mAccessTime = file_time;
+        entry.mLRU = mLRU.insert(pos, file->mID);
+        mTotalBytes += file->mSize;
+        ++added;
+    }
+
+    if (added || removed)
+    {
+        LL_INFOS() << "Disk cache journal rescan of " << mCacheDir << ": " << added << " files added, "
+                   << removed << " entries without a file removed" << LL_ENDL;
+    }
+}
+
+void LLDiskCacheJournal::rescan()
+{
+    const U32 scan_time = (U32)time(nullptr);
+    std::vector<FileInfo> files;
+    listFiles(files);
+
+    LLMutexLock lock(&mMutex);
+    if (mJournal)
+    {
+        mergeFiles(files, scan_time);
+    }
+}
+
+bool LLDiskCacheJournal::rewrite(bool clean)
+{
+    mJournal.close();
+    mUnflushed = false;
+
+    const std::string temp_filename = mJournalFilename + ".tmp";
+    {
+        LLUniqueFile file = LLFile::fopen(temp_filename, "wb");
+        if (!file)
+        {
+            LL_WARNS() << "Unable to write the disk cache journal" << LL_ENDL;
+            return false;
+        }
+
+        LLJournalHeader header = { JOURNAL_MAGIC, JOURNAL_VERSION, clean ? 1U : 0U, 0 };
+        bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+
+        // Oldest first, replaying moves each entry to the front in turn
+        for (auto it = mLRU.rbegin(); success && it != mLRU.rend(); ++it)
+        {
+            Entry& entry = mEntries[*it];
+            LLJournalRecord record = {};
+            record.mOp = OP_WRITE;
+            record.mTime = entry.mAccessTime;
+            record.mSize = entry.mSize;
+            memcpy(record.mID, it->mData, UUID_BYTES);
+            success = fwrite(&record, sizeof(record), 1, file) == 1;
+            entry.mJournalTime = entry.mAccessTime;
+        }
+        if (!success)
+        {
+            LL_WARNS() << "Unable to write the disk cache journal" << LL_ENDL;
+            return false;
+        }
+    }
+
+    LLFile::remove(mJournalFilename, ENOENT);
+    if (LLFile::rename(temp_filename, mJournalFilename) != 0)
+    {
+        return false;
+    }
+    mJournal = LLFile::fopen(mJournalFilename, "r+b");
+    if (mJournal)
+    {
+        fseek(mJournal, 0, SEEK_END);
+    }
+    return bool(mJournal);
+}
+
+void LLDiskCacheJournal::apply(EOperation op, const LLUUID& id, U32 time, uintmax_t size)
+{
+    auto it = mEntries.find(id);
+    switch (op)
+    {
+    case OP_WRITE:
+        if (it == mEntries.end())
+        {
+            it = mEntries.emplace(id, Entry()).first;
+            it->second.mLRU = mLRU.insert(mLRU.begin(), id);
+        }
+        else
+        {
+            mTotalBytes -= it->second.mSize;
+        }
+        it->second.mSize = size;
+        mTotalBytes += size;
+        [[fallthrough]];
+    case OP_ACCESS:
+        if (it != mEntries.end())
+        {
+            it->second.mAccessTime = time;
+            mLRU.splice(mLRU.begin(), mLRU, it->second.mLRU);
+        }
+        break;
+
+    case OP_REMOVE:
+        if (it != mEntries.end())
+        {
+            mTotalBytes -= it->second.mSize;
+            mLRU.erase(it->second.mLRU);
+            mEntries.erase(it);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void LLDiskCacheJournal::append(EOperation op, const LLUUID& id, U32 time, uintmax_t size)
+{
+    if (!mJournal)
+    {
+        return;
+    }
+
+    LLJournalRecord record = {};
+    record.mOp = op;
+    record.mTime = time;
+    record.mSize = size;
+    memcpy(record.mID, id.mData, UUID_BYTES);
+    // Buffered until the next flush(), reads may append one per asset
+    if (fwrite(&record, sizeof(record), 1, mJournal) == 1)
+    {
+        mUnflushed = true;
+    }
+}
+
+void LLDiskCacheJournal::flush()
+{
+    LLMutexLock lock(&mMutex);
+    if (mJournal && mUnflushed)
+    {
+        fflush(mJournal);
+        mUnflushed = false;
+    }
+}
+
+void LLDiskCacheJournal::recordWrite(const LLUUID& id, uintmax_t end_offset, bool truncated)
+{
+    LLMutexLock lock(&mMutex);
+    const U32 now = (U32)time(nullptr);
+    uintmax_t size = end_offset;
+    auto it = mEntries.find(id);
+    if (!truncated && it != mEntries.end())
+    {
+        size = llmax(size, it->second.mSize);
+    }
+    apply(OP_WRITE, id, now, size);
+    append(OP_WRITE, id, now, size);
+    mEntries[id].mJournalTime = now;
+}
+
+void LLDiskCacheJournal::recordAccess(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+    auto it = mEntries.find(id);
+    if (it == mEntries.end())
+    {
+        return;
+    }
+
+    const U32 now = (U32)time(nullptr);
+    apply(OP_ACCESS, id, now, 0);
+    if (now - it->second.mJournalTime > ACCESS_TIME_THRESHOLD)
+    {
+        append(OP_ACCESS, id, now, 0);
+        it->second.mJournalTime = now;
+    }
+}
+
+void LLDiskCacheJournal::recordRemove(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+    if (mEntries.count(id))
+    {
+        apply(OP_REMOVE, id, 0, 0);
+        append(OP_REMOVE, id, 0, 0);
+    }
+}
+
+void LLDiskCacheJournal::recordRename(const LLUUID& old_id, const LLUUID& new_id)
+{
+    LLMutexLock lock(&mMutex);
+    auto it = mEntries.find(old_id);
+    if (it == mEntries.end())
+    {
+        return;
+    }
+
+    const uintmax_t size = it->second.mSize;
+    const U32 now = (U32)time(nullptr);
+    apply(OP_REMOVE, old_id, 0, 0);
+    append(OP_REMOVE, old_id, 0, 0);
+    apply(OP_WRITE, new_id, now, size);
+    append(OP_WRITE, new_id, now, size);
+    mEntries[new_id].mJournalTime = now;
+}
+
+std::vector<LLUUID> LLDiskCacheJournal::collectEvictions(uintmax_t max_size_bytes)
+{
+    LLMutexLock lock(&mMutex);
+    std::vector<LLUUID> evicted;
+    while (mTotalBytes > max_size_bytes && !mLRU.empty())
+    {
+        const LLUUID id = mLRU.back();
+        apply(OP_REMOVE, id, 0, 0);
+        append(OP_REMOVE, id, 0, 0);
+        evicted.push_back(id);
+    }
+    return evicted;
+}
+
+void LLDiskCacheJournal::clear()
+{
+    LLMutexLock lock(&mMutex);
+    mEntries.clear();
+    mLRU.clear();
+    mTotalBytes = 0;
+    rewrite(false);
+}
+
+// static
+void LLDiskCacheJournal::removeFile(const std::string& cache_dir)
+{
+    LLFile::remove(cache_dir + gDirUtilp->getDirDelimiter() + JOURNAL_FILENAME, ENOENT);
+}
+
+U32 LLDiskCacheJournal::getEntryCount()
+{
+    LLMutexLock lock(&mMutex);
+    return (U32)mEntries.size();
+}
+
+uintmax_t LLDiskCacheJournal::getTotalBytes()
+{
+    LLMutexLock lock(&mMutex);
+    return mTotalBytes;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file lldiskcachejournal.h
+ * @brief Incremental LRU bookkeeping for the one file per asset disk cache.
+ *
+ * @Description:
+ * Purging the disk cache used to list every file of the cache folder,
+ * stat() them and sort them by last write time, and reads updated the
+ * last write time of the files. This class keeps the same information
+ * in memory instead:
+ * 1/ A map of the cached assets (size, last access) plus an LRU list
+ *    ordered by last access, and the total size of the cache.
+ * 2/ Every change (write, access, removal) is appended to a small binary
+ *    journal file so that the state survives a restart or a crash. The
+ *    records are buffered until flush(). At startup the journal is
+ *    replayed; the cache folder is only scanned when there is no journal
+ *    yet (first run), or when the previous session did not close it, to
+ *    pick up the files whose records were lost.
+ * 3/ The journal is compacted (rewritten from the in-memory state) at
+ *    startup and shutdown, so it never grows beyond one session of changes.
+ * 4/ Purging pops the least recently used entries until the total size
+ *    fits, so only the files that are actually deleted are touched.
+ * 5/ Files can also be written without a record, by a second (read only)
+ *    viewer instance: rescan() adds the files the journal does not know
+ *    and forgets the entries whose file is gone. The owner calls it once
+ *    in a while, so that those files get evicted too.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLDISKCACHEJOURNAL_H
+#define LL_LLDISKCACHEJOURNAL_H
+
+#include "llfile.h"
+#include "llmutex.h"
+#include "lluuid.h"
+
+#include <list>
+#include <unordered_map>
+
+class LLDiskCacheJournal
+{
+public:
+    LLDiskCacheJournal(const std::string& cache_dir, const std::string& filename_prefix);
+    ~LLDiskCacheJournal();
+
+    /**
+     * Replay the journal, or scan the cache folder when there is none, and
+     * open the journal for appending. Returns false if the journal cannot be
+     * written, in which case the caller should keep using directory scans.
+     */
+    bool open();
+    void close();
+
+    /**
+     * Record a write ending at 'end_offset' in the file of an asset. When
+     * 'truncated' is set, the file was emptied before the write.
+     */
+    void recordWrite(const LLUUID& id, uintmax_t end_offset, bool truncated);
+
+    /**
+     * Record that an asset was read. Only persisted when the last recorded
+     * access is older than an hour, like the last write time updates it
+     * replaces, so as to not wear out SSDs.
+     */
+    void recordAccess(const LLUUID& id);
+
+    void recordRemove(const LLUUID& id);
+    void recordRename(const LLUUID& old_id, const LLUUID& new_id);
+
+    /**
+     * Flush the records appended since the last call. The viewer calls it
+     * once per frame rather than after every record.
+     */
+    void flush();
+
+    /**
+     * Bring the entries in line with the files of the cache folder. Scans
+     * the folder without blocking the record*() calls, so that it can run
+     * on a background thread.
+     */
+    void rescan();
+
+    /**
+     * Pop the least recently used assets until the total size is no more
+     * than 'max_size_bytes' and return them, oldest first. The caller is in
+     * charge of deleting the files.
+     */
+    std::vector<LLUUID> collectEvictions(uintmax_t max_size_bytes);
+
+    /**
+     * Forget every asset and restart the journal from scratch.
+     */
+    void clear();
+
+    /**
+     * Remove the journal of a cache folder, once its files are no longer
+     * managed by it (pack file layout).
+     */
+    static void removeFile(const std::string& cache_dir);
+
+    U32 getEntryCount();
+    uintmax_t getTotalBytes();
+    F32 getReplayTime() const { return mReplayTime; }
+
+private:
+    enum EOperation : U8
+    {
+        OP_WRITE = 1,
+        OP_ACCESS = 2,
+        OP_REMOVE = 3,
+    };
+
+    // A cache file found by listFiles()
+    struct FileInfo
+    {
+        std::time_t mTime;
+        LLUUID mID;
+        uintmax_t mSize;
+    };
+
+    struct Entry
+    {
+        uintmax_t mSize = 0;
+        U32 mAccessTime = 0;        // last access, in seconds since epoch
+        U32 mJournalTime = 0;       // last access written to the journal
+        std::list<LLUUID>::iterator mLRU;
+    };
+    typedef std::unordered_map<LLUUID, Entry> entry_map_t;
+
+    // Oldest first, does not need mMutex
+    void listFiles(std::vector<FileInfo>& files) const;
+
+    // All the helpers below expect mMutex to be held
+    void apply(EOperation op, const LLUUID& id, U32 time, uintmax_t size);
+    void append(EOperation op, const LLUUID& id, U32 time, uintmax_t size);
+    bool replay(bool& clean);
+    void scanDirectory();
+    void mergeFiles(const std::vector<FileInfo>& files, U32 scan_time);
+    bool rewrite(bool clean);
+
+private:
+    std::string mCacheDir;
+    std::string mFilenamePrefix;
+    std::string mJournalFilename;
+
+    LLMutex mMutex;
+    LLUniqueFile mJournal;
+    bool mUnflushed;                // records appended since the last flush()
+    entry_map_t mEntries;
+    std::list<LLUUID> mLRU;         // front is the most recently used
+    uintmax_t mTotalBytes;
+    F32 mReplayTime;                // seconds spent in open()
+};
+
+#endif  // LL_LLDISKCACHEJOURNAL_H
@@ -33,6 +33,8 @@
 #include "llfilesystem.h"
 #include "llfasttimer.h"
 #include "lldiskcache.h"
+#include "lldiskcachejournal.h"
+#include "llpackfilecache.h"
 
 #include "boost/filesystem.hpp"
 
@@ -54,7 +56,13 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
     // This block of code was originally called in the read() method but after comments here:
     // https://bitbucket.org/lindenlab/viewer/commits/e28c1b46e9944f0215a13cab8ee7dded88d7fc90#comment-10537114
     // we decided to follow Henri's suggestion and move the code to update the last access time here.
-    if (mode == LLFileSystem::READ)
+    // The pack file cache keeps track of accesses in its own index, and the
+    // disk cache journal replaces the last write time of the files.
+    if (mode == LLFileSystem::READ && LLDiskCache::getJournal())
+    {
+        LLDiskCache::getJournal()->recordAccess(mFileID);
+    }
+    else if (mode == LLFileSystem::READ && !LLDiskCache::getPackFileCache())
     {
         // build the filename (TODO: we do this in a few places - perhaps we should factor into a single function)
         const std::string filename = LLDiskCache::metaDataToFilepath(mFileID, mFileType);
@@ -75,6 +83,11 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
 bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
     LL_PROFILE_ZONE_SCOPED;
+    if (LLPackFileCache* pack_cache = LLDiskCache::getPackFileCache())
+    {
+        return pack_cache->exists(file_id, file_type);
+    }
+
     const std::string filename = LLDiskCache::metaDataToFilepath(file_id, file_type);
 
     llifstream file(filename, std::ios::binary);
@@ -89,10 +102,21 @@ bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType fil
 // static
 bool LLFileSystem::removeFile(const LLUUID& file_id, const LLAssetType::EType file_type, int suppress_error /*= 0*/)
 {
+    if (LLPackFileCache* pack_cache = LLDiskCache::getPackFileCache())
+    {
+        pack_cache->remove(file_id, file_type);
+        return true;
+    }
+
     const std::string filename = LLDiskCache::metaDataToFilepath(file_id, file_type);
 
     LLFile::remove(filename.c_str(), suppress_error);
 
+    if (LLDiskCacheJournal* journal = LLDiskCache::getJournal())
+    {
+        journal->recordRemove(file_id);
+    }
+
     return true;
 }
 
@@ -100,6 +124,15 @@ bool LLFileSystem::removeFile(const LLUUID& file_id, const LLAssetType::EType fi
 bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::EType old_file_type,
                               const LLUUID& new_file_id, const LLAssetType::EType new_file_type)
 {
+    if (LLPackFileCache* pack_cache = LLDiskCache::getPackFileCache())
+    {
+        if (!pack_cache->rename(old_file_id, old_file_type, new_file_id, new_file_type))
+        {
+            LL_WARNS() << "Failed to rename " << old_file_id << " to " << new_file_id << " in the pack cache" << LL_ENDL;
+        }
+        return true;
+    }
+
     const std::string old_filename = LLDiskCache::metaDataToFilepath(old_file_id, old_file_type);
     const std::string new_filename = LLDiskCache::metaDataToFilepath(new_file_id, new_file_type);
 
@@ -114,6 +147,10 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
         //return false;
         LL_WARNS() << "Failed to rename " << old_file_id << " to " << new_file_id << " reason: " << strerror(errno) << LL_ENDL;
     }
+    else if (LLDiskCacheJournal* journal = LLDiskCache::getJournal())
+    {
+        journal->recordRename(old_file_id, new_file_id);
+    }
 
     return true;
 }
@@ -121,6 +158,11 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
 // static
 S32 LLFileSystem::getFileSize(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
+    if (LLPackFileCache* pack_cache = LLDiskCache::getPackFileCache())
+    {
+        return pack_cache->getSize(file_id, file_type);
+    }
+
     const std::string filename = LLDiskCache::metaDataToFilepath(file_id, file_type);
 
     S32 file_size = 0;
@@ -136,6 +178,13 @@ S32 LLFileSystem::getFileSize(const LLUUID& file_id, const LLAssetType::EType fi
 
 bool LLFileSystem::read(U8* buffer, S32 bytes)
 {
+    if (LLPackFileCache* pack_cache = LLDiskCache::getPackFileCache())
+    {
+        mBytesRead = pack_cache->read(mFileID, mFileType, mPosition, buffer, bytes);
+        mPosition += mBytesRead;
+        return mBytesRead > 0;
+    }
+
     bool success = false;
 
     const std::string filename = LLDiskCache::metaDataToFilepath(mFileID, mFileType);
@@ -180,9 +229,44 @@ bool LLFileSystem::eof() const
 
 bool LLFileSystem::write(const U8* buffer, S32 bytes)
 {
+    if (LLPackFileCache* pack_cache = LLDiskCache::getPackFileCache())
+    {
+        // Same semantics as the file based code below: APPEND writes at the
+        // end, READ_WRITE at the current position and WRITE replaces the
+        // whole content.
+        bool success = false;
+        if (mMode == APPEND)
+        {
+            const S32 size = pack_cache->getSize(mFileID, mFileType);
+            success = pack_cache->write(mFileID, mFileType, size, buffer, bytes, false);
+            if (success)
+            {
+                mPosition = size + bytes;
+            }
+        }
+        else if (mMode == READ_WRITE)
+        {
+            success = pack_cache->write(mFileID, mFileType, mPosition, buffer, bytes, false);
+            if (success)
+            {
+                mPosition += bytes;
+            }
+        }
+        else
+        {
+            success = pack_cache->write(mFileID, mFileType, 0, buffer, bytes, true);
+            if (success)
+            {
+                mPosition += bytes;
+            }
+        }
+        return success;
+    }
+
     const std::string filename = LLDiskCache::metaDataToFilepath(mFileID, mFileType);
 
     bool success = false;
+    bool truncated = false;
 
     if (mMode == APPEND)
     {
@@ -216,6 +300,7 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
                 ofs.write((const char*)buffer, bytes);
                 mPosition += bytes;
                 success = true;
+                truncated = true;
             }
         }
     }
@@ -229,9 +314,17 @@ bool LLFileSystem::write(const U8* buffer, S32 bytes)
             mPosition += bytes;
 
             success = true;
+            truncated = true;
         }
     }
 
+    LLDiskCacheJournal* journal = LLDiskCache::getJournal();
+    if (success && journal)
+    {
+        // A truncated file holds exactly what was just written
+        journal->recordWrite(mFileID, truncated ? bytes : mPosition, truncated);
+    }
+
     return success;
 }
 
@@ -0,0 +1,201 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief A read/write memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if !LL_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static size_t page_size()
+{
+#if LL_WINDOWS
+    static const size_t size = []()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (size_t)info.dwPageSize;
+    }();
+#else
+    static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+    return size;
+}
+
+#if !LL_WINDOWS
+static bool reserve(int file, size_t size)
+{
+#if LL_DARWIN
+    // No posix_fallocate() on macOS: preallocate then grow the file
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0)
+    {
+        return false;
+    }
+    const off_t allocated = (off_t)file_stat.st_blocks * 512;
+    if (file_stat.st_size >= (off_t)size && allocated >= (off_t)size)
+    {
+        return true;
+    }
+    // from the end of the allocated space
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size - allocated, 0 };
+    if (fcntl(file, F_PREALLOCATE, &store) == -1)
+    {
+        store.fst_flags = F_ALLOCATEALL;
+        if (fcntl(file, F_PREALLOCATE, &store) == -1)
+        {
+            return false;
+        }
+    }
+    return file_stat.st_size >= (off_t)size || ftruncate(file, (off_t)size) == 0;
+#else
+    // Only allocates the missing blocks, and grows the file when shorter
+    const int err = posix_fallocate(file, 0, (off_t)size);
+    errno = err;
+    return err == 0;
+#endif
+}
+#endif
+
+bool LLMappedFile::map(const std::string& filename, size_t size)
+{
+    unmap();
+    if (!size)
+    {
+        return false;
+    }
+
+#if LL_WINDOWS
+    mFile = CreateFileW(utf8str_to_utf16str(filename).c_str(), GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        LL_WARNS() << "Unable to open " << filename << LL_ENDL;
+        return false;
+    }
+    // Creating the mapping grows the file to 'size' when needed, allocating
+    // the disk space for it: NTFS only leaves holes in files marked sparse
+    const U64 size64 = (U64)size;
+    mMapping = CreateFileMappingW(mFile, NULL, PAGE_READWRITE, (DWORD)(size64 >> 32), (DWORD)size64, NULL);
+    if (mMapping)
+    {
+        mAddress = (U8*)MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    }
+#else
+    mFile = ::open(filename.c_str(), O_RDWR | O_CREAT, 0600);
+    if (mFile < 0)
+    {
+        LL_WARNS() << "Unable to open " << filename << ": " << strerror(errno) << LL_ENDL;
+        return false;
+    }
+    // Writing to a page of the mapping that the file system can't find space
+    // for raises SIGBUS, so reserve the whole size now, which also allocates
+    // the holes of a sparse file left by an older version
+    if (!reserve(mFile, size))
+    {
+        LL_WARNS() << "Unable to reserve " << size << " bytes for " << filename << ": " << strerror(errno) << LL_ENDL;
+        unmap();
+        return false;
+    }
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0);
+    if (address != MAP_FAILED)
+    {
+        mAddress = (U8*)address;
+    }
+#endif
+    if (!mAddress)
+    {
+        LL_WARNS() << "Unable to map " << filename << LL_ENDL;
+        unmap();
+        return false;
+    }
+    mSize = size;
+    return true;
+}
+
+void LLMappedFile::unmap()
+{
+#if LL_WINDOWS
+    if (mAddress)
+    {
+        UnmapViewOfFile(mAddress);
+    }
+    if (mMapping)
+    {
+        CloseHandle(mMapping);
+        mMapping = NULL;
+    }
+    if (mFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFile);
+        mFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mAddress)
+    {
+        munmap(mAddress, mSize);
+    }
+    if (mFile >= 0)
+    {
+        ::close(mFile);
+        mFile = -1;
+    }
+#endif
+    mAddress = nullptr;
+    mSize = 0;
+}
+
+void LLMappedFile::flush(bool sync)
+{
+    flush(0, mSize, sync);
+}
+
+void LLMappedFile::flush(size_t offset, size_t size, bool sync)
+{
+    if (!mAddress || offset >= mSize || !size)
+    {
+        return;
+    }
+    size = llmin(size, mSize - offset);
+
+    // Both msync() and FlushViewOfFile() want a page aligned address
+    const size_t start = offset - offset % page_size();
+    size += offset - start;
+#if LL_WINDOWS
+    FlushViewOfFile(mAddress + start, size);
+    if (sync)
+    {
+        FlushFileBuffers(mFile);
+    }
+#else
+    msync(mAddress + start, size, sync ? MS_SYNC : MS_ASYNC);
+#endif
+}
@@ -0,0 +1,76 @@
+/**
+ * @file llmappedfile.h
+ * @brief A read/write memory mapping of a whole file.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#if LL_WINDOWS
+#include "llwin32headers.h"
+#endif
+
+//
+// Maps the first 'size' bytes of a file in memory, shared with the file so
+// that writes to the mapping end up in the file. The file is created when
+// missing, grown to 'size' bytes when shorter, and disk space is reserved
+// for all of it: mapping fails when the disk is too full, rather than later
+// writes to the mapping (which would raise SIGBUS).
+//
+// This class does no locking: concurrent accesses to the same bytes must be
+// serialized by the caller.
+//
+class LLMappedFile
+{
+public:
+    LLMappedFile() = default;
+    ~LLMappedFile() { unmap(); }
+
+    LLMappedFile(const LLMappedFile&) = delete;
+    LLMappedFile& operator=(const LLMappedFile&) = delete;
+
+    bool map(const std::string& filename, size_t size);
+    void unmap();
+
+    // Schedule (or, when 'sync' is true, wait for) the write back of the
+    // modified pages to the file. The range is extended to whole pages.
+    void flush(bool sync);
+    void flush(size_t offset, size_t size, bool sync);
+
+    bool isMapped() const { return mAddress != nullptr; }
+    U8* getAddress() const { return mAddress; }
+    size_t getSize() const { return mSize; }
+
+private:
+    U8* mAddress = nullptr;
+    size_t mSize = 0;
+#if LL_WINDOWS
+    HANDLE mFile = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = NULL;
+#else
+    int mFile = -1;
+#endif
+};
+
+#endif  // LL_LLMAPPEDFILE_H
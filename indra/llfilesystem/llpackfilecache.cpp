@@ -0,0 +1,835 @@
+/**
+ * @file llpackfilecache.cpp
+ * @brief An indexed, memory-mapped backend for the asset disk cache.
+ *
+ * See the header for a description of how this is supposed to work.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpackfilecache.h"
+
+#include "lldir.h"
+#include "llfile.h"
+#include "llmappedfile.h"
+#include <boost/filesystem.hpp>
+
+static const std::string PACK_FILENAME_PREFIX("sl_pack");
+static const std::string PACK_INDEX_FILENAME("sl_pack.idx");
+
+static constexpr U32 INDEX_MAGIC = 0x4B50534C;  // "LSPK"
+static constexpr U32 INDEX_VERSION = 1;
+static constexpr U32 INDEX_HEADER_SIZE = 6 * sizeof(U32);
+static constexpr U32 INDEX_RECORD_SIZE = 40;
+
+// Every extent starts with this header, so that stale index entries can be
+// detected after a crash (see the header file).
+struct LLPackExtentHeader
+{
+    U32 mMagic;
+    S32 mType;
+    U8 mID[UUID_BYTES];
+    U32 mSize;
+    U32 mReserved;
+};
+static constexpr U32 EXTENT_MAGIC = 0x5458454C;  // "LEXT"
+static constexpr U32 EXTENT_HEADER_SIZE = sizeof(LLPackExtentHeader);
+static_assert(EXTENT_HEADER_SIZE == 32, "Unexpected pack extent header size");
+
+static std::string slab_filename(const std::string& dir, U32 slab)
+{
+    return llformat("%s%s%s_%02u.slab", dir.c_str(), gDirUtilp->getDirDelimiter().c_str(), PACK_FILENAME_PREFIX.c_str(), slab);
+}
+
+static std::string index_filename(const std::string& dir)
+{
+    return dir + gDirUtilp->getDirDelimiter() + PACK_INDEX_FILENAME;
+}
+
+//----------------------------------------------------------------------------
+// A memory-mapped slab file and the list of its free extents.
+//----------------------------------------------------------------------------
+class LLPackFileCache::Slab
+{
+public:
+    bool map(const std::string& filename);
+    void unmap() { mFile.unmap(); }
+    void flush(bool sync) { mFile.flush(sync); }
+
+    U8* getAddress() const { return mFile.getAddress(); }
+
+    // Free space management. mFreeByBlock is used for coalescing adjacent
+    // extents, mFreeBySize for best-fit allocations.
+    void resetFreeSpace();
+    bool take(U32 blocks, U32& block);
+    void give(U32 block, U32 blocks);
+    bool carve(U32 block, U32 blocks);
+    U32 largestFree() const { return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first; }
+
+private:
+    void insertFree(U32 block, U32 blocks);
+    void eraseFree(std::map<U32, U32>::iterator it);
+
+    LLMappedFile mFile;
+    std::map<U32, U32> mFreeByBlock;            // first block -> length
+    std::set<std::pair<U32, U32>> mFreeBySize;  // (length, first block)
+};
+
+bool LLPackFileCache::Slab::map(const std::string& filename)
+{
+    // A slab takes its whole size on disk as soon as it is mapped, so that a
+    // full disk fails here rather than when writing an asset into it.
+    if (!mFile.map(filename, SLAB_SIZE))
+    {
+        LL_WARNS() << "Unable to map pack cache slab " << filename << LL_ENDL;
+        return false;
+    }
+    resetFreeSpace();
+    return true;
+}
+
+void LLPackFileCache::Slab::resetFreeSpace()
+{
+    mFreeByBlock.clear();
+    mFreeBySize.clear();
+    insertFree(0, BLOCKS_PER_SLAB);
+}
+
+void LLPackFileCache::Slab::insertFree(U32 block, U32 blocks)
+{
+    mFreeByBlock[block] = blocks;
+    mFreeBySize.emplace(blocks, block);
+}
+
+void LLPackFileCache::Slab::eraseFree(std::map<U32, U32>::iterator it)
+{
+    mFreeBySize.erase(std::make_pair(it->second, it->first));
+    mFreeByBlock.erase(it);
+}
+
+bool LLPackFileCache::Slab::take(U32 blocks, U32& block)
+{
+    auto fit = mFreeBySize.lower_bound(std::make_pair(blocks, 0U));
+    if (fit == mFreeBySize.end())
+    {
+        return false;
+    }
+    const U32 free_blocks = fit->first;
+    block = fit->second;
+    eraseFree(mFreeByBlock.find(block));
+    if (free_blocks > blocks)
+    {
+        insertFree(block + blocks, free_blocks - blocks);
+    }
+    return true;
+}
+
+void LLPackFileCache::Slab::give(U32 block, U32 blocks)
+{
+    // Coalesce with the following free extent...
+    auto next = mFreeByBlock.find(block + blocks);
+    if (next != mFreeByBlock.end())
+    {
+        blocks += next->second;
+        eraseFree(next);
+    }
+    // ... and with the preceding one
+    auto prev = mFreeByBlock.lower_bound(block);
+    if (prev != mFreeByBlock.begin())
+    {
+        --prev;
+        if (prev->first + prev->second == block)
+        {
+            block = prev->first;
+            blocks += prev->second;
+            eraseFree(prev);
+        }
+    }
+    insertFree(block, blocks);
+}
+
+bool LLPackFileCache::Slab::carve(U32 block, U32 blocks)
+{
+    // Remove a specific range from the free space, used when rebuilding the
+    // free lists from the index. Fails if the range is not entirely free,
+    // which means the index is corrupted.
+    auto it = mFreeByBlock.upper_bound(block);
+    if (it == mFreeByBlock.begin())
+    {
+        return false;
+    }
+    --it;
+    const U32 free_block = it->first;
+    const U32 free_blocks = it->second;
+    if (block + blocks > free_block + free_blocks)
+    {
+        return false;
+    }
+    eraseFree(it);
+    if (block > free_block)
+    {
+        insertFree(free_block, block - free_block);
+    }
+    if (block + blocks < free_block + free_blocks)
+    {
+        insertFree(block + blocks, free_block + free_blocks - block - blocks);
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// LLPackFileCache
+//----------------------------------------------------------------------------
+LLPackFileCache::LLPackFileCache(const std::string& cache_dir, uintmax_t max_size_bytes) :
+    mCacheDir(cache_dir),
+    mMaxSizeBytes(max_size_bytes),
+    mMaxSlabs(0),
+    mUsedBlocks(0),
+    mIndexDirty(false)
+{
+}
+
+LLPackFileCache::~LLPackFileCache()
+{
+    close();
+}
+
+bool LLPackFileCache::open()
+{
+    LLMutexLock lock(&mMutex);
+
+    if (!mSlabs.empty())
+    {
+        return true;
+    }
+
+    // Map the slabs created by the previous sessions, and at least one so
+    // that a folder which cannot be mapped falls back to the per-file layout
+    // right away. The others get created when the cache fills up.
+    mMaxSlabs = llclamp((U32)((mMaxSizeBytes + SLAB_SIZE - 1) / SLAB_SIZE), 1U, 0xFFFFU);
+    while (mSlabs.size() < mMaxSlabs &&
+           (mSlabs.empty() || LLFile::isfile(slab_filename(mCacheDir, (U32)mSlabs.size()))))
+    {
+        if (!addSlab())
+        {
+            if (mSlabs.empty())
+            {
+                return false;
+            }
+            // the index entries of the slabs that are not mapped get dropped
+            break;
+        }
+    }
+
+    // Slabs left over from a larger cache size setting are not needed any more
+    for (U32 i = mMaxSlabs; LLFile::isfile(slab_filename(mCacheDir, i)); ++i)
+    {
+        LLFile::remove(slab_filename(mCacheDir, i));
+    }
+
+    if (!loadIndex())
+    {
+        mIndex.clear();
+        mLRU.clear();
+        mUsedBlocks = 0;
+        for (Slab* slab : mSlabs)
+        {
+            slab->resetFreeSpace();
+        }
+        mIndexDirty = true;
+    }
+
+    LL_INFOS() << "Opened pack cache with " << mSlabs.size() << " slabs and " << mIndex.size() << " entries" << LL_ENDL;
+    return true;
+}
+
+void LLPackFileCache::close()
+{
+    if (mSlabs.empty())
+    {
+        return;
+    }
+
+    saveIndex();
+
+    LLMutexLock lock(&mMutex);
+    for (Slab* slab : mSlabs)
+    {
+        slab->flush(true);
+        delete slab;
+    }
+    mSlabs.clear();
+    mIndex.clear();
+    mLRU.clear();
+    mUsedBlocks = 0;
+}
+
+U8* LLPackFileCache::extentAddress(U16 slab, U32 block) const
+{
+    return mSlabs[slab]->getAddress() + (size_t)block * BLOCK_SIZE;
+}
+
+void LLPackFileCache::writeExtentHeader(const Key& key, const Entry& entry)
+{
+    LLPackExtentHeader header;
+    header.mMagic = EXTENT_MAGIC;
+    header.mType = key.mType;
+    memcpy(header.mID, key.mID.mData, UUID_BYTES);
+    header.mSize = entry.mSize;
+    header.mReserved = 0;
+    memcpy(extentAddress(entry.mSlab, entry.mBlock), &header, EXTENT_HEADER_SIZE);
+}
+
+LLPackFileCache::index_map_t::iterator LLPackFileCache::findEntry(const LLUUID& id, LLAssetType::EType type)
+{
+    if (mSlabs.empty())
+    {
+        return mIndex.end();
+    }
+
+    auto it = mIndex.find(Key{ id, (S32)type });
+    if (it == mIndex.end() && type != LLAssetType::AT_NONE)
+    {
+        // Assets imported from the per-file layout have no type: adopt the
+        // first one they are looked up with.
+        auto legacy = mIndex.find(Key{ id, (S32)LLAssetType::AT_NONE });
+        if (legacy != mIndex.end())
+        {
+            Entry entry = legacy->second;
+            mLRU.erase(entry.mLRU);
+            mIndex.erase(legacy);
+            Key key{ id, (S32)type };
+            entry.mLRU = mLRU.insert(mLRU.begin(), key);
+            it = mIndex.emplace(key, entry).first;
+            writeExtentHeader(key, it->second);
+            mIndexDirty = true;
+        }
+    }
+
+    if (it != mIndex.end() && !it->second.mVerified)
+    {
+        LLPackExtentHeader header;
+        memcpy(&header, extentAddress(it->second.mSlab, it->second.mBlock), EXTENT_HEADER_SIZE);
+        const U32 capacity = it->second.mBlocks * BLOCK_SIZE - EXTENT_HEADER_SIZE;
+        if (header.mMagic != EXTENT_MAGIC || header.mType != it->first.mType ||
+            memcmp(header.mID, it->first.mID.mData, UUID_BYTES) != 0 || header.mSize > capacity)
+        {
+            LL_WARNS() << "Dropping stale pack cache entry for " << id << LL_ENDL;
+            eraseEntry(it);
+            return mIndex.end();
+        }
+        // The size recorded in the extent is more recent than the index one
+        it->second.mSize = header.mSize;
+        it->second.mVerified = true;
+    }
+
+    return it;
+}
+
+void LLPackFileCache::touchEntry(index_map_t::iterator it)
+{
+    mLRU.splice(mLRU.begin(), mLRU, it->second.mLRU);
+    it->second.mAccessTime = (U32)time(nullptr);
+    mIndexDirty = true;
+}
+
+void LLPackFileCache::eraseEntry(index_map_t::iterator it)
+{
+    Entry& entry = it->second;
+    if (entry.mBlocks)
+    {
+        // Clear the extent header so that the space can never be mistaken
+        // for this asset again.
+        memset(extentAddress(entry.mSlab, entry.mBlock), 0, EXTENT_HEADER_SIZE);
+        freeExtent(entry.mSlab, entry.mBlock, entry.mBlocks);
+    }
+    mLRU.erase(entry.mLRU);
+    mIndex.erase(it);
+    mIndexDirty = true;
+}
+
+bool LLPackFileCache::allocate(U32 blocks, U16& slab, U32& block)
+{
+    // Best fit across the slabs
+    S32 best = -1;
+    U32 best_free = 0;
+    for (size_t i = 0; i < mSlabs.size(); ++i)
+    {
+        const U32 largest = mSlabs[i]->largestFree();
+        if (largest >= blocks && (best < 0 || largest < best_free))
+        {
+            best = (S32)i;
+            best_free = largest;
+        }
+    }
+    if (best < 0)
+    {
+        // Only grow the cache on disk when the existing slabs are full
+        if (mSlabs.size() >= mMaxSlabs || !addSlab())
+        {
+            return false;
+        }
+        best = (S32)mSlabs.size() - 1;
+    }
+    if (!mSlabs[best]->take(blocks, block))
+    {
+        return false;
+    }
+    slab = (U16)best;
+    mUsedBlocks += blocks;
+    return true;
+}
+
+bool LLPackFileCache::addSlab()
+{
+    const std::string filename = slab_filename(mCacheDir, (U32)mSlabs.size());
+    Slab* slab = new Slab();
+    if (!slab->map(filename))
+    {
+        delete slab;
+        LLFile::remove(filename, ENOENT);
+        // Most likely a full disk: make do with the slabs there are, by
+        // evicting older assets, for the rest of the session
+        mMaxSlabs = llmax((U32)mSlabs.size(), 1U);
+        return false;
+    }
+    mSlabs.push_back(slab);
+    return true;
+}
+
+void LLPackFileCache::freeExtent(U16 slab, U32 block, U32 blocks)
+{
+    mSlabs[slab]->give(block, blocks);
+    mUsedBlocks -= blocks;
+}
+
+bool LLPackFileCache::exists(const LLUUID& id, LLAssetType::EType type)
+{
+    LLMutexLock lock(&mMutex);
+    auto it = findEntry(id, type);
+    return it != mIndex.end() && it->second.mSize > 0;
+}
+
+S32 LLPackFileCache::getSize(const LLUUID& id, LLAssetType::EType type)
+{
+    LLMutexLock lock(&mMutex);
+    auto it = findEntry(id, type);
+    return it != mIndex.end() ? (S32)it->second.mSize : 0;
+}
+
+S32 LLPackFileCache::read(const LLUUID& id, LLAssetType::EType type, S32 offset, U8* buffer, S32 bytes)
+{
+    LLMutexLock lock(&mMutex);
+    auto it = findEntry(id, type);
+    if (it == mIndex.end() || offset < 0 || bytes <= 0 || (U32)offset >= it->second.mSize)
+    {
+        return 0;
+    }
+
+    const S32 to_read = llmin(bytes, (S32)(it->second.mSize - offset));
+    memcpy(buffer, extentAddress(it->second.mSlab, it->second.mBlock) + EXTENT_HEADER_SIZE + offset, to_read);
+    touchEntry(it);
+    return to_read;
+}
+
+bool LLPackFileCache::write(const LLUUID& id, LLAssetType::EType type, S32 offset, const U8* buffer, S32 bytes, bool truncate)
+{
+    if (offset < 0 || bytes < 0)
+    {
+        return false;
+    }
+    const uintmax_t needed = (uintmax_t)offset + bytes + EXTENT_HEADER_SIZE;
+    if (needed > SLAB_SIZE)
+    {
+        LL_WARNS() << "Asset " << id << " is too large for the pack cache" << LL_ENDL;
+        return false;
+    }
+
+    LLMutexLock lock(&mMutex);
+    if (mSlabs.empty())
+    {
+        return false;
+    }
+
+    Key key{ id, (S32)type };
+    auto it = findEntry(id, type);
+    if (it == mIndex.end())
+    {
+        Entry entry;
+        entry.mLRU = mLRU.insert(mLRU.begin(), key);
+        it = mIndex.emplace(key, entry).first;
+    }
+    Entry& entry = it->second;
+    if (truncate)
+    {
+        entry.mSize = 0;
+    }
+
+    if (needed > (uintmax_t)entry.mBlocks * BLOCK_SIZE)
+    {
+        // Grow geometrically so that a sequence of appends does not relocate
+        // the asset on each call.
+        U32 blocks = llmax(bytesToBlocks(needed), llmin(entry.mBlocks * 2, BLOCKS_PER_SLAB));
+
+        // Make sure the asset being written is the last one to be evicted
+        touchEntry(it);
+
+        U16 slab = 0;
+        U32 block = 0;
+        bool allocated = allocate(blocks, slab, block);
+        if (!allocated && blocks > bytesToBlocks(needed))
+        {
+            blocks = bytesToBlocks(needed);
+            allocated = allocate(blocks, slab, block);
+        }
+        while (!allocated && mLRU.size() > 1 && !(mLRU.back() == key))
+        {
+            eraseEntry(mIndex.find(mLRU.back()));
+            allocated = allocate(blocks, slab, block);
+        }
+        if (!allocated)
+        {
+            LL_WARNS() << "Unable to find space for asset " << id << " in the pack cache" << LL_ENDL;
+            eraseEntry(it);
+            return false;
+        }
+
+        if (entry.mBlocks)
+        {
+            memcpy(extentAddress(slab, block) + EXTENT_HEADER_SIZE,
+                   extentAddress(entry.mSlab, entry.mBlock) + EXTENT_HEADER_SIZE,
+                   entry.mSize);
+            memset(extentAddress(entry.mSlab, entry.mBlock), 0, EXTENT_HEADER_SIZE);
+            freeExtent(entry.mSlab, entry.mBlock, entry.mBlocks);
+        }
+        entry.mSlab = slab;
+        entry.mBlock = block;
+        entry.mBlocks = blocks;
+    }
+
+    U8* data = extentAddress(entry.mSlab, entry.mBlock) + EXTENT_HEADER_SIZE;
+    if ((U32)offset > entry.mSize)
+    {
+        // Recycled space may hold the remains of another asset
+        memset(data + entry.mSize, 0, offset - entry.mSize);
+    }
+    memcpy(data + offset, buffer, bytes);
+    entry.mSize = llmax(entry.mSize, (U32)(offset + bytes));
+    entry.mVerified = true;
+    writeExtentHeader(key, entry);
+    touchEntry(it);
+    return true;
+}
+
+bool LLPackFileCache::remove(const LLUUID& id, LLAssetType::EType type)
+{
+    LLMutexLock lock(&mMutex);
+    auto it = findEntry(id, type);
+    if (it == mIndex.end())
+    {
+        return false;
+    }
+    eraseEntry(it);
+    return true;
+}
+
+bool LLPackFileCache::rename(const LLUUID& old_id, LLAssetType::EType old_type, const LLUUID& new_id, LLAssetType::EType new_type)
+{
+    LLMutexLock lock(&mMutex);
+    auto it = findEntry(old_id, old_type);
+    if (it == mIndex.end())
+    {
+        return false;
+    }
+
+    // Rename needs the new asset to not exist
+    auto existing = findEntry(new_id, new_type);
+    if (existing != mIndex.end())
+    {
+        eraseEntry(existing);
+        it = mIndex.find(Key{ old_id, (S32)old_type });
+    }
+
+    Entry entry = it->second;
+    mLRU.erase(entry.mLRU);
+    mIndex.erase(it);
+
+    Key key{ new_id, (S32)new_type };
+    entry.mLRU = mLRU.insert(mLRU.begin(), key);
+    it = mIndex.emplace(key, entry).first;
+    writeExtentHeader(key, it->second);
+    touchEntry(it);
+    return true;
+}
+
+U32 LLPackFileCache::purge()
+{
+    LLMutexLock lock(&mMutex);
+
+    U32 evicted = 0;
+    const uintmax_t max_blocks = mMaxSizeBytes / BLOCK_SIZE;
+    while (mUsedBlocks > max_blocks && !mLRU.empty())
+    {
+        eraseEntry(mIndex.find(mLRU.back()));
+        ++evicted;
+    }
+    return evicted;
+}
+
+void LLPackFileCache::clear()
+{
+    LLMutexLock lock(&mMutex);
+    mIndex.clear();
+    mLRU.clear();
+    mUsedBlocks = 0;
+    for (Slab* slab : mSlabs)
+    {
+        slab->resetFreeSpace();
+    }
+    mIndexDirty = true;
+}
+
+U32 LLPackFileCache::getEntryCount()
+{
+    LLMutexLock lock(&mMutex);
+    return (U32)mIndex.size();
+}
+
+uintmax_t LLPackFileCache::getUsedBytes()
+{
+    LLMutexLock lock(&mMutex);
+    return mUsedBlocks * BLOCK_SIZE;
+}
+
+U32 LLPackFileCache::importLegacyFiles(const std::string& prefix)
+{
+    typedef std::pair<std::time_t, std::string> file_info_t;
+    std::vector<file_info_t> file_info;
+
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    std::wstring cache_path(utf8str_to_utf16str(mCacheDir));
+#else
+    std::string cache_path(mCacheDir);
+#endif
+    if (boost::filesystem::is_directory(cache_path, ec) && !ec.failed())
+    {
+        boost::filesystem::directory_iterator iter(cache_path, ec);
+        while (iter != boost::filesystem::directory_iterator() && !ec.failed())
+        {
+            if (boost::filesystem::is_regular_file(*iter, ec) && !ec.failed())
+            {
+                const std::string filename = (*iter).path().filename().string();
+                if (filename.compare(0, prefix.size(), prefix) == 0)
+                {
+                    const std::time_t file_time = boost::filesystem::last_write_time(*iter, ec);
+                    if (!ec.failed())
+                    {
+                        file_info.emplace_back(file_time, (*iter).path().string());
+                    }
+                }
+            }
+            iter.increment(ec);
+        }
+    }
+
+    if (file_info.empty())
+    {
+        return 0;
+    }
+
+    // Oldest first, so that the most recently used files end up at the
+    // front of the LRU list
+    std::sort(file_info.begin(), file_info.end());
+
+    U32 imported = 0;
+    std::vector<U8> buffer;
+    for (const file_info_t& info : file_info)
+    {
+        // File names are <prefix>_<uuid>_<extra>.asset
+        const std::string filename = gDirUtilp->getBaseFileName(info.second);
+        LLUUID id;
+        if (filename.size() >= prefix.size() + 1 + UUID_STR_LENGTH - 1)
+        {
+            const std::string id_str = filename.substr(prefix.size() + 1, UUID_STR_LENGTH - 1);
+            if (LLUUID::validate(id_str))
+            {
+                id.set(id_str);
+            }
+        }
+
+        if (id.notNull())
+        {
+            llifstream file(info.second, std::ios::binary);
+            if (file.is_open())
+            {
+                file.seekg(0, std::ios::end);
+                const std::streamoff size = file.tellg();
+                if (size > 0 && size + EXTENT_HEADER_SIZE <= SLAB_SIZE)
+                {
+                    buffer.resize((size_t)size);
+                    file.seekg(0, std::ios::beg);
+                    file.read((char*)buffer.data(), size);
+                    if (file && write(id, LLAssetType::AT_NONE, 0, buffer.data(), (S32)size, true))
+                    {
+                        ++imported;
+                        file.close();
+                        LLFile::remove(info.second);
+                    }
+                }
+            }
+        }
+    }
+
+    LL_INFOS() << "Imported " << imported << " of " << file_info.size() << " cache files into the pack cache" << LL_ENDL;
+    saveIndex();
+    return imported;
+}
+
+bool LLPackFileCache::loadIndex()
+{
+    LLUniqueFile file = LLFile::fopen(index_filename(mCacheDir), "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    U32 header[6];
+    if (fread(header, sizeof(header), 1, file) != 1 ||
+        header[0] != INDEX_MAGIC || header[1] != INDEX_VERSION ||
+        header[2] != BLOCK_SIZE || header[3] != BLOCKS_PER_SLAB)
+    {
+        LL_WARNS() << "Ignoring pack cache index with an unknown format" << LL_ENDL;
+        return false;
+    }
+    const U32 count = header[5];
+
+    std::vector<U8> records((size_t)count * INDEX_RECORD_SIZE);
+    if (count && fread(records.data(), records.size(), 1, file) != 1)
+    {
+        LL_WARNS() << "Truncated pack cache index" << LL_ENDL;
+        return false;
+    }
+
+    // Records are ordered from the least to the most recently used
+    for (U32 i = 0; i < count; ++i)
+    {
+        const U8* record = &records[(size_t)i * INDEX_RECORD_SIZE];
+        Key key;
+        memcpy(key.mID.mData, record, UUID_BYTES);
+        memcpy(&key.mType, record + 16, sizeof(S32));
+
+        Entry entry;
+        memcpy(&entry.mSlab, record + 20, sizeof(U16));
+        memcpy(&entry.mBlock, record + 24, sizeof(U32));
+        memcpy(&entry.mBlocks, record + 28, sizeof(U32));
+        memcpy(&entry.mSize, record + 32, sizeof(U32));
+        memcpy(&entry.mAccessTime, record + 36, sizeof(U32));
+
+        if (entry.mSlab >= mSlabs.size())
+        {
+            // Slab dropped after a cache size reduction, or not created
+            continue;
+        }
+        if (!entry.mBlocks || entry.mBlock + entry.mBlocks > BLOCKS_PER_SLAB ||
+            !mSlabs[entry.mSlab]->carve(entry.mBlock, entry.mBlocks) ||
+            mIndex.count(key))
+        {
+            LL_WARNS() << "Corrupted pack cache index" << LL_ENDL;
+            return false;
+        }
+
+        entry.mLRU = mLRU.insert(mLRU.begin(), key);
+        mIndex.emplace(key, entry);
+        mUsedBlocks += entry.mBlocks;
+    }
+
+    mIndexDirty = false;
+    return true;
+}
+
+void LLPackFileCache::saveIndex()
+{
+    std::vector<U8> data;
+    {
+        LLMutexLock lock(&mMutex);
+        if (mSlabs.empty() || !mIndexDirty)
+        {
+            return;
+        }
+
+        const U32 header[6] = { INDEX_MAGIC, INDEX_VERSION, BLOCK_SIZE, BLOCKS_PER_SLAB, (U32)mSlabs.size(), (U32)mIndex.size() };
+        data.resize(INDEX_HEADER_SIZE + mIndex.size() * INDEX_RECORD_SIZE, 0);
+        memcpy(data.data(), header, INDEX_HEADER_SIZE);
+
+        U8* record = data.data() + INDEX_HEADER_SIZE;
+        for (auto lru = mLRU.rbegin(); lru != mLRU.rend(); ++lru)
+        {
+            const Entry& entry = mIndex.find(*lru)->second;
+            memcpy(record, lru->mID.mData, UUID_BYTES);
+            memcpy(record + 16, &lru->mType, sizeof(S32));
+            memcpy(record + 20, &entry.mSlab, sizeof(U16));
+            memcpy(record + 24, &entry.mBlock, sizeof(U32));
+            memcpy(record + 28, &entry.mBlocks, sizeof(U32));
+            memcpy(record + 32, &entry.mSize, sizeof(U32));
+            memcpy(record + 36, &entry.mAccessTime, sizeof(U32));
+            record += INDEX_RECORD_SIZE;
+        }
+        mIndexDirty = false;
+
+        // Get the extent headers on their way to the disk before the index
+        // that refers to them.
+        for (Slab* slab : mSlabs)
+        {
+            slab->flush(false);
+        }
+    }
+
+    // Write to a temporary file and swap, so that a crash while saving
+    // leaves the previous index intact.
+    const std::string filename = index_filename(mCacheDir);
+    const std::string temp_filename = filename + ".tmp";
+    {
+        LLUniqueFile file = LLFile::fopen(temp_filename, "wb");
+        if (!file || fwrite(data.data(), data.size(), 1, file) != 1)
+        {
+            LL_WARNS() << "Unable to write the pack cache index" << LL_ENDL;
+            LLMutexLock lock(&mMutex);
+            mIndexDirty = true;
+            return;
+        }
+    }
+    LLFile::remove(filename, ENOENT);
+    LLFile::rename(temp_filename, filename);
+}
+
+// static
+void LLPackFileCache::removeFiles(const std::string& cache_dir)
+{
+    LLFile::remove(index_filename(cache_dir), ENOENT);
+    for (U32 i = 0; LLFile::isfile(slab_filename(cache_dir, i)); ++i)
+    {
+        LLFile::remove(slab_filename(cache_dir, i));
+    }
+}
@@ -0,0 +1,211 @@
+/**
+ * @file llpackfilecache.h
+ * @brief An indexed, memory-mapped backend for the asset disk cache.
+ *
+ * @Description:
+ * Instead of writing each asset as a separate file in the cache folder
+ * (see lldiskcache.h) this backend stores all the assets inside a small
+ * number of large "slab" files that are memory-mapped at startup:
+ * 1/ Each slab is a fixed-size file (SLAB_SIZE bytes) divided into
+ *    blocks of BLOCK_SIZE bytes. An asset occupies a contiguous range
+ *    of blocks (an extent) inside a single slab. Slabs are only created
+ *    when the existing ones are full, up to the configured cache size, so
+ *    the cache takes no more disk space than it needs.
+ * 2/ A compact index keyed by (asset ID, asset type) maps each asset
+ *    to its extent. The index is kept in memory and saved to the
+ *    'sl_pack.idx' file periodically and at shutdown.
+ * 3/ The index also maintains an LRU list of the assets so that purging
+ *    the cache only touches the entries that are actually evicted, in
+ *    place of the directory scan + sort needed by the per-file layout.
+ * 4/ Each extent starts with a small header repeating the asset key and
+ *    size. An index entry is checked against that header the first time
+ *    it is used so that an index read back after a crash never serves an
+ *    asset whose space has since been reused by another one.
+ * 5/ Assets found in the per-file layout are imported (oldest first, so
+ *    that the LRU order is preserved) the first time the pack cache is
+ *    opened on a given cache folder.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKFILECACHE_H
+#define LL_LLPACKFILECACHE_H
+
+#include "llassettype.h"
+#include "llmutex.h"
+#include "lluuid.h"
+
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+class LLPackFileCache
+{
+public:
+    /**
+     * Size of a slab file, and granularity of the allocations inside it.
+     * An asset can never be larger than a slab.
+     */
+    static constexpr U32 SLAB_SIZE = 256 * 1024 * 1024;
+    static constexpr U32 BLOCK_SIZE = 512;
+    static constexpr U32 BLOCKS_PER_SLAB = SLAB_SIZE / BLOCK_SIZE;
+
+    LLPackFileCache(const std::string& cache_dir, uintmax_t max_size_bytes);
+    ~LLPackFileCache();
+
+    /**
+     * Map the existing slab files (creating the first one on first run)
+     * and load the index. When the index is missing or cannot be trusted,
+     * the pack cache starts empty. Returns false when the slabs could not
+     * be mapped, in which case the caller should fall back to the per-file
+     * layout.
+     */
+    bool open();
+
+    /**
+     * Save the index and unmap the slab files.
+     */
+    void close();
+
+    bool isOpen() const { return !mSlabs.empty(); }
+
+    bool exists(const LLUUID& id, LLAssetType::EType type);
+    S32 getSize(const LLUUID& id, LLAssetType::EType type);
+
+    /**
+     * Copy up to 'bytes' bytes of the asset, starting at 'offset', into
+     * 'buffer' and mark the asset as most recently used. Returns the number
+     * of bytes actually copied (0 when the asset is not in the cache).
+     */
+    S32 read(const LLUUID& id, LLAssetType::EType type, S32 offset, U8* buffer, S32 bytes);
+
+    /**
+     * Write 'bytes' bytes at 'offset' in the asset, creating it if needed.
+     * When 'truncate' is true, any existing data is discarded first. The
+     * asset is relocated inside the slabs when it outgrows its extent.
+     */
+    bool write(const LLUUID& id, LLAssetType::EType type, S32 offset, const U8* buffer, S32 bytes, bool truncate);
+
+    bool remove(const LLUUID& id, LLAssetType::EType type);
+    bool rename(const LLUUID& old_id, LLAssetType::EType old_type, const LLUUID& new_id, LLAssetType::EType new_type);
+
+    /**
+     * Evict least recently used assets until the cache holds no more than
+     * mMaxSizeBytes. Cost is proportional to the number of evicted assets.
+     * Returns the number of evicted assets.
+     */
+    U32 purge();
+
+    /**
+     * Drop every asset. The slab files are kept (and reused).
+     */
+    void clear();
+
+    /**
+     * Import the per-file layout assets found in the cache folder (files
+     * whose name starts with 'prefix') and delete the imported files. The
+     * files that fail to import are left in place.
+     * Since the per-file layout does not record the asset type, imported
+     * assets are keyed with AT_NONE and adopt the type of the first lookup
+     * made for their ID. Returns the number of imported assets.
+     */
+    U32 importLegacyFiles(const std::string& prefix);
+
+    /**
+     * Flush the mapped slabs and save the index.
+     */
+    void saveIndex();
+
+    U32 getEntryCount();
+    uintmax_t getUsedBytes();
+    uintmax_t getMaxSizeBytes() const { return mMaxSizeBytes; }
+
+    /**
+     * Remove the slab and index files from a cache folder, for when the
+     * pack cache gets disabled.
+     */
+    static void removeFiles(const std::string& cache_dir);
+
+private:
+    struct Key
+    {
+        LLUUID mID;
+        S32 mType;
+
+        bool operator==(const Key& other) const { return mType == other.mType && mID == other.mID; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            size_t seed = hash_value(key.mID);
+            boost::hash_combine(seed, key.mType);
+            return seed;
+        }
+    };
+
+    typedef std::list<Key> lru_list_t;
+
+    struct Entry
+    {
+        U16 mSlab = 0;
+        U32 mBlock = 0;         // first block of the extent
+        U32 mBlocks = 0;        // extent length, in blocks
+        U32 mSize = 0;          // asset size, in bytes
+        U32 mAccessTime = 0;
+        bool mVerified = false; // extent header checked against the key
+        lru_list_t::iterator mLRU;
+    };
+
+    typedef std::unordered_map<Key, Entry, KeyHash> index_map_t;
+
+    class Slab;
+
+    // All the helpers below expect mMutex to be held
+    index_map_t::iterator findEntry(const LLUUID& id, LLAssetType::EType type);
+    void touchEntry(index_map_t::iterator it);
+    void eraseEntry(index_map_t::iterator it);
+    bool allocate(U32 blocks, U16& slab, U32& block);
+    bool addSlab();
+    void freeExtent(U16 slab, U32 block, U32 blocks);
+    bool loadIndex();
+    U8* extentAddress(U16 slab, U32 block) const;
+    void writeExtentHeader(const Key& key, const Entry& entry);
+
+    static U32 bytesToBlocks(uintmax_t bytes) { return (U32)((bytes + BLOCK_SIZE - 1) / BLOCK_SIZE); }
+
+private:
+    std::string mCacheDir;
+    uintmax_t mMaxSizeBytes;
+
+    LLMutex mMutex;
+    std::vector<Slab*> mSlabs;
+    U32 mMaxSlabs;                  // slabs the cache size allows creating
+    index_map_t mIndex;
+    lru_list_t mLRU;                // front is the most recently used
+    uintmax_t mUsedBlocks;
+    bool mIndexDirty;
+};
+
+#endif  // LL_LLPACKFILECACHE_H
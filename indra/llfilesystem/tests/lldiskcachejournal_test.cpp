@@ -0,0 +1,206 @@
+/**
+ * @file   lldiskcachejournal_test.cpp
+ * @brief  Test for lldiskcachejournal.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lldiskcachejournal.h"
+#include "../lldir.h"
+#include "llfile.h"
+
+#include "../test/lltut.h"
+
+#include <boost/filesystem.hpp>
+
+namespace tut
+{
+    struct LLDiskCacheJournalFixture
+    {
+        LLDiskCacheJournalFixture()
+        {
+            mDir = gDirUtilp->add(LLFile::tmpdir(), "lldiskcachejournal_test");
+            LLFile::mkdir(mDir);
+            cleanup();
+        }
+
+        ~LLDiskCacheJournalFixture()
+        {
+            cleanup();
+            LLFile::rmdir(mDir);
+        }
+
+        void cleanup()
+        {
+            LLDiskCacheJournal::removeFile(mDir);
+            for (const std::string& filename : mFiles)
+            {
+                LLFile::remove(filename, ENOENT);
+            }
+        }
+
+        void writeFile(const LLUUID& id, S32 size, std::time_t write_time = 0)
+        {
+            const std::string filename = gDirUtilp->add(mDir, "sl_cache_" + id.asString() + "_0.asset");
+            {
+                llofstream file(filename, std::ios::binary);
+                file << std::string(size, 'x');
+            }
+            if (write_time)
+            {
+                boost::filesystem::last_write_time(filename, write_time);
+            }
+            mFiles.push_back(filename);
+        }
+
+        std::string mDir;
+        std::vector<std::string> mFiles;
+    };
+    typedef test_group<LLDiskCacheJournalFixture> LLDiskCacheJournalTest_factory;
+    typedef LLDiskCacheJournalTest_factory::object LLDiskCacheJournalTest_t;
+    LLDiskCacheJournalTest_factory tf("LLDiskCacheJournal");
+
+    template<> template<>
+    void LLDiskCacheJournalTest_t::test<1>()
+    {
+        set_test_name("sizes and eviction order");
+
+        LLDiskCacheJournal journal(mDir, "sl_cache");
+        ensure("open", journal.open());
+
+        LLUUID ids[3];
+        for (LLUUID& id : ids)
+        {
+            id.generate();
+            journal.recordWrite(id, 1000, true);
+        }
+        // Appending grows the entry, a non truncating write inside does not
+        journal.recordWrite(ids[0], 1500, false);
+        journal.recordWrite(ids[0], 10, false);
+        ensure_equals("entries", journal.getEntryCount(), 3U);
+        ensure_equals("bytes", journal.getTotalBytes(), (uintmax_t)3500);
+
+        // ids[1] is now the least recently used one
+        journal.recordAccess(ids[0]);
+        journal.recordAccess(ids[2]);
+        std::vector<LLUUID> evicted = journal.collectEvictions(2500);
+        ensure_equals("evicted count", evicted.size(), (size_t)1);
+        ensure_equals("evicted", evicted[0], ids[1]);
+        ensure_equals("bytes after purge", journal.getTotalBytes(), (uintmax_t)2500);
+
+        journal.recordRemove(ids[2]);
+        ensure_equals("bytes after removal", journal.getTotalBytes(), (uintmax_t)1500);
+    }
+
+    template<> template<>
+    void LLDiskCacheJournalTest_t::test<2>()
+    {
+        set_test_name("state survives a restart and a crash");
+
+        LLUUID old_id, new_id, recent;
+        old_id.generate();
+        new_id.generate();
+        recent.generate();
+        {
+            LLDiskCacheJournal journal(mDir, "sl_cache");
+            ensure("open", journal.open());
+            journal.recordWrite(old_id, 100, true);
+            journal.recordWrite(recent, 200, true);
+            journal.recordRename(old_id, new_id);
+        }
+
+        // Never closed nor deleted, as if the viewer had crashed
+        LLDiskCacheJournal* crashed = new LLDiskCacheJournal(mDir, "sl_cache");
+        ensure("reopen", crashed->open());
+        ensure_equals("entries after restart", crashed->getEntryCount(), 2U);
+        crashed->recordAccess(new_id);
+        crashed->recordWrite(recent, 300, false);
+        // as the viewer does every frame
+        crashed->flush();
+
+        LLDiskCacheJournal journal(mDir, "sl_cache");
+        ensure("recover", journal.open());
+        ensure_equals("entries after crash", journal.getEntryCount(), 2U);
+        ensure_equals("bytes after crash", journal.getTotalBytes(), (uintmax_t)400);
+        std::vector<LLUUID> evicted = journal.collectEvictions(300);
+        ensure_equals("evicted count", evicted.size(), (size_t)1);
+        ensure_equals("renamed entry was the oldest", evicted[0], new_id);
+    }
+
+    template<> template<>
+    void LLDiskCacheJournalTest_t::test<3>()
+    {
+        set_test_name("first run scans the cache folder");
+
+        LLUUID id;
+        id.generate();
+        writeFile(id, 1234);
+
+        LLDiskCacheJournal journal(mDir, "sl_cache");
+        ensure("open", journal.open());
+        ensure_equals("entries", journal.getEntryCount(), 1U);
+        ensure_equals("bytes", journal.getTotalBytes(), (uintmax_t)1234);
+    }
+
+    template<> template<>
+    void LLDiskCacheJournalTest_t::test<4>()
+    {
+        set_test_name("rescans pick up the files without records");
+
+        LLUUID old_id, known, unknown, lost;
+        old_id.generate();
+        known.generate();
+        unknown.generate();
+        lost.generate();
+        writeFile(old_id, 10, time(nullptr) - 1000);
+        {
+            LLDiskCacheJournal journal(mDir, "sl_cache");
+            ensure("open", journal.open());
+            ensure_equals("scanned", journal.getEntryCount(), 1U);
+            writeFile(known, 100);
+            journal.recordWrite(known, 100, true);
+            // as a read only instance would
+            writeFile(unknown, 200);
+            journal.rescan();
+            ensure_equals("entries after rescan", journal.getEntryCount(), 3U);
+            ensure_equals("bytes after rescan", journal.getTotalBytes(), (uintmax_t)310);
+
+            LLFile::remove(mFiles[0]);
+            journal.rescan();
+            ensure_equals("entries after removal", journal.getEntryCount(), 2U);
+            ensure_equals("bytes after removal", journal.getTotalBytes(), (uintmax_t)300);
+        }
+
+        // Crashed before flushing the record
+        LLDiskCacheJournal* crashed = new LLDiskCacheJournal(mDir, "sl_cache");
+        ensure("reopen", crashed->open());
+        writeFile(lost, 400);
+        crashed->recordWrite(lost, 400, true);
+
+        LLDiskCacheJournal journal(mDir, "sl_cache");
+        ensure("recover", journal.open());
+        ensure_equals("entries after crash", journal.getEntryCount(), 3U);
+        ensure_equals("bytes after crash", journal.getTotalBytes(), (uintmax_t)700);
+    }
+}
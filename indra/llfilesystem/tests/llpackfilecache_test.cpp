@@ -0,0 +1,231 @@
+/**
+ * @file   llpackfilecache_test.cpp
+ * @brief  Test for llpackfilecache.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpackfilecache.h"
+#include "../lldir.h"
+#include "llfile.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+    struct LLPackFileCacheFixture
+    {
+        LLPackFileCacheFixture()
+        {
+            mDir = gDirUtilp->add(LLFile::tmpdir(), "llpackfilecache_test");
+            LLFile::mkdir(mDir);
+            LLPackFileCache::removeFiles(mDir);
+        }
+
+        ~LLPackFileCacheFixture()
+        {
+            LLPackFileCache::removeFiles(mDir);
+            LLFile::rmdir(mDir);
+        }
+
+        std::vector<U8> makeData(S32 size, U8 seed)
+        {
+            std::vector<U8> data(size);
+            for (S32 i = 0; i < size; ++i)
+            {
+                data[i] = (U8)(seed + i);
+            }
+            return data;
+        }
+
+        std::string mDir;
+    };
+    typedef test_group<LLPackFileCacheFixture> LLPackFileCacheTest_factory;
+    typedef LLPackFileCacheTest_factory::object LLPackFileCacheTest_t;
+    LLPackFileCacheTest_factory tf("LLPackFileCache");
+
+    template<> template<>
+    void LLPackFileCacheTest_t::test<1>()
+    {
+        set_test_name("write, read, append and remove");
+
+        LLPackFileCache cache(mDir, LLPackFileCache::SLAB_SIZE);
+        ensure("open", cache.open());
+
+        LLUUID id;
+        id.generate();
+        std::vector<U8> data = makeData(3000, 7);
+        ensure("write", cache.write(id, LLAssetType::AT_TEXTURE, 0, data.data(), 1000, true));
+        ensure("append", cache.write(id, LLAssetType::AT_TEXTURE, 1000, data.data() + 1000, 2000, false));
+        ensure_equals("size", cache.getSize(id, LLAssetType::AT_TEXTURE), 3000);
+        ensure("other type is a different asset", !cache.exists(id, LLAssetType::AT_SOUND));
+
+        std::vector<U8> read_back(3000);
+        ensure_equals("read", cache.read(id, LLAssetType::AT_TEXTURE, 0, read_back.data(), 4000), 3000);
+        ensure("content", read_back == data);
+        ensure_equals("read past end", cache.read(id, LLAssetType::AT_TEXTURE, 3000, read_back.data(), 10), 0);
+
+        ensure("truncating write", cache.write(id, LLAssetType::AT_TEXTURE, 0, data.data(), 10, true));
+        ensure_equals("truncated size", cache.getSize(id, LLAssetType::AT_TEXTURE), 10);
+
+        ensure("remove", cache.remove(id, LLAssetType::AT_TEXTURE));
+        ensure("removed", !cache.exists(id, LLAssetType::AT_TEXTURE));
+        ensure_equals("empty", cache.getEntryCount(), 0U);
+    }
+
+    template<> template<>
+    void LLPackFileCacheTest_t::test<2>()
+    {
+        set_test_name("purge evicts the least recently used entries");
+
+        // Room for two of the three assets written below
+        const S32 size = 100 * 1024;
+        LLPackFileCache cache(mDir, 2 * (size + LLPackFileCache::BLOCK_SIZE));
+        ensure("open", cache.open());
+
+        LLUUID ids[3];
+        std::vector<U8> data = makeData(size, 1);
+        for (LLUUID& id : ids)
+        {
+            id.generate();
+            ensure("write", cache.write(id, LLAssetType::AT_OBJECT, 0, data.data(), size, true));
+        }
+
+        // Touch the first one so that the second one becomes the oldest
+        U8 byte;
+        ensure_equals("read", cache.read(ids[0], LLAssetType::AT_OBJECT, 0, &byte, 1), 1);
+
+        ensure_equals("evicted", cache.purge(), 1U);
+        ensure("first kept", cache.exists(ids[0], LLAssetType::AT_OBJECT));
+        ensure("second evicted", !cache.exists(ids[1], LLAssetType::AT_OBJECT));
+        ensure("third kept", cache.exists(ids[2], LLAssetType::AT_OBJECT));
+    }
+
+    template<> template<>
+    void LLPackFileCacheTest_t::test<3>()
+    {
+        set_test_name("index survives a restart, stale entries are dropped");
+
+        LLUUID kept, stale, other;
+        kept.generate();
+        stale.generate();
+        other.generate();
+        std::vector<U8> data = makeData(5000, 3);
+
+        // Never closed nor deleted, as if the viewer had crashed
+        LLPackFileCache* crashed = new LLPackFileCache(mDir, LLPackFileCache::SLAB_SIZE);
+        ensure("open", crashed->open());
+        ensure("write", crashed->write(kept, LLAssetType::AT_MESH, 0, data.data(), 5000, true));
+        ensure("write", crashed->write(stale, LLAssetType::AT_MESH, 0, data.data(), 100, true));
+        crashed->saveIndex();
+        // Reuse the space of an indexed asset after the index got saved
+        ensure("remove", crashed->remove(stale, LLAssetType::AT_MESH));
+        ensure("write", crashed->write(other, LLAssetType::AT_MESH, 0, data.data(), 100, true));
+
+        LLPackFileCache cache(mDir, LLPackFileCache::SLAB_SIZE);
+        ensure("reopen", cache.open());
+        ensure_equals("kept size", cache.getSize(kept, LLAssetType::AT_MESH), 5000);
+        std::vector<U8> read_back(5000);
+        ensure_equals("read", cache.read(kept, LLAssetType::AT_MESH, 0, read_back.data(), 5000), 5000);
+        ensure("content", read_back == data);
+        ensure("stale dropped", !cache.exists(stale, LLAssetType::AT_MESH));
+        ensure("unsaved entry lost", !cache.exists(other, LLAssetType::AT_MESH));
+    }
+
+    template<> template<>
+    void LLPackFileCacheTest_t::test<4>()
+    {
+        set_test_name("import of the per-file layout");
+
+        LLUUID id;
+        id.generate();
+        const std::string prefix("sl_cache");
+        const std::string filename = gDirUtilp->add(mDir, prefix + "_" + id.asString() + "_0.asset");
+        std::vector<U8> data = makeData(1234, 9);
+        {
+            llofstream file(filename, std::ios::binary);
+            file.write((const char*)data.data(), data.size());
+        }
+        // an empty file can't be imported
+        const std::string empty_filename = gDirUtilp->add(mDir, prefix + "_" + LLUUID::generateNewID().asString() + "_0.asset");
+        {
+            llofstream file(empty_filename, std::ios::binary);
+        }
+
+        LLPackFileCache cache(mDir, LLPackFileCache::SLAB_SIZE);
+        ensure("open", cache.open());
+        ensure_equals("imported", cache.importLegacyFiles(prefix), 1U);
+        ensure("legacy file removed", !LLFile::isfile(filename));
+        ensure("failed import kept", LLFile::isfile(empty_filename));
+        LLFile::remove(empty_filename);
+
+        // Imported assets have no type until they get looked up
+        ensure_equals("size", cache.getSize(id, LLAssetType::AT_ANIMATION), 1234);
+        ensure("retyped", !cache.exists(id, LLAssetType::AT_NONE));
+    }
+
+    template<> template<>
+    void LLPackFileCacheTest_t::test<5>()
+    {
+        set_test_name("rename");
+
+        LLPackFileCache cache(mDir, LLPackFileCache::SLAB_SIZE);
+        ensure("open", cache.open());
+
+        LLUUID old_id, new_id;
+        old_id.generate();
+        new_id.generate();
+        std::vector<U8> data = makeData(200, 5);
+        ensure("write", cache.write(old_id, LLAssetType::AT_NOTECARD, 0, data.data(), 200, true));
+        ensure("write", cache.write(new_id, LLAssetType::AT_NOTECARD, 0, data.data(), 20, true));
+        ensure("rename", cache.rename(old_id, LLAssetType::AT_NOTECARD, new_id, LLAssetType::AT_NOTECARD));
+        ensure("old gone", !cache.exists(old_id, LLAssetType::AT_NOTECARD));
+        ensure_equals("replaced", cache.getSize(new_id, LLAssetType::AT_NOTECARD), 200);
+        ensure_equals("count", cache.getEntryCount(), 1U);
+    }
+
+    template<> template<>
+    void LLPackFileCacheTest_t::test<6>()
+    {
+        set_test_name("slabs are created as the cache fills up");
+
+        const std::string second_slab = gDirUtilp->add(mDir, "sl_pack_01.slab");
+        LLPackFileCache cache(mDir, 3 * (uintmax_t)LLPackFileCache::SLAB_SIZE);
+        ensure("open", cache.open());
+        ensure("first slab", LLFile::isfile(gDirUtilp->add(mDir, "sl_pack_00.slab")));
+        ensure("no second slab yet", !LLFile::isfile(second_slab));
+
+        // two of these do not fit in one slab
+        std::vector<U8> data(LLPackFileCache::SLAB_SIZE / 2 + 1);
+        LLUUID first, second;
+        first.generate();
+        second.generate();
+        ensure("write first", cache.write(first, LLAssetType::AT_OBJECT, 0, data.data(), (S32)data.size(), true));
+        ensure("still one slab", !LLFile::isfile(second_slab));
+        ensure("write second", cache.write(second, LLAssetType::AT_OBJECT, 0, data.data(), (S32)data.size(), true));
+        ensure("second slab", LLFile::isfile(second_slab));
+        ensure("first kept", cache.exists(first, LLAssetType::AT_OBJECT));
+        ensure_equals("count", cache.getEntryCount(), 2U);
+    }
+}
@@ -42,6 +42,9 @@ LLImageJ2CImpl* fallbackCreateLLImageJ2CImpl();
 LLImageCompressionTester* LLImageJ2C::sTesterp = NULL ;
 const std::string sTesterName("ImageCompressionTester");
 
+S32 LLImageJ2C::sDecodeThreads = 1;
+S32 LLImageJ2C::sDecodeThreadsMinPixels = 1024 * 1024;
+
 //static
 std::string LLImageJ2C::getEngineInfo()
 {
@@ -51,6 +54,25 @@ std::string LLImageJ2C::getEngineInfo()
     return impl->getEngineInfo();
 }
 
+//static
+void LLImageJ2C::setDecodeThreading(S32 threads, S32 min_pixels)
+{
+    sDecodeThreads = llmax(threads, 1);
+    sDecodeThreadsMinPixels = llmax(min_pixels, 0);
+}
+
+//static
+S32 LLImageJ2C::getDecodeThreads(S32 width, S32 height, S32 discard_level)
+{
+    if (sDecodeThreads <= 1)
+    {
+        return 1;
+    }
+    discard_level = llclamp(discard_level, 0, MAX_DISCARD_LEVEL);
+    const S64 pixels = (S64)(width >> discard_level) * (S64)(height >> discard_level);
+    return pixels >= sDecodeThreadsMinPixels ? sDecodeThreads : 1;
+}
+
 LLImageJ2C::LLImageJ2C() :  LLImageFormatted(IMG_CODEC_J2C),
                             mMaxBytes(0),
                             mRawDiscardLevel(-1),
@@ -78,6 +78,14 @@ public:
 
     static std::string getEngineInfo();
 
+    // Decoding of a single codestream over several threads, for the engines
+    // supporting it. Only images decoding to at least 'min_pixels' pixels are
+    // split, since the engine starts its worker threads for each decode and
+    // small images are already spread over the image decode thread pool.
+    // A 'threads' value of 0 or 1 disables this.
+    static void setDecodeThreading(S32 threads, S32 min_pixels);
+    static S32 getDecodeThreads(S32 width, S32 height, S32 discard_level);
+
 protected:
     friend class LLImageJ2CImpl;
     friend class LLImageJ2COJ;
@@ -99,6 +107,9 @@ protected:
 
     // Image compression/decompression tester
     static LLImageCompressionTester* sTesterp;
+
+    static S32 sDecodeThreads;
+    static S32 sDecodeThreadsMinPixels;
 };
 
 // Derive from this class to implement JPEG2000 decoding
@@ -0,0 +1,1553 @@
+/**
+ * @file llimagesimd.cpp
+ * @brief Vectorized pixel loops used by LLImageRaw.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagesimd.h"
+
+#include "llmath.h"
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#if LL_WINDOWS
+#include <intrin.h>
+#endif
+
+#include <boost/preprocessor.hpp>
+
+// The viewer is built for SSE2: the AVX2 functions are compiled for AVX2
+// one by one, and only called once the CPU is known to support it.
+#if LL_WINDOWS
+// MSVC lets any function use the AVX2 intrinsics
+#define LL_TARGET_AVX2
+#else
+#define LL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace LLImageSIMD;
+
+static ELevel detect_level()
+{
+#if LL_WINDOWS
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        __cpuid(info, 1);
+        const bool os_saves_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        if (os_saves_avx && (info[1] & (1 << 5)))
+        {
+            return AVX2;
+        }
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return AVX2;
+    }
+#endif
+    return SSE2;
+}
+
+static ELevel& current_level()
+{
+    static ELevel level = getSupportedLevel();
+    return level;
+}
+
+ELevel LLImageSIMD::getSupportedLevel()
+{
+    static const ELevel level = detect_level();
+    return level;
+}
+
+ELevel LLImageSIMD::getLevel()
+{
+    return current_level();
+}
+
+ELevel LLImageSIMD::setLevel(ELevel level)
+{
+    current_level() = llmin(level, getSupportedLevel());
+    return current_level();
+}
+
+const char* LLImageSIMD::getLevelName(ELevel level)
+{
+    switch (level)
+    {
+    case SCALAR:
+        return "scalar";
+    case SSE2:
+        return "SSE2";
+    case AVX2:
+        return "AVX2";
+    }
+    return "unknown";
+}
+
+static inline U32 load_u32(const U8* p)
+{
+    U32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline void store_u32(U8* p, U32 value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+//---------------------------------------------------------------------------
+// Scalar reference implementations
+//---------------------------------------------------------------------------
+
+static void fill_scalar(U8* data, S32 pixels, S32 components, const U8* color)
+{
+    if (4 == components)
+    {
+        const U32 rgba = load_u32(color);
+        for (S32 i = 0; i < pixels; i++)
+        {
+            store_u32(data + 4 * i, rgba);
+        }
+    }
+    else
+    {
+        for (S32 i = 0; i < pixels; i++)
+        {
+            for (S32 c = 0; c < components; c++)
+            {
+                data[c] = color[c];
+            }
+            data += components;
+        }
+    }
+}
+
+static void tint_scalar(U8* data, S32 pixels, S32 components, const F32* color)
+{
+    for (S32 i = 0; i < pixels; i++)
+    {
+        const float c0 = data[0] * color[0];
+        const float c1 = data[1] * color[1];
+        const float c2 = data[2] * color[2];
+        // Saturated before the cast, brightening colors go past 255
+        data[0] = (U8)llclamp(c0, 0.f, 255.f);
+        data[1] = (U8)llclamp(c1, 0.f, 255.f);
+        data[2] = (U8)llclamp(c2, 0.f, 255.f);
+        data += components;
+    }
+}
+
+static void copy_alpha_mask_scalar(U8* dst, const U8* src, S32 pixels, const U8* fill)
+{
+    for (S32 i = 0; i < pixels; i++)
+    {
+        dst[0] = fill[0];
+        dst[1] = fill[1];
+        dst[2] = fill[2];
+        dst[3] = src[0];
+        src += 1;
+        dst += 4;
+    }
+}
+
+// Calculates (U8)(255*(a/255.f)*(b/255.f) + 0.5f).  Thanks, Jim Blinn!
+static inline U8 fast_fractional_mult(U8 a, U8 b)
+{
+    U32 i = a * b + 128;
+    return U8((i + (i>>8)) >> 8);
+}
+
+static void composite_4onto3_scalar(U8* dst, const U8* src, S32 pixels)
+{
+    while (pixels--)
+    {
+        U8 alpha = src[3];
+        if (alpha)
+        {
+            if (255 == alpha)
+            {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+            else
+            {
+                U8 transparency = 255 - alpha;
+                dst[0] = fast_fractional_mult(dst[0], transparency) + fast_fractional_mult(src[0], alpha);
+                dst[1] = fast_fractional_mult(dst[1], transparency) + fast_fractional_mult(src[1], alpha);
+                dst[2] = fast_fractional_mult(dst[2], transparency) + fast_fractional_mult(src[2], alpha);
+            }
+        }
+
+        src += 4;
+        dst += 3;
+    }
+}
+
+static void vertical_flip_scalar(U8* data, S32 row_bytes, S32 rows)
+{
+    std::vector<U8> line_buffer(row_bytes);
+    S32 mid_row = rows / 2;
+    for (S32 row = 0; row < mid_row; row++)
+    {
+        U8* row_a_data = data + row * row_bytes;
+        U8* row_b_data = data + (rows - 1 - row) * row_bytes;
+        memcpy(&line_buffer[0], row_a_data, row_bytes);
+        memcpy(row_a_data, row_b_data, row_bytes);
+        memcpy(row_b_data, &line_buffer[0], row_bytes);
+    }
+}
+
+static void copy_line_scaled_scalar(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+    llassert( components >= 1 && components <= 4 );
+
+    const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+    const F32 norm_factor = 1.f / ratio;
+
+    S32 goff = components >= 2 ? 1 : 0;
+    S32 boff = components >= 3 ? 2 : 0;
+    for( S32 x = 0; x < out_pixel_len; x++ )
+    {
+        // Sample input pixels in range from sample0 to sample1.
+        // Avoid floating point accumulation error... don't just add ratio each time.  JC
+        const F32 sample0 = x * ratio;
+        const F32 sample1 = (x+1) * ratio;
+        const S32 index0 = llfloor(sample0);            // left integer (floor)
+        const S32 index1 = llfloor(sample1);            // right integer (floor)
+        const F32 fract0 = 1.f - (sample0 - F32(index0));   // spill over on left
+        const F32 fract1 = sample1 - F32(index1);           // spill-over on right
+
+        if( index0 == index1 )
+        {
+            // Interval is embedded in one input pixel
+            S32 t0 = x * out_pixel_step * components;
+            S32 t1 = index0 * in_pixel_step * components;
+            U8* outp = out + t0;
+            const U8* inp = in + t1;
+            for (S32 i = 0; i < components; ++i)
+            {
+                *outp = *inp;
+                ++outp;
+                ++inp;
+            }
+        }
+        else
+        {
+            // Left straddle
+            S32 t1 = index0 * in_pixel_step * components;
+            F32 r = in[t1 + 0] * fract0;
+            F32 g = in[t1 + goff] * fract0;
+            F32 b = in[t1 + boff] * fract0;
+            F32 a = 0;
+            if( components == 4)
+            {
+                a = in[t1 + 3] * fract0;
+            }
+
+            // Central interval
+            if (components < 4)
+            {
+                for( S32 u = index0 + 1; u < index1; u++ )
+                {
+                    S32 t2 = u * in_pixel_step * components;
+                    r += in[t2 + 0];
+                    g += in[t2 + goff];
+                    b += in[t2 + boff];
+                }
+            }
+            else
+            {
+                for( S32 u = index0 + 1; u < index1; u++ )
+                {
+                    S32 t2 = u * in_pixel_step * components;
+                    r += in[t2 + 0];
+                    g += in[t2 + 1];
+                    b += in[t2 + 2];
+                    a += in[t2 + 3];
+                }
+            }
+
+            // right straddle
+            // Watch out for reading off of end of input array.
+            if( fract1 && index1 < in_pixel_len )
+            {
+                S32 t3 = index1 * in_pixel_step * components;
+                if (components < 4)
+                {
+                    U8 in0 = in[t3 + 0];
+                    U8 in1 = in[t3 + goff];
+                    U8 in2 = in[t3 + boff];
+                    r += in0 * fract1;
+                    g += in1 * fract1;
+                    b += in2 * fract1;
+                }
+                else
+                {
+                    U8 in0 = in[t3 + 0];
+                    U8 in1 = in[t3 + 1];
+                    U8 in2 = in[t3 + 2];
+                    U8 in3 = in[t3 + 3];
+                    r += in0 * fract1;
+                    g += in1 * fract1;
+                    b += in2 * fract1;
+                    a += in3 * fract1;
+                }
+            }
+
+            r *= norm_factor;
+            g *= norm_factor;
+            b *= norm_factor;
+            a *= norm_factor;  // skip conditional
+
+            S32 t4 = x * out_pixel_step * components;
+            out[t4 + 0] = U8(ll_round(r));
+            if (components >= 2)
+                out[t4 + 1] = U8(ll_round(g));
+            if (components >= 3)
+                out[t4 + 2] = U8(ll_round(b));
+            if( components == 4)
+                out[t4 + 3] = U8(ll_round(a));
+        }
+    }
+}
+
+//..................................................................................
+//..................................................................................
+// Helper macrose's for generate cycle unwrap templates
+//..................................................................................
+#define _UNROL_GEN_TPL_arg_0(arg)
+#define _UNROL_GEN_TPL_arg_1(arg) arg
+
+#define _UNROL_GEN_TPL_comma_0
+#define _UNROL_GEN_TPL_comma_1 BOOST_PP_COMMA()
+//..................................................................................
+#define _UNROL_GEN_TPL_ARGS_macro(z,n,seq) \
+    BOOST_PP_CAT(_UNROL_GEN_TPL_arg_, BOOST_PP_MOD(n, 2))(BOOST_PP_SEQ_ELEM(n, seq)) BOOST_PP_CAT(_UNROL_GEN_TPL_comma_, BOOST_PP_AND(BOOST_PP_MOD(n, 2), BOOST_PP_NOT_EQUAL(BOOST_PP_INC(n), BOOST_PP_SEQ_SIZE(seq))))
+
+#define _UNROL_GEN_TPL_ARGS(seq) \
+    BOOST_PP_REPEAT(BOOST_PP_SEQ_SIZE(seq), _UNROL_GEN_TPL_ARGS_macro, seq)
+//..................................................................................
+
+#define _UNROL_GEN_TPL_TYPE_ARGS_macro(z,n,seq) \
+    BOOST_PP_SEQ_ELEM(n, seq) BOOST_PP_CAT(_UNROL_GEN_TPL_comma_, BOOST_PP_AND(BOOST_PP_MOD(n, 2), BOOST_PP_NOT_EQUAL(BOOST_PP_INC(n), BOOST_PP_SEQ_SIZE(seq))))
+
+#define _UNROL_GEN_TPL_TYPE_ARGS(seq) \
+    BOOST_PP_REPEAT(BOOST_PP_SEQ_SIZE(seq), _UNROL_GEN_TPL_TYPE_ARGS_macro, seq)
+//..................................................................................
+#define _UNROLL_GEN_TPL_foreach_ee(z, n, seq) \
+    executor<n>(_UNROL_GEN_TPL_ARGS(seq));
+
+#define _UNROLL_GEN_TPL(name, args_seq, operation, spec) \
+    template<> struct name<spec> { \
+    private: \
+        template<S32 _idx> inline void executor(_UNROL_GEN_TPL_TYPE_ARGS(args_seq)) { \
+            BOOST_PP_SEQ_ENUM(operation) ; \
+        } \
+    public: \
+        inline void operator()(_UNROL_GEN_TPL_TYPE_ARGS(args_seq)) { \
+            BOOST_PP_REPEAT(spec, _UNROLL_GEN_TPL_foreach_ee, args_seq) \
+        } \
+};
+//..................................................................................
+#define _UNROLL_GEN_TPL_foreach_seq_macro(r, data, elem) \
+    _UNROLL_GEN_TPL(BOOST_PP_SEQ_ELEM(0, data), BOOST_PP_SEQ_ELEM(1, data), BOOST_PP_SEQ_ELEM(2, data), elem)
+
+#define UNROLL_GEN_TPL(name, args_seq, operation, spec_seq) \
+    /*general specialization - should not be implemented!*/ \
+    template<U8> struct name { inline void operator()(_UNROL_GEN_TPL_TYPE_ARGS(args_seq)) { /*static_assert(!"Should not be instantiated.");*/  } }; \
+    BOOST_PP_SEQ_FOR_EACH(_UNROLL_GEN_TPL_foreach_seq_macro, (name)(args_seq)(operation), spec_seq)
+//..................................................................................
+//..................................................................................
+
+
+//..................................................................................
+// Generated unrolling loop templates with specializations
+//..................................................................................
+//example: for(c = 0; c < ch; ++c) comp[c] = cx[0] = 0;
+UNROLL_GEN_TPL(uroll_zeroze_cx_comp, (S32 *)(cx)(S32 *)(comp), (cx[_idx] = comp[_idx] = 0), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) comp[c] >>= 4;
+UNROLL_GEN_TPL(uroll_comp_rshftasgn_constval, (S32 *)(comp)(const S32)(cval), (comp[_idx] >>= cval), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) comp[c] = (cx[c] >> 5) * yap;
+UNROLL_GEN_TPL(uroll_comp_asgn_cx_rshft_cval_all_mul_val, (S32 *)(comp)(S32 *)(cx)(const S32)(cval)(S32)(val), (comp[_idx] = (cx[_idx] >> cval) * val), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) comp[c] += (cx[c] >> 5) * Cy;
+UNROLL_GEN_TPL(uroll_comp_plusasgn_cx_rshft_cval_all_mul_val, (S32 *)(comp)(S32 *)(cx)(const S32)(cval)(S32)(val), (comp[_idx] += (cx[_idx] >> cval) * val), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) comp[c] += pix[c] * info.xapoints[x];
+UNROLL_GEN_TPL(uroll_inp_plusasgn_pix_mul_val, (S32 *)(comp)(const U8 *)(pix)(S32)(val), (comp[_idx] += pix[_idx] * val), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) cx[c] = pix[c] * info.xapoints[x];
+UNROLL_GEN_TPL(uroll_inp_asgn_pix_mul_val, (S32 *)(comp)(const U8 *)(pix)(S32)(val), (comp[_idx] = pix[_idx] * val), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) comp[c] = ((cx[c] * info.yapoints[y]) + (comp[c] * (256 - info.yapoints[y]))) >> 16;
+UNROLL_GEN_TPL(uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r, (S32 *)(comp)(S32 *)(cx)(S32)(apoint), (comp[_idx] = ((cx[_idx] * apoint) + (comp[_idx] * (256 - apoint))) >> 16), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) comp[c] = (comp[c] + pix[c] * info.yapoints[y]) >> 8;
+UNROLL_GEN_TPL(uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r, (S32 *)(comp)(const U8 *)(pix)(S32)(apoint), (comp[_idx] = (comp[_idx] + pix[_idx] * apoint) >> 8), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) comp[c] = ((comp[c]*(256 - info.xapoints[x])) + ((cx[c] * info.xapoints[x]))) >> 12;
+UNROLL_GEN_TPL(uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r, (S32 *)(comp)(S32)(apoint)(S32 *)(cx), (comp[_idx] = ((comp[_idx] * (256-apoint)) + (cx[_idx] * apoint)) >> 12), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) *dptr++ = comp[c]&0xff;
+UNROLL_GEN_TPL(uroll_uref_dptr_inc_asgn_comp_and_ff, (U8 *&)(dptr)(S32 *)(comp), (*dptr++ = comp[_idx]&0xff), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) *dptr++ = (sptr[info.xpoints[x]*ch + c])&0xff;
+UNROLL_GEN_TPL(uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff, (U8 *&)(dptr)(const U8 *)(sptr)(S32)(apoint), (*dptr++ = sptr[apoint + _idx]&0xff), (1)(3)(4));
+//example: for(c = 0; c < ch; ++c) *dptr++ = (comp[c]>>10)&0xff;
+UNROLL_GEN_TPL(uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff, (U8 *&)(dptr)(S32 *)(comp)(const S32)(cval), (*dptr++ = (comp[_idx]>>cval)&0xff), (1)(3)(4));
+//..................................................................................
+
+
+template<U8 ch>
+struct scale_info
+{
+public:
+    std::vector<S32> xpoints;
+    std::vector<const U8*> ystrides;
+    std::vector<S32> xapoints, yapoints;
+    S32 xup_yup;
+
+public:
+    //unrolling loop types declaration
+    typedef uroll_zeroze_cx_comp<ch>                                                        uroll_zeroze_cx_comp_t;
+    typedef uroll_comp_rshftasgn_constval<ch>                                               uroll_comp_rshftasgn_constval_t;
+    typedef uroll_comp_asgn_cx_rshft_cval_all_mul_val<ch>                                   uroll_comp_asgn_cx_rshft_cval_all_mul_val_t;
+    typedef uroll_comp_plusasgn_cx_rshft_cval_all_mul_val<ch>                               uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t;
+    typedef uroll_inp_plusasgn_pix_mul_val<ch>                                              uroll_inp_plusasgn_pix_mul_val_t;
+    typedef uroll_inp_asgn_pix_mul_val<ch>                                                  uroll_inp_asgn_pix_mul_val_t;
+    typedef uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r<ch>      uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r_t;
+    typedef uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r<ch>                     uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t;
+    typedef uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r<ch>      uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t;
+    typedef uroll_uref_dptr_inc_asgn_comp_and_ff<ch>                                        uroll_uref_dptr_inc_asgn_comp_and_ff_t;
+    typedef uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff<ch>                     uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff_t;
+    typedef uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff<ch>                             uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t;
+
+public:
+    scale_info(const U8 *src, U32 srcW, U32 srcH, U32 dstW, U32 dstH, U32 srcStride)
+        : xup_yup((dstW >= srcW) + ((dstH >= srcH) << 1))
+    {
+        calc_x_points(srcW, dstW);
+        calc_y_strides(src, srcStride, srcH, dstH);
+        calc_aa_points(srcW, dstW, xup_yup&1, xapoints);
+        calc_aa_points(srcH, dstH, xup_yup&2, yapoints);
+    }
+
+private:
+    //...........................................................................................
+    void calc_x_points(U32 srcW, U32 dstW)
+    {
+        xpoints.resize(dstW+1);
+
+        S32 val = dstW >= srcW ? 0x8000 * srcW / dstW - 0x8000 : 0;
+        S32 inc = (srcW << 16) / dstW;
+
+        for(U32 i = 0, j = 0; i < dstW; ++i, ++j, val += inc)
+        {
+            xpoints[j] = llmax(0, val >> 16);
+        }
+    }
+    //...........................................................................................
+    void calc_y_strides(const U8 *src, U32 srcStride, U32 srcH, U32 dstH)
+    {
+        ystrides.resize(dstH+1);
+
+        S32 val = dstH >= srcH ? 0x8000 * srcH / dstH - 0x8000 : 0;
+        S32 inc = (srcH << 16) / dstH;
+
+        for(U32 i = 0, j = 0; i < dstH; ++i, ++j, val += inc)
+        {
+            ystrides[j] = src + llmax(0, val >> 16) * srcStride;
+        }
+    }
+    //...........................................................................................
+    void calc_aa_points(U32 srcSz, U32 dstSz, bool scale_up, std::vector<S32> &vp)
+    {
+        vp.resize(dstSz);
+
+        if(scale_up)
+        {
+            S32 val = 0x8000 * srcSz / dstSz - 0x8000;
+            S32 inc = (srcSz << 16) / dstSz;
+            U32 pos;
+
+            for(U32 i = 0, j = 0; i < dstSz; ++i, ++j, val += inc)
+            {
+                pos = val >> 16;
+
+                if (pos >= (srcSz - 1))
+                    vp[j] = 0;
+                else
+                    vp[j] = (val >> 8) - ((val >> 8) & 0xffffff00);
+            }
+        }
+        else
+        {
+            S32 inc = (srcSz << 16) / dstSz;
+            S32 Cp = ((dstSz << 14) / srcSz) + 1;
+            S32 ap;
+
+            for(U32 i = 0, j = 0, val = 0; i < dstSz; ++i, ++j, val += inc)
+            {
+                ap = ((0x100 - ((val >> 8) & 0xff)) * Cp) >> 8;
+                vp[j] = ap | (Cp << 16);
+            }
+        }
+    }
+};
+
+
+template<U8 ch>
+inline void bilinear_scale(
+    const U8 *src, U32 srcW, U32 srcH, U32 srcStride
+    , U8 *dst, U32 dstW, U32 dstH, U32 dstStride
+    )
+{
+    typedef scale_info<ch> scale_info_t;
+
+    scale_info_t info(src, srcW, srcH, dstW, dstH, srcStride);
+
+    const U8 *sptr;
+    U8 *dptr;
+    U32 x, y;
+    const U8 *pix;
+
+    S32 cx[ch], comp[ch];
+
+
+    if(3 == info.xup_yup)
+    { //scale x/y - up
+        for(y = 0; y < dstH; ++y)
+        {
+            dptr = dst + (y * dstStride);
+            sptr = info.ystrides[y];
+
+            if(0 < info.yapoints[y])
+            {
+                for(x = 0; x < dstW; ++x)
+                {
+                    //for(c = 0; c < ch; ++c) cx[c] = comp[c] = 0;
+                    typename scale_info_t::uroll_zeroze_cx_comp_t()(cx, comp);
+
+                    if(0 < info.xapoints[x])
+                    {
+                        pix = info.ystrides[y] + info.xpoints[x] * ch;
+
+                        //for(c = 0; c < ch; ++c) comp[c] = pix[c] * (256 - info.xapoints[x]);
+                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256 - info.xapoints[x]);
+
+                        pix += ch;
+
+                        //for(c = 0; c < ch; ++c) comp[c] += pix[c] * info.xapoints[x];
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, info.xapoints[x]);
+
+                        pix += srcStride;
+
+                        //for(c = 0; c < ch; ++c) cx[c] = pix[c] * info.xapoints[x];
+                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, info.xapoints[x]);
+
+                        pix -= ch;
+
+                        //for(c = 0; c < ch; ++c) {
+                        //  cx[c] += pix[c] * (256 - info.xapoints[x]);
+                        //  comp[c] = ((cx[c] * info.yapoints[y]) + (comp[c] * (256 - info.yapoints[y]))) >> 16;
+                        //  *dptr++ = comp[c]&0xff;
+                        //}
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, 256 - info.xapoints[x]);
+                        typename scale_info_t::uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r_t()(comp, cx, info.yapoints[y]);
+                        typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
+                    }
+                    else
+                    {
+                        pix = info.ystrides[y] + info.xpoints[x] * ch;
+
+                        //for(c = 0; c < ch; ++c) comp[c] = pix[c] * (256 - info.yapoints[y]);
+                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256-info.yapoints[y]);
+
+                        pix += srcStride;
+
+                        //for(c = 0; c < ch; ++c) {
+                        //  comp[c] = (comp[c] + pix[c] * info.yapoints[y]) >> 8;
+                        //  *dptr++ = comp[c]&0xff;
+                        //}
+                        typename scale_info_t::uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t()(comp, pix, info.yapoints[y]);
+                        typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
+                    }
+                }
+            }
+            else
+            {
+                for(x = 0; x < dstW; ++x)
+                {
+                    if(0 < info.xapoints[x])
+                    {
+                        pix = info.ystrides[y] + info.xpoints[x] * ch;
+
+                        //for(c = 0; c < ch; ++c) {
+                        //  comp[c] = pix[c] * (256 - info.xapoints[x]);
+                        //  comp[c] = (comp[c] + pix[c] * info.xapoints[x]) >> 8;
+                        //  *dptr++ = comp[c]&0xff;
+                        //}
+                        typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, 256 - info.xapoints[x]);
+                        typename scale_info_t::uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t()(comp, pix, info.xapoints[x]);
+                        typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_and_ff_t()(dptr, comp);
+                    }
+                    else
+                    {
+                        //for(c = 0; c < ch; ++c) *dptr++ = (sptr[info.xpoints[x]*ch + c])&0xff;
+                        typename scale_info_t::uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff_t()(dptr, sptr, info.xpoints[x]*ch);
+                    }
+                }
+            }
+        }
+    }
+    else if(info.xup_yup == 1)
+    { //scaling down vertically
+        S32 Cy, j;
+        S32 yap;
+
+        for(y = 0; y < dstH; y++)
+        {
+            Cy = info.yapoints[y] >> 16;
+            yap = info.yapoints[y] & 0xffff;
+
+            dptr = dst + (y * dstStride);
+
+            for(x = 0; x < dstW; x++)
+            {
+                pix = info.ystrides[y] + info.xpoints[x] * ch;
+
+                //for(c = 0; c < ch; ++c) comp[c] = pix[c] * yap;
+                typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, yap);
+
+                pix += srcStride;
+
+                for(j = (1 << 14) - yap; j > Cy; j -= Cy, pix += srcStride)
+                {
+                    //for(c = 0; c < ch; ++c) comp[c] += pix[c] * Cy;
+                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, Cy);
+                }
+
+                if(j > 0)
+                {
+                    //for(c = 0; c < ch; ++c) comp[c] += pix[c] * j;
+                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, j);
+                }
+
+                if(info.xapoints[x] > 0)
+                {
+                    pix = info.ystrides[y] + info.xpoints[x]*ch + ch;
+                    //for(c = 0; c < ch; ++c) cx[c] = pix[c] * yap;
+                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, yap);
+
+                    pix += srcStride;
+                    for(j = (1 << 14) - yap; j > Cy; j -= Cy)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cy;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cy);
+                        pix += srcStride;
+                    }
+
+                    if(j > 0)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * j;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, j);
+                    }
+
+                    //for(c = 0; c < ch; ++c) comp[c] = ((comp[c]*(256 - info.xapoints[x])) + ((cx[c] * info.xapoints[x]))) >> 12;
+                    typename scale_info_t::uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t()(comp, info.xapoints[x], cx);
+                }
+                else
+                {
+                    //for(c = 0; c < ch; ++c) comp[c] >>= 4;
+                    typename scale_info_t::uroll_comp_rshftasgn_constval_t()(comp, 4);
+                }
+
+                //for(c = 0; c < ch; ++c) *dptr++ = (comp[c]>>10)&0xff;
+                typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 10);
+            }
+        }
+    }
+    else if(info.xup_yup == 2)
+    { // scaling down horizontally
+        S32 Cx, j;
+        S32 xap;
+
+        for(y = 0; y < dstH; y++)
+        {
+            dptr = dst + (y * dstStride);
+
+            for(x = 0; x < dstW; x++)
+            {
+                Cx = info.xapoints[x] >> 16;
+                xap = info.xapoints[x] & 0xffff;
+
+                pix = info.ystrides[y] + info.xpoints[x] * ch;
+
+                //for(c = 0; c < ch; ++c) comp[c] = pix[c] * xap;
+                typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(comp, pix, xap);
+
+                pix+=ch;
+                for(j = (1 << 14) - xap; j > Cx; j -= Cx)
+                {
+                    //for(c = 0; c < ch; ++c) comp[c] += pix[c] * Cx;
+                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, Cx);
+                    pix+=ch;
+                }
+
+                if(j > 0)
+                {
+                    //for(c = 0; c < ch; ++c) comp[c] += pix[c] * j;
+                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(comp, pix, j);
+                }
+
+                if(info.yapoints[y] > 0)
+                {
+                    pix = info.ystrides[y] + info.xpoints[x]*ch + srcStride;
+                    //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
+                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+
+                    pix+=ch;
+                    for(j = (1 << 14) - xap; j > Cx; j -= Cx)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                        pix+=ch;
+                    }
+
+                    if(j > 0)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * j;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, j);
+                    }
+
+                    //for(c = 0; c < ch; ++c) comp[c] = ((comp[c] * (256 - info.yapoints[y])) + ((cx[c] * info.yapoints[y]))) >> 12;
+                    typename scale_info_t::uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t()(comp, info.yapoints[y], cx);
+                }
+                else
+                {
+                    //for(c = 0; c < ch; ++c) comp[c] >>= 4;
+                    typename scale_info_t::uroll_comp_rshftasgn_constval_t()(comp, 4);
+                }
+
+                //for(c = 0; c < ch; ++c) *dptr++ = (comp[c]>>10)&0xff;
+                typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 10);
+            }
+        }
+    }
+    else
+    { //scale x/y - down
+        S32 Cx, Cy, i, j;
+        S32 xap, yap;
+
+        for(y = 0; y < dstH; y++)
+        {
+            Cy = info.yapoints[y] >> 16;
+            yap = info.yapoints[y] & 0xffff;
+
+            dptr = dst + (y * dstStride);
+            for(x = 0; x < dstW; x++)
+            {
+                Cx = info.xapoints[x] >> 16;
+                xap = info.xapoints[x] & 0xffff;
+
+                sptr = info.ystrides[y] + info.xpoints[x] * ch;
+                pix = sptr;
+                sptr += srcStride;
+
+                //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
+                typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+
+                pix+=ch;
+                for(i = (1 << 14) - xap; i > Cx; i -= Cx)
+                {
+                    //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
+                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                    pix+=ch;
+                }
+
+                if(i > 0)
+                {
+                    //for(c = 0; c < ch; ++c) cx[c] += pix[c] * i;
+                    typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
+                }
+
+                //for(c = 0; c < ch; ++c) comp[c] = (cx[c] >> 5) * yap;
+                typename scale_info_t::uroll_comp_asgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, yap);
+
+                for(j = (1 << 14) - yap; j > Cy; j -= Cy)
+                {
+                    pix = sptr;
+                    sptr += srcStride;
+
+                    //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
+                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+
+                    pix+=ch;
+                    for(i = (1 << 14) - xap; i > Cx; i -= Cx)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                        pix+=ch;
+                    }
+
+                    if(i > 0)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * i;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
+                    }
+
+                    //for(c = 0; c < ch; ++c) comp[c] += (cx[c] >> 5) * Cy;
+                    typename scale_info_t::uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, Cy);
+                }
+
+                if(j > 0)
+                {
+                    pix = sptr;
+                    sptr += srcStride;
+
+                    //for(c = 0; c < ch; ++c) cx[c] = pix[c] * xap;
+                    typename scale_info_t::uroll_inp_asgn_pix_mul_val_t()(cx, pix, xap);
+
+                    pix+=ch;
+                    for(i = (1 << 14) - xap; i > Cx; i -= Cx)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * Cx;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, Cx);
+                        pix+=ch;
+                    }
+
+                    if(i > 0)
+                    {
+                        //for(c = 0; c < ch; ++c) cx[c] += pix[c] * i;
+                        typename scale_info_t::uroll_inp_plusasgn_pix_mul_val_t()(cx, pix, i);
+                    }
+
+                    //for(c = 0; c < ch; ++c) comp[c] += (cx[c] >> 5) * j;
+                    typename scale_info_t::uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t()(comp, cx, 5, j);
+                }
+
+                //for(c = 0; c < ch; ++c) *dptr++ = (comp[c]>>23)&0xff;
+                typename scale_info_t::uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t()(dptr, comp, 23);
+            }
+        }
+    } //else
+}
+
+//..................................................................................
+// SSE2 version of bilinear_scale(): the same integer steps, with the channels
+// of a pixel in the 32 bits lanes of a vector.
+//..................................................................................
+
+template<U8 ch>
+static inline __m128i load_pixel_sse2(const U8* pix)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const U32 bytes = ch == 4 ? load_u32(pix) : (pix[0] | (pix[1] << 8) | (pix[2] << 16));
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)bytes), zero), zero);
+}
+
+template<U8 ch>
+static inline void store_pixel_sse2(U8*& dptr, __m128i comp)
+{
+    // comp holds bytes, masked by the caller like the scalar code does
+    const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(comp, comp), comp);
+    const U32 value = (U32)_mm_cvtsi128_si32(bytes);
+    memcpy(dptr, &value, ch);
+    dptr += ch;
+}
+
+// Pixel by weight. The weights always fit in 15 bits, so that a multiply
+// and add of 16 bits halves does it.
+static inline __m128i mul_pixel_sse2(__m128i pix, S32 val)
+{
+    return _mm_madd_epi16(pix, _mm_set1_epi32(val));
+}
+
+// 32 bits multiply, which SSE2 lacks
+static inline __m128i mullo_epi32_sse2(__m128i a, S32 val)
+{
+    const __m128i b = _mm_set1_epi32(val);
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Weighted sum of the source pixels covered by a downscaled one, along a row
+// (step = ch) or a column (step = stride)
+template<U8 ch>
+static inline __m128i sum_down_sse2(const U8* pix, S32 step, S32 ap, S32 C)
+{
+    __m128i sum = mul_pixel_sse2(load_pixel_sse2<ch>(pix), ap);
+    pix += step;
+    S32 i;
+    for (i = (1 << 14) - ap; i > C; i -= C)
+    {
+        sum = _mm_add_epi32(sum, mul_pixel_sse2(load_pixel_sse2<ch>(pix), C));
+        pix += step;
+    }
+    if (i > 0)
+    {
+        sum = _mm_add_epi32(sum, mul_pixel_sse2(load_pixel_sse2<ch>(pix), i));
+    }
+    return sum;
+}
+
+template<U8 ch>
+static void bilinear_scale_sse2(
+    const U8 *src, U32 srcW, U32 srcH, U32 srcStride
+    , U8 *dst, U32 dstW, U32 dstH, U32 dstStride
+    )
+{
+    typedef scale_info<ch> scale_info_t;
+
+    scale_info_t info(src, srcW, srcH, dstW, dstH, srcStride);
+
+    const __m128i byte_mask = _mm_set1_epi32(0xff);
+    const U8 *pix;
+    U8 *dptr;
+    U32 x, y;
+    __m128i cx, comp;
+
+    if(3 == info.xup_yup)
+    { //scale x/y - up
+        for(y = 0; y < dstH; ++y)
+        {
+            dptr = dst + (y * dstStride);
+            const S32 yap = info.yapoints[y];
+
+            for(x = 0; x < dstW; ++x)
+            {
+                const S32 xap = info.xapoints[x];
+                pix = info.ystrides[y] + info.xpoints[x] * ch;
+
+                if(0 < yap)
+                {
+                    if(0 < xap)
+                    {
+                        comp = _mm_add_epi32(mul_pixel_sse2(load_pixel_sse2<ch>(pix), 256 - xap),
+                                             mul_pixel_sse2(load_pixel_sse2<ch>(pix + ch), xap));
+                        cx = _mm_add_epi32(mul_pixel_sse2(load_pixel_sse2<ch>(pix + srcStride + ch), xap),
+                                           mul_pixel_sse2(load_pixel_sse2<ch>(pix + srcStride), 256 - xap));
+                        comp = _mm_srai_epi32(_mm_add_epi32(mullo_epi32_sse2(cx, yap), mullo_epi32_sse2(comp, 256 - yap)), 16);
+                    }
+                    else
+                    {
+                        comp = mul_pixel_sse2(load_pixel_sse2<ch>(pix), 256 - yap);
+                        comp = _mm_srai_epi32(_mm_add_epi32(comp, mul_pixel_sse2(load_pixel_sse2<ch>(pix + srcStride), yap)), 8);
+                    }
+                    store_pixel_sse2<ch>(dptr, _mm_and_si128(comp, byte_mask));
+                }
+                else if(0 < xap)
+                {
+                    // Both weights apply to the same pixel, like in the scalar code
+                    comp = mul_pixel_sse2(load_pixel_sse2<ch>(pix), 256 - xap);
+                    comp = _mm_srai_epi32(_mm_add_epi32(comp, mul_pixel_sse2(load_pixel_sse2<ch>(pix), xap)), 8);
+                    store_pixel_sse2<ch>(dptr, _mm_and_si128(comp, byte_mask));
+                }
+                else
+                {
+                    memcpy(dptr, pix, ch);
+                    dptr += ch;
+                }
+            }
+        }
+    }
+    else if(info.xup_yup == 1)
+    { //scaling down vertically
+        for(y = 0; y < dstH; y++)
+        {
+            const S32 Cy = info.yapoints[y] >> 16;
+            const S32 yap = info.yapoints[y] & 0xffff;
+
+            dptr = dst + (y * dstStride);
+
+            for(x = 0; x < dstW; x++)
+            {
+                pix = info.ystrides[y] + info.xpoints[x] * ch;
+                comp = sum_down_sse2<ch>(pix, srcStride, yap, Cy);
+
+                const S32 xap = info.xapoints[x];
+                if(xap > 0)
+                {
+                    cx = sum_down_sse2<ch>(pix + ch, srcStride, yap, Cy);
+                    comp = _mm_srai_epi32(_mm_add_epi32(mullo_epi32_sse2(comp, 256 - xap), mullo_epi32_sse2(cx, xap)), 12);
+                }
+                else
+                {
+                    comp = _mm_srai_epi32(comp, 4);
+                }
+
+                store_pixel_sse2<ch>(dptr, _mm_and_si128(_mm_srai_epi32(comp, 10), byte_mask));
+            }
+        }
+    }
+    else if(info.xup_yup == 2)
+    { // scaling down horizontally
+        for(y = 0; y < dstH; y++)
+        {
+            const S32 yap = info.yapoints[y];
+
+            dptr = dst + (y * dstStride);
+
+            for(x = 0; x < dstW; x++)
+            {
+                const S32 Cx = info.xapoints[x] >> 16;
+                const S32 xap = info.xapoints[x] & 0xffff;
+
+                pix = info.ystrides[y] + info.xpoints[x] * ch;
+                comp = sum_down_sse2<ch>(pix, ch, xap, Cx);
+
+                if(yap > 0)
+                {
+                    cx = sum_down_sse2<ch>(pix + srcStride, ch, xap, Cx);
+                    comp = _mm_srai_epi32(_mm_add_epi32(mullo_epi32_sse2(comp, 256 - yap), mullo_epi32_sse2(cx, yap)), 12);
+                }
+                else
+                {
+                    comp = _mm_srai_epi32(comp, 4);
+                }
+
+                store_pixel_sse2<ch>(dptr, _mm_and_si128(_mm_srai_epi32(comp, 10), byte_mask));
+            }
+        }
+    }
+    else
+    { //scale x/y - down
+        for(y = 0; y < dstH; y++)
+        {
+            const S32 Cy = info.yapoints[y] >> 16;
+            const S32 yap = info.yapoints[y] & 0xffff;
+
+            dptr = dst + (y * dstStride);
+            for(x = 0; x < dstW; x++)
+            {
+                const S32 Cx = info.xapoints[x] >> 16;
+                const S32 xap = info.xapoints[x] & 0xffff;
+
+                pix = info.ystrides[y] + info.xpoints[x] * ch;
+                cx = sum_down_sse2<ch>(pix, ch, xap, Cx);
+                comp = mullo_epi32_sse2(_mm_srai_epi32(cx, 5), yap);
+                pix += srcStride;
+
+                S32 j;
+                for(j = (1 << 14) - yap; j > Cy; j -= Cy)
+                {
+                    cx = sum_down_sse2<ch>(pix, ch, xap, Cx);
+                    comp = _mm_add_epi32(comp, mullo_epi32_sse2(_mm_srai_epi32(cx, 5), Cy));
+                    pix += srcStride;
+                }
+
+                if(j > 0)
+                {
+                    cx = sum_down_sse2<ch>(pix, ch, xap, Cx);
+                    comp = _mm_add_epi32(comp, mullo_epi32_sse2(_mm_srai_epi32(cx, 5), j));
+                }
+
+                store_pixel_sse2<ch>(dptr, _mm_and_si128(_mm_srai_epi32(comp, 23), byte_mask));
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// SSE2
+//---------------------------------------------------------------------------
+
+static void fill_sse2(U8* data, S32 pixels, S32 components, const U8* color)
+{
+    // 16 pixels make a whole number of vectors whatever the pixel size
+    alignas(16) U8 block[4 * 16];
+    fill_scalar(block, 16, components, color);
+    __m128i pattern[4];
+    for (S32 i = 0; i < components; ++i)
+    {
+        pattern[i] = _mm_load_si128((const __m128i*)(block + 16 * i));
+    }
+
+    const S32 blocks = pixels / 16;
+    for (S32 b = 0; b < blocks; ++b)
+    {
+        for (S32 i = 0; i < components; ++i)
+        {
+            _mm_storeu_si128((__m128i*)data, pattern[i]);
+            data += 16;
+        }
+    }
+    fill_scalar(data, pixels - blocks * 16, components, color);
+}
+
+static void tint_sse2(U8* data, S32 pixels, S32 components, const F32* color)
+{
+    // Per byte factors over 16 pixels, alpha is multiplied by one
+    alignas(16) F32 factors[4 * 16];
+    const S32 block_size = components * 16;
+    for (S32 i = 0; i < block_size; ++i)
+    {
+        const S32 c = i % components;
+        factors[i] = c < 3 ? color[c] : 1.f;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const S32 blocks = pixels / 16;
+    for (S32 b = 0; b < blocks; ++b)
+    {
+        for (S32 i = 0; i < block_size; i += 16, data += 16)
+        {
+            const __m128i bytes = _mm_loadu_si128((const __m128i*)data);
+            const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            __m128i v[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                             _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+            for (S32 j = 0; j < 4; ++j)
+            {
+                // Truncated like the scalar cast
+                v[j] = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(v[j]), _mm_load_ps(factors + i + 4 * j)));
+            }
+            // Saturated like the scalar code
+            _mm_storeu_si128((__m128i*)data, _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+        }
+    }
+    tint_scalar(data, pixels - blocks * 16, components, color);
+}
+
+static void copy_alpha_mask_sse2(U8* dst, const U8* src, S32 pixels, const U8* fill)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgb = _mm_set1_epi32(fill[0] | (fill[1] << 8) | (fill[2] << 16));
+    S32 i = 0;
+    for (; i + 16 <= pixels; i += 16, dst += 64)
+    {
+        // Interleaving with zeros twice moves each mask byte to the top of
+        // a 32 bits lane, that is to the alpha of a pixel
+        const __m128i mask = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i lo = _mm_unpacklo_epi8(zero, mask);
+        const __m128i hi = _mm_unpackhi_epi8(zero, mask);
+        _mm_storeu_si128((__m128i*)dst, _mm_or_si128(rgb, _mm_unpacklo_epi16(zero, lo)));
+        _mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(rgb, _mm_unpackhi_epi16(zero, lo)));
+        _mm_storeu_si128((__m128i*)(dst + 32), _mm_or_si128(rgb, _mm_unpacklo_epi16(zero, hi)));
+        _mm_storeu_si128((__m128i*)(dst + 48), _mm_or_si128(rgb, _mm_unpackhi_epi16(zero, hi)));
+    }
+    copy_alpha_mask_scalar(dst, src + i, pixels - i, fill);
+}
+
+// fast_fractional_mult() on 16 bits lanes
+static inline __m128i fractional_mult_sse2(__m128i a, __m128i b)
+{
+    const __m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+}
+
+// The blend used for every alpha value: a null alpha leaves the destination
+// as is, a full one copies the source, like the shortcuts of the scalar
+// code. Pixels are RGBx in 16 bits lanes, the fourth lane is ignored.
+static inline __m128i blend_4onto3_sse2(__m128i d, __m128i s)
+{
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i transparency = _mm_sub_epi16(max, alpha);
+    // Wraps around like the U8 assignment of the scalar code
+    return _mm_and_si128(_mm_add_epi16(fractional_mult_sse2(d, transparency), fractional_mult_sse2(s, alpha)), max);
+}
+
+static void composite_4onto3_sse2(U8* dst, const U8* src, S32 pixels)
+{
+    // Four RGB pixels are loaded as 12 bytes, spread to RGBx in 16 bits lanes
+    // with shifts and masks, and packed back the same way.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i first3 = _mm_set_epi16(0, 0, 0, 0, 0, -1, -1, -1);
+    const __m128i second3 = _mm_set_epi16(0, -1, -1, -1, 0, 0, 0, 0);
+    const __m128i next3 = _mm_set_epi16(0, 0, -1, -1, -1, 0, 0, 0);
+    S32 i = 0;
+    for (; i + 4 <= pixels; i += 4, dst += 12, src += 16)
+    {
+        // d0..d7, d8..d11
+        const __m128i lo = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)dst), zero);
+        const __m128i hi = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)load_u32(dst + 8)), zero);
+        // d6..d11
+        const __m128i tail = _mm_or_si128(_mm_srli_si128(lo, 12), _mm_slli_si128(hi, 4));
+        const __m128i d01 = _mm_or_si128(_mm_and_si128(lo, first3), _mm_and_si128(_mm_slli_si128(lo, 2), second3));
+        const __m128i d23 = _mm_or_si128(_mm_and_si128(tail, first3), _mm_and_si128(_mm_slli_si128(tail, 2), second3));
+
+        const __m128i s = _mm_loadu_si128((const __m128i*)src);
+        const __m128i r01 = blend_4onto3_sse2(d01, _mm_unpacklo_epi8(s, zero));
+        const __m128i r23 = blend_4onto3_sse2(d23, _mm_unpackhi_epi8(s, zero));
+
+        // Back to 6 RGB lanes each, then 12 bytes
+        const __m128i c01 = _mm_or_si128(_mm_and_si128(r01, first3), _mm_and_si128(_mm_srli_si128(r01, 2), next3));
+        const __m128i c23 = _mm_or_si128(_mm_and_si128(r23, first3), _mm_and_si128(_mm_srli_si128(r23, 2), next3));
+        const __m128i result = _mm_packus_epi16(_mm_or_si128(c01, _mm_slli_si128(c23, 12)), _mm_srli_si128(c23, 4));
+        _mm_storel_epi64((__m128i*)dst, result);
+        store_u32(dst + 8, (U32)_mm_cvtsi128_si32(_mm_srli_si128(result, 8)));
+    }
+    composite_4onto3_scalar(dst, src, pixels - i);
+}
+
+static void vertical_flip_sse2(U8* data, S32 row_bytes, S32 rows)
+{
+    S32 mid_row = rows / 2;
+    for (S32 row = 0; row < mid_row; row++)
+    {
+        U8* row_a_data = data + row * row_bytes;
+        U8* row_b_data = data + (rows - 1 - row) * row_bytes;
+        S32 i = 0;
+        for (; i + 16 <= row_bytes; i += 16)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(row_a_data + i));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(row_b_data + i));
+            _mm_storeu_si128((__m128i*)(row_a_data + i), b);
+            _mm_storeu_si128((__m128i*)(row_b_data + i), a);
+        }
+        for (; i < row_bytes; ++i)
+        {
+            std::swap(row_a_data[i], row_b_data[i]);
+        }
+    }
+}
+
+// 4 bytes to 4 floats
+static inline __m128 load_pixel_ps_sse2(const U8* p)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bytes = _mm_cvtsi32_si128((int)load_u32(p));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+
+static void copy_line_scaled_sse2(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+    if (components != 4)
+    {
+        // Channels are only processed together for RGBA pixels
+        copy_line_scaled_scalar(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step, components);
+        return;
+    }
+
+    const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+    const __m128 norm_factor = _mm_set1_ps(1.f / ratio);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i byte_mask = _mm_set1_epi32(0xff);
+
+    // Same steps as the scalar code, each channel in a lane
+    for (S32 x = 0; x < out_pixel_len; x++)
+    {
+        const F32 sample0 = x * ratio;
+        const F32 sample1 = (x+1) * ratio;
+        const S32 index0 = llfloor(sample0);
+        const S32 index1 = llfloor(sample1);
+        const F32 fract0 = 1.f - (sample0 - F32(index0));
+        const F32 fract1 = sample1 - F32(index1);
+
+        U8* outp = out + x * out_pixel_step * 4;
+        if (index0 == index1)
+        {
+            memcpy(outp, in + index0 * in_pixel_step * 4, 4);
+            continue;
+        }
+
+        __m128 sum = _mm_mul_ps(load_pixel_ps_sse2(in + index0 * in_pixel_step * 4), _mm_set1_ps(fract0));
+        for (S32 u = index0 + 1; u < index1; u++)
+        {
+            sum = _mm_add_ps(sum, load_pixel_ps_sse2(in + u * in_pixel_step * 4));
+        }
+        if (fract1 && index1 < in_pixel_len)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(load_pixel_ps_sse2(in + index1 * in_pixel_step * 4), _mm_set1_ps(fract1)));
+        }
+        sum = _mm_mul_ps(sum, norm_factor);
+
+        // ll_round() of positive values, then the U8 cast
+        const __m128i rounded = _mm_and_si128(_mm_cvttps_epi32(_mm_add_ps(sum, half)), byte_mask);
+        const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(rounded, zero), zero);
+        store_u32(outp, (U32)_mm_cvtsi128_si32(bytes));
+    }
+}
+
+//---------------------------------------------------------------------------
+// AVX2
+//---------------------------------------------------------------------------
+
+LL_TARGET_AVX2 static void fill_avx2(U8* data, S32 pixels, S32 components, const U8* color)
+{
+    alignas(32) U8 block[4 * 32];
+    fill_scalar(block, 32, components, color);
+    __m256i pattern[4];
+    for (S32 i = 0; i < components; ++i)
+    {
+        pattern[i] = _mm256_load_si256((const __m256i*)(block + 32 * i));
+    }
+
+    const S32 blocks = pixels / 32;
+    for (S32 b = 0; b < blocks; ++b)
+    {
+        for (S32 i = 0; i < components; ++i)
+        {
+            _mm256_storeu_si256((__m256i*)data, pattern[i]);
+            data += 32;
+        }
+    }
+    fill_sse2(data, pixels - blocks * 32, components, color);
+}
+
+LL_TARGET_AVX2 static void tint_avx2(U8* data, S32 pixels, S32 components, const F32* color)
+{
+    alignas(32) F32 factors[4 * 32];
+    const S32 block_size = components * 32;
+    for (S32 i = 0; i < block_size; ++i)
+    {
+        const S32 c = i % components;
+        factors[i] = c < 3 ? color[c] : 1.f;
+    }
+
+    const S32 blocks = pixels / 32;
+    for (S32 b = 0; b < blocks; ++b)
+    {
+        for (S32 i = 0; i < block_size; i += 16, data += 16)
+        {
+            const __m128i bytes = _mm_loadu_si128((const __m128i*)data);
+            __m256i lo = _mm256_cvtepu8_epi32(bytes);
+            __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8));
+            lo = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(lo), _mm256_load_ps(factors + i)));
+            hi = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(hi), _mm256_load_ps(factors + i + 8)));
+            // The packs work within 128 bits lanes, hence the permutation
+            const __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i*)data, _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1)));
+        }
+    }
+    tint_sse2(data, pixels - blocks * 32, components, color);
+}
+
+LL_TARGET_AVX2 static void copy_alpha_mask_avx2(U8* dst, const U8* src, S32 pixels, const U8* fill)
+{
+    const __m256i rgb = _mm256_set1_epi32(fill[0] | (fill[1] << 8) | (fill[2] << 16));
+    S32 i = 0;
+    for (; i + 16 <= pixels; i += 16, dst += 64)
+    {
+        const __m128i mask = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m256i lo = _mm256_slli_epi32(_mm256_cvtepu8_epi32(mask), 24);
+        const __m256i hi = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(mask, 8)), 24);
+        _mm256_storeu_si256((__m256i*)dst, _mm256_or_si256(rgb, lo));
+        _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_or_si256(rgb, hi));
+    }
+    copy_alpha_mask_scalar(dst, src + i, pixels - i, fill);
+}
+
+LL_TARGET_AVX2 static inline __m256i fractional_mult_avx2(__m256i a, __m256i b)
+{
+    const __m256i i = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(i, _mm256_srli_epi16(i, 8)), 8);
+}
+
+LL_TARGET_AVX2 static void composite_4onto3_avx2(U8* dst, const U8* src, S32 pixels)
+{
+    // Eight pixels at a time, spread to RGBx and packed back with byte
+    // shuffles. The 16 bytes loads of 12 bytes of pixels read 4 bytes ahead,
+    // hence the two spare pixels at the end of the loop.
+    const __m128i spread = _mm_set_epi8(-1, 11, 10, 9, -1, 8, 7, 6, -1, 5, 4, 3, -1, 2, 1, 0);
+    const __m256i pack = _mm256_set_epi8(-1, -1, -1, -1, 14, 13, 12, 10, 9, 8, 6, 5, 4, 2, 1, 0,
+                                         -1, -1, -1, -1, 14, 13, 12, 10, 9, 8, 6, 5, 4, 2, 1, 0);
+    const __m256i max = _mm256_set1_epi16(255);
+    S32 i = 0;
+    for (; i + 10 <= pixels; i += 8, dst += 24, src += 32)
+    {
+        const __m256i d0 = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)dst), spread));
+        const __m256i d1 = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(dst + 12)), spread));
+        const __m256i s0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)src));
+        const __m256i s1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(src + 16)));
+
+        __m256i r[2];
+        const __m256i d[2] = { d0, d1 };
+        const __m256i s[2] = { s0, s1 };
+        for (S32 j = 0; j < 2; ++j)
+        {
+            const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s[j], _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            const __m256i transparency = _mm256_sub_epi16(max, alpha);
+            r[j] = _mm256_and_si256(_mm256_add_epi16(fractional_mult_avx2(d[j], transparency), fractional_mult_avx2(s[j], alpha)), max);
+        }
+
+        // The pack works within 128 bits lanes, hence the permutation to
+        // get the pixels back in order
+        const __m256i rgbx = _mm256_permute4x64_epi64(_mm256_packus_epi16(r[0], r[1]), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i rgb = _mm256_shuffle_epi8(rgbx, pack);
+        const __m128i lo = _mm256_castsi256_si128(rgb);
+        const __m128i hi = _mm256_extracti128_si256(rgb, 1);
+        _mm_storel_epi64((__m128i*)dst, lo);
+        store_u32(dst + 8, (U32)_mm_cvtsi128_si32(_mm_srli_si128(lo, 8)));
+        _mm_storel_epi64((__m128i*)(dst + 12), hi);
+        store_u32(dst + 20, (U32)_mm_cvtsi128_si32(_mm_srli_si128(hi, 8)));
+    }
+    composite_4onto3_sse2(dst, src, pixels - i);
+}
+
+LL_TARGET_AVX2 static void vertical_flip_avx2(U8* data, S32 row_bytes, S32 rows)
+{
+    S32 mid_row = rows / 2;
+    for (S32 row = 0; row < mid_row; row++)
+    {
+        U8* row_a_data = data + row * row_bytes;
+        U8* row_b_data = data + (rows - 1 - row) * row_bytes;
+        S32 i = 0;
+        for (; i + 32 <= row_bytes; i += 32)
+        {
+            const __m256i a = _mm256_loadu_si256((const __m256i*)(row_a_data + i));
+            const __m256i b = _mm256_loadu_si256((const __m256i*)(row_b_data + i));
+            _mm256_storeu_si256((__m256i*)(row_a_data + i), b);
+            _mm256_storeu_si256((__m256i*)(row_b_data + i), a);
+        }
+        for (; i < row_bytes; ++i)
+        {
+            std::swap(row_a_data[i], row_b_data[i]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// Dispatch
+//---------------------------------------------------------------------------
+
+void LLImageSIMD::fill(U8* data, S32 pixels, S32 components, const U8* color)
+{
+    switch (current_level())
+    {
+    case AVX2:
+        fill_avx2(data, pixels, components, color);
+        break;
+    case SSE2:
+        fill_sse2(data, pixels, components, color);
+        break;
+    default:
+        fill_scalar(data, pixels, components, color);
+        break;
+    }
+}
+
+void LLImageSIMD::tint(U8* data, S32 pixels, S32 components, const F32* color)
+{
+    llassert((3 == components) || (4 == components));
+    switch (current_level())
+    {
+    case AVX2:
+        tint_avx2(data, pixels, components, color);
+        break;
+    case SSE2:
+        tint_sse2(data, pixels, components, color);
+        break;
+    default:
+        tint_scalar(data, pixels, components, color);
+        break;
+    }
+}
+
+void LLImageSIMD::copyAlphaMask(U8* dst, const U8* src, S32 pixels, const U8* fill)
+{
+    switch (current_level())
+    {
+    case AVX2:
+        copy_alpha_mask_avx2(dst, src, pixels, fill);
+        break;
+    case SSE2:
+        copy_alpha_mask_sse2(dst, src, pixels, fill);
+        break;
+    default:
+        copy_alpha_mask_scalar(dst, src, pixels, fill);
+        break;
+    }
+}
+
+void LLImageSIMD::composite4onto3(U8* dst, const U8* src, S32 pixels)
+{
+    switch (current_level())
+    {
+    case AVX2:
+        composite_4onto3_avx2(dst, src, pixels);
+        break;
+    case SSE2:
+        composite_4onto3_sse2(dst, src, pixels);
+        break;
+    default:
+        composite_4onto3_scalar(dst, src, pixels);
+        break;
+    }
+}
+
+void LLImageSIMD::verticalFlip(U8* data, S32 row_bytes, S32 rows)
+{
+    llassert(row_bytes > 0);
+    switch (current_level())
+    {
+    case AVX2:
+        vertical_flip_avx2(data, row_bytes, rows);
+        break;
+    case SSE2:
+        vertical_flip_sse2(data, row_bytes, rows);
+        break;
+    default:
+        vertical_flip_scalar(data, row_bytes, rows);
+        break;
+    }
+}
+
+void LLImageSIMD::bilinearScale(const U8* src, U32 src_width, U32 src_height, U32 src_components, U32 src_stride,
+                                U8* dst, U32 dst_width, U32 dst_height, U32 dst_components, U32 dst_stride)
+{
+    llassert(src_components == dst_components);
+    // The filter works on one pixel at a time, with the channels in the
+    // lanes of a vector: there is nothing to gain from vectors wider than a
+    // pixel, and loading 3 bytes pixels one byte at a time costs more than
+    // it saves.
+    switch (src_components)
+    {
+    case 1:
+        bilinear_scale<1>(src, src_width, src_height, src_stride, dst, dst_width, dst_height, dst_stride);
+        break;
+    case 3:
+        bilinear_scale<3>(src, src_width, src_height, src_stride, dst, dst_width, dst_height, dst_stride);
+        break;
+    case 4:
+        if (current_level() >= SSE2)
+        {
+            bilinear_scale_sse2<4>(src, src_width, src_height, src_stride, dst, dst_width, dst_height, dst_stride);
+        }
+        else
+        {
+            bilinear_scale<4>(src, src_width, src_height, src_stride, dst, dst_width, dst_height, dst_stride);
+        }
+        break;
+    default:
+        llassert(!"Implement if need");
+        break;
+    }
+}
+
+void LLImageSIMD::copyLineScaled(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len,
+                                 S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+    if (current_level() >= SSE2)
+    {
+        copy_line_scaled_sse2(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step, components);
+    }
+    else
+    {
+        copy_line_scaled_scalar(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step, components);
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file llimagesimd.h
+ * @brief Vectorized pixel loops used by LLImageRaw.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGESIMD_H
+#define LL_LLIMAGESIMD_H
+
+//
+// The per pixel loops behind LLImageRaw::scale(), composite(), fill(),
+// tint(), copyUnscaledAlphaMask() and verticalFlip(), on plain buffers of
+// tightly packed pixels.
+//
+// Each kernel has a scalar implementation, kept as the reference, and SSE2
+// and/or AVX2 ones producing the very same bytes. The best level the CPU
+// supports is used unless setLevel() says otherwise (tests and benchmarks).
+//
+namespace LLImageSIMD
+{
+    enum ELevel
+    {
+        SCALAR = 0,
+        SSE2,
+        AVX2,
+    };
+
+    // Best level supported by this CPU
+    ELevel getSupportedLevel();
+
+    ELevel getLevel();
+    // Returns the level actually in use, which is no more than the
+    // supported one. Not thread safe: meant to be called at startup.
+    ELevel setLevel(ELevel level);
+
+    const char* getLevelName(ELevel level);
+
+    // Sets every pixel to 'color' (its first 'components' bytes)
+    void fill(U8* data, S32 pixels, S32 components, const U8* color);
+
+    // Multiplies the first three channels by 'color' (3 floats), leaving
+    // alpha untouched. 'components' is 3 or 4.
+    void tint(U8* data, S32 pixels, S32 components, const F32* color);
+
+    // Expands a one component mask into RGBA pixels with 'fill' (3 bytes)
+    // as RGB and the mask as alpha.
+    void copyAlphaMask(U8* dst, const U8* src, S32 pixels, const U8* fill);
+
+    // Blends RGBA 'src' pixels over RGB 'dst' pixels
+    void composite4onto3(U8* dst, const U8* src, S32 pixels);
+
+    // Reverses the order of the rows
+    void verticalFlip(U8* data, S32 row_bytes, S32 rows);
+
+    // Filtered scaling of a whole 1, 3 or 4 components image
+    void bilinearScale(const U8* src, U32 src_width, U32 src_height, U32 src_components, U32 src_stride,
+                       U8* dst, U32 dst_width, U32 dst_height, U32 dst_components, U32 dst_stride);
+
+    // Box filtered scaling of one line (or column, using the pixel steps)
+    void copyLineScaled(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len,
+                        S32 in_pixel_step, S32 out_pixel_step, S32 components);
+}
+
+#endif  // LL_LLIMAGESIMD_H
@@ -38,7 +38,9 @@ public:
                  S32 discard,
                  bool needs_aux,
                  const LLPointer<LLImageDecodeThread::Responder>& responder,
-                 U32 request_id);
+                 U32 request_id,
+                 const LLUUID& id,
+                 LLImageDecodeThread::DecodedCache* decoded_cache);
     virtual ~ImageRequest();
 
     /*virtual*/ bool processRequest();
@@ -58,14 +60,18 @@ private:
     bool mDecodedRaw;
     bool mDecodedAux;
     LLPointer<LLImageDecodeThread::Responder> mResponder;
-    std::string mErrorString;};
+    std::string mErrorString;
+    LLUUID mID;
+    LLImageDecodeThread::DecodedCache* mDecodedCache;
+};
 
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
 LLImageDecodeThread::LLImageDecodeThread(bool /*threaded*/)
-    : mDecodeCount(0)
+    : mDecodeCount(0),
+      mDecodedCache(NULL)
 {
     mThreadPool.reset(new LL::ThreadPool("ImageDecode", 8));
     mThreadPool->start();
@@ -92,7 +98,8 @@ LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(
     const LLPointer<LLImageFormatted>& image,
     S32 discard,
     bool needs_aux,
-    const LLPointer<LLImageDecodeThread::Responder>& responder)
+    const LLPointer<LLImageDecodeThread::Responder>& responder,
+    const LLUUID& id)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
 
@@ -102,7 +109,7 @@ LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(
 
     // Instantiate the ImageRequest right in the lambda, why not?
     bool posted = mThreadPool->getQueue().post(
-        [req = ImageRequest(image, discard, needs_aux, responder, decode_id)]
+        [req = ImageRequest(image, discard, needs_aux, responder, decode_id, id, mDecodedCache)]
         () mutable
         {
             auto done = req.processRequest();
@@ -132,14 +139,18 @@ ImageRequest::ImageRequest(const LLPointer<LLImageFormatted>& image,
                            S32 discard,
                            bool needs_aux,
                            const LLPointer<LLImageDecodeThread::Responder>& responder,
-                           U32 request_id)
+                           U32 request_id,
+                           const LLUUID& id,
+                           LLImageDecodeThread::DecodedCache* decoded_cache)
     : mFormattedImage(image),
       mDiscardLevel(discard),
       mNeedsAux(needs_aux),
       mDecodedRaw(false),
       mDecodedAux(false),
       mResponder(responder),
-      mRequestId(request_id)
+      mRequestId(request_id),
+      mID(id),
+      mDecodedCache(id.notNull() && discard >= 0 ? decoded_cache : NULL)
 {
 }
 
@@ -168,13 +179,38 @@ bool ImageRequest::processRequest()
     LLImageDataLock lockDecodedRaw(mDecodedImageRaw);
     LLImageDataLock lockDecodedAux(mDecodedImageAux);
 
+    bool parsed = false;
+    if (mDecodedCache && !mDecodedRaw && mDecodedImageRaw.isNull())
+    {
+        // parse formatted header
+        if (!mFormattedImage->updateData())
+        {
+            return true; // done (failed)
+        }
+        parsed = true;
+
+        // Let the cache skip the images too small for it to keep
+        const S32 scale = 1 << mDiscardLevel;
+        const S32 pixels = ((mFormattedImage->getWidth() + scale - 1) / scale) *
+                           ((mFormattedImage->getHeight() + scale - 1) / scale);
+        S32 decoded_discard = -1;
+        if (mDecodedCache->read(mID, mDiscardLevel, mNeedsAux, pixels, mDecodedImageRaw, mDecodedImageAux, decoded_discard))
+        {
+            // The requester picks the decoded discard level from there
+            mFormattedImage->setDiscardLevel((S8)decoded_discard);
+            mDecodedRaw = true;
+            mDecodedAux = mNeedsAux;
+            return true;
+        }
+    }
+
     if (!mDecodedRaw)
     {
         // Decode primary channels
         if (mDecodedImageRaw.isNull())
         {
             // parse formatted header
-            if (!mFormattedImage->updateData())
+            if (!parsed && !mFormattedImage->updateData())
             {
                 return true; // done (failed)
             }
@@ -213,6 +249,12 @@ bool ImageRequest::processRequest()
         mErrorString = LLImage::getLastThreadError();
     }
 
+    if (mDecodedCache && done && mDecodedRaw && (!mNeedsAux || mDecodedAux))
+    {
+        mDecodedCache->write(mID, mDiscardLevel, mFormattedImage->getDiscardLevel(),
+                             mDecodedImageRaw, mNeedsAux ? mDecodedImageAux.get() : NULL);
+    }
+
     return done;
 }
 
@@ -29,6 +29,7 @@
 
 #include "llimage.h"
 #include "llpointer.h"
+#include "lluuid.h"
 #include "threadpool_fwd.h"
 
 class LLImageDecodeThread
@@ -42,6 +43,23 @@ public:
         virtual void completed(bool success, const std::string& error_message, LLImageRaw* raw, LLImageRaw* aux, U32 request_id) = 0;
     };
 
+    // Optional store of already decoded images. When set, the decode threads
+    // look it up before decoding an image with a known ID, and feed it with
+    // the images they decode. Implementations must be thread safe.
+    class DecodedCache
+    {
+    public:
+        virtual ~DecodedCache() {}
+        // On success, 'raw' (and 'aux' when needs_aux is set) hold the image
+        // decoded for a request at 'discard', and 'decoded_discard' is the
+        // discard level actually reached by that decode. 'pixels' is the
+        // size of that image according to the formatted image header.
+        virtual bool read(const LLUUID& id, S32 discard, bool needs_aux, S32 pixels,
+                          LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux, S32& decoded_discard) = 0;
+        virtual void write(const LLUUID& id, S32 discard, S32 decoded_discard,
+                           const LLImageRaw* raw, const LLImageRaw* aux) = 0;
+    };
+
 public:
     LLImageDecodeThread(bool threaded = true);
     virtual ~LLImageDecodeThread();
@@ -50,18 +68,24 @@ public:
     typedef U32 handle_t;
     handle_t decodeImage(const LLPointer<LLImageFormatted>& image,
                          S32 discard, bool needs_aux,
-                         const LLPointer<Responder>& responder);
+                         const LLPointer<Responder>& responder,
+                         const LLUUID& id = LLUUID::null);
     size_t getPending();
     size_t update(F32 max_time_ms);
     S32 getTotalDecodeCount() { return mDecodeCount; }
     void shutdown();
 
+    // Requests keep the cache set when they were posted, so it must outlive
+    // them: only reset it once shutdown() returned.
+    void setDecodedCache(DecodedCache* cache) { mDecodedCache = cache; }
+
 private:
     // As of SL-17483, LLImageDecodeThread is no longer itself an
     // LLQueuedThread - instead this is the API by which we submit work to the
     // "ImageDecode" ThreadPool.
     std::unique_ptr<LL::ThreadPool> mThreadPool;
     LLAtomicU32 mDecodeCount;
+    DecodedCache* mDecodedCache;
 };
 
 #endif
@@ -0,0 +1,310 @@
+/**
+ * @file llimagesimd_test.cpp
+ * @brief Checks that the vectorized pixel loops match the scalar ones.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+// Class to test
+#include "../llimagesimd.h"
+// Tut header
+#include "../test/lltut.h"
+
+#include <random>
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+    // Sizes covering whole vectors, scalar tails and tiny images
+    static const S32 sSizes[][2] = { { 1, 1 }, { 7, 3 }, { 16, 16 }, { 33, 17 }, { 64, 64 }, { 129, 31 } };
+    static const S32 sComponents[] = { 1, 3, 4 };
+    // Bytes past the end of the destination buffers, which must be left alone
+    static const S32 GUARD_BYTES = 64;
+
+    struct simd_test
+    {
+        std::vector<LLImageSIMD::ELevel> mLevels;
+        std::mt19937 mRandom;
+
+        simd_test() : mRandom(1234)
+        {
+            // The levels checked against the scalar code
+            for (S32 level = LLImageSIMD::SSE2; level <= LLImageSIMD::getSupportedLevel(); ++level)
+            {
+                mLevels.push_back((LLImageSIMD::ELevel)level);
+            }
+        }
+
+        ~simd_test()
+        {
+            LLImageSIMD::setLevel(LLImageSIMD::getSupportedLevel());
+        }
+
+        std::vector<U8> randomBytes(S32 size)
+        {
+            std::vector<U8> bytes(size);
+            for (U8& byte : bytes)
+            {
+                byte = (U8)(mRandom() & 0xff);
+            }
+            return bytes;
+        }
+
+        std::string describe(LLImageSIMD::ELevel level, S32 components, S32 width, S32 height)
+        {
+            return llformat("%s, %d components, %dx%d", LLImageSIMD::getLevelName(level), components, width, height);
+        }
+    };
+
+    typedef test_group<simd_test> simd_t;
+    typedef simd_t::object simd_object_t;
+    tut::simd_t tut_simd("LLImageSIMD");
+
+    template<> template<>
+    void simd_object_t::test<1>()
+    {
+        // fill()
+        for (S32 components : sComponents)
+        {
+            for (const auto& size : sSizes)
+            {
+                const S32 pixels = size[0] * size[1];
+                const std::vector<U8> color = randomBytes(4);
+                const std::vector<U8> initial = randomBytes(pixels * components + GUARD_BYTES);
+
+                std::vector<U8> expected = initial;
+                LLImageSIMD::setLevel(LLImageSIMD::SCALAR);
+                LLImageSIMD::fill(expected.data(), pixels, components, color.data());
+
+                for (LLImageSIMD::ELevel level : mLevels)
+                {
+                    std::vector<U8> result = initial;
+                    LLImageSIMD::setLevel(level);
+                    LLImageSIMD::fill(result.data(), pixels, components, color.data());
+                    ensure("fill " + describe(level, components, size[0], size[1]), result == expected);
+                }
+            }
+        }
+    }
+
+    template<> template<>
+    void simd_object_t::test<2>()
+    {
+        // tint(), which only makes sense with colors
+        const F32 colors[][3] = { { 1.f, 1.f, 1.f }, { 0.f, 0.5f, 1.f }, { 0.25f, 0.731f, 0.999f }, { 1.5f, 2.f, 0.5f } };
+        for (S32 components : { 3, 4 })
+        {
+            for (const auto& size : sSizes)
+            {
+                for (const auto& color : colors)
+                {
+                    const S32 pixels = size[0] * size[1];
+                    const std::vector<U8> initial = randomBytes(pixels * components + GUARD_BYTES);
+
+                    std::vector<U8> expected = initial;
+                    LLImageSIMD::setLevel(LLImageSIMD::SCALAR);
+                    LLImageSIMD::tint(expected.data(), pixels, components, color);
+
+                    for (LLImageSIMD::ELevel level : mLevels)
+                    {
+                        std::vector<U8> result = initial;
+                        LLImageSIMD::setLevel(level);
+                        LLImageSIMD::tint(result.data(), pixels, components, color);
+                        ensure("tint " + describe(level, components, size[0], size[1]), result == expected);
+                    }
+                }
+            }
+        }
+
+        // Factors over one saturate, scalar tail included: 21 pixels are one
+        // SSE2 block and a tail of 5, an AVX2 tail of 21
+        const F32 bright[3] = { 2.f, 1.5f, 0.5f };
+        for (S32 level = LLImageSIMD::SCALAR; level <= LLImageSIMD::getSupportedLevel(); ++level)
+        {
+            std::vector<U8> pixels(21 * 3, 200);
+            LLImageSIMD::setLevel((LLImageSIMD::ELevel)level);
+            LLImageSIMD::tint(pixels.data(), 21, 3, bright);
+            for (S32 i = 0; i < 21; ++i)
+            {
+                const std::string msg = llformat("bright tint, %s, pixel %d", LLImageSIMD::getLevelName((LLImageSIMD::ELevel)level), i);
+                ensure_equals(msg, pixels[i * 3], (U8)255);
+                ensure_equals(msg, pixels[i * 3 + 1], (U8)255);
+                ensure_equals(msg, pixels[i * 3 + 2], (U8)100);
+            }
+        }
+    }
+
+    template<> template<>
+    void simd_object_t::test<3>()
+    {
+        // copyAlphaMask(), one component to four
+        for (const auto& size : sSizes)
+        {
+            const S32 pixels = size[0] * size[1];
+            const std::vector<U8> fill = randomBytes(3);
+            const std::vector<U8> mask = randomBytes(pixels);
+            const std::vector<U8> initial = randomBytes(pixels * 4 + GUARD_BYTES);
+
+            std::vector<U8> expected = initial;
+            LLImageSIMD::setLevel(LLImageSIMD::SCALAR);
+            LLImageSIMD::copyAlphaMask(expected.data(), mask.data(), pixels, fill.data());
+
+            for (LLImageSIMD::ELevel level : mLevels)
+            {
+                std::vector<U8> result = initial;
+                LLImageSIMD::setLevel(level);
+                LLImageSIMD::copyAlphaMask(result.data(), mask.data(), pixels, fill.data());
+                ensure("copyAlphaMask " + describe(level, 4, size[0], size[1]), result == expected);
+            }
+        }
+    }
+
+    template<> template<>
+    void simd_object_t::test<4>()
+    {
+        // composite4onto3(), with some fully transparent and opaque pixels
+        // since the scalar code has shortcuts for those
+        for (const auto& size : sSizes)
+        {
+            const S32 pixels = size[0] * size[1];
+            std::vector<U8> src = randomBytes(pixels * 4);
+            for (S32 i = 0; i < pixels; i += 3)
+            {
+                src[i * 4 + 3] = (i % 2) ? 0 : 255;
+            }
+            const std::vector<U8> initial = randomBytes(pixels * 3 + GUARD_BYTES);
+
+            std::vector<U8> expected = initial;
+            LLImageSIMD::setLevel(LLImageSIMD::SCALAR);
+            LLImageSIMD::composite4onto3(expected.data(), src.data(), pixels);
+
+            for (LLImageSIMD::ELevel level : mLevels)
+            {
+                std::vector<U8> result = initial;
+                LLImageSIMD::setLevel(level);
+                LLImageSIMD::composite4onto3(result.data(), src.data(), pixels);
+                ensure("composite4onto3 " + describe(level, 4, size[0], size[1]), result == expected);
+            }
+        }
+    }
+
+    template<> template<>
+    void simd_object_t::test<5>()
+    {
+        // verticalFlip()
+        for (S32 components : sComponents)
+        {
+            for (const auto& size : sSizes)
+            {
+                const S32 row_bytes = size[0] * components;
+                const std::vector<U8> initial = randomBytes(row_bytes * size[1] + GUARD_BYTES);
+
+                std::vector<U8> expected = initial;
+                LLImageSIMD::setLevel(LLImageSIMD::SCALAR);
+                LLImageSIMD::verticalFlip(expected.data(), row_bytes, size[1]);
+
+                for (LLImageSIMD::ELevel level : mLevels)
+                {
+                    std::vector<U8> result = initial;
+                    LLImageSIMD::setLevel(level);
+                    LLImageSIMD::verticalFlip(result.data(), row_bytes, size[1]);
+                    ensure("verticalFlip " + describe(level, components, size[0], size[1]), result == expected);
+                }
+            }
+        }
+    }
+
+    template<> template<>
+    void simd_object_t::test<6>()
+    {
+        // bilinearScale(), through all the up/down combinations
+        const S32 scales[][4] = {
+            { 64, 64, 128, 128 },   // up
+            { 7, 5, 19, 23 },
+            { 128, 96, 37, 29 },    // down
+            { 512, 512, 256, 256 },
+            { 16, 16, 1, 1 },
+            { 31, 77, 64, 20 },     // up horizontally, down vertically
+            { 100, 10, 33, 40 },    // down horizontally, up vertically
+            { 33, 17, 33, 17 },     // same size
+        };
+        for (S32 components : sComponents)
+        {
+            for (const auto& scale : scales)
+            {
+                const std::vector<U8> src = randomBytes(scale[0] * scale[1] * components);
+                const S32 dst_size = scale[2] * scale[3] * components;
+                const std::vector<U8> initial = randomBytes(dst_size + GUARD_BYTES);
+
+                std::vector<U8> expected = initial;
+                LLImageSIMD::setLevel(LLImageSIMD::SCALAR);
+                LLImageSIMD::bilinearScale(src.data(), scale[0], scale[1], components, scale[0] * components,
+                                           expected.data(), scale[2], scale[3], components, scale[2] * components);
+
+                for (LLImageSIMD::ELevel level : mLevels)
+                {
+                    std::vector<U8> result = initial;
+                    LLImageSIMD::setLevel(level);
+                    LLImageSIMD::bilinearScale(src.data(), scale[0], scale[1], components, scale[0] * components,
+                                               result.data(), scale[2], scale[3], components, scale[2] * components);
+                    ensure("bilinearScale " + describe(level, components, scale[0], scale[1]) + llformat(" to %dx%d", scale[2], scale[3]),
+                           result == expected);
+                }
+            }
+        }
+    }
+
+    template<> template<>
+    void simd_object_t::test<7>()
+    {
+        // copyLineScaled(), along rows and along columns
+        const S32 lengths[][2] = { { 64, 128 }, { 7, 19 }, { 128, 37 }, { 16, 1 }, { 100, 33 } };
+        for (S32 components : sComponents)
+        {
+            for (const auto& length : lengths)
+            {
+                for (S32 step : { 1, 5 })
+                {
+                    const std::vector<U8> in = randomBytes(length[0] * step * components);
+                    const std::vector<U8> initial = randomBytes(length[1] * step * components + GUARD_BYTES);
+
+                    std::vector<U8> expected = initial;
+                    LLImageSIMD::setLevel(LLImageSIMD::SCALAR);
+                    LLImageSIMD::copyLineScaled(in.data(), expected.data(), length[0], length[1], step, step, components);
+
+                    for (LLImageSIMD::ELevel level : mLevels)
+                    {
+                        std::vector<U8> result = initial;
+                        LLImageSIMD::setLevel(level);
+                        LLImageSIMD::copyLineScaled(in.data(), result.data(), length[0], length[1], step, step, components);
+                        ensure("copyLineScaled " + describe(level, components, length[0], step) + llformat(" to %d", length[1]),
+                               result == expected);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -108,6 +108,8 @@ public:
     // Member Variables
     //--------------------------------------------------------------------
 protected:
+    friend class LLInventoryCacheFile;
+
     LLUUID mUUID;
     LLUUID mParentUUID; // Parent category.  Root categories have LLUUID::NULL.
     LLUUID mThumbnailUUID;
@@ -214,6 +216,8 @@ public:
     // Member Variables
     //--------------------------------------------------------------------
 protected:
+    friend class LLInventoryCacheFile;
+
     LLPermissions mPermissions;
     LLUUID mAssetUUID;
     std::string mDescription;
@@ -276,6 +280,8 @@ public:
     // Member Variables
     //--------------------------------------------------------------------
 protected:
+    friend class LLInventoryCacheFile;
+
     LLFolderType::EType mPreferredType; // Type that this category was "meant" to hold (although it may hold any type).
 };
 
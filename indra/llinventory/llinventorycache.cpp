@@ -0,0 +1,253 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Binary file of inventory categories and items.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llinventorycache.h"
+
+#include "llfile.h"
+#include "llinventory.h"
+
+struct LLInventoryCacheHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    S32 mCacheVersion;
+    U32 mCategoryCount;
+    U32 mItemCount;
+    U32 mStringsSize;
+};
+static_assert(sizeof(LLInventoryCacheHeader) == 24, "Unexpected inventory cache header size");
+
+static constexpr U32 HEADER_MAGIC = 0x5649494C;  // "LIIV"
+static constexpr U32 HEADER_VERSION = 1;
+
+LLInventoryCacheFile::LLInventoryCacheFile()
+    : mCacheVersion(0)
+{
+    static_assert(sizeof(CategoryRecord) == 80, "Unexpected inventory cache category size");
+    static_assert(sizeof(ItemRecord) == 180, "Unexpected inventory cache item size");
+}
+
+void LLInventoryCacheFile::clear()
+{
+    mCacheVersion = 0;
+    mCategories.clear();
+    mItems.clear();
+    mStrings.clear();
+    mStringOffsets.clear();
+}
+
+LLInventoryCacheFile::StringRef LLInventoryCacheFile::addString(const std::string& str)
+{
+    StringRef ref;
+    ref.mSize = (U32)str.size();
+    auto inserted = mStringOffsets.emplace(str, (U32)mStrings.size());
+    ref.mOffset = inserted.first->second;
+    if (inserted.second)
+    {
+        mStrings.append(str);
+    }
+    return ref;
+}
+
+bool LLInventoryCacheFile::getString(const StringRef& ref, std::string& str) const
+{
+    if (ref.mOffset > mStrings.size() || ref.mSize > mStrings.size() - ref.mOffset)
+    {
+        return false;
+    }
+    str.assign(mStrings, ref.mOffset, ref.mSize);
+    return true;
+}
+
+void LLInventoryCacheFile::addCategory(const LLInventoryCategory* cat, const LLUUID& owner_id, S32 version)
+{
+    CategoryRecord record = {};
+    memcpy(record.mID, cat->mUUID.mData, UUID_BYTES);
+    memcpy(record.mParentID, cat->mParentUUID.mData, UUID_BYTES);
+    memcpy(record.mThumbnailID, cat->mThumbnailUUID.mData, UUID_BYTES);
+    memcpy(record.mOwnerID, owner_id.mData, UUID_BYTES);
+    record.mVersion = version;
+    record.mType = (S8)cat->mType;
+    record.mPreferredType = (S8)cat->mPreferredType;
+    record.mName = addString(cat->mName);
+    mCategories.push_back(record);
+}
+
+void LLInventoryCacheFile::addItem(const LLInventoryItem* item)
+{
+    const LLPermissions& perm = item->mPermissions;
+
+    ItemRecord record = {};
+    memcpy(record.mID, item->mUUID.mData, UUID_BYTES);
+    memcpy(record.mParentID, item->mParentUUID.mData, UUID_BYTES);
+    memcpy(record.mThumbnailID, item->mThumbnailUUID.mData, UUID_BYTES);
+    memcpy(record.mAssetID, item->mAssetUUID.mData, UUID_BYTES);
+    memcpy(record.mCreatorID, perm.getCreator().mData, UUID_BYTES);
+    memcpy(record.mOwnerID, perm.getOwner().mData, UUID_BYTES);
+    memcpy(record.mLastOwnerID, perm.getLastOwner().mData, UUID_BYTES);
+    memcpy(record.mGroupID, perm.getGroup().mData, UUID_BYTES);
+    record.mMaskBase = perm.getMaskBase();
+    record.mMaskOwner = perm.getMaskOwner();
+    record.mMaskGroup = perm.getMaskGroup();
+    record.mMaskEveryone = perm.getMaskEveryone();
+    record.mMaskNext = perm.getMaskNextOwner();
+    record.mFlags = item->mFlags;
+    record.mCreationDate = (S32)item->mCreationDate;
+    record.mSalePrice = item->mSaleInfo.getSalePrice();
+    record.mSaleType = (S8)item->mSaleInfo.getSaleType();
+    record.mType = (S8)item->mType;
+    record.mInventoryType = (S8)item->mInventoryType;
+    record.mName = addString(item->mName);
+    record.mDescription = addString(item->mDescription);
+    mItems.push_back(record);
+}
+
+bool LLInventoryCacheFile::save(const std::string& filename, S32 cache_version) const
+{
+    LLInventoryCacheHeader header;
+    header.mMagic = HEADER_MAGIC;
+    header.mVersion = HEADER_VERSION;
+    header.mCacheVersion = cache_version;
+    header.mCategoryCount = (U32)mCategories.size();
+    header.mItemCount = (U32)mItems.size();
+    // keeps what follows the strings, if anything ever does, aligned
+    const U32 strings_size = ((U32)mStrings.size() + 3) & ~3U;
+    header.mStringsSize = strings_size;
+
+    LLUniqueFile file = LLFile::fopen(filename, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string strings(mStrings);
+    strings.resize(strings_size);
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    success = success && fwrite(mCategories.data(), sizeof(CategoryRecord), mCategories.size(), file) == mCategories.size();
+    success = success && fwrite(mItems.data(), sizeof(ItemRecord), mItems.size(), file) == mItems.size();
+    success = success && fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+    return success;
+}
+
+bool LLInventoryCacheFile::load(const std::string& filename)
+{
+    clear();
+
+    LLUniqueFile file = LLFile::fopen(filename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    LLInventoryCacheHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.mMagic != HEADER_MAGIC ||
+        header.mVersion != HEADER_VERSION)
+    {
+        return false;
+    }
+
+    // Check the size before allocating anything from the counts
+    const U64 expected_size = sizeof(header) +
+                              (U64)header.mCategoryCount * sizeof(CategoryRecord) +
+                              (U64)header.mItemCount * sizeof(ItemRecord) +
+                              header.mStringsSize;
+    if (fseek(file, 0, SEEK_END) != 0 || (U64)ftell(file) != expected_size ||
+        fseek(file, (long)sizeof(header), SEEK_SET) != 0)
+    {
+        return false;
+    }
+
+    mCategories.resize(header.mCategoryCount);
+    mItems.resize(header.mItemCount);
+    mStrings.resize(header.mStringsSize);
+    if (fread(mCategories.data(), sizeof(CategoryRecord), mCategories.size(), file) != mCategories.size() ||
+        fread(mItems.data(), sizeof(ItemRecord), mItems.size(), file) != mItems.size() ||
+        fread(&mStrings[0], 1, mStrings.size(), file) != mStrings.size())
+    {
+        clear();
+        return false;
+    }
+
+    mCacheVersion = header.mCacheVersion;
+    return true;
+}
+
+bool LLInventoryCacheFile::getCategory(S32 index, LLInventoryCategory* cat, LLUUID& owner_id, S32& version) const
+{
+    const CategoryRecord& record = mCategories[index];
+
+    if (!getString(record.mName, cat->mName))
+    {
+        return false;
+    }
+    memcpy(cat->mUUID.mData, record.mID, UUID_BYTES);
+    memcpy(cat->mParentUUID.mData, record.mParentID, UUID_BYTES);
+    memcpy(cat->mThumbnailUUID.mData, record.mThumbnailID, UUID_BYTES);
+    memcpy(owner_id.mData, record.mOwnerID, UUID_BYTES);
+    version = record.mVersion;
+    cat->mType = (LLAssetType::EType)record.mType;
+    cat->mPreferredType = (LLFolderType::EType)record.mPreferredType;
+    return true;
+}
+
+bool LLInventoryCacheFile::getItem(S32 index, LLInventoryItem* item) const
+{
+    const ItemRecord& record = mItems[index];
+
+    if (!getString(record.mName, item->mName) ||
+        !getString(record.mDescription, item->mDescription))
+    {
+        return false;
+    }
+    memcpy(item->mUUID.mData, record.mID, UUID_BYTES);
+    memcpy(item->mParentUUID.mData, record.mParentID, UUID_BYTES);
+    memcpy(item->mThumbnailUUID.mData, record.mThumbnailID, UUID_BYTES);
+    memcpy(item->mAssetUUID.mData, record.mAssetID, UUID_BYTES);
+
+    // As ll_permissions_from_sd() does
+    LLUUID creator_id, owner_id, last_owner_id, group_id;
+    memcpy(creator_id.mData, record.mCreatorID, UUID_BYTES);
+    memcpy(owner_id.mData, record.mOwnerID, UUID_BYTES);
+    memcpy(last_owner_id.mData, record.mLastOwnerID, UUID_BYTES);
+    memcpy(group_id.mData, record.mGroupID, UUID_BYTES);
+    LLPermissions& perm = item->mPermissions;
+    perm.init(creator_id, owner_id, last_owner_id, group_id);
+    perm.setMaskBase(record.mMaskBase);
+    perm.setMaskOwner(record.mMaskOwner);
+    perm.setMaskEveryone(record.mMaskEveryone);
+    perm.setMaskGroup(record.mMaskGroup);
+    perm.setMaskNext(record.mMaskNext);
+    perm.fix();
+
+    item->mFlags = record.mFlags;
+    item->mCreationDate = record.mCreationDate;
+    item->mSaleInfo = LLSaleInfo((LLSaleInfo::EForSale)record.mSaleType, record.mSalePrice);
+    item->mType = (LLAssetType::EType)record.mType;
+    item->mInventoryType = (LLInventoryType::EType)record.mInventoryType;
+    return true;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file llinventorycache.h
+ * @brief Binary file of inventory categories and items.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include "lluuid.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class LLInventoryCategory;
+class LLInventoryItem;
+
+//
+// The inventory cache saved at logout and loaded at login, as fixed size
+// records followed by a table of the names and descriptions they point in.
+//
+// The file is a header, the category records, the item records, then the
+// strings, all in native byte order and 4 byte aligned, so that it loads
+// with a few reads and could as well be mapped.  Records are turned into
+// the caller's categories and items one at a time.
+//
+// Each record holds what LLInventoryCategory::exportLLSD() or
+// LLInventoryItem::asLLSD() would, and categories also carry the viewer's
+// owner and version.
+//
+class LLInventoryCacheFile
+{
+public:
+    LLInventoryCacheFile();
+
+    void clear();
+
+    // Writing. Strings are shared between records.
+    void addCategory(const LLInventoryCategory* cat, const LLUUID& owner_id, S32 version);
+    void addItem(const LLInventoryItem* item);
+    // cache_version is for the caller to tell stale content, see
+    // getCacheVersion()
+    bool save(const std::string& filename, S32 cache_version) const;
+
+    // Reading. Fails on files of another format version or that are
+    // truncated, in which case the file is best removed.
+    bool load(const std::string& filename);
+    S32 getCacheVersion() const { return mCacheVersion; }
+
+    S32 getCategoryCount() const { return (S32)mCategories.size(); }
+    S32 getItemCount() const { return (S32)mItems.size(); }
+    // Overwrite the content of 'cat' or 'item'. Return false when a string
+    // lies outside of the string table.
+    bool getCategory(S32 index, LLInventoryCategory* cat, LLUUID& owner_id, S32& version) const;
+    bool getItem(S32 index, LLInventoryItem* item) const;
+
+private:
+    struct StringRef
+    {
+        U32 mOffset;
+        U32 mSize;
+    };
+
+    struct CategoryRecord
+    {
+        U8 mID[UUID_BYTES];
+        U8 mParentID[UUID_BYTES];
+        U8 mThumbnailID[UUID_BYTES];
+        U8 mOwnerID[UUID_BYTES];
+        S32 mVersion;
+        S8 mType;
+        S8 mPreferredType;
+        U8 mPad[2];
+        StringRef mName;
+    };
+
+    struct ItemRecord
+    {
+        U8 mID[UUID_BYTES];
+        U8 mParentID[UUID_BYTES];
+        U8 mThumbnailID[UUID_BYTES];
+        U8 mAssetID[UUID_BYTES];
+        U8 mCreatorID[UUID_BYTES];
+        U8 mOwnerID[UUID_BYTES];
+        U8 mLastOwnerID[UUID_BYTES];
+        U8 mGroupID[UUID_BYTES];
+        U32 mMaskBase;
+        U32 mMaskOwner;
+        U32 mMaskGroup;
+        U32 mMaskEveryone;
+        U32 mMaskNext;
+        U32 mFlags;
+        S32 mCreationDate;
+        S32 mSalePrice;
+        S8 mSaleType;
+        S8 mType;
+        S8 mInventoryType;
+        U8 mPad;
+        StringRef mName;
+        StringRef mDescription;
+    };
+
+    StringRef addString(const std::string& str);
+    bool getString(const StringRef& ref, std::string& str) const;
+
+    S32 mCacheVersion;
+    std::vector<CategoryRecord> mCategories;
+    std::vector<ItemRecord> mItems;
+    std::string mStrings;
+    // Offsets of the strings added so far, while writing
+    std::unordered_map<std::string, U32> mStringOffsets;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
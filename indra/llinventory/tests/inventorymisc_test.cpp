@@ -27,10 +27,14 @@
  */
 
 #include "linden_common.h"
+#include "llfile.h"
 #include "llsd.h"
 #include "llsdserialize.h"
+#include "llsdutil.h"
+#include "lltimer.h"
 
 #include "../llinventory.h"
+#include "../llinventorycache.h"
 #include "../test/lltut.h"
 
 
@@ -509,4 +513,206 @@ namespace tut
         ensure_equals("5.name::getName() failed", src1->getName(), src2->getName());
 
     }
+
+//******class LLInventoryCacheFile*******//
+
+    template<> template<>
+    void inventory_object::test<15>()
+    {
+        const std::string filename("linden_cache.bin");
+        const S32 CACHE_VERSION = 3;
+
+        LLInventoryCategory::cat_array_t cats;
+        LLInventoryItem::item_array_t items;
+        LLInventoryCacheFile out;
+        for (S32 i = 0; i < 5; ++i)
+        {
+            LLPointer<LLInventoryCategory> cat = create_random_inventory_cat();
+            cat->setPreferredType(i ? LLFolderType::FT_NONE : LLFolderType::FT_TEXTURE);
+            if (i == 1)
+            {
+                cat->setThumbnailUUID(LLUUID::generateNewID());
+            }
+            cats.push_back(cat);
+            out.addCategory(cat, LLUUID::generateNewID(), i - 1);
+        }
+        for (S32 i = 0; i < 20; ++i)
+        {
+            LLPointer<LLInventoryItem> item = create_random_inventory_item();
+            item->rename(i % 2 ? "Sample Object" : "Objet \xC3\xA9" "chantillon");
+            item->setDescription(i % 3 ? "" : "Used for Testing");
+            items.push_back(item);
+            out.addItem(item);
+        }
+        ensure("1.save() failed", out.save(filename, CACHE_VERSION));
+
+        LLInventoryCacheFile in;
+        ensure("2.load() failed", in.load(filename));
+        ensure_equals("3.getCacheVersion() failed", in.getCacheVersion(), CACHE_VERSION);
+        ensure_equals("4.getCategoryCount() failed", in.getCategoryCount(), (S32)cats.size());
+        ensure_equals("5.getItemCount() failed", in.getItemCount(), (S32)items.size());
+        for (S32 i = 0; i < in.getCategoryCount(); ++i)
+        {
+            LLPointer<LLInventoryCategory> cat = new LLInventoryCategory();
+            LLUUID owner_id;
+            S32 version = 0;
+            ensure("6.getCategory() failed", in.getCategory(i, cat, owner_id, version));
+            ensure("7.category differs", llsd_equals(cat->exportLLSD(), cats[i]->exportLLSD()));
+            ensure("8.owner not set", owner_id.notNull());
+            ensure_equals("9.version differs", version, i - 1);
+        }
+        for (S32 i = 0; i < in.getItemCount(); ++i)
+        {
+            LLPointer<LLInventoryItem> item = new LLInventoryItem();
+            ensure("10.getItem() failed", in.getItem(i, item));
+            ensure("11.item differs", llsd_equals(item->asLLSD(), items[i]->asLLSD()));
+        }
+
+        // Truncated files are refused as a whole
+        std::string content = LLFile::getContents(filename);
+        {
+            llofstream file(filename.c_str(), std::ios::binary);
+            file.write(content.data(), content.size() - 5);
+        }
+        ensure("12.truncated load() succeeded", !in.load(filename));
+        ensure_equals("13.truncated load() kept items", in.getItemCount(), 0);
+
+        LLFile::remove(filename);
+    }
+
+    template<> template<>
+    void inventory_object::test<16>()
+    {
+        // Time to save then load inventories into items and categories, in
+        // the LLSD notation lines of the text cache and the binary cache.
+        // The text cache is also gzipped, which this leaves out. Set
+        // LL_INVENTORY_CACHE_LARGE for 500000 items as well. Not a
+        // pass/fail test.
+        skip_unless_benchmarking();
+        std::vector<S32> item_counts = { 10000, 100000 };
+        if (getenv("LL_INVENTORY_CACHE_LARGE"))
+        {
+            item_counts.push_back(500000);
+        }
+        const std::string text_filename("linden_cache.llsd");
+        const std::string binary_filename("linden_cache.bin");
+        const S32 ITEMS_PER_CATEGORY = 50;
+
+        for (S32 item_count : item_counts)
+        {
+            LLInventoryCategory::cat_array_t cats;
+            LLInventoryItem::item_array_t items;
+            for (S32 i = 0; i < item_count / ITEMS_PER_CATEGORY; ++i)
+            {
+                cats.push_back(create_random_inventory_cat());
+            }
+            items.reserve(item_count);
+            for (S32 i = 0; i < item_count; ++i)
+            {
+                LLPointer<LLInventoryItem> item = create_random_inventory_item();
+                item->rename(llformat("Object %d", i));
+                item->setParent(cats[i / ITEMS_PER_CATEGORY]->getUUID());
+                items.push_back(item);
+            }
+
+            LLTimer timer;
+            {
+                llofstream file(text_filename.c_str());
+                for (auto& cat : cats)
+                {
+                    file << LLSDOStreamer<LLSDNotationFormatter>(cat->exportLLSD()) << std::endl;
+                }
+                for (auto& item : items)
+                {
+                    file << LLSDOStreamer<LLSDNotationFormatter>(item->asLLSD()) << std::endl;
+                }
+            }
+            const F64 text_save = timer.getElapsedTimeF64();
+
+            timer.reset();
+            {
+                LLInventoryCacheFile cache_file;
+                for (auto& cat : cats)
+                {
+                    cache_file.addCategory(cat, LLUUID::null, 1);
+                }
+                for (auto& item : items)
+                {
+                    cache_file.addItem(item);
+                }
+                cache_file.save(binary_filename, 1);
+            }
+            const F64 binary_save = timer.getElapsedTimeF64();
+
+            // As LLInventoryModel::loadFromFile() does
+            timer.reset();
+            LLInventoryCategory::cat_array_t text_cats;
+            LLInventoryItem::item_array_t text_items;
+            {
+                llifstream file(text_filename.c_str());
+                std::string line;
+                LLPointer<LLSDParser> parser = new LLSDNotationParser();
+                while (std::getline(file, line))
+                {
+                    LLSD s_item;
+                    std::istringstream iss(line);
+                    parser->parse(iss, s_item, line.length());
+                    if (s_item.has("cat_id"))
+                    {
+                        LLPointer<LLInventoryCategory> cat = new LLInventoryCategory();
+                        cat->importLLSD(s_item);
+                        text_cats.push_back(cat);
+                    }
+                    else
+                    {
+                        LLPointer<LLInventoryItem> item = new LLInventoryItem();
+                        item->fromLLSD(s_item);
+                        text_items.push_back(item);
+                    }
+                }
+            }
+            const F64 text_load = timer.getElapsedTimeF64();
+
+            timer.reset();
+            LLInventoryCategory::cat_array_t binary_cats;
+            LLInventoryItem::item_array_t binary_items;
+            {
+                LLInventoryCacheFile cache_file;
+                cache_file.load(binary_filename);
+                binary_cats.reserve(cache_file.getCategoryCount());
+                for (S32 i = 0; i < cache_file.getCategoryCount(); ++i)
+                {
+                    LLPointer<LLInventoryCategory> cat = new LLInventoryCategory();
+                    LLUUID owner_id;
+                    S32 version;
+                    cache_file.getCategory(i, cat, owner_id, version);
+                    binary_cats.push_back(cat);
+                }
+                binary_items.reserve(cache_file.getItemCount());
+                for (S32 i = 0; i < cache_file.getItemCount(); ++i)
+                {
+                    LLPointer<LLInventoryItem> item = new LLInventoryItem();
+                    cache_file.getItem(i, item);
+                    binary_items.push_back(item);
+                }
+            }
+            const F64 binary_load = timer.getElapsedTimeF64();
+
+            ensure_equals("1.text items", text_items.size(), items.size());
+            ensure_equals("2.binary items", binary_items.size(), items.size());
+            ensure_equals("3.binary categories", binary_cats.size(), cats.size());
+
+            llstat text_stat, binary_stat;
+            LLFile::stat(text_filename, &text_stat);
+            LLFile::stat(binary_filename, &binary_stat);
+            LL_INFOS() << item_count << " items: "
+                       << llformat("text %lld bytes, save %.0f ms, load %.0f ms; binary %lld bytes, save %.0f ms, load %.0f ms",
+                                   (long long)text_stat.st_size, text_save * 1000.0, text_load * 1000.0,
+                                   (long long)binary_stat.st_size, binary_save * 1000.0, binary_load * 1000.0)
+                       << LL_ENDL;
+        }
+
+        LLFile::remove(text_filename);
+        LLFile::remove(binary_filename);
+    }
 }
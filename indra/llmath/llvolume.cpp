@@ -32,6 +32,7 @@
 #include <stdint.h>
 #endif
 #include <cmath>
+#include <string_view>
 #include <unordered_map>
 
 #include "llerror.h"
@@ -2287,24 +2288,462 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
     return retval;
 }
 
+// A face of a mesh LOD block. The arrays point into the decompressed block,
+// or into the LLSD it was parsed to.
+struct LLVolume::MeshFaceData
+{
+    struct Array
+    {
+        const U8* mData = nullptr;
+        size_t mSize = 0;
+
+        bool empty() const { return mSize == 0; }
+    };
+
+    bool mNoGeometry = false;
+    Array mPosition;
+    Array mNormal;
+    Array mTexCoord0;
+    Array mTriangleList;
+    bool mHasWeights = false;
+    Array mWeights;
+    LLVector3 mPositionMin;
+    LLVector3 mPositionMax;
+    LLVector2 mTexCoordMin;
+    LLVector2 mTexCoordMax;
+    bool mHasNormalizedScale = false;
+    LLVector3 mNormalizedScale;
+};
+
+// Reads the binary LLSD of a decompressed mesh LOD block into MeshFaceData
+// without building an LLSD, so that the vertex arrays are decoded where they
+// lie instead of being copied into LLSD::Binary first.
+// It reads the layout the uploader writes, an array of maps with binary and
+// real values. read() fails on anything else, the caller then parses the
+// block as generic LLSD.
+class LLMeshLODReader
+{
+public:
+    LLMeshLODReader(const U8* data, size_t size)
+        : mCur(data), mEnd(data + size)
+    {
+    }
+
+    bool read(std::vector<LLVolume::MeshFaceData>& faces)
+    {
+        U32 count = 0;
+        if (!readChar('[') || !readU32(count) || count > remaining())
+        {
+            return false;
+        }
+        faces.resize(count);
+        for (LLVolume::MeshFaceData& face : faces)
+        {
+            if (!readFace(face))
+            {
+                return false;
+            }
+        }
+        return readChar(']');
+    }
+
+private:
+    // LLSD nesting limit of LLUZipHelper::unzip_llsd()
+    static constexpr S32 MAX_DEPTH = 96;
+
+    size_t remaining() const { return mEnd - mCur; }
+
+    bool readChar(char c)
+    {
+        if (mCur == mEnd || *mCur != (U8)c)
+        {
+            return false;
+        }
+        ++mCur;
+        return true;
+    }
+
+    // network byte order
+    bool readU32(U32& value)
+    {
+        if (remaining() < 4)
+        {
+            return false;
+        }
+        value = ((U32)mCur[0] << 24) | ((U32)mCur[1] << 16) | ((U32)mCur[2] << 8) | (U32)mCur[3];
+        mCur += 4;
+        return true;
+    }
+
+    bool readF64(F64& value)
+    {
+        if (remaining() < 8)
+        {
+            return false;
+        }
+        U64 bits = 0;
+        for (S32 i = 0; i < 8; ++i)
+        {
+            bits = (bits << 8) | mCur[i];
+        }
+        memcpy(&value, &bits, sizeof(F64));
+        mCur += 8;
+        return true;
+    }
+
+    // 'k' + size + bytes
+    bool readKey(std::string_view& key)
+    {
+        U32 size = 0;
+        if (!readChar('k') || !readU32(size) || size > remaining())
+        {
+            return false;
+        }
+        key = std::string_view((const char*)mCur, size);
+        mCur += size;
+        return true;
+    }
+
+    bool readBinary(LLVolume::MeshFaceData::Array& array)
+    {
+        U32 size = 0;
+        if (!readChar('b') || !readU32(size) || size > remaining())
+        {
+            return false;
+        }
+        array.mData = mCur;
+        array.mSize = size;
+        mCur += size;
+        return true;
+    }
+
+    // A scalar the way LLSD::asReal() sees it
+    bool readReal(F32& value)
+    {
+        if (mCur == mEnd)
+        {
+            return false;
+        }
+        switch (*mCur++)
+        {
+        case 'r':
+        {
+            F64 real = 0.0;
+            if (!readF64(real))
+            {
+                return false;
+            }
+            value = (F32)real;
+            return true;
+        }
+        case 'i':
+        {
+            U32 integer = 0;
+            if (!readU32(integer))
+            {
+                return false;
+            }
+            value = (F32)(S32)integer;
+            return true;
+        }
+        case '1':
+            value = 1.f;
+            return true;
+        case '0':
+        case '!':
+            value = 0.f;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // An array of reals into 'count' values, as LLVector3::setValue() reads it
+    bool readVector(F32* values, U32 count)
+    {
+        U32 size = 0;
+        if (!readChar('[') || !readU32(size) || size > remaining())
+        {
+            return false;
+        }
+        for (U32 i = 0; i < size; ++i)
+        {
+            F32 value = 0.f;
+            if (!readReal(value))
+            {
+                return false;
+            }
+            if (i < count)
+            {
+                values[i] = value;
+            }
+        }
+        return readChar(']');
+    }
+
+    // {"Min": [...], "Max": [...]}
+    bool readDomain(F32* min, F32* max, U32 count)
+    {
+        U32 size = 0;
+        if (!readChar('{') || !readU32(size) || size > remaining())
+        {
+            return false;
+        }
+        bool has_min = false;
+        bool has_max = false;
+        for (U32 i = 0; i < size; ++i)
+        {
+            std::string_view key;
+            if (!readKey(key))
+            {
+                return false;
+            }
+            // LLSD keeps the first of duplicate keys
+            if (key == "Min" && !has_min)
+            {
+                has_min = true;
+                if (!readVector(min, count))
+                {
+                    return false;
+                }
+            }
+            else if (key == "Max" && !has_max)
+            {
+                has_max = true;
+                if (!readVector(max, count))
+                {
+                    return false;
+                }
+            }
+            else if (!skipValue(MAX_DEPTH))
+            {
+                return false;
+            }
+        }
+        return readChar('}');
+    }
+
+    bool readFace(LLVolume::MeshFaceData& face)
+    {
+        enum
+        {
+            NO_GEOMETRY = 1 << 0,
+            POSITION = 1 << 1,
+            NORMAL = 1 << 2,
+            TEXCOORD0 = 1 << 3,
+            TRIANGLE_LIST = 1 << 4,
+            WEIGHTS = 1 << 5,
+            POSITION_DOMAIN = 1 << 6,
+            TEXCOORD0_DOMAIN = 1 << 7,
+            NORMALIZED_SCALE = 1 << 8
+        };
+
+        U32 size = 0;
+        if (!readChar('{') || !readU32(size) || size > remaining())
+        {
+            return false;
+        }
+
+        U32 seen = 0;
+        for (U32 i = 0; i < size; ++i)
+        {
+            std::string_view key;
+            if (!readKey(key))
+            {
+                return false;
+            }
+
+            U32 field = 0;
+            if (key == "Position") field = POSITION;
+            else if (key == "Normal") field = NORMAL;
+            else if (key == "TexCoord0") field = TEXCOORD0;
+            else if (key == "TriangleList") field = TRIANGLE_LIST;
+            else if (key == "Weights") field = WEIGHTS;
+            else if (key == "PositionDomain") field = POSITION_DOMAIN;
+            else if (key == "TexCoord0Domain") field = TEXCOORD0_DOMAIN;
+            else if (key == "NormalizedScale") field = NORMALIZED_SCALE;
+            else if (key == "NoGeometry") field = NO_GEOMETRY;
+
+            if (!field || (seen & field) || field == NO_GEOMETRY)
+            {
+                // LLSD keeps the first of duplicate keys, NoGeometry only needs to exist
+                if (field == NO_GEOMETRY)
+                {
+                    face.mNoGeometry = true;
+                }
+                if (!skipValue(MAX_DEPTH))
+                {
+                    return false;
+                }
+                continue;
+            }
+            seen |= field;
+
+            bool ok = false;
+            switch (field)
+            {
+            case POSITION:          ok = readBinary(face.mPosition); break;
+            case NORMAL:            ok = readBinary(face.mNormal); break;
+            case TEXCOORD0:         ok = readBinary(face.mTexCoord0); break;
+            case TRIANGLE_LIST:     ok = readBinary(face.mTriangleList); break;
+            case WEIGHTS:           ok = readBinary(face.mWeights); face.mHasWeights = true; break;
+            case POSITION_DOMAIN:   ok = readDomain(face.mPositionMin.mV, face.mPositionMax.mV, 3); break;
+            case TEXCOORD0_DOMAIN:  ok = readDomain(face.mTexCoordMin.mV, face.mTexCoordMax.mV, 2); break;
+            case NORMALIZED_SCALE:  ok = readVector(face.mNormalizedScale.mV, 3); face.mHasNormalizedScale = true; break;
+            }
+            if (!ok)
+            {
+                return false;
+            }
+        }
+        return readChar('}');
+    }
+
+    // Skips a value of a key this reader has no use for
+    bool skipValue(S32 depth)
+    {
+        if (mCur == mEnd || depth == 0)
+        {
+            return false;
+        }
+        U32 size = 0;
+        switch (*mCur++)
+        {
+        case '!':
+        case '0':
+        case '1':
+            return true;
+        case 'i':
+            return skip(4);
+        case 'r':
+        case 'd':
+            return skip(8);
+        case 'u':
+            return skip(16);
+        case 's':
+        case 'l':
+        case 'b':
+            return readU32(size) && skip(size);
+        case '[':
+            if (!readU32(size) || size > remaining())
+            {
+                return false;
+            }
+            for (U32 i = 0; i < size; ++i)
+            {
+                if (!skipValue(depth - 1))
+                {
+                    return false;
+                }
+            }
+            return readChar(']');
+        case '{':
+            if (!readU32(size) || size > remaining())
+            {
+                return false;
+            }
+            for (U32 i = 0; i < size; ++i)
+            {
+                std::string_view key;
+                if (!readKey(key) || !skipValue(depth - 1))
+                {
+                    return false;
+                }
+            }
+            return readChar('}');
+        default:
+            // notation style strings and such
+            return false;
+        }
+    }
+
+    bool skip(size_t size)
+    {
+        if (size > remaining())
+        {
+            return false;
+        }
+        mCur += size;
+        return true;
+    }
+
+    const U8* mCur;
+    const U8* mEnd;
+};
+
+// Loads 3 unsigned shorts as floats, with 0 in the last element. Reads 8 bytes.
+inline LLQuad load_u16x3(const U8* src)
+{
+    __m128i shorts = _mm_loadl_epi64((const __m128i*)src);
+    // drop the 4th short, which belongs to the next vertex
+    shorts = _mm_and_si128(shorts, _mm_set_epi32(0, 0, 0x0000FFFF, -1));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts, _mm_setzero_si128()));
+}
+
+// Same as load_u16x3(), for the last vertex of an array. Reads 6 bytes.
+inline LLQuad load_u16x3_last(const U8* src)
+{
+    U16 v[3];
+    memcpy(v, src, sizeof(v));
+    return _mm_set_ps(0.f, (F32)v[2], (F32)v[1], (F32)v[0]);
+}
+
+// Loads 4 unsigned shorts as floats
+inline LLQuad load_u16x4(const U8* src)
+{
+    __m128i shorts = _mm_loadl_epi64((const __m128i*)src);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts, _mm_setzero_si128()));
+}
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 
     //input stream is now pointing at a zlib compressed block of LLSD
+    std::unique_ptr<U8[]> in(new(std::nothrow) U8[size]);
+    if (!in)
+    {
+        LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << LLUZipHelper::ZR_MEM_ERROR << " , will probably fetch from sim again." << LL_ENDL;
+        return false;
+    }
+    is.read((char*)in.get(), size);
+
+    return unpackVolumeFaces(in.get(), size);
+}
+
+bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    //input data is now pointing at a zlib compressed block of LLSD
     //decompress block
-    LLSD mdl;
-    U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, is, size);
+    std::vector<U8> lod;
+    U32 uzip_result = LLUZipHelper::unzip(lod, in_data, size);
     if (uzip_result != LLUZipHelper::ZR_OK)
     {
         LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
         return false;
     }
-    return unpackVolumeFacesInternal(mdl);
+
+    llssize lod_size = lod.size();
+    const U8* lod_data = (const U8*)strip_deprecated_header((char*)lod.data(), lod_size);
+
+    std::vector<MeshFaceData> faces;
+    if (LLMeshLODReader(lod_data, lod_size).read(faces))
+    {
+        return unpackVolumeFacesInternal(faces);
+    }
+    faces.clear();
+    lod.clear();
+
+    // not laid out the usual way
+    return unpackVolumeFacesLLSD(in_data, size);
 }
 
-bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
+bool LLVolume::unpackVolumeFacesLLSD(U8* in_data, S32 size)
 {
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
     //input data is now pointing at a zlib compressed block of LLSD
     //decompress block
     LLSD mdl;
@@ -2318,9 +2757,57 @@ bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
 }
 
 bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
+{
+    std::vector<MeshFaceData> faces(mdl.size());
+
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        MeshFaceData& data = faces[i];
+
+        if (mdl[i].has("NoGeometry"))
+        {
+            data.mNoGeometry = true;
+            continue;
+        }
+
+        auto array = [](const LLSD& value)
+        {
+            const LLSD::Binary& binary = value.asBinary();
+            MeshFaceData::Array array;
+            array.mData = binary.data();
+            array.mSize = binary.size();
+            return array;
+        };
+
+        data.mPosition = array(mdl[i]["Position"]);
+        data.mNormal = array(mdl[i]["Normal"]);
+        data.mTexCoord0 = array(mdl[i]["TexCoord0"]);
+        data.mTriangleList = array(mdl[i]["TriangleList"]);
+        if (mdl[i].has("Weights"))
+        {
+            data.mHasWeights = true;
+            data.mWeights = array(mdl[i]["Weights"]);
+        }
+
+        data.mPositionMin.setValue(mdl[i]["PositionDomain"]["Min"]);
+        data.mPositionMax.setValue(mdl[i]["PositionDomain"]["Max"]);
+        data.mTexCoordMin.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
+        data.mTexCoordMax.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
+
+        if (mdl[i].has("NormalizedScale"))
+        {
+            data.mHasNormalizedScale = true;
+            data.mNormalizedScale.setValue(mdl[i]["NormalizedScale"]);
+        }
+    }
+
+    return unpackVolumeFacesInternal(faces);
+}
+
+bool LLVolume::unpackVolumeFacesInternal(const std::vector<MeshFaceData>& faces)
 {
     {
-        auto face_count = mdl.size();
+        auto face_count = faces.size();
 
         if (face_count == 0)
         { //no faces unpacked, treat as failed decode
@@ -2333,8 +2820,9 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
         for (size_t i = 0; i < face_count; ++i)
         {
             LLVolumeFace& face = mVolumeFaces[i];
+            const MeshFaceData& data = faces[i];
 
-            if (mdl[i].has("NoGeometry"))
+            if (data.mNoGeometry)
             { //face has no geometry, continue
                 face.resizeIndices(3);
                 face.resizeVertices(1);
@@ -2345,14 +2833,13 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 
-            const LLSD::Binary& pos = mdl[i]["Position"].asBinary();
-            const LLSD::Binary& norm = mdl[i]["Normal"].asBinary();
-            const LLSD::Binary& tangent = mdl[i]["Tangent"].asBinary();
-            const LLSD::Binary& tc = mdl[i]["TexCoord0"].asBinary();
-            const LLSD::Binary& idx = mdl[i]["TriangleList"].asBinary();
+            const MeshFaceData::Array& pos = data.mPosition;
+            const MeshFaceData::Array& norm = data.mNormal;
+            const MeshFaceData::Array& tc = data.mTexCoord0;
+            const MeshFaceData::Array& idx = data.mTriangleList;
 
             //copy out indices
-            auto num_indices = idx.size() / 2;
+            auto num_indices = idx.mSize / 2;
             const S32 indices_to_discard = num_indices % 3;
             if (indices_to_discard > 0)
             {
@@ -2374,14 +2861,11 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 
-            U16* indices = (U16*) &(idx[0]);
-            for (U32 j = 0; j < num_indices; ++j)
-            {
-                face.mIndices[j] = indices[j];
-            }
+            // the arrays are not necessarily aligned
+            memcpy(face.mIndices, idx.mData, num_indices * sizeof(U16));
 
             //copy out vertices
-            U32 num_verts = static_cast<U32>(pos.size())/(3*2);
+            U32 num_verts = static_cast<U32>(pos.mSize)/(3*2);
             face.resizeVertices(num_verts);
 
             if (num_verts > 0 && !face.mPositions)
@@ -2391,24 +2875,17 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 
-            LLVector3 minp;
-            LLVector3 maxp;
-            LLVector2 min_tc;
-            LLVector2 max_tc;
-
-            minp.setValue(mdl[i]["PositionDomain"]["Min"]);
-            maxp.setValue(mdl[i]["PositionDomain"]["Max"]);
             LLVector4a min_pos, max_pos;
-            min_pos.load3(minp.mV);
-            max_pos.load3(maxp.mV);
+            min_pos.load3(data.mPositionMin.mV);
+            max_pos.load3(data.mPositionMax.mV);
 
-            min_tc.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
-            max_tc.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
+            const LLVector2& min_tc = data.mTexCoordMin;
+            const LLVector2& max_tc = data.mTexCoordMax;
 
             //unpack normalized scale/translation
-            if (mdl[i].has("NormalizedScale"))
+            if (data.mHasNormalizedScale)
             {
-                face.mNormalizedScale.setValue(mdl[i]["NormalizedScale"]);
+                face.mNormalizedScale = data.mNormalizedScale;
             }
             else
             {
@@ -2427,32 +2904,34 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
             LLVector4a* norm_out = face.mNormals;
             LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
 
+            // dequantize straight from the data, 8 bytes at a time, the last
+            // vertex is read on its own so as not to read past the array
             {
-                U16* v = (U16*) &(pos[0]);
+                const U8* v = pos.mData;
                 for (U32 j = 0; j < num_verts; ++j)
                 {
-                    pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
+                    *pos_out = j + 1 < num_verts ? load_u16x3(v) : load_u16x3_last(v);
                     pos_out->div(65535.f);
                     pos_out->mul(pos_range);
                     pos_out->add(min_pos);
                     pos_out++;
-                    v += 3;
+                    v += 6;
                 }
 
             }
 
             {
-                if (!norm.empty())
+                if (norm.mSize >= num_verts * 6)
                 {
-                    U16* n = (U16*) &(norm[0]);
+                    const U8* n = norm.mData;
                     for (U32 j = 0; j < num_verts; ++j)
                     {
-                        norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
+                        *norm_out = j + 1 < num_verts ? load_u16x3(n) : load_u16x3_last(n);
                         norm_out->div(65535.f);
                         norm_out->mul(2.f);
                         norm_out->sub(1.f);
                         norm_out++;
-                        n += 3;
+                        n += 6;
                     }
                 }
                 else
@@ -2465,50 +2944,24 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 }
             }
 
-#if 0 // keep this code for now in case we decide to add support for on-the-wire tangents
             {
-                if (!tangent.empty())
+                if (tc.mSize >= num_verts * 4)
                 {
-                    face.allocateTangents(face.mNumVertices);
-                    U16* t = (U16*)&(tangent[0]);
-
-                    // NOTE: tangents coming from the asset may not be mikkt space, but they should always be used by the GLTF shaders to
-                    // maintain compliance with the GLTF spec
-                    LLVector4a* t_out = face.mTangents;
-
-                    for (U32 j = 0; j < num_verts; ++j)
-                    {
-                        t_out->set((F32)t[0], (F32)t[1], (F32)t[2], (F32) t[3]);
-                        t_out->div(65535.f);
-                        t_out->mul(2.f);
-                        t_out->sub(1.f);
-
-                        F32* tp = t_out->getF32ptr();
-                        tp[3] = tp[3] < 0.f ? -1.f : 1.f;
-
-                        t_out++;
-                        t += 4;
-                    }
-                }
-            }
-#endif
-
-            {
-                if (!tc.empty())
-                {
-                    U16* t = (U16*) &(tc[0]);
+                    const U8* t = tc.mData;
                     for (U32 j = 0; j < num_verts; j+=2)
                     {
                         if (j < num_verts-1)
                         {
-                            tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
+                            *tc_out = load_u16x4(t);
                         }
                         else
                         {
-                            tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
+                            U16 last[2];
+                            memcpy(last, t, sizeof(last));
+                            tc_out->set((F32) last[0], (F32) last[1], 0.f, 0.f);
                         }
 
-                        t += 4;
+                        t += 8;
 
                         tc_out->div(65535.f);
                         tc_out->mul(tc_range);
@@ -2527,7 +2980,7 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 }
             }
 
-            if (mdl[i].has("Weights"))
+            if (data.mHasWeights)
             {
                 face.allocateWeights(num_verts);
                 if (!face.mWeights && num_verts)
@@ -2538,25 +2991,32 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                     continue;
                 }
 
-                const LLSD::Binary& weights = mdl[i]["Weights"].asBinary();
+                const U8* weights = data.mWeights.mData;
+                const size_t weights_size = data.mWeights.mSize;
+
+                // past the end reads as 0, for truncated data
+                auto weight = [weights, weights_size](U32 i) -> U8
+                {
+                    return i < weights_size ? weights[i] : 0;
+                };
 
                 U32 idx = 0;
 
                 U32 cur_vertex = 0;
-                while (idx < weights.size() && cur_vertex < num_verts)
+                while (idx < weights_size && cur_vertex < num_verts)
                 {
                     const U8 END_INFLUENCES = 0xFF;
-                    U8 joint = weights[idx++];
+                    U8 joint = weight(idx++);
 
                     U32 cur_influence = 0;
                     LLVector4 wght(0,0,0,0);
                     U32 joints[4] = {0,0,0,0};
                     LLVector4 joints_with_weights(0,0,0,0);
 
-                    while (joint != END_INFLUENCES && idx < weights.size())
+                    while (joint != END_INFLUENCES && idx < weights_size)
                     {
-                        U16 influence = weights[idx++];
-                        influence |= ((U16) weights[idx++] << 8);
+                        U16 influence = weight(idx++);
+                        influence |= ((U16) weight(idx++) << 8);
 
                         F32 w = llclamp((F32) influence / 65535.f, 0.001f, 0.999f);
                         wght.mV[cur_influence] = w;
@@ -2569,7 +3029,7 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                         }
                         else
                         {
-                            joint = weights[idx++];
+                            joint = weight(idx++);
                         }
                     }
                     F32 wsum = wght.mV[VX] + wght.mV[VY] + wght.mV[VZ] + wght.mV[VW];
@@ -2590,7 +3050,7 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                     cur_vertex++;
                 }
 
-                if (cur_vertex != num_verts || idx != weights.size())
+                if (cur_vertex != num_verts || idx != weights_size)
                 {
                     LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
                 }
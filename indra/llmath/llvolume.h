@@ -1114,8 +1114,15 @@ protected:
 public:
     bool unpackVolumeFaces(std::istream& is, S32 size);
     bool unpackVolumeFaces(U8* in_data, S32 size);
+    // Same, through a generic LLSD. unpackVolumeFaces() reads the usual
+    // layout of the binary LLSD directly and only falls back to this.
+    bool unpackVolumeFacesLLSD(U8* in_data, S32 size);
+
+    // A face of a mesh LOD block, as read from its binary LLSD
+    struct MeshFaceData;
 private:
     bool unpackVolumeFacesInternal(const LLSD& mdl);
+    bool unpackVolumeFacesInternal(const std::vector<MeshFaceData>& faces);
 
 public:
     virtual void setMeshAssetLoaded(bool loaded);
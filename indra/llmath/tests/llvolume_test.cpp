@@ -0,0 +1,458 @@
+/**
+ * @file   llvolume_test.cpp
+ * @brief  Test for the mesh LOD decoding of llvolume.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvolume.h"
+
+#include "llsdserialize.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    // A zipped LOD block holding one face, a grid of 'size' x 'size'
+    // vertices, the way the uploader writes it. 'rigged' adds weights and
+    // an extra field of every LLSD type, which decoders must skip.
+    std::vector<U8> makeGridLOD(U32 size, bool rigged = false)
+    {
+        std::vector<U16> pos;
+        std::vector<U16> norm;
+        std::vector<U16> tc;
+        for (U32 y = 0; y < size; ++y)
+        {
+            for (U32 x = 0; x < size; ++x)
+            {
+                const U16 u = (U16)(x * 65535 / (size - 1));
+                const U16 v = (U16)(y * 65535 / (size - 1));
+                pos.push_back(u);
+                pos.push_back(v);
+                pos.push_back(32767);
+                norm.push_back(32767);
+                norm.push_back(32767);
+                norm.push_back(65535);
+                tc.push_back(u);
+                tc.push_back(v);
+            }
+        }
+
+        std::vector<U16> idx;
+        for (U32 y = 0; y + 1 < size; ++y)
+        {
+            for (U32 x = 0; x + 1 < size; ++x)
+            {
+                const U16 i = (U16)(y * size + x);
+                idx.push_back(i);
+                idx.push_back((U16)(i + 1));
+                idx.push_back((U16)(i + size));
+                idx.push_back((U16)(i + 1));
+                idx.push_back((U16)(i + size + 1));
+                idx.push_back((U16)(i + size));
+            }
+        }
+
+        auto binary = [](const std::vector<U16>& values)
+        {
+            const U8* bytes = (const U8*)values.data();
+            return LLSD::Binary(bytes, bytes + values.size() * sizeof(U16));
+        };
+
+        LLSD face;
+        face["Position"] = binary(pos);
+        face["Normal"] = binary(norm);
+        face["TexCoord0"] = binary(tc);
+        face["TriangleList"] = binary(idx);
+        face["PositionDomain"]["Min"] = LLVector3(-0.5f, -0.5f, -0.5f).getValue();
+        face["PositionDomain"]["Max"] = LLVector3(0.5f, 0.5f, 0.5f).getValue();
+        face["TexCoord0Domain"]["Min"] = LLVector2(0.f, 0.f).getValue();
+        face["TexCoord0Domain"]["Max"] = LLVector2(1.f, 1.f).getValue();
+
+        if (rigged)
+        {
+            // per vertex: up to 4 (joint, weight) pairs, or a joint >= 0xFF
+            std::vector<U8> weights;
+            for (U32 i = 0; i < size * size; ++i)
+            {
+                weights.push_back((U8)(i % 8));
+                weights.push_back(0xFF);
+                weights.push_back(0x7F);
+                if (i % 2)
+                {
+                    weights.push_back((U8)(i % 8 + 1));
+                    weights.push_back(0xFF);
+                    weights.push_back(0x7F);
+                }
+                weights.push_back(0xFF);
+            }
+            face["Weights"] = LLSD::Binary(weights);
+
+            LLSD extra;
+            extra["real"] = 1.5;
+            extra["integer"] = 3;
+            extra["boolean"] = true;
+            extra["string"] = "skipped";
+            extra["uuid"] = LLUUID::generateNewID();
+            extra["date"] = LLDate::now();
+            extra["uri"] = LLURI("http://example.com");
+            extra["array"].append(LLSD());
+            extra["array"].append(LLSD::Binary(3, 0));
+            face["Extra"] = extra;
+        }
+
+        LLSD lod;
+        lod.append(face);
+        std::string zipped = zip_llsd(lod);
+        return std::vector<U8>(zipped.begin(), zipped.end());
+    }
+
+    LLPointer<LLVolume> newMeshVolume()
+    {
+        LLVolumeParams volume_params;
+        volume_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+        volume_params.setSculptID(LLUUID::null, LL_SCULPT_TYPE_MESH);
+        return new LLVolume(volume_params, 0);
+    }
+
+    bool decodeLOD(std::vector<U8>& lod)
+    {
+        return newMeshVolume()->unpackVolumeFaces(lod.data(), (S32)lod.size());
+    }
+
+    bool sameVectors(const LLVector4a* a, const LLVector4a* b, S32 count)
+    {
+        for (S32 i = 0; i < count; ++i)
+        {
+            if (memcmp(a[i].getF32ptr(), b[i].getF32ptr(), 3 * sizeof(F32)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Compares what both decoders made of a LOD block, which must not differ
+    // in a single bit
+    std::string compareDecoders(std::vector<U8>& lod)
+    {
+        LLPointer<LLVolume> direct = newMeshVolume();
+        LLPointer<LLVolume> generic = newMeshVolume();
+        const bool direct_ok = direct->unpackVolumeFaces(lod.data(), (S32)lod.size());
+        const bool generic_ok = generic->unpackVolumeFacesLLSD(lod.data(), (S32)lod.size());
+        if (direct_ok != generic_ok)
+        {
+            return "success";
+        }
+        if (direct->getNumVolumeFaces() != generic->getNumVolumeFaces())
+        {
+            return "faces";
+        }
+
+        for (S32 i = 0; i < direct->getNumVolumeFaces(); ++i)
+        {
+            const LLVolumeFace& a = direct->getVolumeFace(i);
+            const LLVolumeFace& b = generic->getVolumeFace(i);
+            if (a.mNumVertices != b.mNumVertices || a.mNumIndices != b.mNumIndices)
+            {
+                return "counts";
+            }
+            if (memcmp(a.mIndices, b.mIndices, a.mNumIndices * sizeof(U16)))
+            {
+                return "indices";
+            }
+            if (!sameVectors(a.mPositions, b.mPositions, a.mNumVertices)
+                || !sameVectors(a.mExtents, b.mExtents, 2))
+            {
+                return "positions";
+            }
+            if ((a.mNormals == NULL) != (b.mNormals == NULL)
+                || (a.mNormals && !sameVectors(a.mNormals, b.mNormals, a.mNumVertices)))
+            {
+                return "normals";
+            }
+            if ((a.mTexCoords == NULL) != (b.mTexCoords == NULL)
+                || (a.mTexCoords && memcmp(a.mTexCoords, b.mTexCoords, a.mNumVertices * sizeof(LLVector2))))
+            {
+                return "texture coordinates";
+            }
+            if ((a.mWeights == NULL) != (b.mWeights == NULL)
+                || (a.mWeights && !sameVectors(a.mWeights, b.mWeights, a.mNumVertices)))
+            {
+                return "weights";
+            }
+        }
+        return std::string();
+    }
+
+    // Appends the LOD blocks of the mesh assets found in 'dir', as the
+    // repository reads them from the header
+    void loadMeshAssets(const std::string& dir, std::vector<std::vector<U8>>& lods)
+    {
+        static const char* const LOD_NAMES[] = { "lowest_lod", "low_lod", "medium_lod", "high_lod" };
+
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+        {
+            std::ifstream file(entry.path(), std::ios::binary);
+            std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+            LLSD header;
+            std::istringstream stream(data);
+            if (LLSDSerialize::fromBinary(header, stream, data.size()) <= 0)
+            {
+                continue;
+            }
+            const size_t header_size = (size_t)stream.tellg();
+
+            for (const char* name : LOD_NAMES)
+            {
+                if (!header.has(name))
+                {
+                    continue;
+                }
+                const size_t offset = header_size + header[name]["offset"].asInteger();
+                const size_t size = header[name]["size"].asInteger();
+                if (size > 0 && offset + size <= data.size())
+                {
+                    lods.emplace_back(data.begin() + offset, data.begin() + offset + size);
+                }
+            }
+        }
+    }
+}
+
+namespace tut
+{
+    struct LLVolumeData
+    {
+    };
+
+    typedef test_group<LLVolumeData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llvolume_test_factory("LLVolume");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        std::vector<U8> lod = makeGridLOD(16);
+        LLPointer<LLVolume> volume = newMeshVolume();
+
+        ensure("unpacked", volume->unpackVolumeFaces(lod.data(), (S32)lod.size()));
+        ensure_equals("faces", volume->getNumVolumeFaces(), 1);
+
+        const LLVolumeFace& face = volume->getVolumeFace(0);
+        ensure_equals("vertices", face.mNumVertices, 16 * 16);
+        ensure_equals("indices", face.mNumIndices, 15 * 15 * 6);
+        ensure("first position", face.mPositions[0].equals3(LLVector4a(-0.5f, -0.5f, 0.f), 0.001f));
+        ensure("last position", face.mPositions[16 * 16 - 1].equals3(LLVector4a(0.5f, 0.5f, 0.f), 0.001f));
+
+        lod.resize(lod.size() / 2);
+        ensure("truncated", !volume->unpackVolumeFaces(lod.data(), (S32)lod.size()));
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        // Decodes LODs on 1..N threads, the way the mesh repository's decode
+        // pool does, reporting LODs/s. The LODs come from the captured mesh
+        // assets in $LL_MESH_ASSET_DIR, or are synthetic grids.
+        // Not a pass/fail test.
+        skip_unless_benchmarking();
+        std::vector<std::vector<U8>> lods;
+        const char* dir = getenv("LL_MESH_ASSET_DIR");
+        if (dir)
+        {
+            loadMeshAssets(dir, lods);
+        }
+        if (lods.empty())
+        {
+            for (U32 size = 8; size <= 64; size *= 2)
+            {
+                lods.push_back(makeGridLOD(size));
+            }
+        }
+
+        const size_t DECODES = llmax(lods.size(), (size_t)2000);
+        const S32 max_threads = (S32)llclamp(std::thread::hardware_concurrency(), 1U, 8U);
+        for (S32 threads = 1; threads <= max_threads; threads *= 2)
+        {
+            std::vector<U32> failures(threads);
+            auto decode = [&lods, &failures, DECODES, threads](S32 i)
+            {
+                for (size_t j = i; j < DECODES; j += threads)
+                {
+                    if (!decodeLOD(lods[j % lods.size()]))
+                    {
+                        ++failures[i];
+                    }
+                }
+            };
+
+            LLTimer timer;
+            std::vector<std::thread> workers;
+            for (S32 i = 1; i < threads; ++i)
+            {
+                workers.emplace_back(decode, i);
+            }
+            decode(0);
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+            const F64 seconds = timer.getElapsedTimeF64();
+
+            U32 failed = 0;
+            for (U32 count : failures)
+            {
+                failed += count;
+            }
+            LL_INFOS() << threads << " thread(s): "
+                       << llformat("%.0f LODs/s", DECODES / llmax(seconds, 1e-6))
+                       << " (" << failed << " failed)"
+                       << LL_ENDL;
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        // The direct decoder and the generic LLSD one agree, on the
+        // synthetic grids and on the mesh assets in $LL_MESH_ASSET_DIR
+        std::vector<std::vector<U8>> lods;
+        for (U32 size = 2; size <= 64; size *= 2)
+        {
+            lods.push_back(makeGridLOD(size));
+            lods.push_back(makeGridLOD(size, true));
+        }
+        const char* dir = getenv("LL_MESH_ASSET_DIR");
+        if (dir)
+        {
+            loadMeshAssets(dir, lods);
+        }
+
+        for (size_t i = 0; i < lods.size(); ++i)
+        {
+            ensure_equals(llformat("LOD %d", (S32)i), compareDecoders(lods[i]), std::string());
+        }
+
+        LLPointer<LLVolume> volume = newMeshVolume();
+        ensure("rigged", volume->unpackVolumeFaces(lods[1].data(), (S32)lods[1].size()));
+        ensure("weights", volume->getVolumeFace(0).mWeights != NULL);
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        // Decode time of both decoders, and the bytes the generic one copies
+        // into LLSD binaries on top of the inflated block (the direct one
+        // reads the arrays where they are). Not a pass/fail test.
+        skip_unless_benchmarking();
+        std::vector<std::vector<U8>> lods;
+        const char* dir = getenv("LL_MESH_ASSET_DIR");
+        if (dir)
+        {
+            loadMeshAssets(dir, lods);
+        }
+        if (lods.empty())
+        {
+            for (U32 size = 8; size <= 64; size *= 2)
+            {
+                lods.push_back(makeGridLOD(size));
+                lods.push_back(makeGridLOD(size, true));
+            }
+        }
+
+        size_t inflated = 0;
+        size_t copied = 0;
+        for (std::vector<U8>& lod : lods)
+        {
+            std::vector<U8> block;
+            if (LLUZipHelper::unzip(block, lod.data(), (S32)lod.size()) != LLUZipHelper::ZR_OK)
+            {
+                continue;
+            }
+            inflated += block.size();
+
+            LLSD mdl;
+            if (LLUZipHelper::unzip_llsd(mdl, lod.data(), (S32)lod.size()) != LLUZipHelper::ZR_OK)
+            {
+                continue;
+            }
+            for (LLSD::array_const_iterator face = mdl.beginArray(); face != mdl.endArray(); ++face)
+            {
+                for (LLSD::map_const_iterator field = face->beginMap(); field != face->endMap(); ++field)
+                {
+                    if (field->second.isBinary())
+                    {
+                        copied += field->second.asBinary().size();
+                    }
+                }
+            }
+        }
+
+        const size_t DECODES = llmax(lods.size(), (size_t)2000);
+        F64 direct_seconds = 0.0;
+        F64 generic_seconds = 0.0;
+        {
+            LLTimer timer;
+            for (size_t i = 0; i < DECODES; ++i)
+            {
+                std::vector<U8>& lod = lods[i % lods.size()];
+                newMeshVolume()->unpackVolumeFaces(lod.data(), (S32)lod.size());
+            }
+            direct_seconds = timer.getElapsedTimeF64();
+        }
+        {
+            LLTimer timer;
+            for (size_t i = 0; i < DECODES; ++i)
+            {
+                std::vector<U8>& lod = lods[i % lods.size()];
+                newMeshVolume()->unpackVolumeFacesLLSD(lod.data(), (S32)lod.size());
+            }
+            generic_seconds = timer.getElapsedTimeF64();
+        }
+
+        LL_INFOS() << lods.size() << " LODs, " << inflated << " bytes inflated, "
+                   << copied << " more copied into LLSD binaries" << LL_ENDL;
+        LL_INFOS() << llformat("direct: %.0f LODs/s, LLSD: %.0f LODs/s",
+                               DECODES / llmax(direct_seconds, 1e-6),
+                               DECODES / llmax(generic_seconds, 1e-6))
+                   << LL_ENDL;
+    }
+}
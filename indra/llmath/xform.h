@@ -138,6 +138,13 @@ public:
 
     const LLMatrix4&    getWorldMatrix() const      { return mWorldMatrix; }
     void setWorldMatrix (const LLMatrix4& mat)   { mWorldMatrix = mat; }
+    // for callers that computed update() and updateMatrix() themselves
+    void setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4& mat)
+    {
+        mWorldPosition = pos;
+        mWorldRotation = rot;
+        mWorldMatrix = mat;
+    }
 
     void init()
     {
@@ -127,6 +127,19 @@ bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
     return true;
 }
 
+bool responseToLLSD(HttpResponse * response, bool log, LLSDXMLVisitor & visitor)
+{
+    BufferArray * body(response->getBody());
+    if (!body || !body->size())
+    {
+        return false;
+    }
+
+    LLCore::BufferArrayStream bas(body);
+    S32 parse_status(LLSDSerialize::fromXML(visitor, bas, log));
+    return LLSDParser::PARSE_FAILURE != parse_status;
+}
+
 
 HttpHandle requestPostWithLLSD(HttpRequest * request,
     HttpRequest::policy_t policy_id,
@@ -550,6 +563,64 @@ LLSD HttpCoroRawHandler::parseBody(LLCore::HttpResponse *response, bool &success
     return LLSD();
 }
 
+//========================================================================
+/// The HttpCoroVisitorHandler is a specialization of the LLCore::HttpHandler
+/// for interacting with coroutines.
+///
+/// The LLSD-XML body of a successful response goes to a visitor, and the
+/// returned LLSD only holds the "http_results".  Error bodies are small and
+/// are parsed as usual.
+///
+class HttpCoroVisitorHandler : public HttpCoroHandler
+{
+public:
+    HttpCoroVisitorHandler(LLEventStream &reply, LLSDXMLVisitor &visitor);
+
+    virtual LLSD handleSuccess(LLCore::HttpResponse * response, LLCore::HttpStatus &status);
+    virtual LLSD parseBody(LLCore::HttpResponse *response, bool &success);
+
+private:
+    LLSDXMLVisitor &mVisitor;
+};
+
+//-------------------------------------------------------------------------
+HttpCoroVisitorHandler::HttpCoroVisitorHandler(LLEventStream &reply, LLSDXMLVisitor &visitor):
+    HttpCoroHandler(reply),
+    mVisitor(visitor)
+{
+}
+
+LLSD HttpCoroVisitorHandler::handleSuccess(LLCore::HttpResponse * response, LLCore::HttpStatus &status)
+{
+    if (response->getBodySize() && !LLCoreHttpUtil::responseToLLSD(response, true, mVisitor))
+    {
+        LL_WARNS("CoreHTTP") << "Failed to deserialize . " << response->getRequestURL()
+            << " [status:" << response->getStatus().toString() << "] " << LL_ENDL;
+
+        // Replace the status with a new one indicating the failure.
+        status = LLCore::HttpStatus(499, "Failed to deserialize LLSD.");
+    }
+
+    return LLSD::emptyMap();
+}
+
+LLSD HttpCoroVisitorHandler::parseBody(LLCore::HttpResponse *response, bool &success)
+{
+    success = true;
+    if (response->getBodySize() == 0)
+        return LLSD();
+
+    LLSD result;
+
+    if (!LLCoreHttpUtil::responseToLLSD(response, true, result))
+    {
+        success = false;
+        return LLSD();
+    }
+
+    return result;
+}
+
 //========================================================================
 /// The HttpCoroJSONHandler is a specialization of the LLCore::HttpHandler for
 /// interacting with coroutines.
@@ -720,6 +791,16 @@ LLSD HttpCoroutineAdapter::postAndSuspend(LLCore::HttpRequest::ptr_t request,
     return postAndSuspend_(request, url, rawbody, options, headers, httpHandler);
 }
 
+LLSD HttpCoroutineAdapter::postAndSuspend(LLCore::HttpRequest::ptr_t request,
+    const std::string & url, const LLSD & body, LLSDXMLVisitor & visitor,
+    LLCore::HttpOptions::ptr_t options, LLCore::HttpHeaders::ptr_t headers)
+{
+    LLEventStream  replyPump(mAdapterName, true);
+    HttpCoroHandler::ptr_t httpHandler(new HttpCoroVisitorHandler(replyPump, visitor));
+
+    return postAndSuspend_(request, url, body, options, headers, httpHandler);
+}
+
 LLSD HttpCoroutineAdapter::postRawAndSuspend(LLCore::HttpRequest::ptr_t request,
     const std::string & url, LLCore::BufferArray::ptr_t rawbody,
     LLCore::HttpOptions::ptr_t options, LLCore::HttpHeaders::ptr_t headers)
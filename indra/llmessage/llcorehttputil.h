@@ -46,6 +46,8 @@
 #include "llassettype.h"
 #include "lluuid.h"
 
+class LLSDXMLVisitor;
+
 ///
 /// The base llcorehttp library implements many HTTP idioms
 /// used in the viewer but not all.  That library intentionally
@@ -90,6 +92,17 @@ bool responseToLLSD(LLCore::HttpResponse * response,
                     bool log,
                     LLSD & out_llsd);
 
+/// Same as above but hands the parsed content to a visitor
+/// as it goes instead of building an LLSD.  Large responses
+/// can be turned into their final structures this way.
+///
+/// @return             Returns true if the parse was successful.
+///                     The visitor may have been called anyway.
+///
+bool responseToLLSD(LLCore::HttpResponse * response,
+                    bool log,
+                    LLSDXMLVisitor & visitor);
+
 /// Create a std::string representation of a response object
 /// suitable for logging.  Mainly intended for logging of
 /// failures and debug information.  This won't be fast,
@@ -353,6 +366,14 @@ public:
             LLCore::HttpOptions::ptr_t(new LLCore::HttpOptions()), headers);
     }
 
+    /// Same as postAndSuspend() with an LLSD body, but an LLSD-XML response
+    /// is streamed to the visitor rather than returned.  The result then
+    /// only holds the status, and the content of error responses.
+    LLSD postAndSuspend(LLCore::HttpRequest::ptr_t request,
+        const std::string & url, const LLSD & body, LLSDXMLVisitor & visitor,
+        LLCore::HttpOptions::ptr_t options = LLCore::HttpOptions::ptr_t(new LLCore::HttpOptions()),
+        LLCore::HttpHeaders::ptr_t headers = LLCore::HttpHeaders::ptr_t(new LLCore::HttpHeaders()));
+
     LLSD postRawAndSuspend(LLCore::HttpRequest::ptr_t request,
         const std::string & url, LLCore::BufferArray::ptr_t rawbody,
         LLCore::HttpOptions::ptr_t options = LLCore::HttpOptions::ptr_t(new LLCore::HttpOptions()),
@@ -55,7 +55,10 @@ LLPacketRing::LLPacketRing () :
     mInBufferLength(0),
     mOutBufferLength(0),
     mDropPercentage(0.0f),
-    mPacketsToDrop(0x0)
+    mPacketsToDrop(0x0),
+    mUseBatchReceive(false),
+    mBatchNext(0),
+    mBatchCount(0)
 {
 }
 
@@ -107,6 +110,20 @@ void LLPacketRing::setUseOutThrottle(const bool use_throttle)
     mUseOutThrottle = use_throttle;
 }
 
+void LLPacketRing::setUseBatchReceive(const bool use_batch)
+{
+    mUseBatchReceive = use_batch;
+    if (use_batch && mBatch.empty())
+    {
+        mBatchData.resize(BATCH_SIZE * NET_BUFFER_SIZE);
+        mBatch.resize(BATCH_SIZE);
+        for (S32 i = 0; i < BATCH_SIZE; ++i)
+        {
+            mBatch[i].mData = &mBatchData[i * NET_BUFFER_SIZE];
+        }
+    }
+}
+
 void LLPacketRing::setInBandwidth(const F32 bps)
 {
     mInThrottle.setRate(bps);
@@ -270,6 +287,48 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
     return packet_size;
 }
 
+///////////////////////////////////////////////////////////
+S32 LLPacketRing::receivePacketInPlace(S32 socket, char *buffer, char *&datap)
+{
+    // Packets already batched are handed out even if batching was turned
+    // off since, so that none is lost or reordered.
+    if (mBatchNext >= mBatchCount)
+    {
+        if (!mUseBatchReceive || mUseInThrottle || LLProxy::isSOCKSProxyEnabled())
+        {
+            datap = buffer;
+            return receivePacket(socket, buffer);
+        }
+
+        mBatchNext = 0;
+        mBatchCount = receive_packets(socket, mBatch.data(), BATCH_SIZE);
+        if (!mBatchCount)
+        {
+            datap = buffer;
+            return 0;
+        }
+    }
+
+    const LLNetDatagram& datagram = mBatch[mBatchNext++];
+    datap = datagram.mData;
+    mLastSender = LLHost(datagram.mSenderIP, datagram.mSenderPort);
+    mLastReceivingIF = LLHost(datagram.mReceivingIP, INVALID_PORT);
+
+    // Same fake packet loss as receivePacket()
+    if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
+    {
+        mPacketsToDrop++;
+    }
+
+    if (mPacketsToDrop)
+    {
+        mPacketsToDrop--;
+        return 0;
+    }
+
+    return datagram.mSize;
+}
+
 bool LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host)
 {
     bool status = true;
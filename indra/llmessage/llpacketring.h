@@ -29,6 +29,7 @@
 #define LL_LLPACKETRING_H
 
 #include <queue>
+#include <vector>
 
 #include "llhost.h"
 #include "llpacketbuffer.h"
@@ -53,6 +54,18 @@ public:
     S32  receivePacket (S32 socket, char *datap);
     S32  receiveFromRing (S32 socket, char *datap);
 
+    // Batch receiving reads up to BATCH_SIZE waiting packets per system
+    // call into a preallocated ring, from which receivePacketInPlace()
+    // hands them out without copying.
+    void setUseBatchReceive(const bool use_batch);
+    bool getUseBatchReceive() const             { return mUseBatchReceive; }
+
+    // Like receivePacket(), but sets 'datap' to the packet data instead of
+    // always copying it to 'buffer' (NET_BUFFER_SIZE bytes). When batch
+    // receiving, 'datap' points into the ring and stays valid until the next
+    // receive. The in throttle and SOCKS proxying still go through 'buffer'.
+    S32  receivePacketInPlace(S32 socket, char *buffer, char *&datap);
+
     bool sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
     inline LLHost getLastSender();
@@ -60,6 +73,8 @@ public:
 
     S32 getAndResetActualInBits()               { S32 bits = mActualBitsIn; mActualBitsIn = 0; return bits;}
     S32 getAndResetActualOutBits()              { S32 bits = mActualBitsOut; mActualBitsOut = 0; return bits;}
+
+    static const S32 BATCH_SIZE = 32;
 protected:
     bool mUseInThrottle;
     bool mUseOutThrottle;
@@ -83,6 +98,14 @@ protected:
     LLHost mLastSender;
     LLHost mLastReceivingIF;
 
+    bool mUseBatchReceive;
+    // Batch receive ring: mBatch[mBatchNext] to mBatch[mBatchCount - 1]
+    // are received packets not handed out yet, their data in mBatchData.
+    std::vector<char> mBatchData;
+    std::vector<LLNetDatagram> mBatch;
+    S32 mBatchNext;
+    S32 mBatchCount;
+
 private:
     bool sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
 };
@@ -42,9 +42,14 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
                                                  number_template_map) :
     mReceiveSize(0),
     mCurrentRMessageTemplate(NULL),
+    mHasDecodedData(false),
+    mLastBlock(0),
+    mLastVariable(0),
     mCurrentRMessageData(NULL),
     mMessageNumbers(number_template_map)
 {
+    // Decoded data never gets much larger than the packets
+    mDecodeArena.reserve(MAX_BUFFER_SIZE);
 }
 
 //virtual
@@ -59,10 +64,51 @@ void LLTemplateMessageReader::clearMessage()
 {
     mReceiveSize = -1;
     mCurrentRMessageTemplate = NULL;
+    mHasDecodedData = false;
     delete mCurrentRMessageData;
     mCurrentRMessageData = NULL;
 }
 
+S32 LLTemplateMessageReader::findBlock(const char *blockname)
+{
+    const LLMessageTemplate::message_block_map_t& blocks = mCurrentRMessageTemplate->mMemberBlocks;
+    const S32 count = (S32)blocks.size();
+    S32 block = mLastBlock < count ? mLastBlock : 0;
+    for (S32 i = 0; i < count; ++i)
+    {
+        // Names are canonical strings, compared by address
+        if ((*(blocks.begin() + block))->mName == blockname)
+        {
+            mLastBlock = block;
+            return block;
+        }
+        block = block + 1 < count ? block + 1 : 0;
+    }
+    return -1;
+}
+
+S32 LLTemplateMessageReader::findVariable(const LLMessageBlock* block, const char *varname)
+{
+    const LLMessageBlock::message_variable_map_t& variables = block->mMemberVariables;
+    const S32 count = (S32)variables.size();
+    S32 var = mLastVariable < count ? mLastVariable : 0;
+    for (S32 i = 0; i < count; ++i)
+    {
+        if ((*(variables.begin() + var))->getName() == varname)
+        {
+            mLastVariable = var;
+            return var;
+        }
+        var = var + 1 < count ? var + 1 : 0;
+    }
+    return -1;
+}
+
+const LLMessageBlock* LLTemplateMessageReader::getTemplateBlock(S32 block) const
+{
+    return *(mCurrentRMessageTemplate->mMemberBlocks.begin() + block);
+}
+
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
 {
     // is there a message ready to go?
@@ -72,79 +118,77 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
         return;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData)
     {
-        LL_ERRS() << "Invalid mCurrentMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "No decoded message data in getData!" << LL_ENDL;
         return;
     }
 
-    char *bnamep = (char *)blockname + blocknum; // this works because it's just a hash.  The bnamep is never derefference
-    char *vnamep = (char *)varname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
+    const S32 block = findBlock(blockname);
 
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    if (block < 0 || blocknum < 0 || blocknum >= mDecodedBlocks[block].mCount)
     {
         LL_ERRS() << "Block " << blockname << " #" << blocknum
-            << " not in message " << mCurrentRMessageData->mName << LL_ENDL;
+            << " not in message " << mCurrentRMessageTemplate->mName << LL_ENDL;
         return;
     }
 
-    LLMsgBlkData *msg_block_data = iter->second;
-    LLMsgBlkData::msg_var_data_map_t &var_data_map = msg_block_data->mMemberVarData;
+    const LLMessageBlock* block_template = getTemplateBlock(block);
+    const S32 var = findVariable(block_template, varname);
 
-    if (var_data_map.find(vnamep) == var_data_map.end())
+    if (var < 0)
     {
-        LL_ERRS() << "Variable "<< vnamep << " not in message "
-            << mCurrentRMessageData->mName<< " block " << bnamep << LL_ENDL;
+        LL_ERRS() << "Variable "<< varname << " not in message "
+            << mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
         return;
     }
 
-    LLMsgVarData& vardata = msg_block_data->mMemberVarData[vnamep];
+    const DecodedVar& vardata = mDecodedVars[mDecodedBlocks[block].mFirstVar
+                                             + blocknum * (S32)block_template->mMemberVariables.size()
+                                             + var];
 
-    if (size && size != vardata.getSize())
+    if (size && size != vardata.mSize)
     {
-        LL_ERRS() << "Msg " << mCurrentRMessageData->mName
-            << " variable " << vnamep
-            << " is size " << vardata.getSize()
+        LL_ERRS() << "Msg " << mCurrentRMessageTemplate->mName
+            << " variable " << varname
+            << " is size " << vardata.mSize
             << " but copying into buffer of size " << size
             << LL_ENDL;
         return;
     }
 
-
-    const S32 vardata_size = vardata.getSize();
+    const U8* var_datap = mDecodeArena.data() + vardata.mOffset;
+    const S32 vardata_size = vardata.mSize;
     if( max_size >= vardata_size )
     {
         switch( vardata_size )
         {
         case 1:
-            *((U8*)datap) = *((U8*)vardata.getData());
+            *((U8*)datap) = *var_datap;
             break;
         case 2:
-            *((U16*)datap) = *((U16*)vardata.getData());
+            memcpy(datap, var_datap, 2);
             break;
         case 4:
-            *((U32*)datap) = *((U32*)vardata.getData());
+            memcpy(datap, var_datap, 4);
             break;
         case 8:
-            ((U32*)datap)[0] = ((U32*)vardata.getData())[0];
-            ((U32*)datap)[1] = ((U32*)vardata.getData())[1];
+            memcpy(datap, var_datap, 8);
             break;
         default:
-            memcpy(datap, vardata.getData(), vardata_size);
+            memcpy(datap, var_datap, vardata_size);
             break;
         }
     }
     else
     {
-        LL_WARNS() << "Msg " << mCurrentRMessageData->mName
-            << " variable " << vnamep
-            << " is size " << vardata.getSize()
+        LL_WARNS() << "Msg " << mCurrentRMessageTemplate->mName
+            << " variable " << varname
+            << " is size " << vardata_size
             << " but truncated to max size of " << max_size
             << LL_ENDL;
 
-        memcpy(datap, vardata.getData(), max_size);
+        memcpy(datap, var_datap, max_size);
     }
 }
 
@@ -157,22 +201,20 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
         return -1;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData)
     {
-        LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "No decoded message data in getNumberOfBlocks!" << LL_ENDL;
         return -1;
     }
 
-    char *bnamep = (char *)blockname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
+    const S32 block = findBlock(blockname);
 
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    if (block < 0)
     {
         return 0;
     }
 
-    return (iter->second)->mBlockNumber;
+    return mDecodedBlocks[block].mCount;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
@@ -184,43 +226,39 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
         return LL_MESSAGE_ERROR;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData)
     {   // This is a serious error - crash
-        LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "No decoded message data in getSize!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    char *bnamep = (char *)blockname;
-
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
+    const S32 block = findBlock(blockname);
 
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    if (block < 0 || !mDecodedBlocks[block].mCount)
     {   // don't crash
-        LL_INFOS() << "Block " << bnamep << " not in message "
-            << mCurrentRMessageData->mName << LL_ENDL;
+        LL_INFOS() << "Block " << blockname << " not in message "
+            << mCurrentRMessageTemplate->mName << LL_ENDL;
         return LL_BLOCK_NOT_IN_MESSAGE;
     }
 
-    char *vnamep = (char *)varname;
+    const LLMessageBlock* block_template = getTemplateBlock(block);
+    const S32 var = findVariable(block_template, varname);
 
-    LLMsgBlkData* msg_data = iter->second;
-    LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-
-    if (!vardata.getName())
+    if (var < 0)
     {   // don't crash
         LL_INFOS() << "Variable " << varname << " not in message "
-            << mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+            << mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
         return LL_VARIABLE_NOT_IN_BLOCK;
     }
 
-    if (mCurrentRMessageTemplate->mMemberBlocks[bnamep]->mType != MBT_SINGLE)
+    if (block_template->mType != MBT_SINGLE)
     {   // This is a serious error - crash
-        LL_ERRS() << "Block " << bnamep << " isn't type MBT_SINGLE,"
+        LL_ERRS() << "Block " << blockname << " isn't type MBT_SINGLE,"
             " use getSize with blocknum argument!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    return vardata.getSize();
+    return mDecodedVars[mDecodedBlocks[block].mFirstVar + var].mSize;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const char *varname)
@@ -232,35 +270,34 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
         return LL_MESSAGE_ERROR;
     }
 
-    if (!mCurrentRMessageData)
+    if (!mHasDecodedData)
     {   // This is a serious error - crash
-        LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+        LL_ERRS() << "No decoded message data in getSize!" << LL_ENDL;
         return LL_MESSAGE_ERROR;
     }
 
-    char *bnamep = (char *)blockname + blocknum;
-    char *vnamep = (char *)varname;
+    const S32 block = findBlock(blockname);
 
-    LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-    if (iter == mCurrentRMessageData->mMemberBlocks.end())
+    if (block < 0 || blocknum < 0 || blocknum >= mDecodedBlocks[block].mCount)
     {   // don't crash
-        LL_INFOS() << "Block " << bnamep << " not in message "
-            << mCurrentRMessageData->mName << LL_ENDL;
+        LL_INFOS() << "Block " << blockname << " #" << blocknum << " not in message "
+            << mCurrentRMessageTemplate->mName << LL_ENDL;
         return LL_BLOCK_NOT_IN_MESSAGE;
     }
 
-    LLMsgBlkData* msg_data = iter->second;
-    LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
+    const LLMessageBlock* block_template = getTemplateBlock(block);
+    const S32 var = findVariable(block_template, varname);
 
-    if (!vardata.getName())
+    if (var < 0)
     {   // don't crash
-        LL_INFOS() << "Variable " << vnamep << " not in message "
-            <<  mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+        LL_INFOS() << "Variable " << varname << " not in message "
+            << mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
         return LL_VARIABLE_NOT_IN_BLOCK;
     }
 
-    return vardata.getSize();
+    return mDecodedVars[mDecodedBlocks[block].mFirstVar
+                        + blocknum * (S32)block_template->mMemberVariables.size()
+                        + var].mSize;
 }
 
 void LLTemplateMessageReader::getBinaryData(const char *blockname,
@@ -537,16 +574,21 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
 
     llassert( mReceiveSize >= 0 );
     llassert( mCurrentRMessageTemplate);
-    llassert( !mCurrentRMessageData );
+    llassert( !mHasDecodedData );
     delete mCurrentRMessageData; // just to make sure
+    mCurrentRMessageData = NULL;
 
     // The offset tells us how may bytes to skip after the end of the
     // message name.
     U8 offset = buffer[PHL_OFFSET];
     S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
 
-    // create base working data set
-    mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
+    // reset the working data set, keeping its storage
+    mDecodedBlocks.clear();
+    mDecodedVars.clear();
+    mDecodeArena.clear();
+    mHasDecodedData = true;
+    S32 total_blocks = 0;
 
     // loop through the template building the data structure as we go
     LLMessageTemplate::message_block_map_t::const_iterator iter;
@@ -595,26 +637,15 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
             return false;
         }
 
-        LLMsgBlkData* cur_data_block = NULL;
+        DecodedBlock decoded_block;
+        decoded_block.mCount = repeat_number;
+        decoded_block.mFirstVar = (S32)mDecodedVars.size();
+        mDecodedBlocks.push_back(decoded_block);
+        total_blocks += repeat_number;
 
         // now loop through the block
         for (i = 0; i < repeat_number; i++)
         {
-            if (i)
-            {
-                // build new name to prevent collisions
-                // TODO: This should really change to a vector
-                cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-                cur_data_block->mName = mbci->mName + i;
-            }
-            else
-            {
-                cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-            }
-
-            // add the block to the message
-            mCurrentRMessageData->addBlock(cur_data_block);
-
             // now read the variables
             for (LLMessageBlock::message_variable_map_t::const_iterator iter =
                      mbci->mMemberVariables.begin();
@@ -622,10 +653,6 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
             {
                 const LLMessageVariable& mvci = **iter;
 
-                // ok, build out the variables
-                // add variable block
-                cur_data_block->addVariable(mvci.getName(), mvci.getType());
-
                 // what type of variable?
                 if (mvci.getType() == MVT_VARIABLE)
                 {
@@ -664,7 +691,14 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
                     }
                     decode_pos += data_size;
 
-                    cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+                    if ((decode_pos + (S32)tsize) > mReceiveSize)
+                    {
+                        // the size field is bogus, don't read past the packet
+                        logRanOffEndOfPacket(sender, decode_pos, tsize);
+                        tsize = 0;
+                    }
+
+                    addDecodedVar(mvci, &buffer[decode_pos], tsize);
                     decode_pos += tsize;
                 }
                 else
@@ -676,17 +710,11 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
                         logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
 
                         // default to 0s.
-                        U32 size = mvci.getSize();
-                        std::vector<U8> data(size, 0);
-                        cur_data_block->addData(mvci.getName(), &(data[0]),
-                                                size, mvci.getType());
+                        addDecodedVar(mvci, NULL, mvci.getSize());
                     }
                     else
                     {
-                        cur_data_block->addData(mvci.getName(),
-                                                &buffer[decode_pos],
-                                                mvci.getSize(),
-                                                mvci.getType());
+                        addDecodedVar(mvci, &buffer[decode_pos], mvci.getSize());
                     }
                     decode_pos += mvci.getSize();
                 }
@@ -694,7 +722,7 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
         }
     }
 
-    if (mCurrentRMessageData->mMemberBlocks.empty()
+    if (!total_blocks
         && !mCurrentRMessageTemplate->mMemberBlocks.empty())
     {
         LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
@@ -704,25 +732,30 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
     {
         static LLTimer decode_timer;
 
-        if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
+        // There is no message system when the reader is used on its own,
+        // as in tests
+        LLMessageSystem* msg_system = gMessageSystem;
+        LLMessageSystem::msg_timing_callback timing_callback = msg_system ? msg_system->getTimingCallback() : NULL;
+
+        if(LLMessageReader::getTimeDecodes() || timing_callback)
         {
             decode_timer.reset();
         }
 
-        if( !mCurrentRMessageTemplate->callHandlerFunc(gMessageSystem) )
+        if( !mCurrentRMessageTemplate->callHandlerFunc(msg_system) )
         {
             LL_WARNS() << "Message from " << sender << " with no handler function received: " << mCurrentRMessageTemplate->mName << LL_ENDL;
         }
 
-        if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
+        if(LLMessageReader::getTimeDecodes() || timing_callback)
         {
             F32 decode_time = decode_timer.getElapsedTimeF32();
 
-            if (gMessageSystem->getTimingCallback())
+            if (timing_callback)
             {
-                (gMessageSystem->getTimingCallback())(mCurrentRMessageTemplate->mName,
+                timing_callback(mCurrentRMessageTemplate->mName,
                                 decode_time,
-                                gMessageSystem->getTimingCallbackData());
+                                msg_system->getTimingCallbackData());
             }
 
             if (LLMessageReader::getTimeDecodes())
@@ -750,6 +783,24 @@ bool LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender
     return true;
 }
 
+void LLTemplateMessageReader::addDecodedVar(const LLMessageVariable& var, const U8* data, S32 size)
+{
+    DecodedVar decoded_var;
+    decoded_var.mOffset = (S32)mDecodeArena.size();
+    decoded_var.mSize = size;
+    mDecodedVars.push_back(decoded_var);
+
+    if (size)
+    {
+        // new bytes are zeroed, which is all missing data needs
+        mDecodeArena.resize(decoded_var.mOffset + size);
+        if (data)
+        {
+            htolememcpy(&mDecodeArena[decoded_var.mOffset], data, var.getType(), size);
+        }
+    }
+}
+
 bool LLTemplateMessageReader::validateMessage(const U8* buffer,
                                               S32 buffer_size,
                                               const LLHost& sender,
@@ -826,5 +877,47 @@ void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
     {
         return;
     }
+    if (!mCurrentRMessageData)
+    {
+        buildMessageData();
+    }
     builder.copyFromMessageData(*mCurrentRMessageData);
 }
+
+void LLTemplateMessageReader::buildMessageData() const
+{
+    mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
+    if (!mHasDecodedData)
+    {
+        return;
+    }
+
+    S32 block = 0;
+    for (LLMessageTemplate::message_block_map_t::const_iterator iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
+         iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+         ++iter, ++block)
+    {
+        const LLMessageBlock* mbci = *iter;
+        const DecodedBlock& decoded_block = mDecodedBlocks[block];
+        S32 var = decoded_block.mFirstVar;
+
+        for (S32 i = 0; i < decoded_block.mCount; i++)
+        {
+            // repeats are told apart by offsetting the block name, which
+            // is only ever compared by address
+            LLMsgBlkData* cur_data_block = new LLMsgBlkData(mbci->mName, decoded_block.mCount);
+            cur_data_block->mName = mbci->mName + i;
+            mCurrentRMessageData->addBlock(cur_data_block);
+
+            for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = mbci->mMemberVariables.begin();
+                 var_iter != mbci->mMemberVariables.end(); ++var_iter, ++var)
+            {
+                const LLMessageVariable& mvci = **var_iter;
+                const DecodedVar& decoded_var = mDecodedVars[var];
+                cur_data_block->addVariable(mvci.getName(), mvci.getType());
+                cur_data_block->addData(mvci.getName(), mDecodeArena.data() + decoded_var.mOffset,
+                                        decoded_var.mSize, mvci.getType());
+            }
+        }
+    }
+}
@@ -30,8 +30,11 @@
 #include "llmessagereader.h"
 
 #include <map>
+#include <vector>
 
+class LLMessageBlock;
 class LLMessageTemplate;
+class LLMessageVariable;
 class LLMsgData;
 
 class LLTemplateMessageReader : public LLMessageReader
@@ -111,6 +114,16 @@ private:
     void getData(const char *blockname, const char *varname, void *datap,
                  S32 size = 0, S32 blocknum = 0, S32 max_size = S32_MAX);
 
+    // Index of the block in the current template or of the variable in
+    // the block, -1 if there is none by that name
+    S32 findBlock(const char *blockname);
+    S32 findVariable(const LLMessageBlock* block, const char *varname);
+    const LLMessageBlock* getTemplateBlock(S32 block) const;
+
+    void addDecodedVar(const LLMessageVariable& var, const U8* data, S32 size);
+    // Builds mCurrentRMessageData from the flat decoded data
+    void buildMessageData() const;
+
     bool decodeTemplate(const U8* buffer, S32 buffer_size,  // inputs
                         LLMessageTemplate** msg_template ); // outputs
 
@@ -120,7 +133,35 @@ private:
 
     S32 mReceiveSize;
     LLMessageTemplate* mCurrentRMessageTemplate;
-    LLMsgData* mCurrentRMessageData;
+
+    // The decoded message, laid out flat and addressed by template index:
+    // one DecodedBlock per block of the template, with its repeat count and
+    // its first variable in mDecodedVars, which holds the variables of every
+    // repeat in template order. Their data is in mDecodeArena. The vectors
+    // are reused from one message to the next, so that decoding does not
+    // allocate once they have grown.
+    struct DecodedBlock
+    {
+        S32 mCount;
+        S32 mFirstVar;
+    };
+    struct DecodedVar
+    {
+        S32 mOffset;
+        S32 mSize;
+    };
+    std::vector<DecodedBlock> mDecodedBlocks;
+    std::vector<DecodedVar> mDecodedVars;
+    std::vector<U8> mDecodeArena;
+    bool mHasDecodedData;
+
+    // Handlers mostly read blocks and variables in template order, so
+    // lookups start from the last ones found
+    S32 mLastBlock;
+    S32 mLastVariable;
+
+    // Tree form of the decoded message, only built for copyToBuilder()
+    mutable LLMsgData* mCurrentRMessageData;
     message_template_number_map_t& mMessageNumbers;
 };
 
@@ -275,6 +275,7 @@ LLMessageSystem::LLMessageSystem(const std::string& filename, U32 port,
     mMaxMessageCounts = 200; // >= 0 means dump warnings
     mMaxMessageTime   = F32Seconds(1.f);
 
+    mTrueReceiveData = mTrueReceiveBuffer;
     mTrueReceiveSize = 0;
 
     mReceiveTime = F32Seconds(0.f);
@@ -511,9 +512,12 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
         S32 acks = 0;
         S32 true_rcv_size = 0;
 
-        U8* buffer = mTrueReceiveBuffer;
+        // Decode straight from where the packet was received
+        char* true_data = NULL;
+        mTrueReceiveSize = mPacketRing.receivePacketInPlace(mSocket, (char *)mTrueReceiveBuffer, true_data);
+        mTrueReceiveData = (U8*)true_data;
+        U8* buffer = mTrueReceiveData;
 
-        mTrueReceiveSize = mPacketRing.receivePacket(mSocket, (char *)mTrueReceiveBuffer);
         // If you want to dump all received packets into SecondLife.log, uncomment this
         //dumpPacketToLog();
 
@@ -578,7 +582,7 @@ bool LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count )
                 for(S32 i = 0; i < acks; ++i)
                 {
                     true_rcv_size -= sizeof(TPACKETID);
-                    memcpy(&mem_id, &mTrueReceiveBuffer[true_rcv_size], /* Flawfinder: ignore*/
+                    memcpy(&mem_id, &mTrueReceiveData[true_rcv_size], /* Flawfinder: ignore*/
                          sizeof(TPACKETID));
                     packet_id = ntohl(mem_id);
                     //LL_INFOS("Messaging") << "got ack: " << packet_id << LL_ENDL;
@@ -3340,7 +3344,7 @@ void LLMessageSystem::dumpPacketToLog()
     {
         S32 offset = cur_line_pos * 3;
         snprintf(line_buffer + offset, sizeof(line_buffer) - offset,
-                 "%02x ", mTrueReceiveBuffer[i]);   /* Flawfinder: ignore */
+                 "%02x ", mTrueReceiveData[i]);   /* Flawfinder: ignore */
         cur_line_pos++;
         if (cur_line_pos >= 16)
         {
@@ -858,6 +858,9 @@ private:
 
     U8  mEncodedRecvBuffer[MAX_BUFFER_SIZE];
     U8  mTrueReceiveBuffer[MAX_BUFFER_SIZE];
+    // The packet being processed: mTrueReceiveBuffer, or a slot of the
+    // packet ring when it batch receives
+    U8* mTrueReceiveData;
     S32 mTrueReceiveSize;
 
     // Must be valid during decode
@@ -523,12 +523,30 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+static void get_pktinfo_destip(struct msghdr* msg, U32 *dstip)
+{
+    struct cmsghdr *cmsgptr;
+    for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
+    {
+        if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+        {
+            in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+            if( pktinfo )
+            {
+                // Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+                // routed. We should stay with specified until we go to multiple
+                // interfaces
+                *dstip = pktinfo->ipi_spec_dst.s_addr;
+            }
+        }
+    }
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
     int size;
     struct iovec iov[1];
     char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-    struct cmsghdr *cmsgptr;
     struct msghdr msg = {0};
 
     iov[0].iov_base = buf;
@@ -549,20 +567,7 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
         return -1;
     }
 
-    for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
-    {
-        if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
-        {
-            in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-            if( pktinfo )
-            {
-                // Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-                // routed. We should stay with specified until we go to multiple
-                // interfaces
-                *dstip = pktinfo->ipi_spec_dst.s_addr;
-            }
-        }
-    }
+    get_pktinfo_destip(&msg, dstip);
 
     return size;
 }
@@ -660,4 +665,80 @@ bool send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 
 #endif
 
+#if LL_LINUX
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+    // Enough for the packet ring, larger requests are served in part
+    const S32 MAX_DATAGRAMS = 64;
+    count = llmin(count, MAX_DATAGRAMS);
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    struct mmsghdr msgs[MAX_DATAGRAMS];
+    struct iovec iovs[MAX_DATAGRAMS];
+    struct sockaddr_in senders[MAX_DATAGRAMS];
+    char cmsgs[MAX_DATAGRAMS][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (S32 i = 0; i < count; ++i)
+    {
+        iovs[i].iov_base = datagrams[i].mData;
+        iovs[i].iov_len = NET_BUFFER_SIZE;
+
+        struct msghdr& msg = msgs[i].msg_hdr;
+        msg.msg_name = &senders[i];
+        msg.msg_namelen = sizeof(senders[i]);
+        msg.msg_iov = &iovs[i];
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmsgs[i];
+        msg.msg_controllen = sizeof(cmsgs[i]);
+    }
+
+    int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+    if (received <= 0)
+    {
+        // Nothing waiting (EAGAIN) or an error, like receive_packet()
+        return 0;
+    }
+
+    for (S32 i = 0; i < received; ++i)
+    {
+        LLNetDatagram& datagram = datagrams[i];
+        datagram.mSize = (S32)msgs[i].msg_len;
+        datagram.mSenderIP = senders[i].sin_addr.s_addr;
+        datagram.mSenderPort = ntohs(senders[i].sin_port);
+        datagram.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+        get_pktinfo_destip(&msgs[i].msg_hdr, &datagram.mReceivingIP);
+    }
+
+    // Keep get_sender() and get_receiving_interface() about the last one,
+    // as after receive_packet()
+    stSrcAddr = senders[received - 1];
+    gsnReceivingIFAddr = datagrams[received - 1].mReceivingIP;
+
+    return received;
+}
+#else
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+    S32 received = 0;
+    while (received < count)
+    {
+        LLNetDatagram& datagram = datagrams[received];
+        datagram.mSize = receive_packet(hSocket, datagram.mData);
+        if (datagram.mSize <= 0)
+        {
+            break;
+        }
+        datagram.mSenderIP = get_sender_ip();
+        datagram.mSenderPort = get_sender_port();
+        datagram.mReceivingIP = get_receiving_interface_ip();
+        ++received;
+    }
+    return received;
+}
+#endif
+
 //EOF
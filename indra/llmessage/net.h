@@ -43,6 +43,21 @@ void    end_net(S32& socket_out);
 // returns size of packet or -1 in case of error
 S32     receive_packet(int hSocket, char * receiveBuffer);
 
+// One datagram of a batch received by receive_packets()
+struct LLNetDatagram
+{
+    char*   mData;          // NET_BUFFER_SIZE bytes, provided by the caller
+    S32     mSize;
+    U32     mSenderIP;
+    U32     mSenderPort;
+    U32     mReceivingIP;   // INVALID_HOST_IP_ADDRESS when unknown
+};
+
+// Receives up to 'count' datagrams at once (a single recvmmsg() on Linux,
+// one receive_packet() per datagram elsewhere). Returns how many were
+// received, zero when none is waiting or on error.
+S32     receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count);
+
 bool    send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);   // Returns true on success.
 
 //void  get_sender(char * tmp);
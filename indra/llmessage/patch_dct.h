@@ -88,4 +88,11 @@ void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
 
+// In place inverse DCT of a 16 bytes aligned block of size*size dequantized
+// coefficients, once init_patch_decompressor(size) was called. The SIMD
+// version, used by the decompress_patch*() functions, gives the very same
+// results as the scalar one, which is kept as the reference.
+void idct_patch_scalar(F32 *block, S32 size);
+void idct_patch_simd(F32 *block, S32 size);
+
 #endif
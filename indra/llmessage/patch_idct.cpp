@@ -27,6 +27,7 @@
 #include "linden_common.h"
 
 #include "llmath.h"
+#include "llvector4a.h"
 #include "v3math.h"
 #include "patch_dct.h"
 
@@ -52,7 +53,7 @@ void build_patch_dequantize_table(S32 size)
 
 S32 gCurrentDeSize = 0;
 
-F32 gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+LL_ALIGN_16(F32 gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
 
 void setup_patch_icosines(S32 size)
 {
@@ -585,13 +586,109 @@ inline void idct_patch_large(F32 *block)
     idct_line_large_slow(temp, block, 31);
 }
 
+// Vectorized idct_patch() and idct_patch_large(). Both passes are products of
+// matrices: out[i][j] = sum over u of a[i][u]*b[u][j], with a read through
+// strides so that the columns pass can use the cosines transposed. Each output
+// sums its terms in the very same order as the scalar code, so that the
+// results match bit for bit: the first term is OO_SQRT2*a[i][0] times b[0][j],
+// which is either the first coefficient or 1.f (cosine of 0).
+template<S32 SIZE>
+static void idct_pass_simd(const F32 *a, S32 a_row_step, S32 a_u_step, const F32 *b, F32 *out, F32 scale)
+{
+    LLVector4a factor0, factor1, vb, term;
+    LLVector4a total00, total01, total02, total03;
+    LLVector4a total10, total11, total12, total13;
+
+    // Two rows by sixteen columns at a time, which fits in the registers
+    for (S32 i = 0; i < SIZE; i += 2)
+    {
+        const F32 *a0 = a + i*a_row_step;
+        const F32 *a1 = a0 + a_row_step;
+        for (S32 j = 0; j < SIZE; j += 16)
+        {
+            const F32 *tb = b + j;
+            factor0.splat(OO_SQRT2*a0[0]);
+            factor1.splat(OO_SQRT2*a1[0]);
+            vb.load4a(tb);      total00.setMul(vb, factor0);    total10.setMul(vb, factor1);
+            vb.load4a(tb + 4);  total01.setMul(vb, factor0);    total11.setMul(vb, factor1);
+            vb.load4a(tb + 8);  total02.setMul(vb, factor0);    total12.setMul(vb, factor1);
+            vb.load4a(tb + 12); total03.setMul(vb, factor0);    total13.setMul(vb, factor1);
+
+            for (S32 u = 1; u < SIZE; u++)
+            {
+                tb += SIZE;
+                factor0.splat(a0[u*a_u_step]);
+                factor1.splat(a1[u*a_u_step]);
+                vb.load4a(tb);
+                term.setMul(vb, factor0);   total00.add(term);
+                term.setMul(vb, factor1);   total10.add(term);
+                vb.load4a(tb + 4);
+                term.setMul(vb, factor0);   total01.add(term);
+                term.setMul(vb, factor1);   total11.add(term);
+                vb.load4a(tb + 8);
+                term.setMul(vb, factor0);   total02.add(term);
+                term.setMul(vb, factor1);   total12.add(term);
+                vb.load4a(tb + 12);
+                term.setMul(vb, factor0);   total03.add(term);
+                term.setMul(vb, factor1);   total13.add(term);
+            }
+
+            if (scale != 1.f)
+            {
+                total00.mul(scale); total01.mul(scale); total02.mul(scale); total03.mul(scale);
+                total10.mul(scale); total11.mul(scale); total12.mul(scale); total13.mul(scale);
+            }
+            F32 *out0 = out + i*SIZE + j;
+            F32 *out1 = out0 + SIZE;
+            total00.store4a(out0);  total01.store4a(out0 + 4);  total02.store4a(out0 + 8);  total03.store4a(out0 + 12);
+            total10.store4a(out1);  total11.store4a(out1 + 4);  total12.store4a(out1 + 8);  total13.store4a(out1 + 12);
+        }
+    }
+}
+
+template<S32 SIZE>
+static void idct_patch_simd_sized(F32 *block)
+{
+    LL_ALIGN_16(F32 temp[SIZE*SIZE]);
+
+    // Columns: temp[n][c] = sum over u of cos[u][n]*block[u][c]
+    idct_pass_simd<SIZE>(gPatchICosines, 1, SIZE, block, temp, 1.f);
+    // Lines: block[l][n] = (sum over u of temp[l][u]*cos[u][n])*oosob
+    idct_pass_simd<SIZE>(temp, SIZE, 1, gPatchICosines, block, 2.f/SIZE);
+}
+
+void idct_patch_scalar(F32 *block, S32 size)
+{
+    if (size == NORMAL_PATCH_SIZE)
+    {
+        idct_patch(block);
+    }
+    else
+    {
+        idct_patch_large(block);
+    }
+}
+
+void idct_patch_simd(F32 *block, S32 size)
+{
+    if (size == NORMAL_PATCH_SIZE)
+    {
+        idct_patch_simd_sized<NORMAL_PATCH_SIZE>(block);
+    }
+    else
+    {
+        idct_patch_simd_sized<LARGE_PATCH_SIZE>(block);
+    }
+}
+
 S32 gDitherNoise = 128;
 
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
 {
     S32     i, j;
 
-    F32     block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock = block;
+    LL_ALIGN_16(F32 block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+    F32     *tblock = block;
     F32     *tpatch;
 
     LLGroupHeader   *gopp = gGOPP;
@@ -614,14 +711,7 @@ void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
         *(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
     }
 
-    if (size == 16)
-    {
-        idct_patch(block);
-    }
-    else
-    {
-        idct_patch_large(block);
-    }
+    idct_patch_simd(block, size);
 
     for (j = 0; j < size; j++)
     {
@@ -639,7 +729,8 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
 {
     S32     i, j;
 
-    F32         block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock = block;
+    LL_ALIGN_16(F32 block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+    F32         *tblock = block;
     LLVector3   *tvec;
 
     LLGroupHeader   *gopp = gGOPP;
@@ -665,10 +756,7 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
         *(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
     }
 
-    if (size == 16)
-        idct_patch(block);
-    else
-        idct_patch_large(block);
+    idct_patch_simd(block, size);
 
     for (j = 0; j < size; j++)
     {
@@ -0,0 +1,197 @@
+/**
+ * @file llpacketring_test.cpp
+ * @brief Loopback tests and benchmark of the LLPacketRing receive paths.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketring.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <ctime>
+
+namespace tut
+{
+    // Packets sent before draining them, well within the socket buffer
+    static const S32 CHUNK_PACKETS = 100;
+
+    struct packetring_test
+    {
+        S32 mReceiveSocket;
+        S32 mSendSocket;
+        int mReceivePort;
+        int mSendPort;
+        U32 mLoopback;
+        // The replayed stream: sizes of the packets of an object update
+        // flood, mostly ObjectUpdateCompressed and ImprovedTerseObjectUpdate
+        std::vector<S32> mSizes;
+
+        packetring_test() :
+            mReceiveSocket(-1),
+            mSendSocket(-1),
+            mReceivePort(NET_USE_OS_ASSIGNED_PORT),
+            mSendPort(NET_USE_OS_ASSIGNED_PORT),
+            mLoopback(ip_string_to_u32(LOOPBACK_ADDRESS_STRING))
+        {
+            start_net(mReceiveSocket, mReceivePort);
+            start_net(mSendSocket, mSendPort);
+
+            static const S32 sizes[] = { 1129, 1143, 87, 1182, 246, 1175, 64, 1103, 389, 1191, 1148, 32, 518, 1200 };
+            for (S32 i = 0; i < 2000; ++i)
+            {
+                mSizes.push_back(sizes[(i * 7) % LL_ARRAY_SIZE(sizes)] - (i % 13));
+            }
+        }
+
+        ~packetring_test()
+        {
+            end_net(mReceiveSocket);
+            end_net(mSendSocket);
+        }
+
+        // Packet 'index', numbered and filled so that corruption shows
+        void makePacket(S32 index, std::vector<char>& packet)
+        {
+            packet.resize(mSizes[index]);
+            for (S32 i = 0; i < (S32)packet.size(); ++i)
+            {
+                packet[i] = (char)(index + i * 31);
+            }
+            memcpy(&packet[0], &index, sizeof(index));
+        }
+
+        void sendPackets(S32 first, S32 count)
+        {
+            std::vector<char> packet;
+            for (S32 index = first; index < first + count; ++index)
+            {
+                makePacket(index, packet);
+                send_packet(mSendSocket, &packet[0], (int)packet.size(), mLoopback, mReceivePort);
+            }
+        }
+
+        // Receives and checks packets 'first' onwards, returning how many
+        S32 receivePackets(LLPacketRing& ring, S32 first, const std::string& desc)
+        {
+            char buffer[NET_BUFFER_SIZE];
+            std::vector<char> expected;
+            S32 index = first;
+            while (true)
+            {
+                char* datap = NULL;
+                S32 size = ring.receivePacketInPlace(mReceiveSocket, buffer, datap);
+                if (!size)
+                {
+                    break;
+                }
+                makePacket(index, expected);
+                ensure_equals(desc + " size", size, (S32)expected.size());
+                ensure(desc + " data", !memcmp(datap, &expected[0], size));
+                ensure_equals(desc + " sender port", (S32)ring.getLastSender().getPort(), (S32)mSendPort);
+                ++index;
+            }
+            return index - first;
+        }
+    };
+
+    typedef test_group<packetring_test> packetring_t;
+    typedef packetring_t::object packetring_object_t;
+    tut::packetring_t tut_packetring("LLPacketRing");
+
+    template<> template<>
+    void packetring_object_t::test<1>()
+    {
+        // The whole stream arrives intact and in order, both ways
+        for (bool batch : { false, true })
+        {
+            LLPacketRing ring;
+            ring.setUseBatchReceive(batch);
+            const std::string desc = batch ? "batch" : "single";
+            for (S32 first = 0; first < (S32)mSizes.size(); first += CHUNK_PACKETS)
+            {
+                sendPackets(first, CHUNK_PACKETS);
+                ensure_equals(desc + " received", receivePackets(ring, first, desc), CHUNK_PACKETS);
+            }
+        }
+    }
+
+    template<> template<>
+    void packetring_object_t::test<2>()
+    {
+        // Packets already batched are still handed out after batching is
+        // turned off, before the new ones
+        LLPacketRing ring;
+        ring.setUseBatchReceive(true);
+        sendPackets(0, 10);
+
+        char buffer[NET_BUFFER_SIZE];
+        char* datap = NULL;
+        ensure("first packet", ring.receivePacketInPlace(mReceiveSocket, buffer, datap) > 0);
+        ensure("in the ring", datap != buffer);
+
+        ring.setUseBatchReceive(false);
+        sendPackets(10, 5);
+        ensure_equals("remaining packets", receivePackets(ring, 1, "unbatched"), 14);
+    }
+
+    template<> template<>
+    void packetring_object_t::test<3>()
+    {
+        // Replays the stream through both paths, reporting the receive rate
+        // and the CPU time per packet. Not a pass/fail test.
+        skip_unless_benchmarking();
+        const S32 REPEATS = 5;
+        for (bool batch : { false, true })
+        {
+            LLPacketRing ring;
+            ring.setUseBatchReceive(batch);
+            S32 packets = 0;
+            F64 seconds = 0.0;
+            std::clock_t cpu = 0;
+            LLTimer timer;
+            for (S32 repeat = 0; repeat < REPEATS; ++repeat)
+            {
+                for (S32 first = 0; first < (S32)mSizes.size(); first += CHUNK_PACKETS)
+                {
+                    sendPackets(first, CHUNK_PACKETS);
+
+                    timer.reset();
+                    const std::clock_t cpu_start = std::clock();
+                    packets += receivePackets(ring, first, "benchmark");
+                    cpu += std::clock() - cpu_start;
+                    seconds += timer.getElapsedTimeF64();
+                }
+            }
+            ensure_equals("benchmark received", packets, REPEATS * (S32)mSizes.size());
+
+            LL_INFOS() << (batch ? "Batch" : "Single") << " receive: " << packets << " packets, "
+                       << llformat("%.0f packets/s, %.2f us CPU per packet",
+                                   packets / llmax(seconds, 1e-6),
+                                   1e6 * cpu / CLOCKS_PER_SEC / packets)
+                       << LL_ENDL;
+        }
+    }
+}
@@ -0,0 +1,380 @@
+/**
+ * @file lltemplatemessagereader_test.cpp
+ * @brief Tests and benchmark of the template message decoding.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lltemplatemessagereader.h"
+#include "../llmessagetemplate.h"
+#include "../llmessagetemplateparser.h"
+#include "llpounceable.h"
+#include "lltimer.h"
+#include "message.h"
+
+#include "../test/lltut.h"
+
+#include <random>
+
+LLPounceable<LLMessageSystem*, LLPounceableStatic> gMessageSystem;
+
+// Only called on malformed packets, which are not tested here
+bool LLMessageSystem::callExceptionFunc(EMessageException exception)
+{
+    return false;
+}
+
+namespace tut
+{
+    // The object update messages, as in message_template.msg, and one
+    // with every kind of block and variable
+    static const char* sTemplates =
+        "version 2.0\n"
+        "{\n"
+        "   ObjectUpdate High 12 Trusted Zerocoded\n"
+        "   {\n"
+        "       RegionData Single\n"
+        "       { RegionHandle U64 }\n"
+        "       { TimeDilation U16 }\n"
+        "   }\n"
+        "   {\n"
+        "       ObjectData Variable\n"
+        "       { ID U32 } { State U8 } { FullID LLUUID } { CRC U32 } { PCode U8 }\n"
+        "       { Material U8 } { ClickAction U8 } { Scale LLVector3 } { ObjectData Variable 1 }\n"
+        "       { ParentID U32 } { UpdateFlags U32 }\n"
+        "       { PathCurve U8 } { ProfileCurve U8 } { PathBegin U16 } { PathEnd U16 }\n"
+        "       { PathScaleX U8 } { PathScaleY U8 } { PathShearX U8 } { PathShearY U8 }\n"
+        "       { PathTwist S8 } { PathTwistBegin S8 } { PathRadiusOffset S8 } { PathTaperX S8 }\n"
+        "       { PathTaperY S8 } { PathRevolutions U8 } { PathSkew S8 }\n"
+        "       { ProfileBegin U16 } { ProfileEnd U16 } { ProfileHollow U16 }\n"
+        "       { TextureEntry Variable 2 } { TextureAnim Variable 1 }\n"
+        "       { NameValue Variable 2 } { Data Variable 2 } { Text Variable 1 }\n"
+        "       { TextColor Fixed 4 } { MediaURL Variable 1 }\n"
+        "       { PSBlock Variable 1 } { ExtraParams Variable 1 }\n"
+        "       { Sound LLUUID } { OwnerID LLUUID } { Gain F32 } { Flags U8 } { Radius F32 }\n"
+        "       { JointType U8 } { JointPivot LLVector3 } { JointAxisOrAnchor LLVector3 }\n"
+        "   }\n"
+        "}\n"
+        "{\n"
+        "   ImprovedTerseObjectUpdate High 15 Trusted Unencoded\n"
+        "   {\n"
+        "       RegionData Single\n"
+        "       { RegionHandle U64 }\n"
+        "       { TimeDilation U16 }\n"
+        "   }\n"
+        "   {\n"
+        "       ObjectData Variable\n"
+        "       { Data Variable 1 }\n"
+        "       { TextureEntry Variable 2 }\n"
+        "   }\n"
+        "}\n"
+        "{\n"
+        "   TestBlocks Low 1 NotTrusted Unencoded\n"
+        "   {\n"
+        "       SingleBlock Single\n"
+        "       { Bytes Fixed 5 } { Float F32 } { Text Variable 1 }\n"
+        "   }\n"
+        "   {\n"
+        "       MultipleBlock Multiple 3\n"
+        "       { Vector LLVector3d } { Short S16 }\n"
+        "   }\n"
+        "   {\n"
+        "       VariableBlock Variable\n"
+        "       { Big Variable 2 } { Byte U8 }\n"
+        "   }\n"
+        "}\n";
+
+    // Every variable of every block repeat of a message
+    typedef std::vector<std::vector<std::vector<std::vector<U8> > > > message_values_t;
+
+    struct TestPacket
+    {
+        const LLMessageTemplate* mTemplate;
+        std::vector<U8> mData;
+        message_values_t mValues;
+    };
+
+    static LLTemplateMessageReader* sReader = NULL;
+    static U32 sChecksum = 0;
+
+    // Reads everything, the way processObjectUpdate() and friends do
+    static void read_message(LLMessageSystem*, void** user_data)
+    {
+        const LLMessageTemplate* templatep = (const LLMessageTemplate*)user_data;
+        U8 buffer[MAX_BUFFER_SIZE];
+        for (const LLMessageBlock* block : templatep->mMemberBlocks)
+        {
+            const S32 count = sReader->getNumberOfBlocks(block->mName);
+            for (S32 i = 0; i < count; ++i)
+            {
+                for (const LLMessageVariable* var : block->mMemberVariables)
+                {
+                    const S32 size = sReader->getSize(block->mName, i, var->getName());
+                    sReader->getBinaryData(block->mName, var->getName(), buffer, 0, i, sizeof(buffer));
+                    sChecksum += size ? buffer[0] + buffer[size - 1] : 1;
+                }
+            }
+        }
+    }
+
+    struct templatemessagereader_test
+    {
+        LLTemplateParser* mParser;
+        LLTemplateMessageReader::message_template_number_map_t mTemplates;
+        LLTemplateMessageReader mReader;
+        LLHost mSender;
+        std::mt19937 mRandom;
+
+        templatemessagereader_test() :
+            mParser(NULL),
+            mReader(mTemplates),
+            mSender("127.0.0.1", 13000),
+            mRandom(4321)
+        {
+            LLTemplateTokenizer tokens(sTemplates);
+            mParser = new LLTemplateParser(tokens);
+            for (LLTemplateParser::message_iterator iter = mParser->getMessagesBegin();
+                 iter != mParser->getMessagesEnd(); ++iter)
+            {
+                LLMessageTemplate* templatep = *iter;
+                mTemplates[templatep->mMessageNumber] = templatep;
+                templatep->setHandlerFunc(read_message, (void**)templatep);
+            }
+            sReader = &mReader;
+        }
+
+        ~templatemessagereader_test()
+        {
+            sReader = NULL;
+            for (auto& entry : mTemplates)
+            {
+                delete entry.second;
+            }
+            delete mParser;
+        }
+
+        const LLMessageTemplate* getTemplate(const char* name)
+        {
+            for (auto& entry : mTemplates)
+            {
+                if (!strcmp(entry.second->mName, name))
+                {
+                    return entry.second;
+                }
+            }
+            return NULL;
+        }
+
+        // A packet of random content, with 'repeats' of each variable block
+        // and variable fields of up to 'max_variable' bytes
+        TestPacket makePacket(const LLMessageTemplate* templatep, S32 repeats, S32 max_variable)
+        {
+            TestPacket packet;
+            packet.mTemplate = templatep;
+            std::vector<U8>& data = packet.mData;
+
+            // flags, packet id and offset, then the message number
+            data.assign(LL_PACKET_ID_SIZE, 0);
+            const U32 number = templatep->mMessageNumber;
+            switch (templatep->mFrequency)
+            {
+            case MFT_HIGH:
+                data.push_back((U8)number);
+                break;
+            case MFT_MEDIUM:
+                data.push_back(255);
+                data.push_back((U8)number);
+                break;
+            default:
+                data.push_back(255);
+                data.push_back(255);
+                data.push_back((U8)(number >> 8));
+                data.push_back((U8)number);
+                break;
+            }
+
+            for (const LLMessageBlock* block : templatep->mMemberBlocks)
+            {
+                S32 count = 1;
+                if (block->mType == MBT_MULTIPLE)
+                {
+                    count = block->mNumber;
+                }
+                else if (block->mType == MBT_VARIABLE)
+                {
+                    count = repeats;
+                    data.push_back((U8)count);
+                }
+
+                packet.mValues.emplace_back(count);
+                for (S32 i = 0; i < count; ++i)
+                {
+                    for (const LLMessageVariable* var : block->mMemberVariables)
+                    {
+                        S32 size = var->getSize();
+                        if (var->getType() == MVT_VARIABLE)
+                        {
+                            const S32 length = mRandom() % (max_variable + 1);
+                            data.push_back((U8)length);
+                            if (size == 2)
+                            {
+                                data.push_back((U8)(length >> 8));
+                            }
+                            size = length;
+                        }
+                        std::vector<U8> value(size);
+                        for (U8& byte : value)
+                        {
+                            byte = (U8)mRandom();
+                        }
+                        data.insert(data.end(), value.begin(), value.end());
+                        packet.mValues.back()[i].push_back(value);
+                    }
+                }
+            }
+            return packet;
+        }
+
+        bool decode(const TestPacket& packet)
+        {
+            mReader.clearMessage();
+            return mReader.validateMessage(&packet.mData[0], (S32)packet.mData.size(), mSender)
+                   && mReader.readMessage(&packet.mData[0], mSender);
+        }
+
+        // Checks every value of the decoded message, visiting the variables
+        // backwards if 'reverse' so that lookups do not always come in
+        // template order
+        void checkValues(const TestPacket& packet, bool reverse)
+        {
+            const std::string name = packet.mTemplate->mName;
+            U8 buffer[MAX_BUFFER_SIZE];
+            S32 block_index = 0;
+            for (const LLMessageBlock* block : packet.mTemplate->mMemberBlocks)
+            {
+                const auto& repeats = packet.mValues[block_index++];
+                ensure_equals(name + " block count", mReader.getNumberOfBlocks(block->mName), (S32)repeats.size());
+                for (S32 i = 0; i < (S32)repeats.size(); ++i)
+                {
+                    const S32 count = (S32)block->mMemberVariables.size();
+                    for (S32 n = 0; n < count; ++n)
+                    {
+                        const S32 v = reverse ? count - 1 - n : n;
+                        const LLMessageVariable* var = *(block->mMemberVariables.begin() + v);
+                        const std::vector<U8>& value = repeats[i][v];
+                        const std::string desc = name + " " + block->mName + " " + var->getName();
+                        ensure_equals(desc + " size", mReader.getSize(block->mName, i, var->getName()), (S32)value.size());
+                        memset(buffer, 0xcd, sizeof(buffer));
+                        mReader.getBinaryData(block->mName, var->getName(), buffer, 0, i, sizeof(buffer));
+                        ensure(desc + " value", value.empty() || !memcmp(buffer, &value[0], value.size()));
+                    }
+                }
+            }
+        }
+    };
+
+    typedef test_group<templatemessagereader_test> templatemessagereader_t;
+    typedef templatemessagereader_t::object templatemessagereader_object_t;
+    tut::templatemessagereader_t tut_templatemessagereader("LLTemplateMessageReader");
+
+    template<> template<>
+    void templatemessagereader_object_t::test<1>()
+    {
+        // Every kind of block and variable, one message after another so
+        // that the reused storage gets checked too
+        for (const char* name : { "TestBlocks", "ObjectUpdate", "ImprovedTerseObjectUpdate" })
+        {
+            const LLMessageTemplate* templatep = getTemplate(name);
+            ensure(std::string("template ") + name, templatep != NULL);
+            for (S32 repeats : { 1, 5, 0, 2 })
+            {
+                const TestPacket packet = makePacket(templatep, repeats, 40);
+                ensure(std::string("decode ") + name, decode(packet));
+                checkValues(packet, false);
+                checkValues(packet, true);
+            }
+        }
+    }
+
+    template<> template<>
+    void templatemessagereader_object_t::test<2>()
+    {
+        // Lookups of what is not in the message
+        const LLMessageTemplate* templatep = getTemplate("TestBlocks");
+        ensure("decode", decode(makePacket(templatep, 0, 10)));
+
+        const LLMessageBlock* single = *templatep->mMemberBlocks.begin();
+        const LLMessageBlock* repeated = *(templatep->mMemberBlocks.begin() + 2);
+        const char* other_var = (*repeated->mMemberVariables.begin())->getName();
+
+        ensure_equals("missing variable block", mReader.getNumberOfBlocks(repeated->mName), 0);
+        ensure_equals("missing variable block size", mReader.getSize(repeated->mName, 0, other_var),
+                      (S32)LL_BLOCK_NOT_IN_MESSAGE);
+        ensure_equals("unknown block", mReader.getNumberOfBlocks(other_var), 0);
+        ensure_equals("variable of another block", mReader.getSize(single->mName, other_var),
+                      (S32)LL_VARIABLE_NOT_IN_BLOCK);
+    }
+
+    template<> template<>
+    void templatemessagereader_object_t::test<3>()
+    {
+        // Decodes an object update stream, reading every variable the way
+        // the handlers do. Reports the decode rate, not a pass/fail test.
+        skip_unless_benchmarking();
+        const LLMessageTemplate* full = getTemplate("ObjectUpdate");
+        const LLMessageTemplate* terse = getTemplate("ImprovedTerseObjectUpdate");
+        std::vector<TestPacket> stream;
+        for (S32 i = 0; i < 200; ++i)
+        {
+            // Terse updates are many more, and pack more objects
+            if (i % 4)
+            {
+                stream.push_back(makePacket(terse, 10 + i % 7, 60));
+            }
+            else
+            {
+                stream.push_back(makePacket(full, 2 + i % 3, 80));
+            }
+        }
+
+        const S32 REPEATS = 50;
+        S32 messages = 0;
+        LLTimer timer;
+        for (S32 repeat = 0; repeat < REPEATS; ++repeat)
+        {
+            for (const TestPacket& packet : stream)
+            {
+                messages += decode(packet);
+            }
+        }
+        const F64 seconds = timer.getElapsedTimeF64();
+        mReader.clearMessage();
+
+        ensure_equals("decoded", messages, REPEATS * (S32)stream.size());
+        LL_INFOS() << "Decoded " << messages << " object updates: "
+                   << llformat("%.0f messages/s, %.2f us per message (checksum %u)",
+                               messages / llmax(seconds, 1e-6), 1e6 * seconds / messages, sChecksum)
+                   << LL_ENDL;
+    }
+}
@@ -0,0 +1,212 @@
+/**
+ * @file patch_idct_test.cpp
+ * @brief Checks the vectorized terrain patch IDCT against the scalar one.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../patch_dct.h"
+#include "llmath.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <random>
+
+namespace tut
+{
+    // Terrain like the simulator sends: a region of patches, with hills
+    // and some noise.
+    static const S32 REGION_WIDTH = 256;
+
+    struct PatchBlock
+    {
+        LL_ALIGN_16(F32 mCoefs[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+    };
+
+    struct patch_idct_test
+    {
+        std::vector<F32> mHeights;
+        std::mt19937 mRandom;
+
+        patch_idct_test()
+        :   mHeights(REGION_WIDTH * REGION_WIDTH),
+            mRandom(4321)
+        {
+            std::uniform_real_distribution<F32> noise(-0.5f, 0.5f);
+            for (S32 j = 0; j < REGION_WIDTH; j++)
+            {
+                for (S32 i = 0; i < REGION_WIDTH; i++)
+                {
+                    mHeights[j * REGION_WIDTH + i] = 20.f + 15.f * sinf(i * 0.05f) * cosf(j * 0.03f)
+                                                     + 4.f * sinf((i + j) * 0.21f) + noise(mRandom);
+                }
+            }
+        }
+
+        // Compresses the whole region into 'size' patches, as the coefficients
+        // decompress_patch() takes, and their headers.
+        void compressRegion(S32 size, std::vector<S32>& coefs, std::vector<LLPatchHeader>& headers)
+        {
+            const S32 patches = REGION_WIDTH / size;
+            coefs.resize(patches * patches * size * size);
+            headers.resize(patches * patches);
+            init_patch_compressor(size, REGION_WIDTH, 0);
+            for (S32 py = 0; py < patches; py++)
+            {
+                for (S32 px = 0; px < patches; px++)
+                {
+                    const S32 index = py * patches + px;
+                    F32* patch = &mHeights[py * size * REGION_WIDTH + px * size];
+                    F32 zmax, zmin;
+                    prescan_patch(patch, &headers[index], zmax, zmin);
+                    compress_patch(patch, &coefs[index * size * size], &headers[index], 10);
+                }
+            }
+        }
+
+        // Coefficients in the range of the dequantized ones
+        void randomBlock(F32* block, S32 size)
+        {
+            std::uniform_int_distribution<S32> coef(-512, 512);
+            for (S32 i = 0; i < size * size; i++)
+            {
+                block[i] = (F32)coef(mRandom) * (1.f + (i % size) + (i / size));
+            }
+        }
+    };
+
+    typedef test_group<patch_idct_test> patch_idct_t;
+    typedef patch_idct_t::object patch_idct_object_t;
+    tut::patch_idct_t tut_patch_idct("patch_idct");
+
+    template<> template<>
+    void patch_idct_object_t::test<1>()
+    {
+        // Same bits as the scalar code, for both patch sizes
+        for (S32 size : { (S32)NORMAL_PATCH_SIZE, (S32)LARGE_PATCH_SIZE })
+        {
+            init_patch_decompressor(size);
+            for (S32 i = 0; i < 50; i++)
+            {
+                LL_ALIGN_16(F32 expected[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+                LL_ALIGN_16(F32 result[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+                randomBlock(expected, size);
+                memcpy(result, expected, sizeof(result));
+
+                idct_patch_scalar(expected, size);
+                idct_patch_simd(result, size);
+                ensure(llformat("idct of %dx%d patch %d", size, size, i),
+                       !memcmp(expected, result, size * size * sizeof(F32)));
+            }
+        }
+    }
+
+    template<> template<>
+    void patch_idct_object_t::test<2>()
+    {
+        // Round trip of actual terrain through the compressor
+        for (S32 size : { (S32)NORMAL_PATCH_SIZE, (S32)LARGE_PATCH_SIZE })
+        {
+            std::vector<S32> coefs;
+            std::vector<LLPatchHeader> headers;
+            compressRegion(size, coefs, headers);
+
+            LLGroupHeader group;
+            get_patch_group_header(&group);
+            init_patch_decompressor(size);
+            set_group_of_patch_header(&group);
+
+            std::vector<F32> decoded(REGION_WIDTH * REGION_WIDTH);
+            const S32 patches = REGION_WIDTH / size;
+            for (S32 py = 0; py < patches; py++)
+            {
+                for (S32 px = 0; px < patches; px++)
+                {
+                    const S32 index = py * patches + px;
+                    decompress_patch(&decoded[py * size * REGION_WIDTH + px * size], &coefs[index * size * size], &headers[index]);
+                }
+            }
+
+            F32 max_error = 0.f;
+            for (S32 i = 0; i < REGION_WIDTH * REGION_WIDTH; i++)
+            {
+                max_error = llmax(max_error, fabsf(decoded[i] - mHeights[i]));
+            }
+            ensure(llformat("%dx%d patches decoded within %f meters", size, size, max_error), max_error < 1.f);
+        }
+    }
+
+    template<> template<>
+    void patch_idct_object_t::test<3>()
+    {
+        // Timings of both versions over the coefficients of a whole region,
+        // logged for reference
+        for (S32 size : { (S32)NORMAL_PATCH_SIZE, (S32)LARGE_PATCH_SIZE })
+        {
+            std::vector<S32> coefs;
+            std::vector<LLPatchHeader> headers;
+            compressRegion(size, coefs, headers);
+            init_patch_decompressor(size);
+
+            const S32 blocks = (S32)headers.size();
+            std::vector<PatchBlock> source(blocks);
+            for (S32 b = 0; b < blocks; b++)
+            {
+                for (S32 i = 0; i < size * size; i++)
+                {
+                    source[b].mCoefs[i] = (F32)coefs[b * size * size + i] * (1.f + (i % size) + (i / size));
+                }
+            }
+
+            F64 seconds[2];
+            std::vector<PatchBlock> results[2];
+            for (S32 simd = 0; simd < 2; simd++)
+            {
+                const S32 REPEATS = 20;
+                LLTimer timer;
+                for (S32 r = 0; r < REPEATS; r++)
+                {
+                    results[simd] = source;
+                    for (PatchBlock& block : results[simd])
+                    {
+                        if (simd)
+                        {
+                            idct_patch_simd(block.mCoefs, size);
+                        }
+                        else
+                        {
+                            idct_patch_scalar(block.mCoefs, size);
+                        }
+                    }
+                }
+                seconds[simd] = timer.getElapsedTimeF64() / REPEATS;
+            }
+            LL_INFOS() << blocks << " patches of " << size << "x" << size << ": scalar " << seconds[0] * 1000.0
+                       << " ms, SIMD " << seconds[1] * 1000.0 << " ms" << LL_ENDL;
+            ensure(llformat("same %dx%d region", size, size),
+                   !memcmp(results[0].data(), results[1].data(), blocks * sizeof(PatchBlock)));
+        }
+    }
+}
@@ -0,0 +1,396 @@
+/**
+ * @file llobjectupdatedata.cpp
+ * @brief Decoded data of a compressed object update.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llobjectupdatedata.h"
+
+#include "llpartdata.h"
+#include "llprofiler.h"
+#include "llquantize.h"
+#include "llvolumemessage.h"
+
+namespace
+{
+    // Same limit as the buffer the TextureEntry of terse updates used to be
+    // copied into
+    const S32 MAX_TERSE_TE_SIZE = 1024;
+
+    // Moves past a binary data block exactly like unpackBinaryData() does,
+    // without copying it, and returns where its bytes are
+    bool skip_binary_data(LLDataPackerBinaryBuffer& dp, LLObjectUpdateData::Range& range, const char* name)
+    {
+        range = LLObjectUpdateData::Range();
+
+        const S32 start = dp.getCurrentSize();
+        S32 size = 0;
+        if (!dp.unpackS32(size, name))
+        {
+            return false;
+        }
+        if (size < 0)
+        {
+            LL_WARNS() << "Skipping binary data of invalid size " << size << " for " << name << LL_ENDL;
+            dp.shift(start);
+            return false;
+        }
+        if (size > dp.getBufferSize() - dp.getCurrentSize())
+        {
+            LL_WARNS() << "Binary data " << name << " overruns the buffer" << LL_ENDL;
+            return false;
+        }
+
+        range.mOffset = dp.getCurrentSize();
+        range.mSize = size;
+        dp.shift(range.mOffset + size);
+        return true;
+    }
+
+    // Whatever the unpacking done by the caller between the two calls used
+    // up, for the main thread to unpack again
+    S32 range_start(const LLDataPackerBinaryBuffer& dp)
+    {
+        return dp.getCurrentSize();
+    }
+
+    LLObjectUpdateData::Range range_end(const LLDataPackerBinaryBuffer& dp, S32 start)
+    {
+        LLObjectUpdateData::Range range;
+        range.mOffset = start;
+        range.mSize = dp.getCurrentSize() - start;
+        return range;
+    }
+}
+
+LLObjectUpdateData::LLObjectUpdateData()
+:   mTerse(false),
+    mLocalID(0),
+    mPCode(0),
+    mState(0),
+    mHasCollisionPlane(false),
+    mCRC(0),
+    mMaterial(0),
+    mClickAction(0),
+    mHasScale(false),
+    mSpecialCode(0),
+    mHasParentID(false),
+    mParentID(0),
+    mGenericDataSize(0),
+    mSoundGain(0.f),
+    mSoundFlags(0),
+    mSoundRadius(0.f),
+    mHasVolume(false),
+    mVolumeParamsValid(false),
+    mHasTextureEntry(false),
+    mTextureEntryValid(false)
+{
+}
+
+void LLObjectUpdateData::unpack(const U8* data, S32 size, bool terse)
+{
+    mData.assign(data, data + llmax(size, 0));
+    unpack(terse);
+}
+
+void LLObjectUpdateData::unpack(bool terse, bool header_only)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    // Back to the defaults the fields had as locals of processUpdateMessage()
+    mTerse = terse;
+    mFullID.setNull();
+    mLocalID = 0;
+    mPCode = 0;
+    mState = 0;
+    mPosition.clear();
+    mRotation = LLQuaternion::DEFAULT;
+    mAngularVelocity.clear();
+    mHasCollisionPlane = false;
+    mVelocity.clear();
+    mAcceleration.clear();
+    mCRC = 0;
+    mMaterial = 0;
+    mClickAction = 0;
+    mHasScale = false;
+    mSpecialCode = 0;
+    mOwnerID.setNull();
+    mHasParentID = false;
+    mParentID = 0;
+    mGenericDataSize = 0;
+    mGenericData = Range();
+    mText.clear();
+    mTextColor.setToBlack();
+    mMediaURL.clear();
+    mLegacyParticles = Range();
+    mExtraParams.clear();
+    mSoundID.setNull();
+    mSoundGain = 0.f;
+    mSoundFlags = 0;
+    mSoundRadius = 0.f;
+    mNameValues.clear();
+    mHasVolume = false;
+    mVolumeParamsValid = false;
+    mVolumeParams = LLVolumeParams();
+    mHasTextureEntry = false;
+    mTextureEntryValid = false;
+    mTextureAnim = Range();
+    mParticles = Range();
+
+    LLDataPackerBinaryBuffer dp = getDataPacker();
+
+    if (terse)
+    {
+        dp.unpackU32(mLocalID, "LocalID");
+        if (!header_only)
+        {
+            unpackTerse(dp);
+        }
+    }
+    else
+    {
+        dp.unpackUUID(mFullID, "ID");
+        dp.unpackU32(mLocalID, "LocalID");
+        dp.unpackU8(mPCode, "PCode");
+        if (header_only)
+        {
+            return;
+        }
+        unpackFull(dp);
+        if (mPCode == LL_PCODE_VOLUME)
+        {
+            unpackVolume(dp);
+        }
+    }
+}
+
+void LLObjectUpdateData::unpackTerse(LLDataPackerBinaryBuffer& dp)
+{
+    U16 val[4] = { 0, 0, 0, 0 };
+
+    dp.unpackU8(mState, "State");
+
+    U8 value = 0;
+    dp.unpackU8(value, "agent");
+    if (value)
+    {
+        mHasCollisionPlane = true;
+        dp.unpackVector4(mCollisionPlane, "Plane");
+    }
+    dp.unpackVector3(mPosition, "Pos");
+    dp.unpackU16(val[VX], "VelX");
+    dp.unpackU16(val[VY], "VelY");
+    dp.unpackU16(val[VZ], "VelZ");
+    mVelocity.set(U16_to_F32(val[VX], -128.f, 128.f),
+                  U16_to_F32(val[VY], -128.f, 128.f),
+                  U16_to_F32(val[VZ], -128.f, 128.f));
+    dp.unpackU16(val[VX], "AccX");
+    dp.unpackU16(val[VY], "AccY");
+    dp.unpackU16(val[VZ], "AccZ");
+    mAcceleration.set(U16_to_F32(val[VX], -64.f, 64.f),
+                      U16_to_F32(val[VY], -64.f, 64.f),
+                      U16_to_F32(val[VZ], -64.f, 64.f));
+
+    dp.unpackU16(val[VX], "ThetaX");
+    dp.unpackU16(val[VY], "ThetaY");
+    dp.unpackU16(val[VZ], "ThetaZ");
+    dp.unpackU16(val[VS], "ThetaS");
+    mRotation.mQ[VX] = U16_to_F32(val[VX], -1.f, 1.f);
+    mRotation.mQ[VY] = U16_to_F32(val[VY], -1.f, 1.f);
+    mRotation.mQ[VZ] = U16_to_F32(val[VZ], -1.f, 1.f);
+    mRotation.mQ[VS] = U16_to_F32(val[VS], -1.f, 1.f);
+    dp.unpackU16(val[VX], "AccX");
+    dp.unpackU16(val[VY], "AccY");
+    dp.unpackU16(val[VZ], "AccZ");
+    mAngularVelocity.set(U16_to_F32(val[VX], -64.f, 64.f),
+                         U16_to_F32(val[VY], -64.f, 64.f),
+                         U16_to_F32(val[VZ], -64.f, 64.f));
+}
+
+void LLObjectUpdateData::unpackFull(LLDataPackerBinaryBuffer& dp)
+{
+    dp.unpackU8(mState, "State");
+    dp.unpackU32(mCRC, "CRC");
+    dp.unpackU8(mMaterial, "Material");
+    dp.unpackU8(mClickAction, "ClickAction");
+    mHasScale = dp.unpackVector3(mScale, "Scale");
+    dp.unpackVector3(mPosition, "Pos");
+    LLVector3 vec;
+    dp.unpackVector3(vec, "Rot");
+    mRotation.unpackFromVector3(vec);
+
+    dp.unpackU32(mSpecialCode, "SpecialCode");
+    dp.unpackUUID(mOwnerID, "Owner");
+
+    if (mSpecialCode & 0x80)
+    {
+        dp.unpackVector3(mAngularVelocity, "Omega");
+    }
+
+    if (mSpecialCode & 0x20)
+    {
+        mHasParentID = dp.unpackU32(mParentID, "ParentID");
+    }
+
+    if (mSpecialCode & 0x2)
+    {
+        mGenericDataSize = 1;
+        const S32 start = range_start(dp);
+        U8 tree_data;
+        dp.unpackU8(tree_data, "TreeData");
+        mGenericData = range_end(dp, start);
+    }
+    else if (mSpecialCode & 0x1)
+    {
+        dp.unpackU32(mGenericDataSize, "ScratchPadSize");
+        skip_binary_data(dp, mGenericData, "PartData");
+    }
+
+    if (mSpecialCode & 0x4)
+    {
+        dp.unpackString(mText, "Text");
+        dp.unpackBinaryDataFixed(mTextColor.mV, 4, "Color");
+    }
+
+    if (mSpecialCode & 0x200)
+    {
+        dp.unpackString(mMediaURL, "MediaURL");
+    }
+
+    if (mSpecialCode & 0x8)
+    {
+        const S32 start = range_start(dp);
+        LLPartSysData part_sys_data;
+        part_sys_data.unpackLegacy(dp);
+        mLegacyParticles = range_end(dp, start);
+    }
+
+    U8 num_parameters = 0;
+    dp.unpackU8(num_parameters, "num_params");
+    for (U8 param = 0; param < num_parameters; ++param)
+    {
+        ExtraParam extra_param;
+        extra_param.mType = 0;
+        dp.unpackU16(extra_param.mType, "param_type");
+        skip_binary_data(dp, extra_param.mData, "param_data");
+        mExtraParams.push_back(extra_param);
+    }
+
+    if (mSpecialCode & 0x10)
+    {
+        dp.unpackUUID(mSoundID, "SoundUUID");
+        dp.unpackF32(mSoundGain, "SoundGain");
+        dp.unpackU8(mSoundFlags, "SoundFlags");
+        dp.unpackF32(mSoundRadius, "SoundRadius");
+    }
+
+    if (mSpecialCode & 0x100)
+    {
+        dp.unpackString(mNameValues, "NV");
+    }
+}
+
+void LLObjectUpdateData::unpackVolume(LLDataPackerBinaryBuffer& dp)
+{
+    mHasVolume = true;
+    mVolumeParamsValid = LLVolumeMessage::unpackVolumeParams(&mVolumeParams, dp);
+
+    unpackTextureEntry(dp);
+
+    if (mSpecialCode & 0x40)
+    {
+        // LLTextureAnim::unpackTAMessage() reads the whole block
+        const S32 start = range_start(dp);
+        Range block;
+        skip_binary_data(dp, block, "TextureAnimation");
+        mTextureAnim = range_end(dp, start);
+    }
+
+    if (mSpecialCode & 0x400)
+    {
+        const S32 start = range_start(dp);
+        LLPartSysData part_sys_data;
+        part_sys_data.unpack(dp);
+        mParticles = range_end(dp, start);
+    }
+}
+
+void LLObjectUpdateData::unpackTerseTextureEntry(const U8* data, S32 size)
+{
+    size = llmin(size, MAX_TERSE_TE_SIZE);
+    if (size <= 0)
+    {
+        mHasTextureEntry = false;
+        return;
+    }
+
+    // Kept after the update data, which the ranges point into
+    const S32 start = (S32)mData.size();
+    mData.insert(mData.end(), data, data + size);
+
+    Range range;
+    range.mOffset = start;
+    range.mSize = size;
+    LLDataPackerBinaryBuffer dp = getDataPacker(range);
+    unpackTextureEntry(dp);
+}
+
+void LLObjectUpdateData::unpackTextureEntry(LLDataPackerBinaryBuffer& dp)
+{
+    if (!mTextureEntry)
+    {
+        mTextureEntry.reset(new LLTEContents);
+    }
+    mHasTextureEntry = true;
+
+    // Relative to the packer, which may not start at mData
+    Range range;
+    mTextureEntryValid = skip_binary_data(dp, range, "TextureEntry");
+    if (!mTextureEntryValid)
+    {
+        LL_WARNS() << "Bad texture entry block!  Abort!" << LL_ENDL;
+        mTextureEntry->face_count = 0;
+        return;
+    }
+
+    LLPrimitive::parseTEData(dp.getBuffer() + range.mOffset, range.mSize, *mTextureEntry);
+}
+
+LLDataPackerBinaryBuffer LLObjectUpdateData::getDataPacker(const Range& range) const
+{
+    if (range.mSize <= 0 || range.mOffset < 0 || range.mOffset + range.mSize > (S32)mData.size())
+    {
+        return LLDataPackerBinaryBuffer(NULL, 0);
+    }
+    // Only ever unpacked from
+    return LLDataPackerBinaryBuffer(const_cast<U8*>(mData.data()) + range.mOffset, range.mSize);
+}
+
+LLDataPackerBinaryBuffer LLObjectUpdateData::getDataPacker() const
+{
+    Range range;
+    range.mSize = (S32)mData.size();
+    return getDataPacker(range);
+}
@@ -0,0 +1,153 @@
+/**
+ * @file llobjectupdatedata.h
+ * @brief Decoded data of a compressed object update.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTUPDATEDATA_H
+#define LL_LLOBJECTUPDATEDATA_H
+
+#include "lldatapacker.h"
+#include "llprimitive.h"
+#include "lluuid.h"
+#include "v3math.h"
+#include "v4color.h"
+#include "v4coloru.h"
+#include "v4math.h"
+#include "llquaternion.h"
+
+#include <memory>
+#include <vector>
+
+//
+// The Data field of an ObjectUpdateCompressed or ImprovedTerseObjectUpdate
+// block (or a cached object), unpacked into plain values.
+//
+// unpack() only depends on the bytes, so that updates can be decoded on a
+// worker thread and applied by LLViewerObject::processUpdateMessage() on the
+// main thread. It makes the very same LLDataPacker calls in the same order
+// as that code did, so malformed data is read the same way.
+//
+// The particle systems, texture animation and extra parameters are left as
+// ranges of the data, which the main thread hands to the usual unpack code.
+//
+class LLObjectUpdateData
+{
+public:
+    // Part of mData, empty when the field is absent
+    struct Range
+    {
+        Range() : mOffset(0), mSize(0) {}
+
+        S32 mOffset;
+        S32 mSize;
+    };
+
+    struct ExtraParam
+    {
+        U16 mType;
+        Range mData;
+    };
+
+    LLObjectUpdateData();
+
+    // Decodes mData, which starts with the LocalID for terse updates and
+    // with the ID, LocalID and PCode for full ones. Volumes are decoded up
+    // to their particle system.
+    void unpack(bool terse, bool header_only = false);
+    // Copies 'size' bytes of update data into mData and decodes them
+    void unpack(const U8* data, S32 size, bool terse);
+
+    // Copies and decodes the TextureEntry field sent along with a terse
+    // update, which holds a binary data block
+    void unpackTerseTextureEntry(const U8* data, S32 size);
+
+    // Packer over a range of mData, or over all of it (for logging and
+    // caching). Unpacking through it leaves the data alone.
+    LLDataPackerBinaryBuffer getDataPacker(const Range& range) const;
+    LLDataPackerBinaryBuffer getDataPacker() const;
+
+    std::vector<U8> mData;
+
+    bool mTerse;
+
+    // Header, only the LocalID for terse updates
+    LLUUID mFullID;
+    U32 mLocalID;
+    LLPCode mPCode;
+
+    U8 mState;
+    LLVector3 mPosition;
+    LLQuaternion mRotation;
+    LLVector3 mAngularVelocity;
+
+    // Terse updates
+    bool mHasCollisionPlane;
+    LLVector4 mCollisionPlane;
+    LLVector3 mVelocity;
+    LLVector3 mAcceleration;
+
+    // Full updates. mSpecialCode tells which of the optional fields follow.
+    U32 mCRC;
+    U8 mMaterial;
+    U8 mClickAction;
+    bool mHasScale;
+    LLVector3 mScale;
+    U32 mSpecialCode;
+    LLUUID mOwnerID;
+    bool mHasParentID;
+    U32 mParentID;
+    // Tree data or scratch pad, of mGenericDataSize bytes once allocated
+    U32 mGenericDataSize;
+    Range mGenericData;
+    std::string mText;
+    LLColor4U mTextColor;
+    std::string mMediaURL;
+    Range mLegacyParticles;
+    std::vector<ExtraParam> mExtraParams;
+    LLUUID mSoundID;
+    F32 mSoundGain;
+    U8 mSoundFlags;
+    F32 mSoundRadius;
+    std::string mNameValues;
+
+    // Volumes, after the above in full updates
+    bool mHasVolume;
+    bool mVolumeParamsValid;
+    LLVolumeParams mVolumeParams;
+    // Also set by unpackTerseTextureEntry()
+    bool mHasTextureEntry;
+    bool mTextureEntryValid;
+    std::unique_ptr<LLTEContents> mTextureEntry;
+    Range mTextureAnim;
+    Range mParticles;
+
+private:
+    void unpackFull(LLDataPackerBinaryBuffer& dp);
+    void unpackTerse(LLDataPackerBinaryBuffer& dp);
+    void unpackVolume(LLDataPackerBinaryBuffer& dp);
+    // Parses the TextureEntry binary data block at the current position
+    void unpackTextureEntry(LLDataPackerBinaryBuffer& dp);
+};
+
+#endif // LL_LLOBJECTUPDATEDATA_H
@@ -1368,13 +1368,56 @@ bool LLPrimitive::packTEMessage(LLDataPacker &dp) const
     return true;
 }
 
-S32 LLPrimitive::parseTEMessage(LLMessageSystem* mesgsys, char const* block_name, const S32 block_num, LLTEContents& tec)
+namespace
 {
-    S32 retval = 0;
-    // temp buffer for material ID processing
-    // data will end up in tec.material_id[]
-    material_id_type material_data[LLTEContents::MAX_TES];
+    // Parses the tec.size bytes in tec.packed_buffer, followed by room for
+    // the terminating zero, for tec.face_count faces
+    bool parse_TEContents(LLTEContents& tec)
+    {
+        // temp buffer for material ID processing
+        // data will end up in tec.material_id[]
+        material_id_type material_data[LLTEContents::MAX_TES];
+
+        // The last field is not zero terminated.
+        // Rather than special case the upack functions.  Just make it 0x00 terminated.
+        tec.packed_buffer[tec.size] = 0x00;
+        ++tec.size;
+
+        U8 *cur_ptr = tec.packed_buffer;
+        LL_DEBUGS("TEXTUREENTRY") << "Texture Entry with buffere sized: " << tec.size << LL_ENDL;
+        U8 *buffer_end = tec.packed_buffer + tec.size;
+
+        if (!(  unpack_TEField<LLUUID>(tec.image_data, tec.face_count, cur_ptr, buffer_end, MVT_LLUUID) &&
+                unpack_TEField<LLColor4U>(tec.colors, tec.face_count, cur_ptr, buffer_end, MVT_U8) &&
+                unpack_TEField<F32>(tec.scale_s, tec.face_count, cur_ptr, buffer_end, MVT_F32) &&
+                unpack_TEField<F32>(tec.scale_t, tec.face_count, cur_ptr, buffer_end, MVT_F32) &&
+                unpack_TEField<S16>(tec.offset_s, tec.face_count, cur_ptr, buffer_end, MVT_S16) &&
+                unpack_TEField<S16>(tec.offset_t, tec.face_count, cur_ptr, buffer_end, MVT_S16) &&
+                unpack_TEField<S16>(tec.image_rot, tec.face_count, cur_ptr, buffer_end, MVT_S16) &&
+                unpack_TEField<U8>(tec.bump, tec.face_count, cur_ptr, buffer_end, MVT_U8) &&
+                unpack_TEField<U8>(tec.media_flags, tec.face_count, cur_ptr, buffer_end, MVT_U8) &&
+                unpack_TEField<U8>(tec.glow, tec.face_count, cur_ptr, buffer_end, MVT_U8)))
+        {
+            LL_WARNS("TEXTUREENTRY") << "Failure parsing Texture Entry Message due to malformed TE Field! Dropping changes on the floor. " << LL_ENDL;
+            return false;
+        }
 
+        if (cur_ptr >= buffer_end || !unpack_TEField<material_id_type>(material_data, tec.face_count, cur_ptr, buffer_end, MVT_LLUUID))
+        {
+            memset((void*)material_data, 0, sizeof(material_data));
+        }
+
+        for (U32 i = 0; i < tec.face_count; i++)
+        {
+            tec.material_ids[i].set(&(material_data[i]));
+        }
+
+        return true;
+    }
+}
+
+S32 LLPrimitive::parseTEMessage(LLMessageSystem* mesgsys, char const* block_name, const S32 block_num, LLTEContents& tec)
+{
     if (block_num < 0)
     {
         tec.size = mesgsys->getSizeFast(block_name, _PREHASH_TextureEntry);
@@ -1387,7 +1430,7 @@ S32 LLPrimitive::parseTEMessage(LLMessageSystem* mesgsys, char const* block_name
     if (tec.size == 0)
     {
         tec.face_count = 0;
-        return retval;
+        return 0;
     }
     else if (tec.size >= LLTEContents::MAX_TE_BUFFER)
     {
@@ -1398,52 +1441,48 @@ S32 LLPrimitive::parseTEMessage(LLMessageSystem* mesgsys, char const* block_name
     // if block_num < 0 ask for block 0
     mesgsys->getBinaryDataFast(block_name, _PREHASH_TextureEntry, tec.packed_buffer, 0, std::max(block_num, 0), LLTEContents::MAX_TE_BUFFER - 1);
 
-    // The last field is not zero terminated.
-    // Rather than special case the upack functions.  Just make it 0x00 terminated.
-    tec.packed_buffer[tec.size] = 0x00;
-    ++tec.size;
-
     tec.face_count = llmin((U32)getNumTEs(),(U32)LLTEContents::MAX_TES);
 
-    U8 *cur_ptr = tec.packed_buffer;
-    LL_DEBUGS("TEXTUREENTRY") << "Texture Entry with buffere sized: " << tec.size << LL_ENDL;
-    U8 *buffer_end = tec.packed_buffer + tec.size;
-
-    if (!(  unpack_TEField<LLUUID>(tec.image_data, tec.face_count, cur_ptr, buffer_end, MVT_LLUUID) &&
-            unpack_TEField<LLColor4U>(tec.colors, tec.face_count, cur_ptr, buffer_end, MVT_U8) &&
-            unpack_TEField<F32>(tec.scale_s, tec.face_count, cur_ptr, buffer_end, MVT_F32) &&
-            unpack_TEField<F32>(tec.scale_t, tec.face_count, cur_ptr, buffer_end, MVT_F32) &&
-            unpack_TEField<S16>(tec.offset_s, tec.face_count, cur_ptr, buffer_end, MVT_S16) &&
-            unpack_TEField<S16>(tec.offset_t, tec.face_count, cur_ptr, buffer_end, MVT_S16) &&
-            unpack_TEField<S16>(tec.image_rot, tec.face_count, cur_ptr, buffer_end, MVT_S16) &&
-            unpack_TEField<U8>(tec.bump, tec.face_count, cur_ptr, buffer_end, MVT_U8) &&
-            unpack_TEField<U8>(tec.media_flags, tec.face_count, cur_ptr, buffer_end, MVT_U8) &&
-            unpack_TEField<U8>(tec.glow, tec.face_count, cur_ptr, buffer_end, MVT_U8)))
-    {
-        LL_WARNS("TEXTUREENTRY") << "Failure parsing Texture Entry Message due to malformed TE Field! Dropping changes on the floor. " << LL_ENDL;
-        return 0;
-    }
+    return parse_TEContents(tec) ? 1 : 0;
+}
 
-    if (cur_ptr >= buffer_end || !unpack_TEField<material_id_type>(material_data, tec.face_count, cur_ptr, buffer_end, MVT_LLUUID))
+// static
+bool LLPrimitive::parseTEData(const U8* data, S32 size, LLTEContents& tec)
+{
+    tec.face_count = 0;
+    if (size <= 0)
     {
-        memset((void*)material_data, 0, sizeof(material_data));
+        tec.size = 0;
+        return true;
     }
-
-    for (U32 i = 0; i < tec.face_count; i++)
+    else if (size >= (S32)LLTEContents::MAX_TE_BUFFER)
     {
-        tec.material_ids[i].set(&(material_data[i]));
+        LL_WARNS("TEXTUREENTRY") << "Excessive buffer size detected in Texture Entry! Truncating." << LL_ENDL;
+        size = LLTEContents::MAX_TE_BUFFER - 1;
     }
+    memcpy(tec.packed_buffer, data, size);
+    tec.size = size;
 
-    retval = 1;
-    return retval;
+    // All the faces, applyParsedTEMessage() only uses those the primitive has
+    tec.face_count = LLTEContents::MAX_TES;
+
+    if (!parse_TEContents(tec))
+    {
+        tec.face_count = 0;
+        return false;
     }
+    return true;
+}
 
 S32 LLPrimitive::applyParsedTEMessage(LLTEContents& tec)
 {
     S32 retval = 0;
 
+    // parseTEData() parses more faces than the primitive may have
+    const U32 face_count = llmin(tec.face_count, (U32)getNumTEs());
+
     LLColor4 color;
-    for (U32 i = 0; i < tec.face_count; i++)
+    for (U32 i = 0; i < face_count; i++)
     {
         LLUUID& req_id = ((LLUUID*)tec.image_data)[i];
         retval |= setTETexture(i, req_id);
@@ -501,6 +501,11 @@ public:
     S32 unpackTEMessage(LLMessageSystem* mesgsys, char const* block_name, const S32 block_num); // Variable num of blocks
     S32 unpackTEMessage(LLDataPacker &dp);
     S32 parseTEMessage(LLMessageSystem* mesgsys, char const* block_name, const S32 block_num, LLTEContents& tec);
+    // Parses a TextureEntry field for LLTEContents::MAX_TES faces, whatever
+    // the number of faces of the primitive it is then applied to. It does not
+    // depend on any primitive, so that it can be done off the main thread.
+    // Returns false when the data is malformed, leaving no face to apply.
+    static bool parseTEData(const U8* data, S32 size, LLTEContents& tec);
     S32 applyParsedTEMessage(LLTEContents& tec);
 
 #ifdef CHECK_FOR_FINITE
@@ -0,0 +1,297 @@
+/**
+ * @file llobjectupdatedata_test.cpp
+ * @brief Tests and benchmark of the LLObjectUpdateData decoder.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llobjectupdatedata.h"
+
+#include "lltimer.h"
+#include "llvolumemessage.h"
+
+#include "../test/lltut.h"
+
+#include <ctime>
+#include <thread>
+
+namespace tut
+{
+    struct objectupdatedata_test
+    {
+        enum { BUFFER_SIZE = 2048 };
+
+        objectupdatedata_test()
+        {
+            mVolumeParams.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+
+            mPrim.setNumTEs(3);
+            mPrim.setTETexture(0, LLUUID("e3d0a8b6-4e60-4ea4-b2a2-5e7a0d5f1c01"));
+            mPrim.setTETexture(1, LLUUID("e3d0a8b6-4e60-4ea4-b2a2-5e7a0d5f1c02"));
+            mPrim.setTETexture(2, LLUUID("e3d0a8b6-4e60-4ea4-b2a2-5e7a0d5f1c02"));
+            mPrim.setTEColor(1, LLColor4(1.f, 0.f, 0.f, 1.f));
+            mPrim.setTEScale(2, 2.f, 0.5f);
+            mPrim.setTEGlow(2, 0.25f);
+        }
+
+        // A full compressed update laid out like the simulator sends it
+        S32 packFull(U8* buffer, LLPCode pcode, U32 local_id)
+        {
+            LLDataPackerBinaryBuffer dp(buffer, BUFFER_SIZE);
+            dp.packUUID(LLUUID("0c3f4b8e-6a1d-4c5e-9f2b-7d8e9a0b1c2d"), "ID");
+            dp.packU32(local_id, "LocalID");
+            dp.packU8(pcode, "PCode");
+            dp.packU8(3, "State");
+            dp.packU32(0xdeadbeef, "CRC");
+            dp.packU8(2, "Material");
+            dp.packU8(1, "ClickAction");
+            dp.packVector3(LLVector3(1.f, 2.f, 3.f), "Scale");
+            dp.packVector3(LLVector3(128.f, 64.f, 25.f), "Pos");
+            dp.packVector3(LLVector3::zero, "Rot");
+
+            // Omega, parent, scratch pad, text, media URL, sound, name
+            // values and, for volumes, texture animation
+            U32 special_code = 0x80 | 0x20 | 0x1 | 0x4 | 0x200 | 0x10 | 0x100;
+            if (pcode == LL_PCODE_VOLUME)
+            {
+                special_code |= 0x40;
+            }
+            dp.packU32(special_code, "SpecialCode");
+            dp.packUUID(LLUUID("a1b2c3d4-0000-4000-8000-000000000001"), "Owner");
+            dp.packVector3(LLVector3(0.f, 0.f, 1.f), "Omega");
+            dp.packU32(42, "ParentID");
+
+            const U8 scratch_pad[] = { 1, 2, 3, 4, 5 };
+            dp.packU32(sizeof(scratch_pad), "ScratchPadSize");
+            dp.packBinaryData(scratch_pad, sizeof(scratch_pad), "PartData");
+
+            dp.packString("Hello", "Text");
+            const U8 color[4] = { 10, 20, 30, 40 };
+            dp.packBinaryDataFixed(color, 4, "Color");
+            dp.packString("http://example.com/", "MediaURL");
+
+            // Two extra parameters
+            const U8 param[] = { 9, 8, 7 };
+            dp.packU8(2, "num_params");
+            dp.packU16(0x10, "param_type");
+            dp.packBinaryData(param, sizeof(param), "param_data");
+            dp.packU16(0x20, "param_type");
+            dp.packBinaryData(param, 1, "param_data");
+
+            dp.packUUID(LLUUID("a1b2c3d4-0000-4000-8000-000000000002"), "SoundUUID");
+            dp.packF32(0.5f, "SoundGain");
+            dp.packU8(4, "SoundFlags");
+            dp.packF32(10.f, "SoundRadius");
+            dp.packString("Attachment STRING RW SV 1", "NV");
+
+            if (pcode == LL_PCODE_VOLUME)
+            {
+                LLVolumeMessage::packVolumeParams(&mVolumeParams, dp);
+                mPrim.packTEMessage(dp);
+                const U8 anim[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+                dp.packBinaryData(anim, sizeof(anim), "TextureAnimation");
+            }
+            return dp.getCurrentSize();
+        }
+
+        S32 packTerse(U8* buffer, U32 local_id)
+        {
+            LLDataPackerBinaryBuffer dp(buffer, BUFFER_SIZE);
+            dp.packU32(local_id, "LocalID");
+            dp.packU8(0, "State");
+            dp.packU8(1, "agent");
+            dp.packVector4(LLVector4(0.f, 0.f, 1.f, 20.f), "Plane");
+            dp.packVector3(LLVector3(10.f, 20.f, 30.f), "Pos");
+            for (S32 i = 0; i < 13; ++i)
+            {
+                dp.packU16(U16_MAX / 2, "Vel/Acc/Theta");
+            }
+            return dp.getCurrentSize();
+        }
+
+        LLVolumeParams mVolumeParams;
+        LLPrimitive mPrim;
+    };
+
+    typedef test_group<objectupdatedata_test> objectupdatedata_t;
+    typedef objectupdatedata_t::object objectupdatedata_object_t;
+    tut::objectupdatedata_t tut_objectupdatedata("LLObjectUpdateData");
+
+    template<> template<>
+    void objectupdatedata_object_t::test<1>()
+    {
+        U8 buffer[BUFFER_SIZE];
+        const S32 size = packTerse(buffer, 1234);
+
+        LLObjectUpdateData update;
+        update.unpack(buffer, size, true);
+        ensure("terse", update.mTerse);
+        ensure_equals("local id", update.mLocalID, 1234U);
+        ensure("collision plane", update.mHasCollisionPlane);
+        ensure_equals("plane distance", update.mCollisionPlane.mV[VW], 20.f);
+        ensure_equals("position", update.mPosition, LLVector3(10.f, 20.f, 30.f));
+        ensure("no texture entry", !update.mHasTextureEntry);
+
+        // The TextureEntry field of the message
+        U8 te_buffer[BUFFER_SIZE];
+        LLDataPackerBinaryBuffer te_dp(te_buffer, BUFFER_SIZE);
+        mPrim.packTEMessage(te_dp);
+        update.unpackTerseTextureEntry(te_buffer, te_dp.getCurrentSize());
+        ensure("texture entry", update.mHasTextureEntry && update.mTextureEntryValid);
+        ensure_equals("face count", update.mTextureEntry->face_count, (U32)LLTEContents::MAX_TES);
+        ensure_equals("texture", update.mTextureEntry->image_data[1], mPrim.getTE(1)->getID());
+        ensure_equals("data kept", update.mLocalID, 1234U);
+    }
+
+    template<> template<>
+    void objectupdatedata_object_t::test<2>()
+    {
+        U8 buffer[BUFFER_SIZE];
+        const S32 size = packFull(buffer, LL_PCODE_LEGACY_GRASS, 77);
+
+        LLObjectUpdateData update;
+        update.unpack(buffer, size, false);
+        ensure("full", !update.mTerse);
+        ensure_equals("local id", update.mLocalID, 77U);
+        ensure_equals("pcode", update.mPCode, LL_PCODE_LEGACY_GRASS);
+        ensure_equals("state", update.mState, 3);
+        ensure_equals("crc", update.mCRC, 0xdeadbeef);
+        ensure("scale", update.mHasScale);
+        ensure_equals("scale value", update.mScale, LLVector3(1.f, 2.f, 3.f));
+        ensure_equals("angular velocity", update.mAngularVelocity, LLVector3(0.f, 0.f, 1.f));
+        ensure("parent", update.mHasParentID);
+        ensure_equals("parent id", update.mParentID, 42U);
+        ensure_equals("scratch pad size", update.mGenericDataSize, 5U);
+        ensure_equals("scratch pad range", update.mGenericData.mSize, 5);
+        ensure_equals("scratch pad data", update.mData[update.mGenericData.mOffset + 4], 5);
+        ensure_equals("text", update.mText, "Hello");
+        ensure_equals("text alpha", update.mTextColor.mV[3], 40);
+        ensure_equals("media url", update.mMediaURL, "http://example.com/");
+        ensure_equals("extra params", update.mExtraParams.size(), 2);
+        ensure_equals("param type", update.mExtraParams[1].mType, 0x20);
+        ensure_equals("param size", update.mExtraParams[0].mData.mSize, 3);
+        ensure_equals("sound radius", update.mSoundRadius, 10.f);
+        ensure_equals("name values", update.mNameValues, "Attachment STRING RW SV 1");
+        ensure("not a volume", !update.mHasVolume);
+
+        // What follows the header is left alone
+        update.unpack(false, true);
+        ensure_equals("header local id", update.mLocalID, 77U);
+        ensure("header only", update.mText.empty());
+
+        // The extra parameters are copied before unpacking
+        LLDataPackerBinaryBuffer param_dp = update.getDataPacker(update.mExtraParams[0].mData);
+        U8 value = 0;
+        param_dp.unpackU8(value, "value");
+        ensure_equals("param data", value, 9);
+    }
+
+    template<> template<>
+    void objectupdatedata_object_t::test<3>()
+    {
+        U8 buffer[BUFFER_SIZE];
+        const S32 size = packFull(buffer, LL_PCODE_VOLUME, 78);
+
+        LLObjectUpdateData update;
+        update.unpack(buffer, size, false);
+        ensure("volume", update.mHasVolume);
+        ensure("volume params", update.mVolumeParamsValid);
+        ensure("same volume", update.mVolumeParams == mVolumeParams);
+        ensure("texture entry", update.mHasTextureEntry && update.mTextureEntryValid);
+        ensure_equals("texture anim", update.mTextureAnim.mSize, 4 + 8);
+        ensure_equals("whole update read", update.mTextureAnim.mOffset + update.mTextureAnim.mSize, size);
+
+        // The texture entry applies like unpackTEMessage() does
+        U8 te_buffer[BUFFER_SIZE];
+        LLDataPackerBinaryBuffer te_dp(te_buffer, BUFFER_SIZE);
+        mPrim.packTEMessage(te_dp);
+        te_dp.reset();
+        LLPrimitive unpacked;
+        unpacked.setNumTEs(3);
+        ensure("unpacked", unpacked.unpackTEMessage(te_dp) != TEM_INVALID);
+
+        LLPrimitive prim;
+        prim.setNumTEs(3);
+        ensure("applied", prim.applyParsedTEMessage(*update.mTextureEntry) != TEM_INVALID);
+        for (U8 face = 0; face < 3; ++face)
+        {
+            ensure("same face", *prim.getTE(face) == *unpacked.getTE(face));
+        }
+        ensure_equals("texture", prim.getTE(2)->getID(), mPrim.getTE(2)->getID());
+
+        // Truncated texture entry
+        update.unpack(buffer, size - 20, false);
+        ensure("volume params still read", update.mVolumeParamsValid);
+        ensure("bad texture entry", !update.mTextureEntryValid);
+    }
+
+    template<> template<>
+    void objectupdatedata_object_t::test<4>()
+    {
+        // Decodes a stream of volume updates on the calling thread and split
+        // across threads, the way the jobs pool does it, reporting objects/ms.
+        // Not a pass/fail test.
+        skip_unless_benchmarking();
+        const S32 OBJECTS = 20000;
+        U8 buffer[BUFFER_SIZE];
+        const S32 size = packFull(buffer, LL_PCODE_VOLUME, 1);
+
+        std::vector<LLObjectUpdateData> updates(OBJECTS);
+        for (LLObjectUpdateData& update : updates)
+        {
+            update.mData.assign(buffer, buffer + size);
+        }
+
+        const S32 max_threads = (S32)llclamp(std::thread::hardware_concurrency(), 1U, 4U);
+        for (S32 threads = 1; threads <= max_threads; threads *= 2)
+        {
+            LLTimer timer;
+            std::vector<std::thread> workers;
+            for (S32 i = 1; i < threads; ++i)
+            {
+                workers.emplace_back([&updates, i, threads]()
+                    {
+                        for (size_t j = i; j < updates.size(); j += threads)
+                        {
+                            updates[j].unpack(false);
+                        }
+                    });
+            }
+            for (size_t j = 0; j < updates.size(); j += threads)
+            {
+                updates[j].unpack(false);
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+            const F64 seconds = timer.getElapsedTimeF64();
+
+            ensure_equals("last decoded", updates.back().mTextureAnim.mSize, 4 + 8);
+            LL_INFOS() << threads << " thread(s): "
+                       << llformat("%.0f objects/ms", OBJECTS / llmax(seconds * 1000.0, 1e-6))
+                       << LL_ENDL;
+        }
+    }
+}
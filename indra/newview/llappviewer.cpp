@@ -165,6 +165,7 @@
 #include "lllfsthread.h"
 #include "llworkerthread.h"
 #include "lltexturecache.h"
+#include "lldecodedtexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
 #include "llevents.h"
@@ -630,6 +631,7 @@ bool LLAppViewer::sendURLToOtherInstance(const std::string& url)
 LLAppViewer* LLAppViewer::sInstance = NULL;
 LLTextureCache* LLAppViewer::sTextureCache = NULL;
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL;
+LLDecodedTextureCache* LLAppViewer::sDecodedTextureCache = NULL;
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL;
 LLPurgeDiskCacheThread* LLAppViewer::sPurgeDiskCacheThread = NULL;
 
@@ -644,6 +646,7 @@ LLAppViewer::LLAppViewer()
     mReportedCrash(false),
     mNumSessions(0),
     mGeneralThreadPool(nullptr),
+    mJobsThreadPool(nullptr),
     mPurgeCache(false),
     mPurgeCacheOnExit(false),
     mPurgeUserDataOnExit(false),
@@ -1791,6 +1794,10 @@ S32 LLAppViewer::updateTextureThreads(F32 max_time)
     {
         LL_PROFILE_ZONE_NAMED_CATEGORY_APP("Image Decode");
         work_pending += LLAppViewer::getImageDecodeThread()->update(max_time); // unpauses the image thread
+        if (sDecodedTextureCache)
+        {
+            sDecodedTextureCache->updateStats();
+        }
     }
     {
         LL_PROFILE_ZONE_NAMED_CATEGORY_APP("Image Fetch");
@@ -2173,11 +2180,22 @@ bool LLAppViewer::cleanup()
     sTextureFetch->shutdown();
     sTextureCache->shutdown();
     sImageDecodeThread->shutdown();
+    if (sDecodedTextureCache)
+    {
+        // The decode threads are done with it
+        sImageDecodeThread->setDecodedCache(NULL);
+        delete sDecodedTextureCache;
+        sDecodedTextureCache = NULL;
+    }
     sPurgeDiskCacheThread->shutdown();
     if (mGeneralThreadPool)
     {
         mGeneralThreadPool->close();
     }
+    if (mJobsThreadPool)
+    {
+        mJobsThreadPool->close();
+    }
 
     sTextureFetch->shutDownTextureCacheThread() ;
     LLLFSThread::sLocal->shutdown();
@@ -2209,6 +2227,8 @@ bool LLAppViewer::cleanup()
     sPurgeDiskCacheThread = NULL;
     delete mGeneralThreadPool;
     mGeneralThreadPool = NULL;
+    delete mJobsThreadPool;
+    mJobsThreadPool = NULL;
 
     if (LLFastTimerView::sAnalyzePerformance)
     {
@@ -2316,6 +2336,7 @@ bool LLAppViewer::initThreads()
     static const bool enable_threads = true;
 
     LLImage::initClass(gSavedSettings.getBOOL("TextureNewByteRange"),gSavedSettings.getS32("TextureReverseByteRange"));
+    LLImageJ2C::setDecodeThreading(gSavedSettings.getS32("TextureDecodeThreadsPerImage"), gSavedSettings.getS32("TextureDecodeThreadsMinPixels"));
 
     LLLFSThread::initClass(enable_threads && true); // TODO: fix crashes associated with this shutdo
 
@@ -2350,6 +2371,12 @@ bool LLAppViewer::initThreads()
 
     LLAppViewer::sPurgeDiskCacheThread = new LLPurgeDiskCacheThread();
 
+    // Short jobs the main thread splits up and waits for, see LL::runJobs():
+    // terrain patches, object update decoding, avatar animation and rigged
+    // mesh skinning
+    mJobsThreadPool = new LL::ThreadPool("Jobs", llclamp(cores / 2 - 1, 1, 4));
+    mJobsThreadPool->start();
+
     if (LLTrace::BlockTimer::sLog || LLTrace::BlockTimer::sMetricLog)
     {
         LLTrace::BlockTimer::setLogLock(new LLMutex());
@@ -4316,7 +4343,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
     // Viewer object cache version, change if object update
     // format changes. JC
-    const U32 INDRA_OBJECT_CACHE_VERSION = 17;
+    const U32 INDRA_OBJECT_CACHE_VERSION = 18;
 
     return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -4343,6 +4370,7 @@ bool LLAppViewer::initCache()
     // total cache size - the 'CacheSize' pref - for all caches.
     const uintmax_t disk_cache_size = uintmax_t(cache_total_size * disk_cache_percent / 100);
     const bool enable_cache_debug_info = gSavedSettings.getBOOL("EnableDiskCacheDebugInfo");
+    const bool use_pack_files = gSavedSettings.getBOOL("DiskCacheUsePackFiles");
 
     bool texture_cache_mismatch = false;
     bool remove_vfs_files = false;
@@ -4396,7 +4424,7 @@ bool LLAppViewer::initCache()
     }
 
     const std::string cache_dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, cache_dir_name);
-    LLDiskCache::initParamSingleton(cache_dir, disk_cache_size, enable_cache_debug_info);
+    LLDiskCache::initParamSingleton(cache_dir, disk_cache_size, enable_cache_debug_info, use_pack_files, read_only);
 
     if (!read_only)
     {
@@ -4412,6 +4440,11 @@ bool LLAppViewer::initCache()
             LLDiskCache::getInstance()->removeOldVFSFiles();
         }
 
+        if (!use_pack_files)
+        {
+            LLDiskCache::getInstance()->removePackFiles();
+        }
+
         if (mPurgeCache)
         {
         LLSplashScreen::update(LLTrans::getString("StartupClearingCache"));
@@ -4436,6 +4469,30 @@ bool LLAppViewer::initCache()
 
     LLAppViewer::getTextureCache()->initCache(LL_PATH_CACHE, texture_cache_size, texture_cache_mismatch);
 
+    // The decoded texture cache only speeds things up, it is not shared with
+    // other instances.
+    if (!read_only && gSavedSettings.getBOOL("TextureDecodedCacheEnabled"))
+    {
+        const U64 decoded_cache_size = U64(gSavedSettings.getU32("TextureDecodedCacheSize")) * MB;
+        sDecodedTextureCache = new LLDecodedTextureCache(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "decodedtextures"),
+                                                         decoded_cache_size,
+                                                         gSavedSettings.getS32("TextureDecodedCacheMinPixels"),
+                                                         gSavedSettings.getBOOL("TextureDecodedCacheCompress"));
+        if (sDecodedTextureCache->open())
+        {
+            if (texture_cache_mismatch)
+            {
+                sDecodedTextureCache->clear();
+            }
+            sImageDecodeThread->setDecodedCache(sDecodedTextureCache);
+        }
+        else
+        {
+            delete sDecodedTextureCache;
+            sDecodedTextureCache = NULL;
+        }
+    }
+
     const U32 CACHE_NUMBER_OF_REGIONS_FOR_OBJECTS = 128;
     LLVOCache::getInstance()->initCache(LL_PATH_CACHE, CACHE_NUMBER_OF_REGIONS_FOR_OBJECTS, getObjectCacheVersion());
 
@@ -4483,6 +4540,10 @@ void LLAppViewer::purgeCacheImmediate()
 {
     LL_INFOS("AppCache") << "Purging Object Cache and Texture Cache immediately..." << LL_ENDL;
     LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE, false);
+    if (sDecodedTextureCache)
+    {
+        sDecodedTextureCache->clear();
+    }
     LLVOCache::getInstance()->removeCache(LL_PATH_CACHE, true);
 }
 
@@ -4737,6 +4798,11 @@ void LLAppViewer::idle()
     F32 dt_raw = idle_timer.getElapsedTimeAndResetF32();
 
     LLGLTFMaterialList::flushUpdates();
+    LLDiskCache::flushJournal();
+    if (sDecodedTextureCache)
+    {
+        sDecodedTextureCache->flushJournal();
+    }
 
     static LLCachedControl<U32> downscale_method(gSavedSettings, "RenderDownScaleMethod");
     gGLManager.mDownScaleMethod = downscale_method;
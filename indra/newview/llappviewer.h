@@ -58,6 +58,7 @@ class LLFrameTimer;
 class LLPumpIO;
 class LLTextureCache;
 class LLImageDecodeThread;
+class LLDecodedTextureCache;
 class LLTextureFetch;
 class LLWatchdogTimeout;
 class LLViewerJoystick;
@@ -120,6 +121,7 @@ public:
     // Thread accessors
     static LLTextureCache* getTextureCache() { return sTextureCache; }
     static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
+    static LLDecodedTextureCache* getDecodedTextureCache() { return sDecodedTextureCache; }
     static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
     static LLPurgeDiskCacheThread* getPurgeDiskCacheThread() { return sPurgeDiskCacheThread; }
 
@@ -302,9 +304,11 @@ private:
     // Thread objects.
     static LLTextureCache* sTextureCache;
     static LLImageDecodeThread* sImageDecodeThread;
+    static LLDecodedTextureCache* sDecodedTextureCache;
     static LLTextureFetch* sTextureFetch;
     static LLPurgeDiskCacheThread* sPurgeDiskCacheThread;
     LL::ThreadPool* mGeneralThreadPool;
+    LL::ThreadPool* mJobsThreadPool;
 
     S32 mNumSessions;
 
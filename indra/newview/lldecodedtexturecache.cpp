@@ -0,0 +1,413 @@
+/**
+ * @file lldecodedtexturecache.cpp
+ * @brief On disk cache of decoded textures, consulted before decoding.
+ *
+ * See the header for a description of how this is supposed to work.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lldecodedtexturecache.h"
+
+#include "lldir.h"
+#include "llfile.h"
+#include "llimage.h"
+
+#include <functional>
+#include <thread>
+
+#ifdef LL_USESYSTEMLIBS
+# include <zlib.h>
+#else
+# include "zlib-ng/zlib.h"
+#endif
+
+LLTrace::CountStatHandle<> LLDecodedTextureCache::sHits("decoded_texture_cache_hit", "Textures read back from the decoded texture cache");
+LLTrace::CountStatHandle<F64Kilobytes> LLDecodedTextureCache::sBytesSaved("decoded_texture_cache_saved", "Decoded texture data read back instead of decoding it");
+LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > LLDecodedTextureCache::sHitRate("decoded_texture_cache_hits");
+
+static const std::string FILENAME_PREFIX("decoded");
+static const std::string FILENAME_EXTENSION(".raw");
+
+// Every file starts with this header, followed by the pixels of the main
+// image then those of the aux image if any, deflated or not.
+struct LLDecodedTextureHeader
+{
+    U32 mMagic;
+    U16 mVersion;
+    S8  mDiscard;       // discard level reached by the decode
+    U8  mFlags;
+    U16 mWidth;
+    U16 mHeight;
+    U8  mComponents;
+    U8  mPad[3];
+    U32 mDataSize;      // pixel bytes
+    U32 mStoredSize;    // pixel bytes as written in the file
+    U8  mID[UUID_BYTES];
+};
+static_assert(sizeof(LLDecodedTextureHeader) == 40, "Unexpected decoded texture header size");
+
+static constexpr U32 HEADER_MAGIC = 0x5854444C;  // "LDTX"
+static constexpr U16 HEADER_VERSION = 1;
+static constexpr U8 FLAG_AUX = 1;
+static constexpr U8 FLAG_DEFLATED = 2;
+
+// Deflate the concatenation of two buffers with the fastest zlib level.
+// Returns false when that does not make the data any smaller.
+static bool deflate_buffers(const U8* first, U32 first_size, const U8* second, U32 second_size, std::vector<U8>& out)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit(&strm, Z_BEST_SPEED) != Z_OK)
+    {
+        return false;
+    }
+
+    const U32 total = first_size + second_size;
+    out.resize(deflateBound(&strm, total));
+    strm.next_out = out.data();
+    strm.avail_out = (uInt)out.size();
+
+    strm.next_in = (Bytef*)first;
+    strm.avail_in = first_size;
+    S32 ret = deflate(&strm, second_size ? Z_NO_FLUSH : Z_FINISH);
+    if (second_size && ret == Z_OK)
+    {
+        strm.next_in = (Bytef*)second;
+        strm.avail_in = second_size;
+        ret = deflate(&strm, Z_FINISH);
+    }
+    const uLong stored = strm.total_out;
+    deflateEnd(&strm);
+
+    if (ret != Z_STREAM_END || stored >= total)
+    {
+        return false;
+    }
+    out.resize(stored);
+    return true;
+}
+
+LLDecodedTextureCache::LLDecodedTextureCache(const std::string& cache_dir, U64 max_size_bytes, S32 min_pixels, bool compress) :
+    mCacheDir(cache_dir),
+    mMaxSizeBytes(max_size_bytes),
+    mMinPixels(min_pixels),
+    mCompress(compress),
+    mJournal(cache_dir, FILENAME_PREFIX),
+    mHits(0),
+    mMisses(0),
+    mWrites(0),
+    mBytesSaved(0),
+    mReportedHits(0),
+    mReportedMisses(0),
+    mReportedBytesSaved(0)
+{
+}
+
+LLDecodedTextureCache::~LLDecodedTextureCache()
+{
+    close();
+}
+
+bool LLDecodedTextureCache::open()
+{
+    if (!LLFile::isdir(mCacheDir))
+    {
+        LLFile::mkdir(mCacheDir);
+    }
+    if (!mJournal.open())
+    {
+        LL_WARNS("TextureCache") << "Unable to open the decoded texture cache in " << mCacheDir << LL_ENDL;
+        return false;
+    }
+    evict();
+
+    LL_INFOS("TextureCache") << "Decoded texture cache: " << mJournal.getEntryCount() << " images, "
+                             << mJournal.getTotalBytes() / (1024 * 1024) << " MB of " << mMaxSizeBytes / (1024 * 1024) << " MB"
+                             << (mCompress ? ", deflated" : "") << LL_ENDL;
+    return true;
+}
+
+void LLDecodedTextureCache::close()
+{
+    if (mWrites || mHits || mMisses)
+    {
+        LL_INFOS("TextureCache") << getStatsString() << LL_ENDL;
+    }
+    mJournal.close();
+}
+
+void LLDecodedTextureCache::clear()
+{
+    mJournal.clear();
+    gDirUtilp->deleteFilesInDir(mCacheDir, "*" + FILENAME_EXTENSION);
+}
+
+//static
+LLUUID LLDecodedTextureCache::getKey(const LLUUID& id, S32 discard, bool needs_aux)
+{
+    LLUUID salt;
+    salt.mData[0] = (U8)discard;
+    salt.mData[1] = needs_aux ? 1 : 0;
+    return id.combine(salt);
+}
+
+std::string LLDecodedTextureCache::getFilename(const LLUUID& key) const
+{
+    return mCacheDir + gDirUtilp->getDirDelimiter() + FILENAME_PREFIX + "_" + key.asString() + FILENAME_EXTENSION;
+}
+
+// Called from the decode threads
+bool LLDecodedTextureCache::read(const LLUUID& id, S32 discard, bool needs_aux, S32 image_pixels,
+                                 LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux, S32& decoded_discard)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+    if (image_pixels < mMinPixels)
+    {
+        // Never written, see write(), so not a miss either
+        return false;
+    }
+
+    const LLUUID key = getKey(id, discard, needs_aux);
+    const std::string filename = getFilename(key);
+
+    LLUniqueFile file = LLFile::fopen(filename, "rb");
+    if (!file)
+    {
+        ++mMisses;
+        return false;
+    }
+
+    LLDecodedTextureHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.mMagic == HEADER_MAGIC &&
+                 header.mVersion == HEADER_VERSION &&
+                 !memcmp(header.mID, id.mData, UUID_BYTES) &&
+                 ((header.mFlags & FLAG_AUX) != 0) == needs_aux &&
+                 header.mComponents > 0 && header.mComponents <= 4 &&
+                 header.mDiscard >= 0;
+    const U32 pixels = valid ? (U32)header.mWidth * (U32)header.mHeight : 0;
+    const U32 raw_size = pixels * header.mComponents;
+    const U32 aux_size = needs_aux ? pixels : 0;
+    valid = valid && pixels > 0 && header.mDataSize == raw_size + aux_size;
+
+    LLPointer<LLImageRaw> raw_image;
+    LLPointer<LLImageRaw> aux_image;
+    if (valid)
+    {
+        raw_image = new LLImageRaw(header.mWidth, header.mHeight, header.mComponents);
+        if (needs_aux)
+        {
+            aux_image = new LLImageRaw(header.mWidth, header.mHeight, 1);
+        }
+        if (!raw_image->getData() || (needs_aux && !aux_image->getData()))
+        {
+            // Out of memory, let the decoder deal with it
+            ++mMisses;
+            return false;
+        }
+    }
+
+    if (valid && (header.mFlags & FLAG_DEFLATED))
+    {
+        std::vector<U8> stored(header.mStoredSize);
+        std::vector<U8> data(header.mDataSize);
+        uLongf data_size = header.mDataSize;
+        valid = fread(stored.data(), 1, stored.size(), file) == stored.size() &&
+                uncompress(data.data(), &data_size, stored.data(), header.mStoredSize) == Z_OK &&
+                data_size == header.mDataSize;
+        if (valid)
+        {
+            memcpy(raw_image->getData(), data.data(), raw_size);
+            if (needs_aux)
+            {
+                memcpy(aux_image->getData(), data.data() + raw_size, aux_size);
+            }
+        }
+    }
+    else if (valid)
+    {
+        // Read straight into the images
+        valid = header.mStoredSize == header.mDataSize &&
+                fread(raw_image->getData(), 1, raw_size, file) == raw_size &&
+                (!needs_aux || fread(aux_image->getData(), 1, aux_size, file) == aux_size);
+    }
+
+    if (!valid)
+    {
+        LL_DEBUGS("TextureCache") << "Removing invalid decoded texture cache file " << filename << LL_ENDL;
+        file.close();
+        LLFile::remove(filename);
+        mJournal.recordRemove(key);
+        ++mMisses;
+        return false;
+    }
+
+    mJournal.recordAccess(key);
+    raw = raw_image;
+    aux = aux_image;
+    decoded_discard = header.mDiscard;
+    ++mHits;
+    mBytesSaved += header.mDataSize;
+    return true;
+}
+
+// Called from the decode threads
+void LLDecodedTextureCache::write(const LLUUID& id, S32 discard, S32 decoded_discard,
+                                  const LLImageRaw* raw, const LLImageRaw* aux)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+
+    // Only keep complete decodes: one that stopped short of the requested
+    // discard level (not enough data yet) would otherwise be served again
+    // once the data is there.
+    if (!raw || !raw->getData() || decoded_discard != discard)
+    {
+        return;
+    }
+    const S32 width = raw->getWidth();
+    const S32 height = raw->getHeight();
+    if (width * height < mMinPixels)
+    {
+        // Cheaper to decode again than to read back
+        return;
+    }
+    if (aux && (aux->getWidth() != width || aux->getHeight() != height || aux->getComponents() != 1 || !aux->getData()))
+    {
+        return;
+    }
+
+    const U32 raw_size = (U32)(width * height * raw->getComponents());
+    const U32 aux_size = aux ? (U32)(width * height) : 0;
+
+    LLDecodedTextureHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mMagic = HEADER_MAGIC;
+    header.mVersion = HEADER_VERSION;
+    header.mDiscard = (S8)decoded_discard;
+    header.mFlags = aux ? FLAG_AUX : 0;
+    header.mWidth = (U16)width;
+    header.mHeight = (U16)height;
+    header.mComponents = (U8)raw->getComponents();
+    header.mDataSize = raw_size + aux_size;
+    header.mStoredSize = header.mDataSize;
+    memcpy(header.mID, id.mData, UUID_BYTES);
+
+    std::vector<U8> deflated;
+    if (mCompress && deflate_buffers(raw->getData(), raw_size, aux ? aux->getData() : NULL, aux_size, deflated))
+    {
+        header.mFlags |= FLAG_DEFLATED;
+        header.mStoredSize = (U32)deflated.size();
+    }
+
+    // Written aside then renamed, so that readers never see a partial file.
+    // The temporary name is unique per thread since two decode threads may
+    // store the same image at once, and does not start with the journal
+    // prefix so that a leftover one is not mistaken for a cached image.
+    const LLUUID key = getKey(id, discard, aux != NULL);
+    const std::string filename = getFilename(key);
+    const std::string temp_filename = mCacheDir + gDirUtilp->getDirDelimiter() +
+        llformat("tmp_%s_%zx", key.asString().c_str(), std::hash<std::thread::id>()(std::this_thread::get_id())) + FILENAME_EXTENSION;
+    {
+        LLUniqueFile file = LLFile::fopen(temp_filename, "wb");
+        if (!file)
+        {
+            return;
+        }
+        bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+        if (header.mFlags & FLAG_DEFLATED)
+        {
+            success = success && fwrite(deflated.data(), 1, deflated.size(), file) == deflated.size();
+        }
+        else
+        {
+            success = success && fwrite(raw->getData(), 1, raw_size, file) == raw_size &&
+                      (!aux || fwrite(aux->getData(), 1, aux_size, file) == aux_size);
+        }
+        if (!success)
+        {
+            file.close();
+            LLFile::remove(temp_filename);
+            return;
+        }
+    }
+    LLFile::remove(filename, ENOENT);
+    if (LLFile::rename(temp_filename, filename) != 0)
+    {
+        LLFile::remove(temp_filename);
+        return;
+    }
+
+    mJournal.recordWrite(key, sizeof(header) + header.mStoredSize, true);
+    ++mWrites;
+    evict();
+}
+
+void LLDecodedTextureCache::evict()
+{
+    if (mJournal.getTotalBytes() <= mMaxSizeBytes)
+    {
+        return;
+    }
+    // Make some room at once rather than evicting on every write
+    const std::vector<LLUUID> evicted = mJournal.collectEvictions(mMaxSizeBytes / 10 * 9);
+    for (const LLUUID& key : evicted)
+    {
+        LLFile::remove(getFilename(key), ENOENT);
+    }
+    LL_DEBUGS("TextureCache") << "Evicted " << evicted.size() << " decoded textures" << LL_ENDL;
+}
+
+void LLDecodedTextureCache::updateStats()
+{
+    const U64 hits = mHits;
+    const U64 misses = mMisses;
+    const U64 bytes_saved = mBytesSaved;
+
+    const U64 new_hits = hits - mReportedHits;
+    const U64 new_misses = misses - mReportedMisses;
+    if (new_hits)
+    {
+        add(sHits, (F64)new_hits);
+        add(sBytesSaved, F64Bytes((F64)(bytes_saved - mReportedBytesSaved)));
+    }
+    if (new_hits + new_misses)
+    {
+        record(sHitRate, LLUnits::Ratio::fromValue((F32)new_hits / (F32)(new_hits + new_misses)));
+    }
+    mReportedHits = hits;
+    mReportedMisses = misses;
+    mReportedBytesSaved = bytes_saved;
+}
+
+std::string LLDecodedTextureCache::getStatsString()
+{
+    const U64 hits = mHits;
+    const U64 lookups = hits + mMisses;
+    return llformat("Decoded texture cache: %llu hits out of %llu lookups (%.1f%%), %.1f MB not decoded again, %llu images stored, %u images / %.1f MB in cache",
+                    (unsigned long long)hits, (unsigned long long)lookups, lookups ? 100.0 * (F64)hits / (F64)lookups : 0.0,
+                    (F64)mBytesSaved / (1024.0 * 1024.0), (unsigned long long)(U64)mWrites,
+                    mJournal.getEntryCount(), (F64)mJournal.getTotalBytes() / (1024.0 * 1024.0));
+}
@@ -0,0 +1,110 @@
+/**
+ * @file lldecodedtexturecache.h
+ * @brief On disk cache of decoded textures, consulted before decoding.
+ *
+ * @Description:
+ * Textures evicted from memory and needed again later used to be read back
+ * from the texture cache and fully decoded again. This cache keeps a copy of
+ * the decoded pixels instead:
+ * 1/ Each decode result is stored in its own file, keyed by texture ID,
+ *    requested discard level and presence of the auxiliary channel. The
+ *    file name is derived from a hash of that key.
+ * 2/ The decode threads look the key up before decoding (see
+ *    LLImageDecodeThread::DecodedCache) and skip the decode on a hit.
+ * 3/ Only images of at least TextureDecodedCacheMinPixels pixels are kept:
+ *    decoding smaller ones is about as fast as reading them back.
+ * 4/ The pixels can optionally be deflated (fastest zlib level) to trade
+ *    some of the saved CPU time for disk space.
+ * 5/ The size of the cache is bounded, least recently used files are
+ *    evicted using an LLDiskCacheJournal.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLDECODEDTEXTURECACHE_H
+#define LL_LLDECODEDTEXTURECACHE_H
+
+#include "lldiskcachejournal.h"
+#include "llimageworker.h"
+#include "lltrace.h"
+
+#include <atomic>
+
+class LLDecodedTextureCache : public LLImageDecodeThread::DecodedCache
+{
+public:
+    LLDecodedTextureCache(const std::string& cache_dir, U64 max_size_bytes, S32 min_pixels, bool compress);
+    ~LLDecodedTextureCache();
+
+    // Create the cache folder and load the journal
+    bool open();
+    void close();
+
+    // Remove all the cached images
+    void clear();
+
+    // LLImageDecodeThread::DecodedCache interface, called by the decode threads
+    bool read(const LLUUID& id, S32 discard, bool needs_aux, S32 image_pixels,
+              LLPointer<LLImageRaw>& raw, LLPointer<LLImageRaw>& aux, S32& decoded_discard) override;
+    void write(const LLUUID& id, S32 discard, S32 decoded_discard,
+               const LLImageRaw* raw, const LLImageRaw* aux) override;
+
+    // Main thread: push the counters gathered by the decode threads to the
+    // statistics.
+    void updateStats();
+
+    // Main thread, once per frame: hand the journal records of the frame to
+    // the OS
+    void flushJournal() { mJournal.flush(); }
+
+    // Human readable summary of the cache usage and efficiency
+    std::string getStatsString();
+
+    static LLTrace::CountStatHandle<>                      sHits;
+    static LLTrace::CountStatHandle<F64Kilobytes>          sBytesSaved;
+    static LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > sHitRate;
+
+private:
+    static LLUUID getKey(const LLUUID& id, S32 discard, bool needs_aux);
+    std::string getFilename(const LLUUID& key) const;
+    void evict();
+
+private:
+    std::string mCacheDir;
+    U64 mMaxSizeBytes;
+    S32 mMinPixels;
+    bool mCompress;
+    LLDiskCacheJournal mJournal;
+
+    // Updated by the decode threads
+    std::atomic<U64> mHits;
+    std::atomic<U64> mMisses;
+    std::atomic<U64> mWrites;
+    std::atomic<U64> mBytesSaved;       // decoded bytes served without decoding
+
+    // Values already pushed to the statistics by updateStats()
+    U64 mReportedHits;
+    U64 mReportedMisses;
+    U64 mReportedBytesSaved;
+};
+
+#endif  // LL_LLDECODEDTEXTURECACHE_H
@@ -53,6 +53,7 @@
 #include "llviewerregion.h"
 #include <boost/regex.hpp>
 #include "llcorehttputil.h"
+#include "llsdserialize.h"
 #include "lluiusage.h"
 
 #include <boost/lexical_cast.hpp>
@@ -2134,6 +2135,94 @@ void LLGroupMgr::processGroupBanRequest(const LLSD& content)
     LLGroupMgr::getInstance()->notifyObservers(GC_BANLIST);
 }
 
+// Reads a GroupMemberData response into LLGroupMgr::CapGroupMembers. Only
+// one member at a time exists as an LLSD.
+class LLGroupMgr::CapGroupMembersVisitor : public LLSDXMLVisitor
+{
+public:
+    CapGroupMembersVisitor(CapGroupMembers& response)
+        : mResponse(response),
+          mDepth(0)
+    {}
+
+    virtual bool beginMap()
+    {
+        if (mDepth == 0 || (mDepth == 1 && mKey == "members"))
+        {
+            ++mDepth;
+            return false;
+        }
+        // Members and defaults
+        return true;
+    }
+
+    virtual void endMap() { --mDepth; }
+
+    virtual bool beginArray() { return true; }
+
+    virtual void key(const std::string& name)
+    {
+        if (mDepth == 1)
+        {
+            mResponse.mHasContent = true;
+        }
+        mKey = name;
+    }
+
+    virtual void value(const LLSD& value)
+    {
+        if (mDepth == 1)
+        {
+            if (mKey == "group_id")
+            {
+                mResponse.mGroupID = value.asUUID();
+            }
+            else if (mKey == "titles")
+            {
+                mResponse.mTitles.reserve(value.size());
+                for (LLSD::array_const_iterator it = value.beginArray(); it != value.endArray(); ++it)
+                {
+                    mResponse.mTitles.emplace_back(it->asString());
+                }
+            }
+            else if (mKey == "defaults")
+            {
+                mResponse.mDefaultPowers = value["default_powers"].asString();
+            }
+        }
+        else if (mDepth == 2)
+        {
+            CapGroupMember member;
+            member.mID.set(mKey);
+            if (value.has("last_login"))
+            {
+                member.mHasLastLogin = true;
+                member.mLastLogin = value["last_login"].asString();
+            }
+            if (value.has("title"))
+            {
+                member.mTitle = value["title"].asInteger();
+            }
+            if (value.has("powers"))
+            {
+                member.mHasPowers = true;
+                member.mPowers = llstrtou64(value["powers"].asString().c_str(), NULL, 16);
+            }
+            if (value.has("donated_square_meters"))
+            {
+                member.mDonated = value["donated_square_meters"].asInteger();
+            }
+            member.mIsOwner = value.has("owner");
+            mResponse.mMembers.emplace_back(std::move(member));
+        }
+    }
+
+private:
+    CapGroupMembers& mResponse;
+    S32 mDepth;
+    std::string mKey;
+};
+
 void LLGroupMgr::groupMembersRequestCoro(std::string url, LLUUID group_id, U32 page_size, U32 page_start, U32 sort_column, bool sort_descending)
 {
     LL_INFOS("GrpMgr") << "group_id: '" << group_id << "'"
@@ -2168,7 +2257,9 @@ void LLGroupMgr::groupMembersRequestCoro(std::string url, LLUUID group_id, U32 p
 
     mMemberRequestInFlight = true;
 
-    LLSD response = httpAdapter->postAndSuspend(httpRequest, url, postData, httpOpts);
+    CapGroupMembers members;
+    CapGroupMembersVisitor visitor(members);
+    LLSD response = httpAdapter->postAndSuspend(httpRequest, url, postData, visitor, httpOpts);
 
     mMemberRequestInFlight = false;
 
@@ -2181,8 +2272,7 @@ void LLGroupMgr::groupMembersRequestCoro(std::string url, LLUUID group_id, U32 p
         return;
     }
 
-    response.erase(LLCoreHttpUtil::HttpCoroutineAdapter::HTTP_RESULTS);
-    processCapGroupMembersResponse(response, url, page_size, page_start, sort_column, sort_descending);
+    processCapGroupMembersResponse(members, url, page_size, page_start, sort_column, sort_descending);
 }
 
 void LLGroupMgr::sendCapGroupMembersRequest(const LLUUID& group_id, U32 page_size, U32 page_start, const std::string& sort_column_name, bool sort_descending)
@@ -2251,15 +2341,15 @@ void LLGroupMgr::sendCapGroupMembersRequest(const LLUUID& group_id, U32 page_siz
         });
 }
 
-void LLGroupMgr::processCapGroupMembersResponse(const LLSD& response, const std::string& url, U32 page_size, U32 page_start, U32 sort_column, bool sort_descending)
+void LLGroupMgr::processCapGroupMembersResponse(const CapGroupMembers& response, const std::string& url, U32 page_size, U32 page_start, U32 sort_column, bool sort_descending)
 {
-    LLUUID group_id = response["group_id"].asUUID();
+    LLUUID group_id = response.mGroupID;
     LL_INFOS("GrpMgr") << "group_id: '" << group_id << "'"
         << ", page_size: " << page_size << ", page_start: " << page_start
         << ", sort_column: " << sort_column << ", sort_descending: " << sort_descending << LL_ENDL;
 
     // Did we get anything in content?
-    if (!response.size())
+    if (!response.mHasContent)
     {
         LL_INFOS("GrpMgr") << "No group member data received." << LL_ENDL;
         return;
@@ -2272,33 +2362,27 @@ void LLGroupMgr::processCapGroupMembersResponse(const LLSD& response, const std:
         return;
     }
 
-    LLSD members = response["members"];
-    LLSD titles = response["titles"];
-    LLSD defaults = response["defaults"];
+    const std::vector<std::string>& titles = response.mTitles;
 
     size_t members_before = group_datap->mMembers.size();
-    size_t members_loaded = members.size();
+    size_t members_loaded = response.mMembers.size();
 
     // Compute this once, rather than every time.
-    std::string default_title = titles.size() ? titles[0].asString() : LLStringUtil::null;
-    U64 default_powers = llstrtou64(defaults["default_powers"].asString().c_str(), NULL, 16);
+    std::string default_title = titles.size() ? titles[0] : LLStringUtil::null;
+    U64 default_powers = llstrtou64(response.mDefaultPowers.c_str(), NULL, 16);
 
-    auto members_end = members.endMap();
-    for (auto it = members.beginMap(); it != members_end; ++it)
+    for (const CapGroupMember& member_info : response.mMembers)
     {
         // Reset defaults
         std::string online_status = "unknown";
         std::string title = default_title;
         U64 member_powers = default_powers;
-        S32 donated_square_meters = 0;
-        bool is_owner = false;
 
-        const LLUUID member_id(it->first);
-        LLSD member_info = it->second;
+        const LLUUID& member_id(member_info.mID);
 
-        if (member_info.has("last_login"))
+        if (member_info.mHasLastLogin)
         {
-            online_status = member_info["last_login"].asString();
+            online_status = member_info.mLastLogin;
             if (online_status == "Online")
             {
                 online_status = LLTrans::getString("group_member_status_online");
@@ -2309,28 +2393,18 @@ void LLGroupMgr::processCapGroupMembersResponse(const LLSD& response, const std:
             }
         }
 
-        if (member_info.has("title"))
-        {
-            title = titles[member_info["title"].asInteger()].asString();
-        }
-
-        if (member_info.has("powers"))
-        {
-            member_powers = llstrtou64(member_info["powers"].asString().c_str(), NULL, 16);
-        }
-
-        if (member_info.has("donated_square_meters"))
+        if (member_info.mTitle >= 0)
         {
-            donated_square_meters = member_info["donated_square_meters"];
+            title = (size_t)member_info.mTitle < titles.size() ? titles[member_info.mTitle] : LLStringUtil::null;
         }
 
-        if (member_info.has("owner"))
+        if (member_info.mHasPowers)
         {
-            is_owner = true;
+            member_powers = member_info.mPowers;
         }
 
         LLGroupMemberData* data = new LLGroupMemberData(member_id,
-            donated_square_meters, member_powers, title, online_status, is_owner);
+            member_info.mDonated, member_powers, title, online_status, member_info.mIsOwner);
 
         if (group_datap->mRoleMemberDataComplete)
         {
@@ -437,8 +437,38 @@ public:
     void clearGroupData(const LLUUID& group_id);
 
 private:
+    // A member in a GroupMemberData response
+    struct CapGroupMember
+    {
+        CapGroupMember() : mHasLastLogin(false), mTitle(-1), mHasPowers(false), mPowers(0), mDonated(0), mIsOwner(false) {}
+
+        LLUUID mID;
+        bool mHasLastLogin;
+        std::string mLastLogin;
+        S32 mTitle; // index in mTitles, -1 for the default one
+        bool mHasPowers;
+        U64 mPowers;
+        S32 mDonated;
+        bool mIsOwner;
+    };
+
+    // A GroupMemberData response, read as it is parsed by
+    // CapGroupMembersVisitor so that large groups never exist as an LLSD
+    struct CapGroupMembers
+    {
+        CapGroupMembers() : mHasContent(false) {}
+
+        bool mHasContent;
+        LLUUID mGroupID;
+        std::vector<std::string> mTitles;
+        std::string mDefaultPowers;
+        std::vector<CapGroupMember> mMembers;
+    };
+
+    class CapGroupMembersVisitor;
+
     void groupMembersRequestCoro(std::string url, LLUUID group_id, U32 page_size, U32 page_start, U32 sort_column, bool sort_descending);
-    void processCapGroupMembersResponse(const LLSD& response, const std::string& url, U32 page_size, U32 page_start, U32 sort_column, bool sort_descending);
+    void processCapGroupMembersResponse(const CapGroupMembers& response, const std::string& url, U32 page_size, U32 page_start, U32 sort_column, bool sort_descending);
 
     void getGroupBanRequestCoro(std::string url, LLUUID group_id);
     void postGroupBanRequestCoro(std::string url, LLUUID group_id, U32 action, uuid_vec_t ban_list, bool update);
@@ -60,6 +60,7 @@
 #include "llcallbacklist.h"
 #include "llvoavatarself.h"
 #include "llgesturemgr.h"
+#include "llinventorycache.h"
 #include "llsdserialize.h"
 #include "llsdutil.h"
 #include "bufferarray.h"
@@ -90,6 +91,9 @@ S32 LLInventoryModel::sPendingSystemFolders = 0;
 //bool decompress_file(const char* src_filename, const char* dst_filename);
 static const char PRODUCTION_CACHE_FORMAT_STRING[] = "%s.inv.llsd";
 static const char GRID_CACHE_FORMAT_STRING[] = "%s.%s.inv.llsd";
+// Appended to the above for the binary cache, which is preferred over the
+// gzipped text one when present
+static const char BINARY_CACHE_SUFFIX[] = ".bin";
 static const char * const LOG_INV("Inventory");
 
 struct InventoryIDPtrLess
@@ -2332,12 +2336,33 @@ void LLInventoryModel::cache(
         items,
         INCLUDE_TRASH,
         can_cache);
+    std::string gzip_filename = getInvCacheAddres(agent_id);
+    gzip_filename.append(".gz");
+
+    // Written aside then renamed, so that another instance never reads a
+    // partial file
+    std::string binary_filename = getInvCacheAddres(agent_id);
+    binary_filename.append(BINARY_CACHE_SUFFIX);
+    std::string binary_temp_file = binary_filename + ".tmp";
+    if (saveToBinaryFile(binary_temp_file, categories, items))
+    {
+        LLFile::remove(binary_filename, ENOENT);
+        if (LLFile::rename(binary_temp_file, binary_filename) == 0)
+        {
+            // The text cache would only go stale
+            LLFile::remove(gzip_filename, ENOENT);
+            return;
+        }
+    }
+    LLFile::remove(binary_temp_file, ENOENT);
+    // The binary cache is read first, it must not shadow the text one
+    LLFile::remove(binary_filename, ENOENT);
+    LL_WARNS(LOG_INV) << "Unable to save " << binary_filename << ", falling back to the text cache" << LL_ENDL;
+
     // Use temporary file to avoid potential conflicts with other
     // instances (even a 'read only' instance unzips into a file)
     std::string temp_file = gDirUtilp->getTempFilename();
     saveToFile(temp_file, categories, items);
-    std::string gzip_filename = getInvCacheAddres(agent_id);
-    gzip_filename.append(".gz");
     if(gzip_file(temp_file, gzip_filename))
     {
         LL_DEBUGS(LOG_INV) << "Successfully compressed " << temp_file << " to " << gzip_filename << LL_ENDL;
@@ -2702,9 +2727,16 @@ bool LLInventoryModel::loadSkeleton(
         const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
         std::string gzip_filename(inventory_filename);
         gzip_filename.append(".gz");
-        LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+        std::string binary_filename(inventory_filename);
+        binary_filename.append(BINARY_CACHE_SUFFIX);
+        const bool use_binary_file = LLFile::isfile(binary_filename);
+        LLFILE* fp = use_binary_file ? NULL : LLFile::fopen(gzip_filename, "rb");
         bool remove_inventory_file = false;
-        if (LLAppViewer::instance()->isSecondInstance())
+        if (use_binary_file)
+        {
+            // Read as is, nothing to unpack
+        }
+        else if (LLAppViewer::instance()->isSecondInstance())
         {
             // Safeguard viewer against trying to unpack file twice
             // ex: user logs into two accounts simultaneously, so two
@@ -2732,7 +2764,10 @@ bool LLInventoryModel::loadSkeleton(
             }
         }
         bool is_cache_obsolete = false;
-        if (loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete))
+        bool loaded = use_binary_file ?
+            loadFromBinaryFile(binary_filename, categories, items, categories_to_update, is_cache_obsolete) :
+            loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete);
+        if (loaded)
         {
             // We were able to find a cache of files. So, use what we
             // found to generate a set of categories we should add. We
@@ -2925,7 +2960,8 @@ bool LLInventoryModel::loadSkeleton(
         {
             // If out of date, remove the gzipped file too.
             LL_WARNS(LOG_INV) << "Inv cache out of date, removing" << LL_ENDL;
-            LLFile::remove(gzip_filename);
+            LLFile::remove(gzip_filename, ENOENT);
+            LLFile::remove(binary_filename, ENOENT);
         }
         categories.clear(); // will unref and delete entries
     }
@@ -3504,6 +3540,106 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
     return true;
 }
 
+// static
+bool LLInventoryModel::loadFromBinaryFile(const std::string& filename,
+                                          LLInventoryModel::cat_array_t& categories,
+                                          LLInventoryModel::item_array_t& items,
+                                          LLInventoryModel::changed_items_t& cats_to_update,
+                                          bool &is_cache_obsolete)
+{
+    LL_PROFILE_ZONE_NAMED("inventory load from binary file");
+
+    LL_INFOS(LOG_INV) << "loading inventory from: (" << filename << ")" << LL_ENDL;
+
+    is_cache_obsolete = true; // Obsolete until proven current
+
+    LLInventoryCacheFile cache_file;
+    if (!cache_file.load(filename))
+    {
+        LL_WARNS(LOG_INV) << "Unable to load inventory from: " << filename << LL_ENDL;
+        return false;
+    }
+    if (cache_file.getCacheVersion() != sCurrentInvCacheVersion)
+    {
+        LL_WARNS(LOG_INV) << "Inventory cache is out of date" << LL_ENDL;
+        return false;
+    }
+    is_cache_obsolete = false;
+
+    const S32 cat_count = cache_file.getCategoryCount();
+    categories.reserve(categories.size() + cat_count);
+    for (S32 i = 0; i < cat_count; ++i)
+    {
+        LLPointer<LLViewerInventoryCategory> inv_cat = new LLViewerInventoryCategory(LLUUID::null);
+        S32 version;
+        if (cache_file.getCategory(i, inv_cat, inv_cat->mOwnerID, version))
+        {
+            inv_cat->setVersion(version);
+            categories.push_back(inv_cat);
+        }
+    }
+
+    const S32 item_count = cache_file.getItemCount();
+    items.reserve(items.size() + item_count);
+    for (S32 i = 0; i < item_count; ++i)
+    {
+        LLPointer<LLViewerInventoryItem> inv_item = new LLViewerInventoryItem;
+        if (!cache_file.getItem(i, inv_item))
+        {
+            continue;
+        }
+        if (inv_item->getUUID().isNull())
+        {
+            LL_DEBUGS(LOG_INV) << "Ignoring inventory with null item id: "
+                << inv_item->getName() << LL_ENDL;
+        }
+        else if (inv_item->getType() == LLAssetType::AT_UNKNOWN)
+        {
+            cats_to_update.insert(inv_item->getParentUUID());
+        }
+        else
+        {
+            items.push_back(inv_item);
+        }
+    }
+
+    return true;
+}
+
+// static
+bool LLInventoryModel::saveToBinaryFile(const std::string& filename,
+                                        const cat_array_t& categories,
+                                        const item_array_t& items)
+{
+    LL_PROFILE_ZONE_NAMED("inventory save to binary file");
+
+    LL_INFOS(LOG_INV) << "saving inventory to: (" << filename << ")" << LL_ENDL;
+
+    LLInventoryCacheFile cache_file;
+    S32 cat_count = 0;
+    for (auto& cat : categories)
+    {
+        if (cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+        {
+            cache_file.addCategory(cat, cat->getOwnerID(), cat->getVersion());
+            cat_count++;
+        }
+    }
+    for (auto& item : items)
+    {
+        cache_file.addItem(item);
+    }
+
+    if (!cache_file.save(filename, sCurrentInvCacheVersion))
+    {
+        LL_WARNS(LOG_INV) << "Unable to save inventory to: " << filename << LL_ENDL;
+        return false;
+    }
+
+    LL_INFOS(LOG_INV) << "Inventory saved: " << cat_count << " categories, " << items.size() << " items." << LL_ENDL;
+    return true;
+}
+
 // message handling functionality
 // static
 void LLInventoryModel::registerCallbacks(LLMessageSystem* msg)
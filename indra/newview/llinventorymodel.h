@@ -668,6 +668,15 @@ protected:
     static bool saveToFile(const std::string& filename,
                            const cat_array_t& categories,
                            const item_array_t& items);
+    // Same for the binary cache, see LLInventoryCacheFile
+    static bool loadFromBinaryFile(const std::string& filename,
+                                   cat_array_t& categories,
+                                   item_array_t& items,
+                                   changed_items_t& cats_to_update,
+                                   bool& is_cache_obsolete);
+    static bool saveToBinaryFile(const std::string& filename,
+                                 const cat_array_t& categories,
+                                 const item_array_t& items);
 
     //--------------------------------------------------------------------
     // Message handling functionality
@@ -45,6 +45,7 @@
 #include "bufferarray.h"
 #include "bufferstream.h"
 #include "llcorehttputil.h"
+#include "llsdserialize.h"
 
 // History (may be apocryphal)
 //
@@ -168,7 +169,23 @@ public:
     bool getIsRecursive(const LLUUID& cat_id) const;
 
 private:
-    void processData(LLSD& body, LLCore::HttpResponse* response);
+    // One entry of the "folders" array of the response
+    struct FolderData
+    {
+        FolderData() : mVersion(0), mDescendents(0) {}
+
+        LLUUID mFolderID;
+        LLUUID mOwnerID;
+        S32 mVersion;
+        S32 mDescendents;
+        std::vector<LLSD> mCategories;
+        std::vector<LLPointer<LLViewerInventoryItem> > mItems;
+    };
+
+    class FolderVisitor;
+
+    void processFolder(const FolderData& folder);
+    void processBadFolders(const LLSD& bad_folders);
     void processFailure(LLCore::HttpStatus status, LLCore::HttpResponse* response);
     void processFailure(const char* const reason, LLCore::HttpResponse* response);
 
@@ -178,6 +195,55 @@ private:
 };
 
 
+// Turns the response into folders as it is parsed, so that large fetches
+// never exist as a whole LLSD.  A folder is applied once it is complete,
+// since its "folder_id" may come after its content.
+//
+class BGFolderHttpHandler::FolderVisitor : public LLSDXMLVisitor
+{
+public:
+    FolderVisitor(BGFolderHttpHandler& handler)
+        : mHandler(handler),
+          mDepth(0),
+          mInFolders(false),
+          mInItems(false),
+          mRootIsMap(false),
+          mHasError(false)
+        {}
+
+    virtual bool beginMap();
+    virtual void endMap();
+    virtual bool beginArray();
+    virtual void endArray();
+    virtual void key(const std::string& name) { mKey = name; }
+    virtual void value(const LLSD& value);
+
+    bool rootIsMap() const { return mRootIsMap; }
+    bool hasError() const { return mHasError; }
+    const LLSD& getBadFolders() const { return mBadFolders; }
+
+private:
+    // Depths of the containers being visited
+    enum
+    {
+        DEPTH_ROOT = 1,
+        DEPTH_FOLDERS,
+        DEPTH_FOLDER,
+        DEPTH_FOLDER_CONTENT
+    };
+
+    BGFolderHttpHandler& mHandler;
+    S32 mDepth;
+    std::string mKey;
+    bool mInFolders;
+    bool mInItems;  // else in categories, at DEPTH_FOLDER_CONTENT
+    bool mRootIsMap;
+    bool mHasError;
+    FolderData mFolder;
+    LLSD mBadFolders;
+};
+
+
 const char* const LOG_INV("Inventory");
 
 } // end of namespace anonymous
@@ -1315,10 +1381,12 @@ void BGFolderHttpHandler::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRes
 
         // Could test 'Content-Type' header but probably unreliable.
 
-        // Convert response to LLSD
+        // Parse the response, folders are processed as they are read.
+        // Should the parse fail halfway, the folders are fetched again
+        // and those already processed are simply updated twice.
         // body->write(0, "Garbage Response", 16);      // Dev tool to force error handling
-        LLSD body_llsd;
-        if (! LLCoreHttpUtil::responseToLLSD(response, true, body_llsd))
+        FolderVisitor visitor(*this);
+        if (! LLCoreHttpUtil::responseToLLSD(response, true, visitor))
         {
             // INFOS-level logging will occur on the parsed failure
             processFailure("HTTP response contained malformed LLSD", response);
@@ -1326,8 +1394,7 @@ void BGFolderHttpHandler::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRes
         }
 
         // Expect top-level structure to be a map
-        // body_llsd = LLSD::emptyArray();              // Dev tool to force error handling
-        if (! body_llsd.isMap())
+        if (! visitor.rootIsMap())
         {
             processFailure("LLSD response not a map", response);
             break;          // goto common exit
@@ -1336,152 +1403,205 @@ void BGFolderHttpHandler::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRes
         // Check for 200-with-error failures
         //
         // See comments in llinventorymodel.cpp about this mode of error.
-        //
-        // body_llsd["error"] = LLSD::emptyMap();       // Dev tool to force error handling
-        // body_llsd["error"]["identifier"] = "Development";
-        // body_llsd["error"]["message"] = "You left development code in the viewer";
-        if (body_llsd.has("error"))
+        if (visitor.hasError())
         {
             processFailure("Inventory application error (200-with-error)", response);
             break;          // goto common exit
         }
 
-        // Okay, process data if possible
-        processData(body_llsd, response);
+        processBadFolders(visitor.getBadFolders());
+
+        LLInventoryModelBackgroundFetch* fetcher(LLInventoryModelBackgroundFetch::getInstance());
+        if (fetcher->isBulkFetchProcessingComplete())
+        {
+            fetcher->setAllFoldersFetched();
+        }
     }
     while (false);
 }
 
 
-void BGFolderHttpHandler::processData(LLSD& content, LLCore::HttpResponse* response)
+void BGFolderHttpHandler::processFolder(const FolderData& folder)
 {
     LLInventoryModelBackgroundFetch* fetcher(LLInventoryModelBackgroundFetch::getInstance());
 
-    // API V2 and earlier should probably be testing for "error" map
-    // in response as an application-level error.
+    const LLUUID& parent_id(folder.mFolderID);
+    LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(folder.mOwnerID);
 
-    // Instead, we assume success and attempt to extract information.
-    if (content.has("folders"))
+    if (parent_id.isNull())
     {
-        LLSD folders(content["folders"]);
-
-        for (LLSD::array_const_iterator folder_it = folders.beginArray();
-            folder_it != folders.endArray();
-            ++folder_it)
+        for (LLViewerInventoryItem* titem : folder.mItems)
         {
-            LLSD folder_sd(*folder_it);
+            const LLUUID lost_uuid(gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND));
 
-            //LLUUID agent_id = folder_sd["agent_id"];
+            if (lost_uuid.notNull())
+            {
+                LLInventoryModel::update_list_t update;
+                LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
+                update.emplace_back(new_folder);
+                gInventory.accountForUpdate(update);
 
-            //if (agent_id != gAgent.getID())    //This should never happen.
-            //{
-            //  LL_WARNS(LOG_INV) << "Got a UpdateInventoryItem for the wrong agent."
-            //          << LL_ENDL;
-            //  break;
-            //}
+                titem->setParent(lost_uuid);
+                titem->updateParentOnServer(false);
+                gInventory.updateItem(titem);
+            }
+        }
+    }
 
-            LLUUID parent_id(folder_sd["folder_id"].asUUID());
-            LLUUID owner_id(folder_sd["owner_id"].asUUID());
-            S32    version(folder_sd["version"].asInteger());
-            S32    descendents(folder_sd["descendents"].asInteger());
-            LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(owner_id);
+    LLViewerInventoryCategory* pcat(gInventory.getCategory(parent_id));
+    if (! pcat)
+    {
+        return;
+    }
 
-            if (parent_id.isNull())
-            {
-                LLSD items(folder_sd["items"]);
-                LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
+    for (const LLSD& category : folder.mCategories)
+    {
+        tcategory->fromLLSD(category);
 
-                for (LLSD::array_const_iterator item_it = items.beginArray();
-                    item_it != items.endArray();
-                    ++item_it)
-                {
-                    const LLUUID lost_uuid(gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND));
+        const bool recursive(getIsRecursive(tcategory->getUUID()));
+        if (recursive)
+        {
+            fetcher->addRequestAtBack(tcategory->getUUID(), recursive, true);
+        }
+        else if (! gInventory.isCategoryComplete(tcategory->getUUID()))
+        {
+            gInventory.updateCategory(tcategory);
+        }
+    }
 
-                    if (lost_uuid.notNull())
-                    {
-                        LLSD item(*item_it);
+    for (LLViewerInventoryItem* titem : folder.mItems)
+    {
+        gInventory.updateItem(titem);
+    }
 
-                        titem->unpackMessage(item);
+    // Set version and descendentcount according to message.
+    LLViewerInventoryCategory* cat(gInventory.getCategory(parent_id));
+    if (cat)
+    {
+        cat->setVersion(folder.mVersion);
+        cat->setDescendentCount(folder.mDescendents);
+        cat->determineFolderType();
+    }
+}
 
-                        LLInventoryModel::update_list_t update;
-                        LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
-                        update.emplace_back(new_folder);
-                        gInventory.accountForUpdate(update);
 
-                        titem->setParent(lost_uuid);
-                        titem->updateParentOnServer(false);
-                        gInventory.updateItem(titem);
-                    }
-                }
-            }
+void BGFolderHttpHandler::processBadFolders(const LLSD& bad_folders)
+{
+    for (LLSD::array_const_iterator folder_it = bad_folders.beginArray();
+         folder_it != bad_folders.endArray();
+         ++folder_it)
+    {
+        const LLSD& folder_sd(*folder_it);
 
-            LLViewerInventoryCategory* pcat(gInventory.getCategory(parent_id));
-            if (! pcat)
-            {
-                continue;
-            }
+        // These folders failed on the dataserver.  We probably don't want to retry them.
+        LL_WARNS(LOG_INV) << "Folder " << folder_sd["folder_id"].asString()
+                          << "Error: " << folder_sd["error"].asString() << LL_ENDL;
+    }
+}
 
-            LLSD categories(folder_sd["categories"]);
-            for (LLSD::array_const_iterator category_it = categories.beginArray();
-                category_it != categories.endArray();
-                ++category_it)
-            {
-                LLSD category(*category_it);
-                tcategory->fromLLSD(category);
 
-                const bool recursive(getIsRecursive(tcategory->getUUID()));
-                if (recursive)
-                {
-                    fetcher->addRequestAtBack(tcategory->getUUID(), recursive, true);
-                }
-                else if (! gInventory.isCategoryComplete(tcategory->getUUID()))
-                {
-                    gInventory.updateCategory(tcategory);
-                }
-            }
+///----------------------------------------------------------------------------
+/// Class <anonymous>::BGFolderHttpHandler::FolderVisitor
+///----------------------------------------------------------------------------
 
-            LLSD items(folder_sd["items"]);
-            LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
-            for (LLSD::array_const_iterator item_it = items.beginArray();
-                 item_it != items.endArray();
-                 ++item_it)
-            {
-                LLSD item(*item_it);
-                titem->unpackMessage(item);
+bool BGFolderHttpHandler::FolderVisitor::beginMap()
+{
+    if (mDepth == 0)
+    {
+        mRootIsMap = true;
+    }
+    else if (mDepth == DEPTH_FOLDERS)
+    {
+        mFolder = FolderData();
+    }
+    else
+    {
+        // Categories, items and anything unexpected come as a whole
+        return true;
+    }
+    ++mDepth;
+    return false;
+}
 
-                gInventory.updateItem(titem);
-            }
+void BGFolderHttpHandler::FolderVisitor::endMap()
+{
+    if (--mDepth == DEPTH_FOLDERS)
+    {
+        mHandler.processFolder(mFolder);
+        mFolder = FolderData();
+    }
+}
 
-            // Set version and descendentcount according to message.
-            LLViewerInventoryCategory* cat(gInventory.getCategory(parent_id));
-            if (cat)
-            {
-                cat->setVersion(version);
-                cat->setDescendentCount(descendents);
-                cat->determineFolderType();
-            }
-        }
+bool BGFolderHttpHandler::FolderVisitor::beginArray()
+{
+    if (mDepth == DEPTH_ROOT && mKey == "folders")
+    {
+        mInFolders = true;
+    }
+    else if (mDepth == DEPTH_FOLDER && (mKey == "categories" || mKey == "items"))
+    {
+        mInItems = (mKey == "items");
+    }
+    else
+    {
+        return true;
     }
+    ++mDepth;
+    return false;
+}
 
-    if (content.has("bad_folders"))
+void BGFolderHttpHandler::FolderVisitor::endArray()
+{
+    if (--mDepth == DEPTH_ROOT)
     {
-        LLSD bad_folders(content["bad_folders"]);
-        for (LLSD::array_const_iterator folder_it = bad_folders.beginArray();
-             folder_it != bad_folders.endArray();
-             ++folder_it)
-        {
-            // *TODO: Stop copying data [ed:  this isn't copying data]
-            LLSD folder_sd(*folder_it);
+        mInFolders = false;
+    }
+}
 
-            // These folders failed on the dataserver.  We probably don't want to retry them.
-            LL_WARNS(LOG_INV) << "Folder " << folder_sd["folder_id"].asString()
-                              << "Error: " << folder_sd["error"].asString() << LL_ENDL;
+void BGFolderHttpHandler::FolderVisitor::value(const LLSD& value)
+{
+    if (mDepth == DEPTH_ROOT)
+    {
+        if (mKey == "error")
+        {
+            mHasError = true;
+        }
+        else if (mKey == "bad_folders")
+        {
+            mBadFolders = value;
         }
     }
-
-    if (fetcher->isBulkFetchProcessingComplete())
+    else if (mDepth == DEPTH_FOLDER && mInFolders)
     {
-        fetcher->setAllFoldersFetched();
+        if (mKey == "folder_id")
+        {
+            mFolder.mFolderID = value.asUUID();
+        }
+        else if (mKey == "owner_id")
+        {
+            mFolder.mOwnerID = value.asUUID();
+        }
+        else if (mKey == "version")
+        {
+            mFolder.mVersion = value.asInteger();
+        }
+        else if (mKey == "descendents")
+        {
+            mFolder.mDescendents = value.asInteger();
+        }
+    }
+    else if (mDepth == DEPTH_FOLDER_CONTENT && mInFolders)
+    {
+        if (mInItems)
+        {
+            LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
+            titem->unpackMessage(value);
+            mFolder.mItems.emplace_back(titem);
+        }
+        else
+        {
+            mFolder.mCategories.emplace_back(value);
+        }
     }
 }
 
@@ -79,9 +79,9 @@
 #include "llfloaterreg.h"
 #include "llvoavatarself.h"
 #include "llskinningutil.h"
+#include "lldir.h"
+#include "llfile.h"
 
-#include "boost/iostreams/device/array.hpp"
-#include "boost/iostreams/stream.hpp"
 #include "boost/lexical_cast.hpp"
 
 #ifndef LL_WINDOWS
@@ -113,6 +113,8 @@
 //
 //   main     Main rendering thread, very sensitive to locking and other stalls
 //   repo     Overseeing worker thread associated with the LLMeshRepoThread class
+//   decodeN  "MeshDecode" thread pool, reads cached assets and decodes LODs,
+//            skin info, decompositions and physics shapes for the repo thread
 //   decom    Worker thread for mesh decomposition requests
 //   core     HTTP worker thread:  does the work but doesn't intrude here
 //   uploadN  0-N temporary mesh upload threads (0-1 in practice)
@@ -150,12 +152,17 @@
 //                             scan mLODReqQ
 //                             fetchMeshLOD() invoked
 //                               issue Byte-Range GET for LOD
+//                               (or a header request first, for an
+//                               indexed header whose asset left the cache)
 //                             ...
 //                             onCompleted() invoked for GET
 //                               data copied
-//                               lodReceived() invoked
-//                                 unpack data into LLVolume
-//                                 append LoadedMesh to mLoadedQ
+//                               postDecode() invoked
+//                             ...
+//                                                 decode thread
+//                                                 lodReceived() invoked
+//                                                   unpack data into LLVolume
+//                                                   append LoadedMesh to mLoadedQ
 //                             ...
 //         notifyLoadedMeshes() invoked again
 //           scan mLoadedQ
@@ -169,6 +176,7 @@
 //   LLMeshRepository::mMeshMutex
 //   LLMeshRepoThread::mMutex
 //   LLMeshRepoThread::mHeaderMutex
+//   LLMeshRepoThread::mSkinMapMutex
 //   LLMeshRepoThread::mSignal (LLCondition)
 //   LLPhysicsDecomp::mSignal (LLCondition)
 //   LLPhysicsDecomp::mMutex
@@ -225,7 +233,7 @@
 //     sHTTPErrorCount                 "
 //     sLODPending                     mMeshMutex [4]  rw.main.mMeshMutex
 //     sLODProcessing                  Repo::mMutex    rw.any.Repo::mMutex
-//     sCacheBytesRead                 none            rw.repo.none, ro.main.none [1]
+//     sCacheBytesRead                 atomic          rw.repo.none, rw.decodeN.none, ro.main.none
 //     sCacheBytesWritten              "
 //     sCacheReads                     "
 //     sCacheWrites                    "
@@ -251,6 +259,7 @@
 //     sActiveLODRequests       mMutex        rw.any.mMutex, ro.repo.none [1]
 //     sMaxConcurrentRequests   mMutex        wo.main.none, ro.repo.none, ro.main.mMutex
 //     mMeshHeader              mHeaderMutex  rw.repo.mHeaderMutex, ro.main.mHeaderMutex, ro.main.none [0]
+//                                            wo.main.mHeaderMutex (index load), ro.main.mHeaderMutex (index save)
 //     mSkinRequests            mMutex        rw.repo.mMutex, ro.repo.none [5]
 //     mSkinInfoQ               mMutex        rw.repo.mMutex, rw.main.mMutex [5] (was:  [0])
 //     mDecompositionRequests   mMutex        rw.repo.mMutex, ro.repo.none [5]
@@ -345,6 +354,8 @@ LLMeshRepository gMeshRepo;
 
 const S32 MESH_HEADER_SIZE = 4096;                      // Important:  assumption is that headers fit in this space
 
+const U32 MESH_HEADER_INDEX_MAX_ENTRIES = 32768;        // Headers kept across sessions, about 2.5MB
+
 
 const S32 REQUEST2_HIGH_WATER_MIN = 32;                 // Limits for GetMesh2 regions
 const S32 REQUEST2_HIGH_WATER_MAX = 100;
@@ -385,13 +396,13 @@ U32 LLMeshRepository::sHTTPErrorCount = 0;
 U32 LLMeshRepository::sLODProcessing = 0;
 U32 LLMeshRepository::sLODPending = 0;
 
-U32 LLMeshRepository::sCacheBytesRead = 0;
-U32 LLMeshRepository::sCacheBytesWritten = 0;
+std::atomic<U32> LLMeshRepository::sCacheBytesRead(0);
+std::atomic<U32> LLMeshRepository::sCacheBytesWritten(0);
 U32 LLMeshRepository::sCacheBytesHeaders = 0;
 U32 LLMeshRepository::sCacheBytesSkins = 0;
 U32 LLMeshRepository::sCacheBytesDecomps = 0;
-U32 LLMeshRepository::sCacheReads = 0;
-U32 LLMeshRepository::sCacheWrites = 0;
+std::atomic<U32> LLMeshRepository::sCacheReads(0);
+std::atomic<U32> LLMeshRepository::sCacheWrites(0);
 U32 LLMeshRepository::sMaxLockHoldoffs = 0;
 
 LLDeadmanTimer LLMeshRepository::sQuiescentTimer(15.0, false);  // true -> gather cpu metrics
@@ -831,7 +842,8 @@ LLMeshRepoThread::LLMeshRepoThread()
   mHttpHeaders(),
   mHttpPolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpLargePolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
-  mWorkQueue("MeshRepoThread", 1024*1024)
+  mWorkQueue("MeshRepoThread", 1024*1024),
+  mDecodePool(NULL)
 {
     LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
 
@@ -849,6 +861,11 @@ LLMeshRepoThread::LLMeshRepoThread()
     mHttpHeaders->append(HTTP_OUT_HEADER_ACCEPT, HTTP_CONTENT_VND_LL_MESH);
     mHttpPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH2);
     mHttpLargePolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_LARGE_MESH);
+
+    // Leave cores for the main thread and the texture decoding
+    const U32 decode_threads = llclamp(std::thread::hardware_concurrency() / 2, 1U, 4U);
+    mDecodePool = new LL::ThreadPool("MeshDecode", decode_threads);
+    mDecodePool->start();
 }
 
 
@@ -859,6 +876,11 @@ LLMeshRepoThread::~LLMeshRepoThread()
                        << ", Max Lock Holdoffs:  " << LLMeshRepository::sMaxLockHoldoffs
                        << LL_ENDL;
 
+    // Finishes the pending decodes, which still use the queues and mutexes
+    mDecodePool->close();
+    delete mDecodePool;
+    mDecodePool = NULL;
+
     mHttpRequestSet.clear();
     mHttpHeaders.reset();
 
@@ -950,7 +972,7 @@ void LLMeshRepoThread::run()
                     // failed to load before, wait a bit
                     incomplete.push_front(req);
                 }
-                else if (!fetchMeshLOD(req.mMeshParams, req.mLOD, req.canRetry()))
+                else if (!fetchMeshLOD(req))
                 {
                     if (req.canRetry())
                     {
@@ -1050,7 +1072,7 @@ void LLMeshRepoThread::run()
                     {
                         incomplete.emplace_back(req);
                     }
-                    else if (!fetchMeshSkinInfo(req.mId, req.canRetry()))
+                    else if (!fetchMeshSkinInfo(req))
                     {
                         if (req.canRetry())
                         {
@@ -1229,6 +1251,21 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
     }
 }
 
+void LLMeshRepoThread::postDecode(const std::function<void()>& work)
+{
+    // Runs inline if the pool is gone or closed, as during shutdown
+    if (!mDecodePool || !mDecodePool->getQueue().post(work))
+    {
+        work();
+    }
+}
+
+void LLMeshRepoThread::postToRepoThread(const std::function<void()>& work)
+{
+    mWorkQueue.post(work);
+    mSignal->signal();
+}
+
 // Mutex:  must be holding mMutex when called
 void LLMeshRepoThread::setGetMeshCap(const std::string & mesh_cap)
 {
@@ -1327,9 +1364,11 @@ LLCore::HttpHandle LLMeshRepoThread::getByteRange(const std::string & url,
 }
 
 
-bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
+bool LLMeshRepoThread::fetchMeshSkinInfo(const UUIDBasedRequest& req)
 {
     LL_PROFILE_ZONE_SCOPED;
+    const LLUUID& mesh_id = req.mId;
+    bool can_retry = req.canRetry();
     if (!mHeaderMutex)
     {
         return false;
@@ -1364,78 +1403,119 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
             LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
             if (file.getSize() >= offset + size)
             {
-                U8* buffer = new(std::nothrow) U8[size];
-                if (!buffer)
-                {
-                    LL_WARNS(LOG_MESH) << "Failed to allocate memory for skin info, size: " << size << LL_ENDL;
-
-                    // Not sure what size is reasonable for skin info,
-                    // but if 20MB allocation failed, we definetely have issues
-                    const S32 MAX_SIZE = 30 * 1024 * 1024; //30MB
-                    if (size < MAX_SIZE)
+                // read and decoded on the decode pool, which comes back
+                // here to fetch from sim if the cached data is bad
+                postDecode([this, req, offset, size]()
                     {
-                        LLAppViewer::instance()->outOfMemorySoftQuit();
-                    } // else ignore failures for anomalously large data
-                    LLMutexLock locker(mMutex);
-                    mSkinUnavailableQ.emplace_back(mesh_id);
-                    return true;
-                }
-                LLMeshRepository::sCacheBytesRead += size;
-                ++LLMeshRepository::sCacheReads;
-                file.seek(offset);
-                file.read(buffer, size);
+                        loadCachedMeshSkinInfo(req, offset, size);
+                    });
+                return true;
+            }
 
-                //make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
-                bool zero = true;
-                for (S32 i = 0; i < llmin(size, 1024) && zero; ++i)
-                {
-                    zero = buffer[i] == 0;
-                }
+            //not in cache, fetch from sim
+            ret = requestMeshSkinInfo(mesh_id, offset, size, can_retry);
+        }
+        else
+        {
+            LLMutexLock locker(mMutex);
+            mSkinUnavailableQ.emplace_back(mesh_id);
+        }
+    }
+    else
+    {
+        mHeaderMutex->unlock();
+    }
 
-                if (!zero)
-                { //attempt to parse
-                    if (skinInfoReceived(mesh_id, buffer, size))
-                    {
-                        delete[] buffer;
-                        return true;
-                    }
-                }
+    //early out was not hit, effectively fetched
+    return ret;
+}
 
-                delete[] buffer;
-            }
+void LLMeshRepoThread::loadCachedMeshSkinInfo(const UUIDBasedRequest& req, S32 offset, S32 size)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const LLUUID& mesh_id = req.mId;
+    U8* buffer = new(std::nothrow) U8[size];
+    if (!buffer)
+    {
+        LL_WARNS(LOG_MESH) << "Failed to allocate memory for skin info, size: " << size << LL_ENDL;
 
-            //reading from cache failed for whatever reason, fetch from sim
-            std::string http_url;
-            constructUrl(mesh_id, &http_url);
+        // Not sure what size is reasonable for skin info,
+        // but if 20MB allocation failed, we definetely have issues
+        const S32 MAX_SIZE = 30 * 1024 * 1024; //30MB
+        if (size < MAX_SIZE)
+        {
+            LLAppViewer::instance()->outOfMemorySoftQuit();
+        } // else ignore failures for anomalously large data
+        LLMutexLock locker(mMutex);
+        mSkinUnavailableQ.emplace_back(mesh_id);
+        return;
+    }
+    LLMeshRepository::sCacheBytesRead += size;
+    ++LLMeshRepository::sCacheReads;
+    LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
+    file.seek(offset);
+    file.read(buffer, size);
 
-            if (!http_url.empty())
+    //make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
+    bool zero = true;
+    for (S32 i = 0; i < llmin(size, 1024) && zero; ++i)
+    {
+        zero = buffer[i] == 0;
+    }
+
+    //attempt to parse
+    if (!zero && skinInfoReceived(mesh_id, buffer, size))
+    {
+        delete[] buffer;
+        return;
+    }
+
+    delete[] buffer;
+
+    //reading from cache failed for whatever reason, fetch from sim
+    postToRepoThread([this, req = UUIDBasedRequest(req), offset, size]() mutable
+        {
+            if (!requestMeshSkinInfo(req.mId, offset, size, req.canRetry()))
             {
-                LLMeshHandlerBase::ptr_t handler(new LLMeshSkinInfoHandler(mesh_id, offset, size));
-                LLCore::HttpHandle handle = getByteRange(http_url, offset, size, handler);
-                if (LLCORE_HTTP_HANDLE_INVALID == handle)
-                {
-                    LL_WARNS(LOG_MESH) << "HTTP GET request failed for skin info on mesh " << mID
-                                       << ".  Reason:  " << mHttpStatus.toString()
-                                       << " (" << mHttpStatus.toTerseString() << ")"
-                                       << LL_ENDL;
-                    ret = false;
-                }
-                else if(can_retry)
+                LLMutexLock locker(mMutex);
+                if (req.canRetry())
                 {
-                    handler->mHttpHandle = handle;
-                    mHttpRequestSet.insert(handler);
+                    // failed, resubmit
+                    req.updateTime();
+                    mSkinRequests.push_back(req);
                 }
                 else
                 {
-                    LLMutexLock locker(mMutex);
-                    mSkinUnavailableQ.emplace_back(mesh_id);
+                    mSkinUnavailableQ.push_back(req);
                 }
             }
-            else
-            {
-                LLMutexLock locker(mMutex);
-                mSkinUnavailableQ.emplace_back(mesh_id);
-            }
+        });
+}
+
+//return false if the request could not be issued
+bool LLMeshRepoThread::requestMeshSkinInfo(const LLUUID& mesh_id, S32 offset, S32 size, bool can_retry)
+{
+    bool ret = true;
+
+    std::string http_url;
+    constructUrl(mesh_id, &http_url);
+
+    if (!http_url.empty())
+    {
+        LLMeshHandlerBase::ptr_t handler(new LLMeshSkinInfoHandler(mesh_id, offset, size));
+        LLCore::HttpHandle handle = getByteRange(http_url, offset, size, handler);
+        if (LLCORE_HTTP_HANDLE_INVALID == handle)
+        {
+            LL_WARNS(LOG_MESH) << "HTTP GET request failed for skin info on mesh " << mID
+                               << ".  Reason:  " << mHttpStatus.toString()
+                               << " (" << mHttpStatus.toTerseString() << ")"
+                               << LL_ENDL;
+            ret = false;
+        }
+        else if(can_retry)
+        {
+            handler->mHttpHandle = handle;
+            mHttpRequestSet.insert(handler);
         }
         else
         {
@@ -1445,10 +1525,10 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
     }
     else
     {
-        mHeaderMutex->unlock();
+        LLMutexLock locker(mMutex);
+        mSkinUnavailableQ.emplace_back(mesh_id);
     }
 
-    //early out was not hit, effectively fetched
     return ret;
 }
 
@@ -1764,9 +1844,12 @@ bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, bool c
 }
 
 //return false if failed to get mesh lod.
-bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry)
+bool LLMeshRepoThread::fetchMeshLOD(const LODRequest& req)
 {
     LL_PROFILE_ZONE_SCOPED;
+    const LLVolumeParams& mesh_params = req.mMeshParams;
+    S32 lod = req.mLOD;
+    bool can_retry = req.canRetry();
     if (!mHeaderMutex)
     {
         return false;
@@ -1791,6 +1874,8 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
         S32 version = header.mVersion;
         S32 offset = header_size + header.mLodOffset[lod];
         S32 size = header.mLodSize[lod];
+        bool indexed = header.mIndexed;
+        bool has_skin = header.mSkinSize > 0;
         mHeaderMutex->unlock();
 
         if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
@@ -1798,86 +1883,165 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 
             //check cache for mesh asset
             LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
-            if (file.getSize() >= offset+size)
+            S32 cached_size = file.getSize();
+            if (indexed && cached_size < (S32)header_size)
             {
-                U8* buffer = new(std::nothrow) U8[size];
-                if (!buffer)
+                // The header came from the index but the asset is no longer
+                // cached.  Read the header again, which reserves the asset in
+                // the cache, and let this LOD follow it.
+                LLMutexLock lock(mMutex);
+                std::vector<S32>& pending = mPendingLOD[mesh_id];
+                if (pending.empty())
                 {
-                    LL_WARNS(LOG_MESH) << "Can't allocate memory for mesh " << mesh_id << " LOD " << lod << ", size: " << size << LL_ENDL;
-
-                    // Not sure what size is reasonable for a mesh,
-                    // but if 20MB allocation failed, we definetely have issues
-                    const S32 MAX_SIZE = 30 * 1024 * 1024; //30MB
-                    if (size < MAX_SIZE)
+                    mHeaderReqQ.push(HeaderRequest(mesh_params));
+                }
+                pending.push_back(lod);
+                return true;
+            }
+            if (indexed)
+            {
+                // first use of an indexed header this session, do what
+                // headerReceived() would have
+                {
+                    LLMutexLock lock(mHeaderMutex);
+                    header_it = mMeshHeader.find(mesh_id);
+                    if (header_it != mMeshHeader.end())
                     {
-                        LLAppViewer::instance()->outOfMemorySoftQuit();
-                    } // else ignore failures for anomalously large data
-                    LLMutexLock lock(mMutex);
-                    mUnavailableQ.push_back(LODRequest(mesh_params, lod));
-                    return true;
+                        header_it->second.second.mIndexed = false;
+                    }
                 }
-                LLMeshRepository::sCacheBytesRead += size;
-                ++LLMeshRepository::sCacheReads;
-                file.seek(offset);
-                file.read(buffer, size);
-
-                //make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
-                bool zero = true;
-                for (S32 i = 0; i < llmin(size, 1024) && zero; ++i)
+                if (has_skin)
                 {
-                    zero = buffer[i] == 0;
+                    prefetchMeshSkinInfo(mesh_id);
                 }
+            }
 
-                if (!zero)
-                { //attempt to parse
-                    if (lodReceived(mesh_params, lod, buffer, size) == MESH_OK)
+            if (cached_size >= offset+size)
+            {
+                // read and decoded on the decode pool, which comes back
+                // here to fetch from sim if the cached data is bad
+                postDecode([this, req, offset, size]()
                     {
-                        delete[] buffer;
+                        loadCachedMeshLOD(req, offset, size);
+                    });
+                return true;
+            }
 
-                        LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh body for ID " << mesh_id << " - was retrieved from the cache." << LL_ENDL;
+            //not in cache, fetch from sim
+            retval = requestMeshLOD(mesh_params, lod, offset, size, can_retry);
+        }
+        else
+        {
+            LLMutexLock lock(mMutex);
+            mUnavailableQ.push_back(LODRequest(mesh_params, lod));
+        }
+    }
+    else
+    {
+        mHeaderMutex->unlock();
+    }
 
-                        return true;
-                    }
-                }
+    return retval;
+}
 
-                delete[] buffer;
-            }
+void LLMeshRepoThread::loadCachedMeshLOD(const LODRequest& req, S32 offset, S32 size)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const LLVolumeParams& mesh_params = req.mMeshParams;
+    S32 lod = req.mLOD;
+    const LLUUID& mesh_id = mesh_params.getSculptID();
 
-            //reading from cache failed for whatever reason, fetch from sim
-            std::string http_url;
-            constructUrl(mesh_id, &http_url);
+    U8* buffer = new(std::nothrow) U8[size];
+    if (!buffer)
+    {
+        LL_WARNS(LOG_MESH) << "Can't allocate memory for mesh " << mesh_id << " LOD " << lod << ", size: " << size << LL_ENDL;
 
-            if (!http_url.empty())
-            {
-                LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh body for ID " << mesh_id << " - was retrieved from the simulator." << LL_ENDL;
+        // Not sure what size is reasonable for a mesh,
+        // but if 20MB allocation failed, we definetely have issues
+        const S32 MAX_SIZE = 30 * 1024 * 1024; //30MB
+        if (size < MAX_SIZE)
+        {
+            LLAppViewer::instance()->outOfMemorySoftQuit();
+        } // else ignore failures for anomalously large data
+        LLMutexLock lock(mMutex);
+        mUnavailableQ.push_back(LODRequest(mesh_params, lod));
+        return;
+    }
+    LLMeshRepository::sCacheBytesRead += size;
+    ++LLMeshRepository::sCacheReads;
+    LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
+    file.seek(offset);
+    file.read(buffer, size);
 
-                LLMeshHandlerBase::ptr_t handler(new LLMeshLODHandler(mesh_params, lod, offset, size));
-                LLCore::HttpHandle handle = getByteRange(http_url, offset, size, handler);
-                if (LLCORE_HTTP_HANDLE_INVALID == handle)
-                {
-                    LL_WARNS(LOG_MESH) << "HTTP GET request failed for LOD on mesh " << mID
-                                       << ".  Reason:  " << mHttpStatus.toString()
-                                       << " (" << mHttpStatus.toTerseString() << ")"
-                                       << LL_ENDL;
-                    retval = false;
-                }
-                else if (can_retry)
+    //make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
+    bool zero = true;
+    for (S32 i = 0; i < llmin(size, 1024) && zero; ++i)
+    {
+        zero = buffer[i] == 0;
+    }
+
+    //attempt to parse
+    if (!zero && lodReceived(mesh_params, lod, buffer, size) == MESH_OK)
+    {
+        delete[] buffer;
+
+        LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh body for ID " << mesh_id << " - was retrieved from the cache." << LL_ENDL;
+
+        return;
+    }
+
+    delete[] buffer;
+
+    //reading from cache failed for whatever reason, fetch from sim
+    postToRepoThread([this, req = LODRequest(req), offset, size]() mutable
+        {
+            if (!requestMeshLOD(req.mMeshParams, req.mLOD, offset, size, req.canRetry()))
+            {
+                LLMutexLock lock(mMutex);
+                if (req.canRetry())
                 {
-                    handler->mHttpHandle = handle;
-                    mHttpRequestSet.insert(handler);
-                    // *NOTE:  Allowing a re-request, not marking as unavailable.  Is that correct?
+                    // failed, resubmit
+                    req.updateTime();
+                    mLODReqQ.push(req);
+                    ++LLMeshRepository::sLODProcessing;
                 }
                 else
                 {
-                    LLMutexLock lock(mMutex);
-                    mUnavailableQ.push_back(LODRequest(mesh_params, lod));
+                    mUnavailableQ.push_back(req);
+                    LL_WARNS() << "Failed to load " << req.mMeshParams << " , skip" << LL_ENDL;
                 }
             }
-            else
-            {
-                LLMutexLock lock(mMutex);
-                mUnavailableQ.push_back(LODRequest(mesh_params, lod));
-            }
+        });
+}
+
+//return false if the request could not be issued
+bool LLMeshRepoThread::requestMeshLOD(const LLVolumeParams& mesh_params, S32 lod, S32 offset, S32 size, bool can_retry)
+{
+    const LLUUID& mesh_id = mesh_params.getSculptID();
+    bool retval = true;
+
+    std::string http_url;
+    constructUrl(mesh_id, &http_url);
+
+    if (!http_url.empty())
+    {
+        LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh body for ID " << mesh_id << " - was retrieved from the simulator." << LL_ENDL;
+
+        LLMeshHandlerBase::ptr_t handler(new LLMeshLODHandler(mesh_params, lod, offset, size));
+        LLCore::HttpHandle handle = getByteRange(http_url, offset, size, handler);
+        if (LLCORE_HTTP_HANDLE_INVALID == handle)
+        {
+            LL_WARNS(LOG_MESH) << "HTTP GET request failed for LOD on mesh " << mID
+                               << ".  Reason:  " << mHttpStatus.toString()
+                               << " (" << mHttpStatus.toTerseString() << ")"
+                               << LL_ENDL;
+            retval = false;
+        }
+        else if (can_retry)
+        {
+            handler->mHttpHandle = handle;
+            mHttpRequestSet.insert(handler);
+            // *NOTE:  Allowing a re-request, not marking as unavailable.  Is that correct?
         }
         else
         {
@@ -1887,12 +2051,28 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
     }
     else
     {
-        mHeaderMutex->unlock();
+        LLMutexLock lock(mMutex);
+        mUnavailableQ.push_back(LODRequest(mesh_params, lod));
     }
 
     return retval;
 }
 
+void LLMeshRepoThread::prefetchMeshSkinInfo(const LLUUID& mesh_id)
+{
+    // immediately request SkinInfo since we'll need it before we can render any LoD if it is present
+    {
+        LLMutexLock lock(gMeshRepo.mMeshMutex);
+
+        if (gMeshRepo.mLoadingSkins.find(mesh_id) == gMeshRepo.mLoadingSkins.end())
+        {
+            gMeshRepo.mLoadingSkins[mesh_id] = {}; // add an empty vector to indicate to main thread that we are loading skin info
+        }
+    }
+
+    fetchMeshSkinInfo(UUIDBasedRequest(mesh_id));
+}
+
 EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size)
 {
     const LLUUID mesh_id = mesh_params.getSculptID();
@@ -1908,9 +2088,8 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
 
         data_size = (S32)dsize;
 
-        boost::iostreams::stream<boost::iostreams::array_source> stream(result_ptr, data_size);
-
-        if (!LLSDSerialize::fromBinary(header_data, stream, data_size))
+        size_t parsed_bytes = 0;
+        if (LLSDSerialize::fromBinary(header_data, (const U8*)result_ptr, data_size, -1, &parsed_bytes) <= 0)
         {
             LL_WARNS(LOG_MESH) << "Mesh header parse error.  Not a valid mesh asset!  ID:  " << mesh_id
                                << LL_ENDL;
@@ -1933,7 +2112,7 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
         // make sure there is at least one lod, function returns -1 and marks as 404 otherwise
         else if (LLMeshRepository::getActualMeshLOD(header, 0) >= 0)
         {
-            header_size += stream.tellg();
+            header_size += parsed_bytes;
         }
     }
     else
@@ -1951,17 +2130,7 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
             LLMeshRepository::sCacheBytesHeaders += (U32)header_size;
         }
 
-        // immediately request SkinInfo since we'll need it before we can render any LoD if it is present
-        {
-            LLMutexLock lock(gMeshRepo.mMeshMutex);
-
-            if (gMeshRepo.mLoadingSkins.find(mesh_id) == gMeshRepo.mLoadingSkins.end())
-            {
-                gMeshRepo.mLoadingSkins[mesh_id] = {}; // add an empty vector to indicate to main thread that we are loading skin info
-            }
-        }
-
-        fetchMeshSkinInfo(mesh_id);
+        prefetchMeshSkinInfo(mesh_id);
 
         LLMutexLock lock(mMutex); // make sure only one thread access mPendingLOD at the same time.
 
@@ -1995,14 +2164,18 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
         if (volume->getNumFaces() > 0)
         {
             // if we have a valid SkinInfo, cache per-joint bounding boxes for this LOD
-            LLMeshSkinInfo* skin_info = mSkinMap[mesh_params.getSculptID()];
-            if (skin_info && isAgentAvatarValid())
             {
-                for (S32 i = 0; i < volume->getNumFaces(); ++i)
+                LLSharedMutexLock skin_lock(&mSkinMapMutex);
+                skin_map::const_iterator skin_it = mSkinMap.find(mesh_params.getSculptID());
+                const LLMeshSkinInfo* skin_info = skin_it != mSkinMap.end() ? skin_it->second.get() : NULL;
+                if (skin_info && isAgentAvatarValid())
                 {
-                    // NOTE: no need to lock gAgentAvatarp as the state being checked is not changed after initialization
-                    LLVolumeFace& face = volume->getVolumeFace(i);
-                    LLSkinningUtil::updateRiggingInfo(skin_info, gAgentAvatarp, face);
+                    for (S32 i = 0; i < volume->getNumFaces(); ++i)
+                    {
+                        // NOTE: no need to lock gAgentAvatarp as the state being checked is not changed after initialization
+                        LLVolumeFace& face = volume->getVolumeFace(i);
+                        LLSkinningUtil::updateRiggingInfo(skin_info, gAgentAvatarp, face);
+                    }
                 }
             }
 
@@ -2060,7 +2233,12 @@ bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 dat
 
         // copy the skin info for the background thread so we can use it
         // to calculate per-joint bounding boxes when volumes are loaded
-        mSkinMap[mesh_id] = new LLMeshSkinInfo(*info);
+        // (moved in so that its reference count only changes under the lock)
+        LLPointer<LLMeshSkinInfo> info_copy = new LLMeshSkinInfo(*info);
+        {
+            LLExclusiveMutexLock skin_lock(&mSkinMapMutex);
+            mSkinMap[mesh_id] = std::move(info_copy);
+        }
 
         {
             // Move the LLPointer in to the skin info queue to avoid reference
@@ -3392,6 +3570,21 @@ void LLMeshLODHandler::processFailure(LLCore::HttpStatus status)
     gMeshRepo.mThread->mUnavailableQ.push_back(LLMeshRepoThread::LODRequest(mMeshParams, mLOD));
 }
 
+// Writes a block fetched from the sim to the cache, if the cache file
+// has room for it.  Any thread.
+static void write_mesh_cache(const LLUUID& mesh_id, S32 offset, S32 size, const U8* data)
+{
+    LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
+
+    if (file.getSize() >= offset+size)
+    {
+        LLMeshRepository::sCacheBytesWritten += size;
+        ++LLMeshRepository::sCacheWrites;
+        file.seek(offset);
+        file.write(data, size);
+    }
+}
+
 void LLMeshLODHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
                                    U8 * data, S32 data_size)
 {
@@ -3399,34 +3592,33 @@ void LLMeshLODHandler::processData(LLCore::BufferArray * /* body */, S32 /* body
     if ((!MESH_LOD_PROCESS_FAILED)
         && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        EMeshProcessingResult result = gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size);
-        if (result == MESH_OK)
-        {
-            // good fetch from sim, write to cache
-            LLFileSystem file(mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
-            S32 offset = mOffset;
-            S32 size = mRequestedBytes;
-
-            if (file.getSize() >= offset+size)
+        // data is released on return, decode a copy
+        std::shared_ptr<std::vector<U8>> buffer = std::make_shared<std::vector<U8>>(data, data + data_size);
+        LLVolumeParams mesh_params = mMeshParams;
+        S32 lod = mLOD;
+        S32 offset = mOffset;
+        S32 size = mRequestedBytes;
+        gMeshRepo.mThread->postDecode([buffer, mesh_params, lod, offset, size]()
             {
-                file.seek(offset);
-                file.write(data, size);
-                LLMeshRepository::sCacheBytesWritten += size;
-                ++LLMeshRepository::sCacheWrites;
-            }
-        }
-        else
-        {
-            LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mMeshParams.getSculptID()
-                               << ", Reason: " << result
-                               << " LOD: " << mLOD
-                               << " Data size: " << data_size
-                               << " Not retrying."
-                               << LL_ENDL;
-            LLMutexLock lock(gMeshRepo.mThread->mMutex);
-            gMeshRepo.mThread->mUnavailableQ.push_back(LLMeshRepoThread::LODRequest(mMeshParams, mLOD));
-        }
+                S32 lod_size = static_cast<S32>(buffer->size());
+                EMeshProcessingResult result = gMeshRepo.mThread->lodReceived(mesh_params, lod, buffer->data(), lod_size);
+                if (result == MESH_OK)
+                {
+                    // good fetch from sim, write to cache
+                    write_mesh_cache(mesh_params.getSculptID(), offset, size, buffer->data());
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mesh_params.getSculptID()
+                                       << ", Reason: " << result
+                                       << " LOD: " << lod
+                                       << " Data size: " << lod_size
+                                       << " Not retrying."
+                                       << LL_ENDL;
+                    LLMutexLock lock(gMeshRepo.mThread->mMutex);
+                    gMeshRepo.mThread->mUnavailableQ.push_back(LLMeshRepoThread::LODRequest(mesh_params, lod));
+                }
+            });
     }
     else
     {
@@ -3463,22 +3655,29 @@ void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * /* body */, S32 /*
 {
     LL_PROFILE_ZONE_SCOPED;
     if ((!MESH_SKIN_INFO_PROCESS_FAILED)
-        && ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-        && gMeshRepo.mThread->skinInfoReceived(mMeshID, data, data_size))
+        && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        // good fetch from sim, write to cache
-        LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
+        // data is released on return, decode a copy
+        std::shared_ptr<std::vector<U8>> buffer = std::make_shared<std::vector<U8>>(data, data + data_size);
+        LLUUID mesh_id = mMeshID;
         S32 offset = mOffset;
         S32 size = mRequestedBytes;
-
-        if (file.getSize() >= offset+size)
-        {
-            LLMeshRepository::sCacheBytesWritten += size;
-            ++LLMeshRepository::sCacheWrites;
-            file.seek(offset);
-            file.write(data, size);
-        }
+        gMeshRepo.mThread->postDecode([buffer, mesh_id, offset, size]()
+            {
+                if (gMeshRepo.mThread->skinInfoReceived(mesh_id, buffer->data(), static_cast<S32>(buffer->size())))
+                {
+                    // good fetch from sim, write to cache
+                    write_mesh_cache(mesh_id, offset, size, buffer->data());
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh skin info processing.  ID:  " << mesh_id
+                                       << ", Unknown reason.  Not retrying."
+                                       << LL_ENDL;
+                    LLMutexLock lock(gMeshRepo.mThread->mMutex);
+                    gMeshRepo.mThread->mSkinUnavailableQ.emplace_back(mesh_id);
+                }
+            });
     }
     else
     {
@@ -3513,22 +3712,28 @@ void LLMeshDecompositionHandler::processData(LLCore::BufferArray * /* body */, S
 {
     LL_PROFILE_ZONE_SCOPED;
     if ((!MESH_DECOMP_PROCESS_FAILED)
-        && ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-        && gMeshRepo.mThread->decompositionReceived(mMeshID, data, data_size))
+        && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        // good fetch from sim, write to cache
-        LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
+        // data is released on return, decode a copy
+        std::shared_ptr<std::vector<U8>> buffer = std::make_shared<std::vector<U8>>(data, data + data_size);
+        LLUUID mesh_id = mMeshID;
         S32 offset = mOffset;
         S32 size = mRequestedBytes;
-
-        if (file.getSize() >= offset+size)
-        {
-            LLMeshRepository::sCacheBytesWritten += size;
-            ++LLMeshRepository::sCacheWrites;
-            file.seek(offset);
-            file.write(data, size);
-        }
+        gMeshRepo.mThread->postDecode([buffer, mesh_id, offset, size]()
+            {
+                if (gMeshRepo.mThread->decompositionReceived(mesh_id, buffer->data(), static_cast<S32>(buffer->size())))
+                {
+                    // good fetch from sim, write to cache
+                    write_mesh_cache(mesh_id, offset, size, buffer->data());
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh decomposition processing.  ID:  " << mesh_id
+                                       << ", Unknown reason.  Not retrying."
+                                       << LL_ENDL;
+                    // *TODO:  Mark mesh unavailable on error
+                }
+            });
     }
     else
     {
@@ -3561,22 +3766,29 @@ void LLMeshPhysicsShapeHandler::processData(LLCore::BufferArray * /* body */, S3
 {
     LL_PROFILE_ZONE_SCOPED;
     if ((!MESH_PHYS_SHAPE_PROCESS_FAILED)
-        && ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-        && gMeshRepo.mThread->physicsShapeReceived(mMeshID, data, data_size) == MESH_OK)
+        && ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
     {
-        // good fetch from sim, write to cache for caching
-        LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
+        // data is released on return, decode a copy
+        std::shared_ptr<std::vector<U8>> buffer = std::make_shared<std::vector<U8>>(data, data + data_size);
+        LLUUID mesh_id = mMeshID;
         S32 offset = mOffset;
         S32 size = mRequestedBytes;
-
-        if (file.getSize() >= offset+size)
-        {
-            LLMeshRepository::sCacheBytesWritten += size;
-            ++LLMeshRepository::sCacheWrites;
-            file.seek(offset);
-            file.write(data, size);
-        }
+        gMeshRepo.mThread->postDecode([buffer, mesh_id, offset, size]()
+            {
+                U8* shape_data = buffer->empty() ? NULL : buffer->data();
+                if (gMeshRepo.mThread->physicsShapeReceived(mesh_id, shape_data, static_cast<S32>(buffer->size())) == MESH_OK)
+                {
+                    // good fetch from sim, write to cache for caching
+                    write_mesh_cache(mesh_id, offset, size, buffer->data());
+                }
+                else
+                {
+                    LL_WARNS(LOG_MESH) << "Error during mesh physics shape processing.  ID:  " << mesh_id
+                                       << ", Unknown reason.  Not retrying."
+                                       << LL_ENDL;
+                    // *TODO:  Mark mesh unavailable on error
+                }
+            });
     }
     else
     {
@@ -3618,6 +3830,7 @@ void LLMeshRepository::init()
     metrics_teleport_started_signal = LLViewerMessage::getInstance()->setTeleportStartedCallback(teleport_started);
 
     mThread = new LLMeshRepoThread();
+    mThread->loadHeaderIndex();
     mThread->start();
 }
 
@@ -3641,6 +3854,7 @@ void LLMeshRepository::shutdown()
     {
         apr_sleep(10);
     }
+    mThread->saveHeaderIndex();
     delete mThread;
     mThread = NULL;
 
@@ -3961,6 +4175,7 @@ void LLMeshRepository::notifyLoadedMeshes()
             // erase from background thread
             mThread->mWorkQueue.post([=]()
                 {
+                    LLExclusiveMutexLock skin_lock(&mThread->mSkinMapMutex);
                     mThread->mSkinMap.erase(id);
                 });
         }
@@ -4451,6 +4666,180 @@ bool LLMeshRepoThread::hasHeader(const LLUUID& mesh_id)
     return iter != mMeshHeader.end();
 }
 
+// An entry of the header index file, in host byte order
+struct LLMeshHeaderIndexEntry
+{
+    U8  mID[UUID_BYTES];
+    U32 mHeaderSize;
+    S32 mVersion;
+    S32 mSkinOffset;
+    S32 mSkinSize;
+    S32 mPhysicsConvexOffset;
+    S32 mPhysicsConvexSize;
+    S32 mPhysicsMeshOffset;
+    S32 mPhysicsMeshSize;
+    S32 mLodOffset[4];
+    S32 mLodSize[4];
+};
+static_assert(sizeof(LLMeshHeaderIndexEntry) == 80, "Unexpected mesh header index entry size");
+
+struct LLMeshHeaderIndexHeader
+{
+    U32 mMagic;
+    U32 mVersion;
+    U32 mCount;
+};
+
+static constexpr U32 MESH_HEADER_INDEX_MAGIC = 0x49484D4C;    // "LMHI"
+static constexpr U32 MESH_HEADER_INDEX_VERSION = 1;
+
+static std::string get_mesh_header_index_filename()
+{
+    return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "mesh_headers.idx");
+}
+
+// Called from the main thread before start()
+void LLMeshRepoThread::loadHeaderIndex()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const std::string filename = get_mesh_header_index_filename();
+    LLUniqueFile file = LLFile::fopen(filename, "rb");
+    if (!file)
+    {
+        return;
+    }
+
+    LLMeshHeaderIndexHeader index_header;
+    std::vector<LLMeshHeaderIndexEntry> entries;
+    bool valid = fread(&index_header, sizeof(index_header), 1, file) == 1 &&
+                 index_header.mMagic == MESH_HEADER_INDEX_MAGIC &&
+                 index_header.mVersion == MESH_HEADER_INDEX_VERSION &&
+                 index_header.mCount <= MESH_HEADER_INDEX_MAX_ENTRIES;
+    if (valid)
+    {
+        entries.resize(index_header.mCount);
+        valid = fread(entries.data(), sizeof(LLMeshHeaderIndexEntry), entries.size(), file) == entries.size();
+    }
+    file.close();
+    if (!valid)
+    {
+        LL_WARNS(LOG_MESH) << "Discarding invalid mesh header index " << filename << LL_ENDL;
+        LLFile::remove(filename);
+        return;
+    }
+
+    LLMutexLock lock(mHeaderMutex);
+    for (const LLMeshHeaderIndexEntry& entry : entries)
+    {
+        if (entry.mHeaderSize == 0 || entry.mVersion > MAX_MESH_VERSION)
+        {
+            continue;
+        }
+
+        LLUUID mesh_id;
+        memcpy(mesh_id.mData, entry.mID, UUID_BYTES);
+
+        LLMeshHeader header;
+        header.mVersion = entry.mVersion;
+        header.mSkinOffset = entry.mSkinOffset;
+        header.mSkinSize = entry.mSkinSize;
+        header.mPhysicsConvexOffset = entry.mPhysicsConvexOffset;
+        header.mPhysicsConvexSize = entry.mPhysicsConvexSize;
+        header.mPhysicsMeshOffset = entry.mPhysicsMeshOffset;
+        header.mPhysicsMeshSize = entry.mPhysicsMeshSize;
+        for (U32 i = 0; i < 4; ++i)
+        {
+            header.mLodOffset[i] = entry.mLodOffset[i];
+            header.mLodSize[i] = entry.mLodSize[i];
+        }
+        header.mIndexed = true;
+
+        mMeshHeader.emplace(mesh_id, std::make_pair(entry.mHeaderSize, header));
+    }
+
+    LL_INFOS(LOG_MESH) << "Loaded " << mMeshHeader.size() << " mesh headers from the index" << LL_ENDL;
+}
+
+// Called from the main thread once the thread stopped.  The headers used
+// this session are written first, so that those not seen for a while are
+// the ones dropped when the index is full.
+void LLMeshRepoThread::saveHeaderIndex()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    std::vector<LLMeshHeaderIndexEntry> entries;
+    {
+        LLMutexLock lock(mHeaderMutex);
+        entries.reserve(llmin((U32)mMeshHeader.size(), MESH_HEADER_INDEX_MAX_ENTRIES));
+        for (bool indexed : { false, true })
+        {
+            for (const auto& iter : mMeshHeader)
+            {
+                const U32 header_size = iter.second.first;
+                const LLMeshHeader& header = iter.second.second;
+                if (header.mIndexed != indexed
+                    || header_size == 0
+                    || header.m404
+                    || header.mVersion > MAX_MESH_VERSION)
+                {
+                    continue;
+                }
+                if (entries.size() >= MESH_HEADER_INDEX_MAX_ENTRIES)
+                {
+                    break;
+                }
+
+                LLMeshHeaderIndexEntry entry;
+                memcpy(entry.mID, iter.first.mData, UUID_BYTES);
+                entry.mHeaderSize = header_size;
+                entry.mVersion = header.mVersion;
+                entry.mSkinOffset = header.mSkinOffset;
+                entry.mSkinSize = header.mSkinSize;
+                entry.mPhysicsConvexOffset = header.mPhysicsConvexOffset;
+                entry.mPhysicsConvexSize = header.mPhysicsConvexSize;
+                entry.mPhysicsMeshOffset = header.mPhysicsMeshOffset;
+                entry.mPhysicsMeshSize = header.mPhysicsMeshSize;
+                for (U32 i = 0; i < 4; ++i)
+                {
+                    entry.mLodOffset[i] = header.mLodOffset[i];
+                    entry.mLodSize[i] = header.mLodSize[i];
+                }
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    LLMeshHeaderIndexHeader index_header;
+    index_header.mMagic = MESH_HEADER_INDEX_MAGIC;
+    index_header.mVersion = MESH_HEADER_INDEX_VERSION;
+    index_header.mCount = (U32)entries.size();
+
+    const std::string filename = get_mesh_header_index_filename();
+    const std::string temp_filename = filename + ".tmp";
+    {
+        LLUniqueFile file = LLFile::fopen(temp_filename, "wb");
+        if (!file)
+        {
+            return;
+        }
+        bool success = fwrite(&index_header, sizeof(index_header), 1, file) == 1 &&
+                       fwrite(entries.data(), sizeof(LLMeshHeaderIndexEntry), entries.size(), file) == entries.size();
+        if (!success)
+        {
+            file.close();
+            LLFile::remove(temp_filename);
+            return;
+        }
+    }
+    LLFile::remove(filename, ENOENT);
+    if (LLFile::rename(temp_filename, filename) != 0)
+    {
+        LLFile::remove(temp_filename);
+        return;
+    }
+
+    LL_INFOS(LOG_MESH) << "Saved " << entries.size() << " mesh headers to the index" << LL_ENDL;
+}
+
 void LLMeshRepository::uploadModel(std::vector<LLModelInstance>& data, LLVector3& scale, bool upload_textures,
                                    bool upload_skin, bool upload_joints, bool lock_scale_if_joint_position,
                                    std::string upload_url, bool do_upload,
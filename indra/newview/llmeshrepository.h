@@ -27,6 +27,7 @@
 #ifndef LL_MESH_REPOSITORY_H
 #define LL_MESH_REPOSITORY_H
 
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 #include "llassettype.h"
@@ -41,6 +42,8 @@
 #include "httpheaders.h"
 #include "httphandler.h"
 #include "llthread.h"
+#include "llmutex.h"
+#include "threadpool.h"
 
 #define LLCONVEXDECOMPINTER_STATIC 1
 
@@ -250,6 +253,8 @@ public:
     S32 mLodSize[4] = { -1 };
 
     bool m404 = false;
+    // Read from the header index, the asset may have left the cache since
+    bool mIndexed = false;
 };
 
 class LLMeshRepoThread : public LLThread
@@ -374,12 +379,18 @@ public:
 
     // map of mesh ID to skin info (mirrors LLMeshRepository::mSkinMap)
     /// NOTE: LLMeshRepository::mSkinMap is accessed very frequently, so maintain a copy here to avoid mutex overhead
+    /// Written under an exclusive lock of mSkinMapMutex, read by LOD decoding under a shared one
     typedef std::unordered_map<LLUUID, LLPointer<LLMeshSkinInfo>> skin_map;
     skin_map mSkinMap;
+    LLSharedMutex mSkinMapMutex;
 
     // workqueue for processing generic requests
     LL::WorkQueue mWorkQueue;
 
+    // Decodes the LODs, skin info, decompositions and physics shapes, see postDecode().
+    // Its width can be set with the "MeshDecode" entry of the ThreadPoolSizes setting.
+    LL::ThreadPool* mDecodePool;
+
     // llcorehttp library interface objects.
     LLCore::HttpStatus                  mHttpStatus;
     LLCore::HttpRequest *               mHttpRequest;
@@ -403,7 +414,11 @@ public:
     void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 
     bool fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry = true);
-    bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry = true);
+    bool fetchMeshLOD(const LODRequest& req);
+    // Decode pool side of fetchMeshLOD() for cached LODs, resubmits req
+    // while it can retry if the cache is bad and the sim can't be asked
+    void loadCachedMeshLOD(const LODRequest& req, S32 offset, S32 size);
+    bool requestMeshLOD(const LLVolumeParams& mesh_params, S32 lod, S32 offset, S32 size, bool can_retry);
     EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
     EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
     bool skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
@@ -413,6 +428,11 @@ public:
     bool hasSkinInfoInHeader(const LLUUID& mesh_id);
     bool hasHeader(const LLUUID& mesh_id);
 
+    // Parsed headers kept across sessions, so that LOD selection and costs
+    // do not wait for every header in view to be read again
+    void loadHeaderIndex();
+    void saveHeaderIndex();
+
     void notifyLoadedMeshes();
     S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 
@@ -422,7 +442,12 @@ public:
 
     //send request for skin info, returns true if header info exists
     //  (should hold onto mesh_id and try again later if header info does not exist)
-    bool fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry = true);
+    bool fetchMeshSkinInfo(const UUIDBasedRequest& req);
+    // Fetches skin info ahead of the LODs, as those can't render without it
+    void prefetchMeshSkinInfo(const LLUUID& mesh_id);
+    // Decode pool side of fetchMeshSkinInfo() for cached skin info
+    void loadCachedMeshSkinInfo(const UUIDBasedRequest& req, S32 offset, S32 size);
+    bool requestMeshSkinInfo(const LLUUID& mesh_id, S32 offset, S32 size, bool can_retry);
 
     //send request for decomposition, returns true if header info exists
     //  (should hold onto mesh_id and try again later if header info does not exist)
@@ -446,6 +471,15 @@ public:
     // Mutex:  acquires mMutex
     void constructUrl(LLUUID mesh_id, std::string * url);
 
+    // Runs 'work' on the decode pool, or right away once the pool is shut
+    // down. lodReceived(), skinInfoReceived(), decompositionReceived() and
+    // physicsShapeReceived() only touch state guarded by mMutex, mHeaderMutex
+    // or mSkinMapMutex, so they can run there.
+    void postDecode(const std::function<void()>& work);
+
+    // Runs 'work' on the repo thread, for what needs mHttpRequest
+    void postToRepoThread(const std::function<void()>& work);
+
 private:
     // Issue a GET request to a URL with 'Range' header using
     // the correct policy class and other attributes.  If an invalid
@@ -619,13 +653,13 @@ public:
     static U32 sHTTPErrorCount;                 // Requests ending in error
     static U32 sLODPending;
     static U32 sLODProcessing;
-    static U32 sCacheBytesRead;
-    static U32 sCacheBytesWritten;
+    static std::atomic<U32> sCacheBytesRead;    // Also updated by the decode threads
+    static std::atomic<U32> sCacheBytesWritten;
     static U32 sCacheBytesHeaders;
     static U32 sCacheBytesSkins;
     static U32 sCacheBytesDecomps;
-    static U32 sCacheReads;
-    static U32 sCacheWrites;
+    static std::atomic<U32> sCacheReads;
+    static std::atomic<U32> sCacheWrites;
     static U32 sMaxLockHoldoffs;                // Maximum sequential locking failures
 
     static LLDeadmanTimer sQuiescentTimer;      // Time-to-complete-mesh-downloads after significant events
@@ -666,6 +700,11 @@ public:
     bool hasSkinInfo(const LLUUID& mesh_id);
     bool hasHeader(const LLUUID& mesh_id);
 
+    // Parsed headers kept across sessions, so that LOD selection and costs
+    // do not wait for every header in view to be read again
+    void loadHeaderIndex();
+    void saveHeaderIndex();
+
     void buildHull(const LLVolumeParams& params, S32 detail);
     void buildPhysicsMesh(LLModel::Decomposition& decomp);
 
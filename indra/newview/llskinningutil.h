@@ -31,10 +31,10 @@
 #include "v4math.h"
 #include "llvector4a.h"
 #include "llmatrix4a.h"
+#include "llvolume.h"
 
 class LLVOAvatar;
 class LLMeshSkinInfo;
-class LLVolumeFace;
 class LLJointRiggingInfoTab;
 
 namespace LLSkinningUtil
@@ -66,6 +66,138 @@ namespace LLSkinningUtil
         final_mat.add(src[3]);
     }
 
+    // Same result as getPerVertexSkinMatrix() then affineTransform(), mat
+    // being a palette already multiplied by the bind shape matrix. Blends
+    // the vertex transformed by each of its joints rather than the matrices.
+    LL_FORCE_INLINE void skinPosition(
+        const LLVector4a&   weights,
+        const LLVector4a&   pos,
+        const LLMatrix4a*   mat,
+        S32                 max_joints,
+        LLVector4a&         res)
+    {
+        // joint indices in the integer parts, never negative, weights in
+        // the fractions
+        LL_ALIGN_16(S32 idx[4]);
+        const __m128i joints = _mm_cvttps_epi32(weights);
+        _mm_store_si128((__m128i*)idx, joints);
+
+        LLVector4a w;
+        w.setSub(weights, LLVector4a(_mm_cvtepi32_ps(joints)));
+        LLVector4a scale(_mm_add_ps(w, _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 3, 0, 1))));
+        scale = _mm_add_ps(scale, _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(1, 0, 3, 2)));
+        // scale > 0 is enforced in unpackVolumeFaces()
+        w.div(scale);
+
+        LLVector4a t, weight;
+        mat[llclamp(idx[0], 0, max_joints - 1)].affineTransform(pos, res);
+        weight.splat<0>(w);
+        res.mul(weight);
+        mat[llclamp(idx[1], 0, max_joints - 1)].affineTransform(pos, t);
+        weight.splat<1>(w);
+        t.mul(weight);
+        res.add(t);
+        mat[llclamp(idx[2], 0, max_joints - 1)].affineTransform(pos, t);
+        weight.splat<2>(w);
+        t.mul(weight);
+        res.add(t);
+        mat[llclamp(idx[3], 0, max_joints - 1)].affineTransform(pos, t);
+        weight.splat<3>(w);
+        t.mul(weight);
+        res.add(t);
+    }
+
+    // Multiplies a palette from initSkinningMatrixPalette() by the bind
+    // shape matrix, so that skinPosition() transforms each vertex once per
+    // joint
+    inline void applyBindShapeMatrix(const LLMatrix4a& bind_shape_matrix, LLMatrix4a* mat, U32 count)
+    {
+        for (U32 j = 0; j < count; ++j)
+        {
+            const LLMatrix4a joint_mat = mat[j];
+            matMulUnsafe(bind_shape_matrix, joint_mat, mat[j]);
+        }
+    }
+
+    // Mesh bodies have faces of 100k vertices and more, which are skinned
+    // in batches of up to this many vertices on the "Jobs" thread pool
+    const S32 SKINNING_BATCH_VERTICES = 8192;
+
+    struct SkinningBatch
+    {
+        S32         mFace;
+        S32         mBegin;
+        S32         mEnd;
+        // bounds of the skinned vertices, see boundSkinningBatch()
+        LLVector4a  mMin;
+        LLVector4a  mMax;
+    };
+
+    inline void addSkinningBatches(S32 face, S32 num_vertices, std::vector<SkinningBatch>& batches)
+    {
+        for (S32 begin = 0; begin < num_vertices; begin += SKINNING_BATCH_VERTICES)
+        {
+            SkinningBatch batch;
+            batch.mFace = face;
+            batch.mBegin = begin;
+            batch.mEnd = llmin(begin + SKINNING_BATCH_VERTICES, num_vertices);
+            batches.push_back(batch);
+        }
+    }
+
+    // pos are the skinned vertices of the whole face
+    inline void boundSkinningBatch(SkinningBatch& batch, const LLVector4a* pos)
+    {
+        batch.mMin = pos[batch.mBegin];
+        batch.mMax = pos[batch.mBegin];
+        for (S32 j = batch.mBegin + 1; j < batch.mEnd; ++j)
+        {
+            batch.mMin.setMin(batch.mMin, pos[j]);
+            batch.mMax.setMax(batch.mMax, pos[j]);
+        }
+    }
+
+    // Sets the extents and centers of the skinned faces from the bounds of
+    // their batches, which addSkinningBatches() left in order, and
+    // box_min and box_max to the bounds of all of those faces
+    inline void updateSkinnedExtents(const std::vector<SkinningBatch>& batches, LLVolume::face_list_t& faces,
+                                     LLVector4a& box_min, LLVector4a& box_max)
+    {
+        bool first_face = true;
+        for (const SkinningBatch& batch : batches)
+        {
+            LLVolumeFace& face = faces[batch.mFace];
+            LLVector4a& min = face.mExtents[0];
+            LLVector4a& max = face.mExtents[1];
+            if (batch.mBegin == 0)
+            {
+                min = batch.mMin;
+                max = batch.mMax;
+            }
+            else
+            {
+                min.setMin(min, batch.mMin);
+                max.setMax(max, batch.mMax);
+            }
+
+            if (batch.mEnd == face.mNumVertices)
+            {
+                // the face's last batch
+                if (first_face)
+                {
+                    box_min = min;
+                    box_max = max;
+                    first_face = false;
+                }
+                box_min.setMin(min, box_min);
+                box_max.setMax(max, box_max);
+
+                face.mCenter->setAdd(face.mExtents[0], face.mExtents[1]);
+                face.mCenter->mul(0.5f);
+            }
+        }
+    }
+
     void initJointNums(LLMeshSkinInfo* skin, LLVOAvatar *avatar);
     void updateRiggingInfo(const LLMeshSkinInfo* skin, LLVOAvatar *avatar, LLVolumeFace& vol_face);
     LLQuaternion getUnscaledQuaternion(const LLMatrix4& mat4);
@@ -624,6 +624,8 @@ bool idle_startup()
             F32 dropPercent = gSavedSettings.getF32("PacketDropPercentage");
             msg->mPacketRing.setDropPercentage(dropPercent);
 
+            msg->mPacketRing.setUseBatchReceive(gSavedSettings.getBOOL("PacketBatchReceive"));
+
             F32 inBandwidth = gSavedSettings.getF32("InBandwidth");
             F32 outBandwidth = gSavedSettings.getF32("OutBandwidth");
             if (inBandwidth != 0.f)
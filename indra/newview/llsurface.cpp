@@ -55,6 +55,7 @@
 #include "lldrawpoolterrain.h"
 #include "lldrawable.h"
 #include "llworldmipmap.h"
+#include "threadpool.h"
 
 extern LLPipeline gPipeline;
 extern bool gShiftFrame;
@@ -139,6 +140,10 @@ LLSurface::~LLSurface()
 
 void LLSurface::initClasses()
 {
+    // noise2(), used by LLSurfacePatch::eval(), sets its tables up on first
+    // use, which must not happen on several terrain threads at once.
+    F32 noise_vec[2] = { 0.f, 0.f };
+    noise2(noise_vec);
 }
 
 void LLSurface::setRegion(LLViewerRegion *regionp)
@@ -611,14 +616,47 @@ bool LLSurface::idleUpdate(F32 max_update_time)
     }
 
     // Always call updateNormals() / updateVerticalStats()
-    //  every frame to avoid artifacts
+    //  every frame to avoid artifacts.
+    // This is done on the terrain threads. A patch reads the heights around
+    // it and writes its normals, edges included, which are shared with its
+    // neighbors: the patches are done in four passes, by parity of their
+    // position, so that no two neighbors are done at the same time.
+    std::vector<LLSurfacePatch *> passes[4];
+    for (LLSurfacePatch *patchp : mDirtyPatchList)
+    {
+        if (patchp->hasDirtyNormalsOrStats())
+        {
+            patchp->updateNorthEastCorner();
+            const S32 index = (S32)(patchp - mPatchList);
+            const S32 x = index % mPatchesPerEdge;
+            const S32 y = index / mPatchesPerEdge;
+            passes[(x & 1) + 2 * (y & 1)].push_back(patchp);
+        }
+    }
+    for (std::vector<LLSurfacePatch *> &patches : passes)
+    {
+        std::vector<U8> stats_changed(patches.size());
+        runPatchJobs((S32)patches.size(), [&patches, &stats_changed](S32 i)
+            {
+                patches[i]->calcNormals<PBR>();
+                stats_changed[i] = patches[i]->calcVerticalStats();
+            });
+        // The patches are already in mDirtyPatchList, no need to call
+        // dirtySurfacePatch() for their normals.
+        for (size_t i = 0; i < patches.size(); ++i)
+        {
+            if (stats_changed[i])
+            {
+                patches[i]->applyVerticalStats();
+            }
+        }
+    }
+
     for(std::set<LLSurfacePatch *>::iterator iter = mDirtyPatchList.begin();
         iter != mDirtyPatchList.end(); )
     {
         std::set<LLSurfacePatch *>::iterator curiter = iter++;
         LLSurfacePatch *patchp = *curiter;
-        patchp->updateNormals<PBR>();
-        patchp->updateVerticalStats();
         if (max_update_time == 0.f || update_timer.getElapsedTimeF32() < max_update_time)
         {
             if (patchp->updateTexture())
@@ -639,6 +677,13 @@ bool LLSurface::idleUpdate(F32 max_update_time)
 template bool LLSurface::idleUpdate</*PBR=*/false>(F32 max_update_time);
 template bool LLSurface::idleUpdate</*PBR=*/true>(F32 max_update_time);
 
+// static
+void LLSurface::runPatchJobs(S32 count, const std::function<void(S32)>& job)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    LL::runJobs("Jobs", (size_t)llmax(count, 0), [&job](size_t i) { job((S32)i); });
+}
+
 void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, bool b_large_patch)
 {
 
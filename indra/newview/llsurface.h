@@ -41,6 +41,8 @@
 #include "llpatchvertexarray.h"
 #include "llviewertexture.h"
 
+#include <functional>
+
 class LLTimer;
 class LLUUID;
 class LLAgent;
@@ -115,6 +117,12 @@ public:
     template<bool PBR>
     bool idleUpdate(F32 max_update_time);
 
+    // Calls job(0) to job(count - 1) over the "Jobs" thread pool and the
+    // calling thread, and returns once they are all done (see LL::runJobs()).
+    // The jobs must only write to their own patch (or to their own part of a
+    // buffer).
+    static void runPatchJobs(S32 count, const std::function<void(S32)>& job);
+
     bool containsPosition(const LLVector3 &position);
 
     void moveZ(const S32 x, const S32 y, const F32 delta);
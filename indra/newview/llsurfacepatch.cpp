@@ -545,11 +545,11 @@ F32 LLSurfacePatch::getDistance() const
 
 // Called when a patch has changed its height field
 // data.
-void LLSurfacePatch::updateVerticalStats()
+bool LLSurfacePatch::calcVerticalStats()
 {
     if (!mDirtyZStats)
     {
-        return;
+        return false;
     }
 
     U32 grids_per_patch_edge = mSurfacep->getGridsPerPatchEdge();
@@ -595,6 +595,13 @@ void LLSurfacePatch::updateVerticalStats()
                         mMaxZ - mMinZ);
     mRadius = diam_vec.magVec() * 0.5f;
 
+    mDirtyZStats = false;
+    return true;
+}
+
+// Main thread side of calcVerticalStats()
+void LLSurfacePatch::applyVerticalStats()
+{
     mSurfacep->mMaxZ = llmax(mMaxZ, mSurfacep->mMaxZ);
     mSurfacep->mMinZ = llmin(mMinZ, mSurfacep->mMinZ);
     mSurfacep->mHasZData = true;
@@ -604,16 +611,120 @@ void LLSurfacePatch::updateVerticalStats()
     {
         mVObjp->dirtyPatch();
     }
-    mDirtyZStats = false;
 }
 
+bool LLSurfacePatch::hasDirtyNormalsOrStats() const
+{
+    if (mDirtyZStats)
+    {
+        return true;
+    }
+    for (S32 i = 0; i < 9; i++)
+    {
+        if (mNormalsInvalid[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LLSurfacePatch::updateVerticalStats()
+{
+    if (calcVerticalStats())
+    {
+        applyVerticalStats();
+    }
+}
+
+
+// Invalidating the northeast corner is different, because depending on what the adjacent neighbors are,
+// we'll want to do different things. This writes the z of the corner, which may be read by the vertical
+// stats of a neighbor, so it has to be done on the main thread, before calcNormals().
+void LLSurfacePatch::updateNorthEastCorner()
+{
+    if (!mNormalsInvalid[NORTHEAST] || mSurfacep->mType == 'w')
+    {
+        return;
+    }
+    U32 grids_per_patch_edge = mSurfacep->getGridsPerPatchEdge();
+    U32 grids_per_edge = mSurfacep->getGridsPerEdge();
+
+    if (!getNeighborPatch(NORTHEAST))
+    {
+        if (!getNeighborPatch(NORTH))
+        {
+            if (!getNeighborPatch(EAST))
+            {
+                // No north or east neighbors.  Pull from the diagonal in your own patch.
+                *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
+                    *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
+            }
+            else
+            {
+                if (getNeighborPatch(EAST)->getHasReceivedData())
+                {
+                    // East, but not north.  Pull from your east neighbor's northwest point.
+                    *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
+                        *(getNeighborPatch(EAST)->mDataZ + (grids_per_patch_edge - 1)*grids_per_edge);
+                }
+                else
+                {
+                    *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
+                        *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
+                }
+            }
+        }
+        else
+        {
+            // We have a north.
+            if (getNeighborPatch(EAST))
+            {
+                // North and east neighbors, but not northeast.
+                // Pull from diagonal in your own patch.
+                *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
+                    *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
+            }
+            else
+            {
+                if (getNeighborPatch(NORTH)->getHasReceivedData())
+                {
+                    // North, but not east.  Pull from your north neighbor's southeast corner.
+                    *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
+                        *(getNeighborPatch(NORTH)->mDataZ + (grids_per_patch_edge - 1));
+                }
+                else
+                {
+                    *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
+                        *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
+                }
+            }
+        }
+    }
+    else if (getNeighborPatch(NORTHEAST)->mSurfacep != mSurfacep)
+    {
+        if (
+            (!getNeighborPatch(NORTH) || (getNeighborPatch(NORTH)->mSurfacep != mSurfacep))
+            &&
+            (!getNeighborPatch(EAST) || (getNeighborPatch(EAST)->mSurfacep != mSurfacep)))
+        {
+            *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
+                                    *(getNeighborPatch(NORTHEAST)->mDataZ);
+        }
+    }
+    else
+    {
+        // We've got a northeast patch in the same surface.
+        // The z and normals will be handled by that patch.
+    }
+}
 
 template<bool PBR>
-void LLSurfacePatch::updateNormals()
+bool LLSurfacePatch::calcNormals()
 {
     if (mSurfacep->mType == 'w')
     {
-        return;
+        return false;
     }
     U32 grids_per_patch_edge = mSurfacep->getGridsPerPatchEdge();
     U32 grids_per_edge = mSurfacep->getGridsPerEdge();
@@ -669,77 +780,9 @@ void LLSurfacePatch::updateNormals()
         dirty_patch = true;
     }
 
-    // Invalidating the northeast corner is different, because depending on what the adjacent neighbors are,
-    // we'll want to do different things.
+    // The z of the northeast corner was set by updateNorthEastCorner()
     if (mNormalsInvalid[NORTHEAST])
     {
-        if (!getNeighborPatch(NORTHEAST))
-        {
-            if (!getNeighborPatch(NORTH))
-            {
-                if (!getNeighborPatch(EAST))
-                {
-                    // No north or east neighbors.  Pull from the diagonal in your own patch.
-                    *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
-                        *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
-                }
-                else
-                {
-                    if (getNeighborPatch(EAST)->getHasReceivedData())
-                    {
-                        // East, but not north.  Pull from your east neighbor's northwest point.
-                        *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
-                            *(getNeighborPatch(EAST)->mDataZ + (grids_per_patch_edge - 1)*grids_per_edge);
-                    }
-                    else
-                    {
-                        *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
-                            *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
-                    }
-                }
-            }
-            else
-            {
-                // We have a north.
-                if (getNeighborPatch(EAST))
-                {
-                    // North and east neighbors, but not northeast.
-                    // Pull from diagonal in your own patch.
-                    *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
-                        *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
-                }
-                else
-                {
-                    if (getNeighborPatch(NORTH)->getHasReceivedData())
-                    {
-                        // North, but not east.  Pull from your north neighbor's southeast corner.
-                        *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
-                            *(getNeighborPatch(NORTH)->mDataZ + (grids_per_patch_edge - 1));
-                    }
-                    else
-                    {
-                        *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
-                            *(mDataZ + grids_per_patch_edge - 1 + (grids_per_patch_edge - 1)*grids_per_edge);
-                    }
-                }
-            }
-        }
-        else if (getNeighborPatch(NORTHEAST)->mSurfacep != mSurfacep)
-        {
-            if (
-                (!getNeighborPatch(NORTH) || (getNeighborPatch(NORTH)->mSurfacep != mSurfacep))
-                &&
-                (!getNeighborPatch(EAST) || (getNeighborPatch(EAST)->mSurfacep != mSurfacep)))
-            {
-                *(mDataZ + grids_per_patch_edge + grids_per_patch_edge*grids_per_edge) =
-                                        *(getNeighborPatch(NORTHEAST)->mDataZ);
-            }
-        }
-        else
-        {
-            // We've got a northeast patch in the same surface.
-            // The z and normals will be handled by that patch.
-        }
         calcNormal<PBR>(grids_per_patch_edge, grids_per_patch_edge, 2);
         calcNormal<PBR>(grids_per_patch_edge, grids_per_patch_edge - 1, 2);
         calcNormal<PBR>(grids_per_patch_edge - 1, grids_per_patch_edge, 2);
@@ -760,14 +803,24 @@ void LLSurfacePatch::updateNormals()
         dirty_patch = true;
     }
 
-    if (dirty_patch)
+    for (i = 0; i < 9; i++)
     {
-        mSurfacep->dirtySurfacePatch(this);
+        mNormalsInvalid[i] = false;
     }
 
-    for (i = 0; i < 9; i++)
+    return dirty_patch;
+}
+
+template bool LLSurfacePatch::calcNormals</*PBR=*/false>();
+template bool LLSurfacePatch::calcNormals</*PBR=*/true>();
+
+template<bool PBR>
+void LLSurfacePatch::updateNormals()
+{
+    updateNorthEastCorner();
+    if (calcNormals<PBR>())
     {
-        mNormalsInvalid[i] = false;
+        mSurfacep->dirtySurfacePatch(this);
     }
 }
 
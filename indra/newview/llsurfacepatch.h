@@ -75,8 +75,19 @@ public:
 
     bool updateTexture();
 
+    // The calc*() halves of updateVerticalStats() and updateNormals() only
+    // write to this patch, and may run for several patches at once on the
+    // terrain threads (see LLSurface::runPatchJobs()). They return true when
+    // something changed, which the main thread then has to apply.
+    // updateNorthEastCorner() must be called on the main thread first.
+    bool calcVerticalStats();
+    void applyVerticalStats();
     void updateVerticalStats();
     void updateCompositionStats();
+    void updateNorthEastCorner();
+    bool hasDirtyNormalsOrStats() const;
+    template<bool PBR>
+    bool calcNormals();
     template<bool PBR>
     void updateNormals();
 
@@ -193,6 +204,8 @@ protected:
     LLSurface *mSurfacep; // Pointer to "parent" surface
 };
 
+extern template bool LLSurfacePatch::calcNormals</*PBR=*/false>();
+extern template bool LLSurfacePatch::calcNormals</*PBR=*/true>();
 extern template void LLSurfacePatch::updateNormals</*PBR=*/false>();
 extern template void LLSurfacePatch::updateNormals</*PBR=*/true>();
 
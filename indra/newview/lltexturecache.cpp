@@ -56,6 +56,7 @@ const S32 TEXTURE_FAST_CACHE_DATA_SIZE = 16 * 16 * 4;
 const S32 TEXTURE_FAST_CACHE_ENTRY_SIZE = TEXTURE_FAST_CACHE_DATA_SIZE + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
 const F32 TEXTURE_LAZY_PURGE_TIME_LIMIT = .004f; // 4ms. Would be better to autoadjust, but there is a major cache rework in progress.
 const F32 TEXTURE_PRUNING_MAX_TIME = 15.f;
+const std::chrono::milliseconds TEXTURE_CACHE_HEADER_WRITE_INTERVAL{1000};
 
 class LLTextureCacheWorker : public LLWorkerClass
 {
@@ -789,6 +790,32 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Saves the header entries updated by the workers in batches, so that neither
+// the workers nor the main thread wait on the header file.
+class LLTextureCacheHeaderWriter : public LLThread
+{
+public:
+    LLTextureCacheHeaderWriter(LLTextureCache* cache)
+    :   LLThread("TextureCacheHeaderWriter"),
+        mCache(cache)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        while (!isQuitting() && LLApp::instance()->sleep(TEXTURE_CACHE_HEADER_WRITE_INTERVAL))
+        {
+            mCache->writeUpdatedEntries();
+        }
+    }
+
+private:
+    LLTextureCache* mCache;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
 LLTextureCache::LLTextureCache(bool threaded)
     : LLWorkerThread("TextureCache", threaded),
       mWorkersMutex(),
@@ -796,20 +823,30 @@ LLTextureCache::LLTextureCache(bool threaded)
       mListMutex(),
       mFastCacheMutex(),
       mHeaderAPRFile(NULL),
+      mHeaderWriter(NULL),
       mReadOnly(true), //do not allow to change the texture cache until setReadOnly() is called.
       mTexturesSizeTotal(0),
       mDoPurge(false),
       mFastCachep(NULL),
       mFastCachePoolp(NULL),
-      mFastCachePadBuffer(NULL)
+      mFastCachePadBuffer(NULL),
+      mFastCacheDirtyBegin(SIZE_MAX),
+      mFastCacheDirtyEnd(0)
 {
     mHeaderAPRFilePoolp = new LLVolatileAPRPool(); // is_local = true, because this pool is for headers, headers are under own mutex
 }
 
 LLTextureCache::~LLTextureCache()
 {
+    if (mHeaderWriter)
+    {
+        mHeaderWriter->shutdown();
+        delete mHeaderWriter;
+        mHeaderWriter = NULL;
+    }
     clearDeleteList() ;
     writeUpdatedEntries() ;
+    flushFastCache(true);
     delete mFastCachep;
     delete mFastCachePoolp;
     delete mHeaderAPRFilePoolp;
@@ -822,9 +859,6 @@ LLTextureCache::~LLTextureCache()
 size_t LLTextureCache::update(F32 max_time_ms)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
-    static LLFrameTimer timer ;
-    static const F32 MAX_TIME_INTERVAL = 300.f ; //seconds.
-
     size_t res;
     res = LLWorkerThread::update(max_time_ms);
 
@@ -844,11 +878,8 @@ size_t LLTextureCache::update(F32 max_time_ms)
         responder->completed(success);
     }
 
-    if(!res && timer.getElapsedTimeF32() > MAX_TIME_INTERVAL)
-    {
-        timer.reset() ;
-        writeUpdatedEntries() ;
-    }
+    // Batch the write back of the fast cache slots modified this frame
+    flushFastCache(false);
 
     return res;
 }
@@ -875,10 +906,7 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 bool LLTextureCache::isInCache(const LLUUID& id)
 {
-    LLMutexLock lock(&mHeaderMutex);
-    id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-
-    return (iter != mHeaderIDMap.end()) ;
+    return mHeaderIndex.contains(id);
 }
 
 //debug
@@ -1038,6 +1066,12 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, bool texture_cache
     llassert_always(getPending() == 0) ; //should not start accessing the texture cache before initialized.
     openFastCache(true);
 
+    if (!mReadOnly && !mHeaderWriter)
+    {
+        mHeaderWriter = new LLTextureCacheHeaderWriter(this);
+        mHeaderWriter->start();
+    }
+
     return max_size; // unused cache space
 }
 
@@ -1115,10 +1149,10 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 {
     S32 idx = -1;
 
-    id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-    if (iter1 != mHeaderIDMap.end())
+    HeaderRecord record;
+    if (mHeaderIndex.find(id, record))
     {
-        idx = iter1->second;
+        idx = record.mIndex;
     }
 
     if (idx < 0)
@@ -1145,12 +1179,14 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
                     LLUUID oldid = *curiter2;
                     // Erase entry from LRU regardless
                     mLRU.erase(curiter2);
-                    // Look up entry and use it if it is valid
-                    id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-                    if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+                    // Look up entry and use it if it is valid and was not
+                    // read since the LRU got built
+                    HeaderRecord old_record;
+                    if (mHeaderIndex.find(oldid, old_record) && old_record.mIndex >= 0 && !old_record.mAccessed)
                     {
-                        idx = iter3->second;
+                        idx = old_record.mIndex;
                         removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
+                        mUpdatedEntryMap.erase(idx);
                         break;
                     }
                 }
@@ -1170,16 +1206,7 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
     {
         // Remove this entry from the LRU if it exists
         mLRU.erase(id);
-        // Read the entry
-        idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-        if(iter != mUpdatedEntryMap.end())
-        {
-            entry = iter->second ;
-        }
-        else
-        {
-            readEntryFromHeaderImmediately(idx, entry) ;
-        }
+        entry = record.mEntry;
         if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
         {
             LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL ;
@@ -1187,7 +1214,6 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
             //erase this entry and the cached texture from the cache.
             std::string tex_filename = getTextureFileName(id);
             removeEntry(idx, entry, tex_filename) ;
-            mUpdatedEntryMap.erase(idx) ;
             idx = -1 ;
         }
     }
@@ -1230,43 +1256,7 @@ void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool
     mUpdatedEntryMap.erase(idx) ;
 }
 
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
-{
-    S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-    LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-    S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-    closeHeaderEntriesFile();
-
-    if(bytes_read != sizeof(Entry))
-    {
-        clearCorruptedCache() ; //clear the cache.
-        idx = -1 ;//mark the idx invalid.
-    }
-}
-
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
-void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
-{
-    static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
-
-    if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
-    {
-        return ; //there are enough empty entry index space, no need to stamp time.
-    }
-
-    if (idx >= 0)
-    {
-        if (!mReadOnly)
-        {
-            entry.mTime = (U32)time(NULL);
-            mUpdatedEntryMap[idx] = entry ;
-        }
-    }
-}
-
-//update an existing entry, write to header file immediately.
+//update an existing entry, its header gets written by mHeaderWriter.
 bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_data_size)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
@@ -1282,19 +1272,14 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 
         lockHeaders() ;
 
-        bool update_header = false ;
         if(entry.mImageSize < 0) //is a brand-new entry
         {
-            mHeaderIDMap[entry.mID] = idx;
             mTexturesSizeMap[entry.mID] = new_body_size ;
             mTexturesSizeTotal += new_body_size ;
-
-            // Update Header
-            update_header = true ;
         }
         else if (entry.mBodySize != new_body_size)
         {
-            //already in mHeaderIDMap.
+            //already in mHeaderIndex.
             mTexturesSizeMap[entry.mID] = new_body_size ;
             mTexturesSizeTotal -= entry.mBodySize ;
             mTexturesSizeTotal += new_body_size ;
@@ -1303,7 +1288,8 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
         entry.mImageSize = new_image_size ;
         entry.mBodySize = new_body_size ;
 
-        writeEntryToHeaderImmediately(idx, entry, update_header) ;
+        mHeaderIndex.insert(entry.mID, HeaderRecord(idx, entry, true));
+        mUpdatedEntryMap.insert(idx, entry);
 
         if (mTexturesSizeTotal > sCacheMaxTexturesSize)
         {
@@ -1325,7 +1311,9 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 {
     U32 num_entries = mHeaderEntriesInfo.mEntries;
 
-    mHeaderIDMap.clear();
+    // mHeaderIndex is not cleared: the updated entries get saved first below,
+    // so the file matches it, and the workers keep finding their textures
+    // while it is refreshed.
     mTexturesSizeMap.clear();
     mFreeList.clear();
     mTexturesSizeTotal = 0;
@@ -1360,7 +1348,7 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 //      LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
         if(entry.mImageSize > entry.mBodySize)
         {
-            mHeaderIDMap[entry.mID] = idx;
+            mHeaderIndex.insert(entry.mID, HeaderRecord(idx, entry, false));
             mTexturesSizeMap[entry.mID] = entry.mBodySize;
             mTexturesSizeTotal += entry.mBodySize;
         }
@@ -1420,11 +1408,18 @@ void LLTextureCache::updatedHeaderEntriesFile()
             return ;
         }
 
+        //collect the updated entries, sorted so that they get written in order
+        std::map<S32, Entry> updated_entries;
+        mUpdatedEntryMap.drain([&updated_entries](const S32& idx, Entry& entry)
+        {
+            updated_entries[idx] = entry;
+        });
+
         //write each updated entry
         S32 entry_size = (S32)sizeof(Entry) ;
         S32 prev_idx = -1 ;
         S32 delta_idx ;
-        for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
+        for (std::map<S32, Entry>::iterator iter = updated_entries.begin(); iter != updated_entries.end(); ++iter)
         {
             delta_idx = iter->first - prev_idx - 1;
             prev_idx = iter->first ;
@@ -1440,7 +1435,6 @@ void LLTextureCache::updatedHeaderEntriesFile()
                 return ;
             }
         }
-        mUpdatedEntryMap.clear() ;
     }
 }
 //----------------------------------------------------------------------------
@@ -1575,6 +1569,15 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+    // The fast cache file cannot be deleted from under its mapping, nor its
+    // slots reused by new entries while it still holds the old ones
+    bool fast_cache_open;
+    {
+        LLMutexLock lock(&mFastCacheMutex);
+        fast_cache_open = mFastCacheMap.isMapped() || mFastCachep;
+        closeFastCache(true);
+    }
+
     if (!mReadOnly)
     {
         const char* subdirs = "0123456789abcdef";
@@ -1605,7 +1608,7 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
             LLFile::rmdir(mTexturesDirName);
         }
     }
-    mHeaderIDMap.clear();
+    mHeaderIndex.clear();
     mTexturesSizeMap.clear();
     mTexturesSizeTotal = 0;
     mFreeList.clear();
@@ -1616,6 +1619,12 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
     setEntriesHeader();
     writeEntriesHeader();
 
+    if (fast_cache_open)
+    {
+        LLMutexLock lock(&mFastCacheMutex);
+        openFastCache(true);
+    }
+
     LL_INFOS() << "The entire texture cache is cleared." << LL_ENDL ;
 }
 
@@ -1652,15 +1661,15 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
         {
             if (iter1->second > 0)
             {
-                id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-                if (iter2 != mHeaderIDMap.end())
+                HeaderRecord record;
+                if (mHeaderIndex.find(iter1->first, record))
                 {
-                    S32 idx = iter2->second;
+                    S32 idx = record.mIndex;
                     time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
                 }
                 else
                 {
-                    LL_ERRS("TextureCache") << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL;
+                    LL_ERRS("TextureCache") << "mTexturesSizeMap / mHeaderIndex corrupted." << LL_ENDL;
                 }
             }
         }
@@ -1693,8 +1702,8 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
             Entry entry = mPurgeEntryList.back().second;
             mPurgeEntryList.pop_back();
             // make sure record is still valid
-            id_map_t::iterator iter_header = mHeaderIDMap.find(entry.mID);
-            if (iter_header != mHeaderIDMap.end() && iter_header->second == idx)
+            HeaderRecord record;
+            if (mHeaderIndex.find(entry.mID, record) && record.mIndex == idx)
             {
                 std::string tex_filename = getTextureFileName(entry.mID);
                 removeEntry(idx, entry, tex_filename);
@@ -1737,16 +1746,16 @@ void LLTextureCache::purgeTextures(bool validate)
     {
         if (iter1->second > 0)
         {
-            id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-            if (iter2 != mHeaderIDMap.end())
+            HeaderRecord record;
+            if (mHeaderIndex.find(iter1->first, record))
             {
-                S32 idx = iter2->second;
+                S32 idx = record.mIndex;
                 time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
 //              LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
             }
             else
             {
-                LL_ERRS() << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL ;
+                LL_ERRS() << "mTexturesSizeMap / mHeaderIndex corrupted." << LL_ENDL ;
             }
         }
     }
@@ -1850,15 +1859,40 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 //////////////////////////////////////////////////////////////////////////////
 // Called from work thread
 
-// Reads imagesize from the header, updates timestamp
+// Reads imagesize from the header, updates timestamp.
+// Only locks the shard of mHeaderIndex holding the entry, so that the workers
+// reading textures do not wait on each other.
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
-    LLMutexLock lock(&mHeaderMutex);
-    S32 idx = openAndReadEntry(id, entry, false);
-    if (idx >= 0)
+    static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
+
+    // When there is enough empty entry index space, no need to stamp time.
+    const bool stamp_time = !mReadOnly && mHeaderEntriesInfo.mEntries >= MAX_ENTRIES_WITHOUT_TIME_STAMP;
+
+    // Used to record the access pattern for lltexturecache_libtest
+    LL_DEBUGS("TextureCacheIndex") << "read " << id << LL_ENDL;
+
+    S32 idx = -1;
+    mHeaderIndex.update(id, [&](HeaderRecord& record)
+    {
+        record.mAccessed = true;
+        if (stamp_time)
+        {
+            // Delay writing, done while the shard is locked so that a removal
+            // of the entry cannot happen in between.
+            record.mEntry.mTime = (U32)time(NULL);
+            mUpdatedEntryMap.insert(record.mIndex, record.mEntry);
+        }
+        idx = record.mIndex;
+        entry = record.mEntry;
+    });
+
+    if (idx >= 0 && entry.mImageSize <= entry.mBodySize)
     {
-        updateEntryTimeStamp(idx, entry); // updates time
+        // Corrupted entry: let openAndReadEntry() remove it
+        LLMutexLock lock(&mHeaderMutex);
+        idx = openAndReadEntry(id, entry, false);
     }
     return idx;
 }
@@ -1867,6 +1901,7 @@ S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    LL_DEBUGS("TextureCacheIndex") << "write " << id << LL_ENDL;
     mHeaderMutex.lock();
     S32 idx = openAndReadEntry(id, entry, true); // read or create
     mHeaderMutex.unlock();
@@ -1991,14 +2026,13 @@ LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& d
 {
     U32 offset;
     {
-        LLMutexLock lock(&mHeaderMutex);
-        id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-        if(iter == mHeaderIDMap.end())
+        HeaderRecord record;
+        if (!mHeaderIndex.find(id, record))
         {
             return NULL; //not in the cache
         }
 
-        offset = iter->second;
+        offset = record.mIndex;
     }
     offset *= TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
@@ -2007,36 +2041,64 @@ LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& d
     {
         LLMutexLock lock(&mFastCacheMutex);
 
-        openFastCache();
-
-        mFastCachep->seek(APR_SET, offset);
-
-        if(mFastCachep->read(head, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD) != TEXTURE_FAST_CACHE_ENTRY_OVERHEAD)
+        if (mFastCacheMap.isMapped())
         {
-            //cache corrupted or under thread race condition
-            closeFastCache();
-            return NULL;
-        }
+            if ((size_t)offset + TEXTURE_FAST_CACHE_ENTRY_SIZE > mFastCacheMap.getSize())
+            {
+                return NULL;
+            }
+            // The slot is copied once, straight into the image buffer. The
+            // image cannot wrap the mapped bytes: it outlives the slot, which
+            // gets rewritten when the entry is recycled, and it may be scaled
+            // in place by its users.
+            const U8* slot = mFastCacheMap.getAddress() + offset;
+            memcpy(head, slot, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
+
+            S32 image_size = head[0] * head[1] * head[2];
+            if(image_size <= 0
+               || image_size > TEXTURE_FAST_CACHE_DATA_SIZE
+               || head[3] < 0) //invalid
+            {
+                return NULL;
+            }
+            discardlevel = head[3];
 
-        S32 image_size = head[0] * head[1] * head[2];
-        if(image_size <= 0
-           || image_size > TEXTURE_FAST_CACHE_DATA_SIZE
-           || head[3] < 0) //invalid
-        {
-            closeFastCache();
-            return NULL;
+            data = (U8*)ll_aligned_malloc_16(image_size);
+            memcpy(data, slot + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD, image_size);
         }
-        discardlevel = head[3];
-
-        data = (U8*)ll_aligned_malloc_16(image_size);
-        if(mFastCachep->read(data, image_size) != image_size)
+        else
         {
-            ll_aligned_free_16(data);
+            openFastCache();
+
+            mFastCachep->seek(APR_SET, offset);
+
+            if(mFastCachep->read(head, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD) != TEXTURE_FAST_CACHE_ENTRY_OVERHEAD)
+            {
+                //cache corrupted or under thread race condition
+                closeFastCache();
+                return NULL;
+            }
+
+            S32 image_size = head[0] * head[1] * head[2];
+            if(image_size <= 0
+               || image_size > TEXTURE_FAST_CACHE_DATA_SIZE
+               || head[3] < 0) //invalid
+            {
+                closeFastCache();
+                return NULL;
+            }
+            discardlevel = head[3];
+
+            data = (U8*)ll_aligned_malloc_16(image_size);
+            if(mFastCachep->read(data, image_size) != image_size)
+            {
+                ll_aligned_free_16(data);
+                closeFastCache();
+                return NULL;
+            }
+
             closeFastCache();
-            return NULL;
         }
-
-        closeFastCache();
     }
     LLPointer<LLImageRaw> raw = new LLImageRaw(data, head[0], head[1], head[2], true);
 
@@ -2091,6 +2153,31 @@ bool LLTextureCache::writeToFastCache(LLUUID image_id, S32 id, LLPointer<LLImage
         }
     }
 
+    if (mFastCacheMap.isMapped())
+    {
+        // Fill the slot in place, the pages are written back to the file by
+        // flushFastCache() once per frame.
+        const S32 head[4] = { w, h, c, discardlevel };
+        S32 copy_size = llmin(w * h * c, TEXTURE_FAST_CACHE_DATA_SIZE);
+        size_t offset = (size_t)id * TEXTURE_FAST_CACHE_ENTRY_SIZE;
+
+        LLMutexLock lock(&mFastCacheMutex);
+
+        if (offset + TEXTURE_FAST_CACHE_ENTRY_SIZE > mFastCacheMap.getSize())
+        {
+            return false;
+        }
+        U8* slot = mFastCacheMap.getAddress() + offset;
+        memcpy(slot, head, TEXTURE_FAST_CACHE_ENTRY_OVERHEAD);
+        if (copy_size > 0)
+        {
+            memcpy(slot + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD, raw->getData(), copy_size);
+        }
+        mFastCacheDirtyBegin = llmin(mFastCacheDirtyBegin, offset);
+        mFastCacheDirtyEnd = llmax(mFastCacheDirtyEnd, offset + TEXTURE_FAST_CACHE_ENTRY_SIZE);
+        return true;
+    }
+
     //copy data
     memcpy(mFastCachePadBuffer, &w, sizeof(S32));
     memcpy(mFastCachePadBuffer + sizeof(S32), &h, sizeof(S32));
@@ -2125,6 +2212,24 @@ bool LLTextureCache::writeToFastCache(LLUUID image_id, S32 id, LLPointer<LLImage
 
 void LLTextureCache::openFastCache(bool first_time)
 {
+    if (mFastCacheMap.isMapped())
+    {
+        return;
+    }
+
+    if (first_time && !mReadOnly)
+    {
+        // One fixed size slot per header entry. Read-only instances share
+        // the file with the viewer owning the cache and keep using
+        // mFastCachep, as does the fallback when the file cannot be mapped.
+        if (mFastCacheMap.map(mFastCacheFileName, (size_t)sCacheMaxEntries * TEXTURE_FAST_CACHE_ENTRY_SIZE))
+        {
+            LL_INFOS("TextureCache") << "Mapped fast cache: " << sCacheMaxEntries << " slots" << LL_ENDL;
+            return;
+        }
+        LL_WARNS("TextureCache") << "Unable to map the fast cache, using file accesses" << LL_ENDL;
+    }
+
     if(!mFastCachep)
     {
         if(first_time)
@@ -2133,7 +2238,10 @@ void LLTextureCache::openFastCache(bool first_time)
             {
                 mFastCachePadBuffer = (U8*)ll_aligned_malloc_16(TEXTURE_FAST_CACHE_ENTRY_SIZE);
             }
-            mFastCachePoolp = new LLVolatileAPRPool(); // is_local= true by default, so not thread safe by default
+            if(!mFastCachePoolp)
+            {
+                mFastCachePoolp = new LLVolatileAPRPool(); // is_local= true by default, so not thread safe by default
+            }
             if (LLAPRFile::isExist(mFastCacheFileName, mFastCachePoolp))
             {
                 mFastCachep = new LLAPRFile(mFastCacheFileName, APR_READ|APR_WRITE|APR_BINARY, mFastCachePoolp) ;
@@ -2157,6 +2265,14 @@ void LLTextureCache::closeFastCache(bool forced)
 {
     static const F32 timeout = 10.f ; //seconds
 
+    if (forced && mFastCacheMap.isMapped())
+    {
+        // the pages already written to stay with the file
+        mFastCacheDirtyBegin = SIZE_MAX;
+        mFastCacheDirtyEnd = 0;
+        mFastCacheMap.unmap();
+    }
+
     if(!mFastCachep)
     {
         return ;
@@ -2172,6 +2288,22 @@ void LLTextureCache::closeFastCache(bool forced)
     return;
 }
 
+void LLTextureCache::flushFastCache(bool sync)
+{
+    size_t begin, end;
+    {
+        LLMutexLock lock(&mFastCacheMutex);
+        begin = mFastCacheDirtyBegin;
+        end = mFastCacheDirtyEnd;
+        mFastCacheDirtyBegin = SIZE_MAX;
+        mFastCacheDirtyEnd = 0;
+    }
+    if (begin < end)
+    {
+        mFastCacheMap.flush(begin, end - begin, sync);
+    }
+}
+
 bool LLTextureCache::writeComplete(handle_t handle, bool abort)
 {
     lockWorkers();
@@ -2216,7 +2348,7 @@ void LLTextureCache::removeCachedTexture(const LLUUID& id)
         mTexturesSizeTotal -= mTexturesSizeMap[id] ;
         mTexturesSizeMap.erase(id);
     }
-    mHeaderIDMap.erase(id);
+    mHeaderIndex.erase(id);
     // We are inside header's mutex so mHeaderAPRFilePoolp is safe to use,
     // but getLocalAPRFilePool() is not safe, it might be in use by worker
     LLAPRFile::remove(getTextureFileName(id), mHeaderAPRFilePoolp);
@@ -2247,7 +2379,8 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
         entry.mImageSize = -1;
         entry.mBodySize = 0;
-        mHeaderIDMap.erase(entry.mID);
+        mHeaderIndex.erase(entry.mID);
+        mUpdatedEntryMap.erase(idx);
         mTexturesSizeMap.erase(entry.mID);
         mFreeList.insert(idx);
     }
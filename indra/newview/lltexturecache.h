@@ -28,6 +28,8 @@
 #define LL_LLTEXTURECACHE_H
 
 #include "lldir.h"
+#include "llmappedfile.h"
+#include "llshardedmap.h"
 #include "llstl.h"
 #include "llstring.h"
 #include "lluuid.h"
@@ -35,6 +37,7 @@
 #include "llworkerthread.h"
 
 class LLImageFormatted;
+class LLTextureCacheHeaderWriter;
 class LLTextureCacheWorker;
 class LLImageRaw;
 
@@ -43,6 +46,7 @@ class LLTextureCache : public LLWorkerThread
     friend class LLTextureCacheWorker;
     friend class LLTextureCacheRemoteWorker;
     friend class LLTextureCacheLocalFileWorker;
+    friend class LLTextureCacheHeaderWriter;
 
 private:
 
@@ -82,6 +86,17 @@ private:
 #pragma pack(pop)
 #endif
 
+    // In-memory copy of a valid entry of the header file
+    struct HeaderRecord
+    {
+        HeaderRecord() : mIndex(-1), mAccessed(false) {}
+        HeaderRecord(S32 idx, const Entry& entry, bool accessed) :
+            mIndex(idx), mEntry(entry), mAccessed(accessed) {}
+        S32 mIndex; // index of the entry in the header files
+        Entry mEntry;
+        bool mAccessed; // used since the LRU got built, so not to be recycled
+    };
+
 public:
 
     class Responder : public LLResponder
@@ -172,10 +187,8 @@ private:
     void writeEntriesHeader();
     S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
     bool updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_body_size);
-    void updateEntryTimeStamp(S32 idx, Entry& entry) ;
     U32 openAndReadEntries(std::vector<Entry>& entries);
     void writeEntriesAndClose(const std::vector<Entry>& entries);
-    void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
     void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
     void removeEntry(S32 idx, Entry& entry, std::string& filename);
     void removeCachedTexture(const LLUUID& id) ;
@@ -188,6 +201,7 @@ private:
 
     void openFastCache(bool first_time = false);
     void closeFastCache(bool forced = false);
+    void flushFastCache(bool sync);
     bool writeToFastCache(LLUUID image_id, S32 cache_id, LLPointer<LLImageRaw> raw, S32 discardlevel);
 
 private:
@@ -198,6 +212,7 @@ private:
     LLMutex mFastCacheMutex;
     LLAPRFile* mHeaderAPRFile;
     LLVolatileAPRPool* mFastCachePoolp;
+    LLTextureCacheHeaderWriter* mHeaderWriter;
 
     // mLocalAPRFilePoolp is not thread safe and is meant only for workers
     // howhever mHeaderEntriesFileName is accessed not from workers' threads
@@ -223,12 +238,21 @@ private:
     EntriesInfo mHeaderEntriesInfo;
     std::set<S32> mFreeList; // deleted entries
     std::set<LLUUID> mLRU;
-    typedef std::map<LLUUID, S32> id_map_t;
-    id_map_t mHeaderIDMap;
+    // All the valid entries, looked up by the workers without locking
+    // mHeaderMutex. Only modified with mHeaderMutex locked, except for the
+    // access time stamps.
+    typedef LLShardedMap<LLUUID, HeaderRecord> header_index_t;
+    header_index_t mHeaderIndex;
 
     LLAPRFile*   mFastCachep;
     LLFrameTimer mFastCacheTimer;
     U8*          mFastCachePadBuffer;
+    // When mapped, the fast cache slots are accessed in place instead of
+    // through mFastCachep. The range of bytes modified since the last
+    // flushFastCache() call is [mFastCacheDirtyBegin, mFastCacheDirtyEnd).
+    LLMappedFile mFastCacheMap;
+    size_t       mFastCacheDirtyBegin;
+    size_t       mFastCacheDirtyEnd;
 
     // BODIES (TEXTURES minus headers)
     std::string mTexturesDirName;
@@ -237,7 +261,8 @@ private:
     S64 mTexturesSizeTotal;
     LLAtomicBool mDoPurge;
 
-    typedef std::map<S32, Entry> idx_entry_map_t;
+    // Entries waiting for mHeaderWriter to save them to the header file
+    typedef LLShardedMap<S32, Entry, 16> idx_entry_map_t;
     idx_entry_map_t mUpdatedEntryMap;
     typedef std::vector<std::pair<S32, Entry> > idx_entry_vector_t;
     idx_entry_vector_t mPurgeEntryList;
@@ -44,6 +44,7 @@
 #include "llmaterialtable.h"
 #include "llmutelist.h"
 #include "llnamevalue.h"
+#include "llobjectupdatedata.h"
 #include "llprimitive.h"
 #include "llquantize.h"
 #include "llregionhandle.h"
@@ -1157,12 +1158,12 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                      void **user_data,
                      U32 block_num,
                      const EObjectUpdateType update_type,
-                     LLDataPacker *dp)
+                     const LLObjectUpdateData* update)
 {
     LL_PROFILE_ZONE_SCOPED;
     LL_DEBUGS_ONCE("SceneLoadTiming") << "Received viewer object data" << LL_ENDL;
 
-    LL_DEBUGS("ObjectUpdate") << " mesgsys " << mesgsys << " dp " << dp << " id " << getID() << " update_type " << (S32) update_type << LL_ENDL;
+    LL_DEBUGS("ObjectUpdate") << " mesgsys " << mesgsys << " update " << update << " id " << getID() << " update_type " << (S32) update_type << LL_ENDL;
 
     // The new OBJECTDATA_FIELD_SIZE_124, OBJECTDATA_FIELD_SIZE_140, OBJECTDATA_FIELD_SIZE_80
     // and OBJECTDATA_FIELD_SIZE_64 lengths should be supported in the existing cases below.
@@ -1279,7 +1280,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
         parent_id = cur_parentp->mLocalID;
     }
 
-    if (!dp)
+    if (!update)
     {
         switch(update_type)
         {
@@ -1660,19 +1661,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
     }
     else
     {
-        // handle the compressed case - have dp datapacker
-        LLUUID sound_uuid;
-        LLUUID  owner_id;
-        F32    gain = 0;
-        U8     sound_flags = 0;
-        F32     cutoff = 0;
-
-        U16 val[4];
-
-        U8      state;
-
-        dp->unpackU8(state, "State");
-        mAttachmentState = state;
+        // handle the compressed case, decoded by LLObjectUpdateData
+        mAttachmentState = update->mState;
 
         switch(update_type)
         {
@@ -1681,43 +1671,16 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 #ifdef DEBUG_UPDATE_TYPE
                 LL_INFOS() << "CompTI:" << getID() << LL_ENDL;
 #endif
-                U8      value;
-                dp->unpackU8(value, "agent");
-                if (value)
+                if (update->mHasCollisionPlane)
                 {
-                    LLVector4 collision_plane;
-                    dp->unpackVector4(collision_plane, "Plane");
-                    ((LLVOAvatar*)this)->setFootPlane(collision_plane);
+                    ((LLVOAvatar*)this)->setFootPlane(update->mCollisionPlane);
                 }
                 test_pos_parent = getPosition();
-                dp->unpackVector3(new_pos_parent, "Pos");
-                dp->unpackU16(val[VX], "VelX");
-                dp->unpackU16(val[VY], "VelY");
-                dp->unpackU16(val[VZ], "VelZ");
-                setVelocity(U16_to_F32(val[VX], -128.f, 128.f),
-                            U16_to_F32(val[VY], -128.f, 128.f),
-                            U16_to_F32(val[VZ], -128.f, 128.f));
-                dp->unpackU16(val[VX], "AccX");
-                dp->unpackU16(val[VY], "AccY");
-                dp->unpackU16(val[VZ], "AccZ");
-                setAcceleration(U16_to_F32(val[VX], -64.f, 64.f),
-                                U16_to_F32(val[VY], -64.f, 64.f),
-                                U16_to_F32(val[VZ], -64.f, 64.f));
-
-                dp->unpackU16(val[VX], "ThetaX");
-                dp->unpackU16(val[VY], "ThetaY");
-                dp->unpackU16(val[VZ], "ThetaZ");
-                dp->unpackU16(val[VS], "ThetaS");
-                new_rot.mQ[VX] = U16_to_F32(val[VX], -1.f, 1.f);
-                new_rot.mQ[VY] = U16_to_F32(val[VY], -1.f, 1.f);
-                new_rot.mQ[VZ] = U16_to_F32(val[VZ], -1.f, 1.f);
-                new_rot.mQ[VS] = U16_to_F32(val[VS], -1.f, 1.f);
-                dp->unpackU16(val[VX], "AccX");
-                dp->unpackU16(val[VY], "AccY");
-                dp->unpackU16(val[VZ], "AccZ");
-                new_angv.set(U16_to_F32(val[VX], -64.f, 64.f),
-                                    U16_to_F32(val[VY], -64.f, 64.f),
-                                    U16_to_F32(val[VZ], -64.f, 64.f));
+                new_pos_parent = update->mPosition;
+                setVelocity(update->mVelocity);
+                setAcceleration(update->mAcceleration);
+                new_rot = update->mRotation;
+                new_angv = update->mAngularVelocity;
                 setAngularVelocity(new_angv);
             }
             break;
@@ -1734,9 +1697,9 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                     gFloaterTools->dirty();
                 }
 
-                dp->unpackU32(crc, "CRC");
+                crc = update->mCRC;
                 mTotalCRC = crc;
-                dp->unpackU8(material, "Material");
+                material = update->mMaterial;
                 U8 old_material = getMaterial();
                 if (old_material != material)
                 {
@@ -1746,52 +1709,49 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                         gPipeline.markMoved(mDrawable, false); // undamped
                     }
                 }
-                dp->unpackU8(click_action, "ClickAction");
+                click_action = update->mClickAction;
                 setClickAction(click_action);
-                dp->unpackVector3(new_scale, "Scale");
-                dp->unpackVector3(new_pos_parent, "Pos");
-                LLVector3 vec;
-                dp->unpackVector3(vec, "Rot");
-                new_rot.unpackFromVector3(vec);
+                if (update->mHasScale)
+                {
+                    new_scale = update->mScale;
+                }
+                new_pos_parent = update->mPosition;
+                new_rot = update->mRotation;
                 setAcceleration(LLVector3::zero);
 
-                U32 value;
-                dp->unpackU32(value, "SpecialCode");
-                dp->setPassFlags(value);
-                dp->unpackUUID(owner_id, "Owner");
+                U32 value = update->mSpecialCode;
+                const LLUUID& owner_id = update->mOwnerID;
 
                 mOwnerID = owner_id;
 
                 if (value & 0x80)
                 {
-                    dp->unpackVector3(new_angv, "Omega");
+                    new_angv = update->mAngularVelocity;
                     setAngularVelocity(new_angv);
                 }
 
                 if (value & 0x20)
                 {
-                    dp->unpackU32(parent_id, "ParentID");
+                    if (update->mHasParentID)
+                    {
+                        parent_id = update->mParentID;
+                    }
                 }
                 else
                 {
                     parent_id = 0;
                 }
 
-                S32 sp_size;
-                U32 size;
-                if (value & 0x2)
+                if (value & (0x2 | 0x1))
                 {
-                    sp_size = 1;
+                    // Tree data or scratch pad
                     delete [] mData;
-                    mData = new U8[1];
-                    dp->unpackU8(((U8*)mData)[0], "TreeData");
-                }
-                else if (value & 0x1)
-                {
-                    dp->unpackU32(size, "ScratchPadSize");
-                    delete [] mData;
-                    mData = new U8[size];
-                    dp->unpackBinaryData((U8 *)mData, sp_size, "PartData");
+                    mData = new U8[update->mGenericDataSize];
+                    const S32 copy_size = llmin((S32)update->mGenericDataSize, update->mGenericData.mSize);
+                    if (copy_size > 0)
+                    {
+                        memcpy(mData, &update->mData[update->mGenericData.mOffset], copy_size);
+                    }
                 }
                 else
                 {
@@ -1806,16 +1766,12 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
                 if (value & 0x4)
                 {
-                    std::string temp_string;
-                    dp->unpackString(temp_string, "Text");
-
-                    LLColor4U coloru;
-                    dp->unpackBinaryDataFixed(coloru.mV, 4, "Color");
+                    LLColor4U coloru = update->mTextColor;
                     coloru.mV[3] = 255 - coloru.mV[3];
                     mText->setColor(LLColor4(coloru));
-                    mText->setString(temp_string);
+                    mText->setString(update->mText);
 
-                    mHudText = temp_string;
+                    mHudText = update->mText;
                     mHudTextColor = LLColor4(coloru);
 
                     setChanged(TEXTURE);
@@ -1830,19 +1786,15 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                     mHudText.clear();
                 }
 
-                std::string media_url;
-                if (value & 0x200)
-                {
-                    dp->unpackString(media_url, "MediaURL");
-                }
-                retval |= checkMediaURL(media_url);
+                retval |= checkMediaURL(update->mMediaURL);
 
                 //
                 // Unpack particle system data (legacy)
                 //
                 if (value & 0x8)
                 {
-                    unpackParticleSource(*dp, owner_id, true);
+                    LLDataPackerBinaryBuffer pdp = update->getDataPacker(update->mLegacyParticles);
+                    unpackParticleSource(pdp, owner_id, true);
                 }
                 else if (!(value & 0x400))
                 {
@@ -1857,18 +1809,10 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                 }
 
                 // Unpack extra params
-                U8 num_parameters;
-                dp->unpackU8(num_parameters, "num_params");
-                U8 param_block[MAX_OBJECT_PARAMS_SIZE];
-                for (U8 param=0; param<num_parameters; ++param)
+                for (const LLObjectUpdateData::ExtraParam& param : update->mExtraParams)
                 {
-                    U16 param_type;
-                    S32 param_size;
-                    dp->unpackU16(param_type, "param_type");
-                    dp->unpackBinaryData(param_block, param_size, "param_data");
-                    //LL_INFOS() << "Param type: " << param_type << ", Size: " << param_size << LL_ENDL;
-                    LLDataPackerBinaryBuffer dp2(param_block, param_size);
-                    unpackParameterEntry(param_type, &dp2);
+                    LLDataPackerBinaryBuffer dp2 = update->getDataPacker(param.mData);
+                    unpackParameterEntry(param.mType, &dp2);
                 }
 
                 for (iter = mExtraParameterList.begin(); iter != mExtraParameterList.end(); ++iter)
@@ -1880,26 +1824,15 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
                     }
                 }
 
-                if (value & 0x10)
-                {
-                    dp->unpackUUID(sound_uuid, "SoundUUID");
-                    dp->unpackF32(gain, "SoundGain");
-                    dp->unpackU8(sound_flags, "SoundFlags");
-                    dp->unpackF32(cutoff, "SoundRadius");
-                }
-
                 if (value & 0x100)
                 {
-                    std::string name_value_list;
-                    dp->unpackString(name_value_list, "NV");
-
-                    setNameValueList(name_value_list);
+                    setNameValueList(update->mNameValues);
                 }
 
                 mTotalCRC = crc;
-                mSoundCutOffRadius = cutoff;
+                mSoundCutOffRadius = update->mSoundRadius;
 
-                setAttachedSound(sound_uuid, owner_id, gain, sound_flags);
+                setAttachedSound(update->mSoundID, owner_id, update->mSoundGain, update->mSoundFlags);
 
                 // only get these flags on updates from sim, not cached ones
                 // Preload these five flags for every object.
@@ -67,6 +67,7 @@ class LLHUDText;
 class LLHost;
 class LLMessageSystem;
 class LLNameValue;
+class LLObjectUpdateData;
 class LLPartSysData;
 class LLPipeline;
 class LLTextureEntry;
@@ -178,7 +179,7 @@ public:
                                         void **user_data,
                                         U32 block_num,
                                         const EObjectUpdateType update_type,
-                                        LLDataPacker *dp);
+                                        const LLObjectUpdateData* update);
 
 
     virtual bool    isActive() const; // Whether this object needs to do an idleUpdate.
@@ -81,6 +81,7 @@
 #include "llvocache.h"
 #include "llcorehttputil.h"
 #include "llstartup.h"
+#include "threadpool.h"
 
 #include <algorithm>
 #include <iterator>
@@ -231,7 +232,7 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
                                            void** user_data,
                                            U32 i,
                                            const EObjectUpdateType update_type,
-                                           LLDataPacker* dpp,
+                                           const LLObjectUpdateData* update,
                                            bool just_created,
                                            bool from_cache)
 {
@@ -246,7 +247,7 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
     LL_DEBUGS("ObjectUpdate") << "uuid " << objectp->mID << " calling processUpdateMessage "
                               << objectp << " just_created " << just_created << " from_cache " << from_cache << " msg " << msg << LL_ENDL;
 
-    objectp->processUpdateMessage(msg, user_data, i, update_type, dpp);
+    objectp->processUpdateMessage(msg, user_data, i, update_type, update);
 
     if (objectp->isDead())
     {
@@ -301,31 +302,66 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 
 static LLTrace::BlockTimerStatHandle FTM_PROCESS_OBJECTS("Process Objects");
 
-LLViewerObject* LLViewerObjectList::processObjectUpdateFromCache(LLVOCacheEntry* entry, LLViewerRegion* regionp)
+// static
+void LLViewerObjectList::decodeCacheEntries(const std::vector<LLVOCacheEntry*>& entries, std::vector<LLObjectUpdateData>& updates)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
 
-    LLDataPacker *cached_dpp = entry->getDP();
+    if (updates.size() < entries.size())
+    {
+        updates.resize(entries.size());
+    }
+
+    // getDP() copies the data out of the cache file mapping the first time,
+    // which must not race with the main thread: do it here, so that the jobs
+    // only read from the buffers.
+    std::vector<const LLDataPackerBinaryBuffer*> buffers(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        buffers[i] = entries[i]->getDP();
+    }
+
+    LL::runJobs("Jobs", entries.size(), [&buffers, &updates](size_t i)
+    {
+        const LLDataPackerBinaryBuffer* cached_dpp = buffers[i];
+        if (cached_dpp)
+        {
+            updates[i].unpack(cached_dpp->getBuffer(), cached_dpp->getBufferSize(), false);
+        }
+        else
+        {
+            updates[i].unpack(NULL, 0, false);
+        }
+    });
+}
+
+LLViewerObject* LLViewerObjectList::processObjectUpdateFromCache(LLVOCacheEntry* entry, LLViewerRegion* regionp, const LLObjectUpdateData* update)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+
+    LLDataPackerBinaryBuffer *cached_dpp = entry->getDP();
 
     if (!cached_dpp || gNonInteractive)
     {
         return NULL; //nothing cached.
     }
 
+    // Decode the entry here unless the caller already did
+    LLObjectUpdateData decoded;
+    if (!update)
+    {
+        decoded.unpack(cached_dpp->getBuffer(), cached_dpp->getBufferSize(), false);
+        update = &decoded;
+    }
+
     LLViewerObject *objectp;
-    U32             local_id;
-    LLPCode         pcode = 0;
-    LLUUID          fullid;
+    LLPCode         pcode = update->mPCode;
+    const LLUUID&   fullid = update->mFullID;
     LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
 
     // Cache Hit.
     record(LLStatViewer::OBJECT_CACHE_HIT_RATE, LLUnits::Ratio::fromValue(1));
 
-    cached_dpp->reset();
-    cached_dpp->unpackUUID(fullid, "ID");
-    cached_dpp->unpackU32(local_id, "LocalID");
-    cached_dpp->unpackU8(pcode, "PCode");
-
     objectp = findObject(fullid);
 
     if (objectp)
@@ -377,7 +413,7 @@ LLViewerObject* LLViewerObjectList::processObjectUpdateFromCache(LLVOCacheEntry*
         LL_WARNS() << "Dead object " << objectp->mID << " in UUID map 1!" << LL_ENDL;
     }
 
-    processUpdateCore(objectp, NULL, 0, OUT_FULL_CACHED, cached_dpp, justCreated, true);
+    processUpdateCore(objectp, NULL, 0, OUT_FULL_CACHED, update, justCreated, true);
     objectp->loadFlags(entry->getUpdateFlags()); //just in case, reload update flags from cache.
 
     if(entry->getHitCount() > 0)
@@ -461,8 +497,11 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
         return;
     }
 
-    U8 compressed_dpbuffer[2048];
-    LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
+    if (compressed)
+    {
+        decodeCompressedUpdates(mesgsys, update_type, num_objects);
+    }
+
     LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
 
     for (i = 0; i < num_objects; i++)
@@ -472,21 +511,15 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 
         if (compressed)
         {
-            compressed_dp.reset();
-
-            S32 uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
-            LL_DEBUGS("ObjectUpdate") << "got binary data from message to compressed_dpbuffer" << LL_ENDL;
-            mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i, 2048);
-            compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
+            const LLObjectUpdateData& update = mDecodedUpdates[i];
 
             if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
             {
-                U32 flags = 0;
-                mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+                U32 flags = mDecodedUpdateFlags[i];
 
-                compressed_dp.unpackUUID(fullid, "ID");
-                compressed_dp.unpackU32(local_id, "LocalID");
-                compressed_dp.unpackU8(pcode, "PCode");
+                fullid = update.mFullID;
+                local_id = update.mLocalID;
+                pcode = update.mPCode;
 
                 if (pcode == 0)
                 {
@@ -502,14 +535,15 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
                 else if ((flags & FLAGS_TEMPORARY_ON_REZ) == 0)
                 {
                     //send to object cache
-                    regionp->cacheFullUpdate(compressed_dp, flags);
+                    LLDataPackerBinaryBuffer cache_dp = update.getDataPacker();
+                    regionp->cacheFullUpdate(cache_dp, flags);
                     continue;
                 }
             }
             else //OUT_TERSE_IMPROVED
             {
                 update_cache = true;
-                compressed_dp.unpackU32(local_id, "LocalID");
+                local_id = update.mLocalID;
                 getUUIDFromLocal(fullid,
                                  local_id,
                                  gMessageSystem->getSenderIP(),
@@ -656,7 +690,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
             {
                 objectp->mLocalID = local_id;
             }
-            processUpdateCore(objectp, user_data, i, update_type, &compressed_dp, justCreated);
+            processUpdateCore(objectp, user_data, i, update_type, &mDecodedUpdates[i], justCreated);
 
 #if 0
             if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
@@ -667,7 +701,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
                 if(!(flags & FLAGS_TEMPORARY_ON_REZ))
                 {
                     bCached = true;
-                    LLViewerRegion::eCacheUpdateResult result = objectp->mRegionp->cacheFullUpdate(objectp, compressed_dp, flags);
+                    LLDataPackerBinaryBuffer cache_dp = mDecodedUpdates[i].getDataPacker();
+                    LLViewerRegion::eCacheUpdateResult result = objectp->mRegionp->cacheFullUpdate(objectp, cache_dp, flags);
                     recorder.cacheFullUpdate(result);
                 }
             }
@@ -688,6 +723,63 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
     LLVOAvatar::cullAvatarsByPixelArea();
 }
 
+void LLViewerObjectList::decodeCompressedUpdates(LLMessageSystem* mesgsys, EObjectUpdateType update_type, S32 num_objects)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_NETWORK;
+
+    const bool terse = (update_type == OUT_TERSE_IMPROVED);
+    if ((S32)mDecodedUpdates.size() < num_objects)
+    {
+        mDecodedUpdates.resize(num_objects);
+        mDecodedUpdateFlags.resize(num_objects);
+        mTerseTextureEntries.resize(num_objects);
+    }
+
+    // The message system is only for this thread, copy what the jobs need
+    for (S32 i = 0; i < num_objects; i++)
+    {
+        std::vector<U8>& data = mDecodedUpdates[i].mData;
+        data.resize(mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data));
+        if (!data.empty())
+        {
+            mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, data.data(), 0, i, (S32)data.size());
+        }
+
+        mDecodedUpdateFlags[i] = 0;
+        mTerseTextureEntries[i].clear();
+        if (terse)
+        {
+            std::vector<U8>& texture_entry = mTerseTextureEntries[i];
+            texture_entry.resize(mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_TextureEntry));
+            if (!texture_entry.empty())
+            {
+                mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_TextureEntry, texture_entry.data(), 0, i, (S32)texture_entry.size());
+            }
+        }
+        else
+        {
+            mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, mDecodedUpdateFlags[i], i);
+        }
+    }
+
+    LL::runJobs("Jobs", num_objects, [this, terse](size_t i)
+    {
+        LLObjectUpdateData& update = mDecodedUpdates[i];
+        if (terse)
+        {
+            update.unpack(true);
+            const std::vector<U8>& texture_entry = mTerseTextureEntries[i];
+            update.unpackTerseTextureEntry(texture_entry.data(), (S32)texture_entry.size());
+        }
+        else
+        {
+            // Only temporary objects are created from the message, the
+            // others go to the object cache
+            update.unpack(false, (mDecodedUpdateFlags[i] & FLAGS_TEMPORARY_ON_REZ) == 0);
+        }
+    });
+}
+
 void LLViewerObjectList::processCompressedObjectUpdate(LLMessageSystem *mesgsys,
                                              void **user_data,
                                              const EObjectUpdateType update_type)
@@ -932,6 +1024,9 @@ void LLViewerObjectList::update(LLAgent &agent)
     }
     else
     {
+        // Animate the avatars all at once after their idle updates
+        LLVOAvatar::sDeferMotionEvaluation = true;
+
         for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
             idle_iter != idle_end; idle_iter++)
         {
@@ -940,6 +1035,8 @@ void LLViewerObjectList::update(LLAgent &agent)
                 objectp->idleUpdate(agent, frame_time);
         }
 
+        LLVOAvatar::evaluateDeferredMotions();
+
         //update flexible objects
         LLVolumeImplFlexible::updateClass();
 
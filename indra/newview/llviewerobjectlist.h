@@ -29,6 +29,7 @@
 
 #include <map>
 #include <set>
+#include <vector>
 
 // common includes
 #include "llstring.h"
@@ -36,6 +37,7 @@
 
 // project includes
 #include "llviewerobject.h"
+#include "llobjectupdatedata.h"
 #include "lleventcoro.h"
 #include "llcoros.h"
 
@@ -82,8 +84,12 @@ public:
 
     // Simulator and viewer side object updates...
     void processUpdateCore(LLViewerObject* objectp, void** data, U32 block, const EObjectUpdateType update_type,
-                           LLDataPacker* dpp, bool justCreated, bool from_cache = false);
-    LLViewerObject* processObjectUpdateFromCache(LLVOCacheEntry* entry, LLViewerRegion* regionp);
+                           const LLObjectUpdateData* update, bool justCreated, bool from_cache = false);
+    // 'update' is the entry's data already decoded, if any, see decodeCacheEntries()
+    LLViewerObject* processObjectUpdateFromCache(LLVOCacheEntry* entry, LLViewerRegion* regionp, const LLObjectUpdateData* update = NULL);
+    // Decodes the data of cache entries on the "Jobs" thread pool, for
+    // processObjectUpdateFromCache()
+    static void decodeCacheEntries(const std::vector<LLVOCacheEntry*>& entries, std::vector<LLObjectUpdateData>& updates);
     void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool compressed=false);
     void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
     void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
@@ -225,6 +231,15 @@ protected:
     friend class LLViewerObject;
 
 private:
+    // Decodes the compressed blocks of an object update message into
+    // mDecodedUpdates on the "Jobs" thread pool
+    void decodeCompressedUpdates(LLMessageSystem* mesgsys, EObjectUpdateType update_type, S32 num_objects);
+
+    // Kept from one message to the next
+    std::vector<LLObjectUpdateData> mDecodedUpdates;
+    std::vector<U32> mDecodedUpdateFlags;
+    std::vector<std::vector<U8> > mTerseTextureEntries;
+
     static void reportObjectCostFailure(LLSD &objectList);
     void fetchObjectCostsCoro(std::string url);
 
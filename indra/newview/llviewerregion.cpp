@@ -1502,21 +1502,43 @@ void LLViewerRegion::createVisibleObjects(F32 max_time)
         return;
     }
 
+    // Entries decoded at a time on the "Jobs" thread pool, before creating
+    // their objects here. Few enough not to waste much when out of time.
+    const size_t DECODE_BATCH_SIZE = 64;
+    static std::vector<LLVOCacheEntry*> entries;
+    static std::vector<LLObjectUpdateData> updates;
+
     S32 throttle = sNewObjectCreationThrottle;
     bool has_new_obj = false;
+    bool out_of_time = false;
     LLTimer update_timer;
-    for(LLVOCacheEntry::vocache_entry_priority_list_t::iterator iter = mImpl->mWaitingList.begin();
-        iter != mImpl->mWaitingList.end(); ++iter)
+    LLVOCacheEntry::vocache_entry_priority_list_t::iterator iter = mImpl->mWaitingList.begin();
+    while (iter != mImpl->mWaitingList.end() && !out_of_time)
     {
-        LLVOCacheEntry* vo_entry = *iter;
+        entries.clear();
+        for (; iter != mImpl->mWaitingList.end() && entries.size() < DECODE_BATCH_SIZE; ++iter)
+        {
+            if ((*iter)->getState() < LLVOCacheEntry::WAITING)
+            {
+                entries.push_back(*iter);
+            }
+        }
+        LLViewerObjectList::decodeCacheEntries(entries, updates);
 
-        if(vo_entry->getState() < LLVOCacheEntry::WAITING)
+        for (size_t i = 0; i < entries.size(); ++i)
         {
-            addNewObject(vo_entry);
-            has_new_obj = true;
-            if(throttle > 0 && !(--throttle) && update_timer.getElapsedTimeF32() > max_time)
+            LLVOCacheEntry* vo_entry = entries[i];
+
+            // Creating an object may have added one of the next ones
+            if(vo_entry->getState() < LLVOCacheEntry::WAITING)
             {
-                break;
+                addNewObject(vo_entry, &updates[i]);
+                has_new_obj = true;
+                if(throttle > 0 && !(--throttle) && update_timer.getElapsedTimeF32() > max_time)
+                {
+                    out_of_time = true;
+                    break;
+                }
             }
         }
     }
@@ -1855,7 +1877,7 @@ void LLViewerRegion::killObject(LLVOCacheEntry* entry, std::vector<LLDrawable*>&
     }
 }
 
-LLViewerObject* LLViewerRegion::addNewObject(LLVOCacheEntry* entry)
+LLViewerObject* LLViewerRegion::addNewObject(LLVOCacheEntry* entry, const LLObjectUpdateData* update)
 {
     if(!entry || !entry->getEntry())
     {
@@ -1871,7 +1893,7 @@ LLViewerObject* LLViewerRegion::addNewObject(LLVOCacheEntry* entry)
     if(!entry->getEntry()->hasDrawable()) //not added to the rendering pipeline yet
     {
         //add the object
-        obj = gObjectList.processObjectUpdateFromCache(entry, this);
+        obj = gObjectList.processObjectUpdateFromCache(entry, this, update);
         if(obj)
         {
             if(!entry->isState(LLVOCacheEntry::ACTIVE))
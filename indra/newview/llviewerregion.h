@@ -76,6 +76,7 @@ class LLBBox;
 class LLSpatialGroup;
 class LLDrawable;
 class LLGLTFOverrideCacheEntry;
+class LLObjectUpdateData;
 class LLViewerRegionImpl;
 class LLViewerOctreeGroup;
 class LLVOCachePartition;
@@ -432,7 +433,8 @@ public:
 
 private:
     void addToVOCacheTree(LLVOCacheEntry* entry);
-    LLViewerObject* addNewObject(LLVOCacheEntry* entry);
+    // 'update' is the entry's data already decoded, if any
+    LLViewerObject* addNewObject(LLVOCacheEntry* entry, const LLObjectUpdateData* update = NULL);
     void killObject(LLVOCacheEntry* entry, std::vector<LLDrawable*>& delete_list); //adds entry into list if it is safe to move into cache
     void removeFromVOCacheTree(LLVOCacheEntry* entry);
     void killCacheEntry(LLVOCacheEntry* entry, bool for_rendering = false); //physically delete the cache entry
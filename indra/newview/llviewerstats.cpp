@@ -53,6 +53,7 @@
 #include "llfasttimerview.h"
 #include "llviewerregion.h"
 #include "llvoavatar.h"
+#include "llkeyframemotion.h"
 #include "llvoavatarself.h"
 #include "llworld.h"
 #include "llfeaturemanager.h"
@@ -188,6 +189,7 @@ LLTrace::SampleStatHandle<> FPS_SAMPLE("fpssample"),
                             NUM_ACTIVE_OBJECTS("numactiveobjectsstat"),
                             ENABLE_VBO("enablevbo", "Vertex Buffers Enabled"),
                             VISIBLE_AVATARS("visibleavatars", "Visible Avatars"),
+                            SHARED_ANIMATION_POSES("sharedanimationposes", "Animation poses reused from another avatar playing in step"),
                             SHADER_OBJECTS("shaderobjects", "Object Shaders"),
                             DRAW_DISTANCE("drawdistance", "Draw Distance"),
                             WINDOW_WIDTH("windowwidth", "Window width"),
@@ -381,6 +383,7 @@ void update_statistics()
     gTransferManager.resetTransferBitsIn(LLTCT_ASSET);
 
     sample(LLStatViewer::VISIBLE_AVATARS, LLVOAvatar::sNumVisibleAvatars);
+    sample(LLStatViewer::SHARED_ANIMATION_POSES, LLKeyframeMotion::sNumSharedPoses.exchange(0));
     LLWorld *world = LLWorld::getInstance(); // not LLSingleton
     if (world)
     {
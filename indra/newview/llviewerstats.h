@@ -180,6 +180,7 @@ extern LLTrace::SampleStatHandle<>      FPS_SAMPLE,
                                         ENABLE_VBO,
                                         LIGHTING_DETAIL,
                                         VISIBLE_AVATARS,
+                                        SHARED_ANIMATION_POSES,
                                         SHADER_OBJECTS,
                                         DRAW_DISTANCE,
                                         WINDOW_WIDTH,
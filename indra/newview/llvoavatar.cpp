@@ -97,6 +97,7 @@
 #include "pipeline.h"
 #include "llviewershadermgr.h"
 #include "llsky.h"
+#include "threadpool.h"
 #include "llanimstatelabels.h"
 #include "lltrans.h"
 #include "llappearancemgr.h"
@@ -594,6 +595,10 @@ bool LLVOAvatar::sLimitNonImpostors = false; // True unless RenderAvatarMaxNonIm
 F32 LLVOAvatar::sRenderDistance = 256.f;
 S32 LLVOAvatar::sNumVisibleAvatars = 0;
 S32 LLVOAvatar::sNumLODChangesThisFrame = 0;
+bool LLVOAvatar::sDeferMotionEvaluation = false;
+
+// Avatars whose animation waits for LLVOAvatar::evaluateDeferredMotions()
+static std::vector<LLPointer<LLVOAvatar> > sDeferredMotionAvatars;
 
 const LLUUID LLVOAvatar::sStepSoundOnLand("e8af4a28-aa83-4310-a7c4-c047e15ea0df");
 const LLUUID LLVOAvatar::sStepSounds[LL_MCODE_END] =
@@ -2555,12 +2560,12 @@ void LLVOAvatar::updateMeshData()
 U32 LLVOAvatar::processUpdateMessage(LLMessageSystem *mesgsys,
                                      void **user_data,
                                      U32 block_num, const EObjectUpdateType update_type,
-                                     LLDataPacker *dp)
+                                     const LLObjectUpdateData* update)
 {
     const bool had_no_name = !getNVPair("FirstName");
 
     // Do base class updates...
-    U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, dp);
+    U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, update);
 
     // Print out arrival information once we have name of avatar.
     const bool has_name = getNVPair("FirstName");
@@ -2801,7 +2806,17 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
     // store off last frame's root position to be consistent with camera position
     mLastRootPos = mRoot->getWorldPosition();
     bool detailed_update = updateCharacter(agent);
+    if (mMotionsDeferred)
+    {
+        // The rest reads the joints, see evaluateDeferredMotions()
+        mDeferredDetailedUpdate = detailed_update;
+        return;
+    }
+    idleUpdateAfterMotions(detailed_update);
+}
 
+void LLVOAvatar::idleUpdateAfterMotions(bool detailed_update)
+{
     static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
     bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
                          LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -4847,6 +4862,12 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     // store data relevant to motions
     mSpeed = speed;
 
+    if (visible)
+    {
+        // System avatar mesh vertices need to be reskinned.
+        mNeedsSkin = true;
+    }
+
     // update animations
     if (!visible && !isSelf()) // NOTE: never do a "hidden update" for self avatar as it interrupts controller processing
     {
@@ -4856,12 +4877,27 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     {
         updateMotions(LLCharacter::FORCE_UPDATE);
     }
+    else if (sDeferMotionEvaluation && !isSelf())
+    {
+        // Might be better to do HIDDEN_UPDATE if cloud
+        updateMotions(LLCharacter::NORMAL_UPDATE, true);
+        sDeferredMotionAvatars.push_back(this);
+        mMotionsDeferred = true;
+        mDeferredSitGroundConstrained = was_sit_ground_constrained;
+        return visible;
+    }
     else
     {
         // Might be better to do HIDDEN_UPDATE if cloud
         updateMotions(LLCharacter::NORMAL_UPDATE);
     }
 
+    updateCharacterAfterMotions(was_sit_ground_constrained, false);
+    return visible;
+}
+
+void LLVOAvatar::updateCharacterAfterMotions(bool was_sit_ground_constrained, bool world_matrices_updated)
+{
     // Special handling for sitting on ground.
     if (!getParent() && (isSitting() || was_sit_ground_constrained))
     {
@@ -4874,6 +4910,7 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
             mRoot->touch();
             // SL-315
             mRoot->setWorldPosition(pos);
+            world_matrices_updated = false;
         }
     }
 
@@ -4884,15 +4921,48 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     updateFootstepSounds();
 
     // Update child joints as needed.
-    mRoot->updateWorldMatrixChildren();
-
-    if (visible)
+    if (!world_matrices_updated)
     {
-        // System avatar mesh vertices need to be reskinned.
-        mNeedsSkin = true;
+        updateWorldMatrices();
     }
+}
 
-    return visible;
+// static
+void LLVOAvatar::evaluateDeferredMotions()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    sDeferMotionEvaluation = false;
+
+    // Each job only touches its own avatar's motions and joints. Motions
+    // which need more were updated by updateCharacter() already, see
+    // LLMotion::canUpdateOnJobThread(), and the motions which stopped
+    // themselves are handled back here.
+    std::vector<LLPointer<LLVOAvatar> >& avatars = sDeferredMotionAvatars;
+    LL::runJobs("Jobs", avatars.size(), [&avatars](size_t i)
+    {
+        LLVOAvatar* avatarp = avatars[i];
+        if (!avatarp->isDead())
+        {
+            avatarp->getMotionController().evaluateDeferredMotions();
+            avatarp->updateWorldMatrices();
+        }
+    });
+
+    // Only then are the joints read, by this avatar or by the others
+    for (LLVOAvatar* avatarp : avatars)
+    {
+        avatarp->getMotionController().finishDeferredMotions();
+        avatarp->mMotionsDeferred = false;
+    }
+    for (LLVOAvatar* avatarp : avatars)
+    {
+        if (!avatarp->isDead())
+        {
+            avatarp->updateCharacterAfterMotions(avatarp->mDeferredSitGroundConstrained, true);
+            avatarp->idleUpdateAfterMotions(avatarp->mDeferredDetailedUpdate);
+        }
+    }
+    avatars.clear();
 }
 
 //-----------------------------------------------------------------------------
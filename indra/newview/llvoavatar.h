@@ -130,7 +130,7 @@ public:
                                                      void **user_data,
                                                      U32 block_num,
                                                      const EObjectUpdateType update_type,
-                                                     LLDataPacker *dp);
+                                                     const LLObjectUpdateData* update);
     virtual void                idleUpdate(LLAgent &agent, const F64 &time);
     /*virtual*/ bool            updateLOD();
     bool                        updateJointLODs();
@@ -273,6 +273,16 @@ public:
     virtual void    updateDebugText();
     virtual bool    computeNeedsUpdate();
     virtual bool    updateCharacter(LLAgent &agent);
+    // Evaluates the motions, blends the poses and updates the skeletons of
+    // the avatars updateCharacter() deferred that of, on the "Jobs" thread
+    // pool, see sDeferMotionEvaluation. The rest of their idle updates,
+    // which read the joints, follows.
+    static void     evaluateDeferredMotions();
+private:
+    // The parts of updateCharacter() and idleUpdate() after the motions
+    void            updateCharacterAfterMotions(bool was_sit_ground_constrained, bool world_matrices_updated);
+    void            idleUpdateAfterMotions(bool detailed_update);
+public:
     void            updateFootstepSounds();
     void            computeUpdatePeriod();
     void            updateOrientation(LLAgent &agent, F32 speed, F32 delta_time);
@@ -362,6 +372,7 @@ public:
     static bool     sShowCollisionVolumes;  // show skeletal collision volumes
     static bool     sVisibleInFirstPerson;
     static S32      sNumLODChangesThisFrame;
+    static bool     sDeferMotionEvaluation; // while set, updateCharacter() leaves other avatars' animation to evaluateDeferredMotions()
     static S32      sNumVisibleChatBubbles;
     static bool     sDebugInvisible;
     static bool     sShowAttachmentPoints;
@@ -1044,6 +1055,9 @@ private:
     F32         mSpeedAccum; // measures speed (for diagnostics mostly).
     bool        mTurning; // controls hysteresis on avatar rotation
     F32         mSpeed; // misc. animation repeated state
+    bool        mMotionsDeferred{false}; // left to evaluateDeferredMotions() this frame
+    bool        mDeferredSitGroundConstrained{false};
+    bool        mDeferredDetailedUpdate{false};
 
     //--------------------------------------------------------------------
     // Dimensions
@@ -26,6 +26,7 @@
 
 #include "llviewerprecompiledheaders.h"
 #include "llvocache.h"
+#include "llmappedfile.h"
 #include "llregionhandle.h"
 #include "llviewercontrol.h"
 #include "llviewerobjectlist.h"
@@ -34,6 +35,17 @@
 #include "llagentcamera.h"
 #include "llsdserialize.h"
 #include "llworld.h" // For LLWorld::getInstance()
+#include "workqueue.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <unordered_set>
+#if LL_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 //static variables
 U32 LLVOCacheEntry::sMinFrameRange = 0;
 F32 LLVOCacheEntry::sNearRadius = 1.0f;
@@ -42,9 +54,20 @@ F32 LLVOCacheEntry::sFrontPixelThreshold = 1.0f;
 F32 LLVOCacheEntry::sRearPixelThreshold = 1.0f;
 bool LLVOCachePartition::sNeedsOcclusionCheck = false;
 
+// Object cache files hold the region ID and the number of entries, then
+// the index of the entries and their data, in the same order
+const S32 CACHE_HEADER_SIZE = UUID_BYTES + sizeof(S32);
 const S32 ENTRY_HEADER_SIZE = 6 * sizeof(S32);
 const S32 MAX_ENTRY_BODY_SIZE = 10000;
 
+// A mapped cache file, with the entries which still have their data in it.
+// Only used on the main thread.
+struct LLVOCacheMapping
+{
+    LLMappedFile mFile;
+    std::unordered_set<LLVOCacheEntry*> mEntries;
+};
+
 bool check_read(LLAPRFile* apr_file, void* src, S32 n_bytes)
 {
     return apr_file->read(src, n_bytes) == n_bytes ;
@@ -56,8 +79,9 @@ bool check_write(LLAPRFile* apr_file, void* src, S32 n_bytes)
 }
 
 // Material Override Cache needs a version label, so we can upgrade this later.
+// Version 2 entries are binary LLSD, back to back.
 const std::string LLGLTFOverrideCacheEntry::VERSION_LABEL = {"GLTFCacheVer"};
-const int LLGLTFOverrideCacheEntry::VERSION = 1;
+const int LLGLTFOverrideCacheEntry::VERSION = 2;
 
 bool LLGLTFOverrideCacheEntry::fromLLSD(const LLSD& data)
 {
@@ -167,7 +191,9 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
     mSceneContrib(0.f),
     mValid(true),
     mParentID(0),
-    mBSphereRadius(-1.0f)
+    mBSphereRadius(-1.0f),
+    mMappedData(NULL),
+    mMappedSize(0)
 {
     mBuffer = new U8[dp.getBufferSize()];
     mDP.assignBuffer(mBuffer, dp.getBufferSize());
@@ -187,12 +213,14 @@ LLVOCacheEntry::LLVOCacheEntry()
     mSceneContrib(0.f),
     mValid(true),
     mParentID(0),
-    mBSphereRadius(-1.0f)
+    mBSphereRadius(-1.0f),
+    mMappedData(NULL),
+    mMappedSize(0)
 {
     mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
+LLVOCacheEntry::LLVOCacheEntry(const U8* header, const U8* data, const std::shared_ptr<LLVOCacheMapping>& mapping)
 :   LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
     mBuffer(NULL),
     mUpdateFlags(-1),
@@ -200,68 +228,62 @@ LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
     mSceneContrib(0.f),
     mValid(false),
     mParentID(0),
-    mBSphereRadius(-1.0f)
+    mBSphereRadius(-1.0f),
+    mMapping(mapping),
+    mMappedData(data),
+    mMappedSize(0)
 {
-    S32 size = -1;
-    bool success;
-    static U8 data_buffer[ENTRY_HEADER_SIZE];
-
     mDP.assignBuffer(mBuffer, 0);
 
-    success = check_read(apr_file, (void *)data_buffer, ENTRY_HEADER_SIZE);
-    if (success)
-    {
-        memcpy(&mLocalID, data_buffer, sizeof(U32));
-        memcpy(&mCRC, data_buffer + sizeof(U32), sizeof(U32));
-        memcpy(&mHitCount, data_buffer + (2 * sizeof(U32)), sizeof(S32));
-        memcpy(&mDupeCount, data_buffer + (3 * sizeof(U32)), sizeof(S32));
-        memcpy(&mCRCChangeCount, data_buffer + (4 * sizeof(U32)), sizeof(S32));
-        memcpy(&size, data_buffer + (5 * sizeof(U32)), sizeof(S32));
+    memcpy(&mLocalID, header, sizeof(U32));
+    memcpy(&mCRC, header + sizeof(U32), sizeof(U32));
+    memcpy(&mHitCount, header + (2 * sizeof(U32)), sizeof(S32));
+    memcpy(&mDupeCount, header + (3 * sizeof(U32)), sizeof(S32));
+    memcpy(&mCRCChangeCount, header + (4 * sizeof(U32)), sizeof(S32));
+    memcpy(&mMappedSize, header + (5 * sizeof(U32)), sizeof(S32));
 
-        // Corruption in the cache entries
-        if ((size > MAX_ENTRY_BODY_SIZE) || (size < 1))
-        {
-            // We've got a bogus size, skip reading it.
-            // We won't bother seeking, because the rest of this file
-            // is likely bogus, and will be tossed anyway.
-            LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-            success = false;
-        }
-    }
-    if(success && size > 0)
-    {
-        mBuffer = new U8[size];
-        success = check_read(apr_file, mBuffer, size);
+    // Corruption in the cache entries, checked by LLVOCache::readFromCache()
+    llassert(mMappedSize > 0 && mMappedSize <= MAX_ENTRY_BODY_SIZE);
 
-        if(success)
-        {
-            mDP.assignBuffer(mBuffer, size);
-        }
-        else
-        {
-            // Improve logging around vocache
-            LL_WARNS() << "Error loading cache entry for " << mLocalID << ", size " << size << " aborting!" << LL_ENDL;
-            delete[] mBuffer ;
-            mBuffer = NULL ;
-        }
+    mMapping->mEntries.insert(this);
+}
+
+LLVOCacheEntry::~LLVOCacheEntry()
+{
+    releaseMapping();
+    mDP.freeBuffer();
+}
+
+void LLVOCacheEntry::releaseMapping()
+{
+    if (mMapping)
+    {
+        mMapping->mEntries.erase(this);
+        mMapping.reset();
     }
+    mMappedData = NULL;
+    mMappedSize = 0;
+}
 
-    if(!success)
+void LLVOCacheEntry::materialize()
+{
+    if (mMappedData)
     {
-        mLocalID = 0;
-        mCRC = 0;
-        mHitCount = 0;
-        mDupeCount = 0;
-        mCRCChangeCount = 0;
-        mBuffer = NULL;
-        mEntry = NULL;
-        mState = INACTIVE;
+        mBuffer = new U8[mMappedSize];
+        memcpy(mBuffer, mMappedData, mMappedSize);
+        mDP.assignBuffer(mBuffer, mMappedSize);
+        releaseMapping();
     }
 }
 
-LLVOCacheEntry::~LLVOCacheEntry()
+//static
+void LLVOCacheEntry::materializeAll(LLVOCacheMapping& mapping)
 {
-    mDP.freeBuffer();
+    // Each entry leaves the set, the caller holds a reference to the mapping
+    while (!mapping.mEntries.empty())
+    {
+        (*mapping.mEntries.begin())->materialize();
+    }
 }
 
 void LLVOCacheEntry::updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp)
@@ -273,6 +295,7 @@ void LLVOCacheEntry::updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp)
     }
 
     mDP.freeBuffer();
+    releaseMapping();
 
     llassert_always(dp.getBufferSize() > 0);
     mBuffer = new U8[dp.getBufferSize()];
@@ -405,6 +428,8 @@ LLVOCacheEntry* LLVOCacheEntry::getChild()
 
 LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP()
 {
+    materialize();
+
     if (mDP.getBufferSize() == 0)
     {
         //LL_INFOS() << "Not getting cache entry, invalid!" << LL_ENDL;
@@ -430,15 +455,14 @@ void LLVOCacheEntry::dump() const
         << LL_ENDL;
 }
 
-S32 LLVOCacheEntry::writeToBuffer(U8 *data_buffer) const
+S32 LLVOCacheEntry::getSize() const
 {
-    S32 size = mDP.getBufferSize();
+    return mMappedData ? mMappedSize : mDP.getBufferSize();
+}
 
-    if (size > MAX_ENTRY_BODY_SIZE)
-    {
-        LL_WARNS() << "Failed to write entry with size above allowed limit: " << size << LL_ENDL;
-        return 0;
-    }
+void LLVOCacheEntry::writeHeader(U8 *data_buffer) const
+{
+    S32 size = getSize();
 
     memcpy(data_buffer, &mLocalID, sizeof(U32));
     memcpy(data_buffer + sizeof(U32), &mCRC, sizeof(U32));
@@ -446,9 +470,21 @@ S32 LLVOCacheEntry::writeToBuffer(U8 *data_buffer) const
     memcpy(data_buffer + (3 * sizeof(U32)), &mDupeCount, sizeof(S32));
     memcpy(data_buffer + (4 * sizeof(U32)), &mCRCChangeCount, sizeof(S32));
     memcpy(data_buffer + (5 * sizeof(U32)), &size, sizeof(S32));
-    memcpy(data_buffer + ENTRY_HEADER_SIZE, (void*)mBuffer, size);
+}
+
+S32 LLVOCacheEntry::writeToBuffer(U8 *data_buffer) const
+{
+    S32 size = getSize();
+
+    if (size > MAX_ENTRY_BODY_SIZE)
+    {
+        LL_WARNS() << "Failed to write entry with size above allowed limit: " << size << LL_ENDL;
+        return 0;
+    }
+
+    memcpy(data_buffer, mMappedData ? mMappedData : mDP.getBuffer(), size);
 
-    return ENTRY_HEADER_SIZE + size;
+    return size;
 }
 
 #ifndef LL_TEST
@@ -1142,6 +1178,328 @@ const U32 INVALID_TIME = 0 ;
 const char* object_cache_dirname = "objectcache";
 const char* header_filename = "object.cache";
 
+//-------------------------------------------------------------------
+//LLVOCache::WriteQueue
+//-------------------------------------------------------------------
+// Writes the region cache files and the header entries on the "General"
+// thread pool, so that leaving regions does not stall the main thread on
+// disk I/O.
+//
+// LLVOCache hands over complete file images (serialized on the main thread,
+// since neither the cache entries nor LLSD are thread-safe). Each region has
+// at most one pending write, replaced by newer ones, and a single job writes
+// everything pending at a time: writes to a file always land in order, and
+// the header file is synced once per batch.
+//
+// Removing or reading the files of a region first cancels or flushes its
+// pending write, so the main thread never sees a write land after it.
+class LLVOCache::WriteQueue : public std::enable_shared_from_this<LLVOCache::WriteQueue>
+{
+public:
+    struct RegionWrite
+    {
+        RegionWrite() : mWriteObjects(false), mWriteExtras(false) {}
+
+        bool        mWriteObjects;
+        std::string mObjectsFilename;
+        std::vector<U8> mObjects;
+
+        bool        mWriteExtras;
+        std::string mExtrasFilename;
+        std::string mExtras;
+    };
+
+    WriteQueue() : mWritingHeader(false), mScheduled(false), mDraining(false) {}
+
+    void setHeaderFilename(const std::string& filename);
+
+    // Takes over the content of 'write', replacing the same files of a
+    // pending write for the region
+    void queue(U64 handle, RegionWrite& write);
+    void queueHeaderEntry(const HeaderEntryInfo& entry);
+
+    // Drops the pending write of a region, and waits for the one in progress
+    void cancel(U64 handle);
+    // Drops all pending writes, and waits for the ones in progress
+    void cancelAll();
+    // Drops the pending header entries before the header file is rewritten
+    void cancelHeaderEntries();
+
+    // Writes the pending write of a region right away
+    void flush(U64 handle);
+    // Writes everything pending right away, for shutdown
+    void flushAll();
+
+private:
+    typedef std::map<U64, RegionWrite> region_write_map_t;
+    typedef std::map<S32, HeaderEntryInfo> header_entry_map_t;
+
+    void schedule(std::unique_lock<std::mutex>& lock);
+    void writePending();
+    void writeRegion(U64 handle, const RegionWrite& write);
+    static bool writeHeaderEntries(const std::string& filename, const header_entry_map_t& entries);
+    static bool writeFile(const std::string& filename, const void* data, size_t size);
+
+    std::mutex          mMutex;
+    std::condition_variable mWriteDone;
+    std::string         mHeaderFilename;
+    region_write_map_t  mPendingRegions;
+    header_entry_map_t  mPendingHeaderEntries;
+    std::set<U64>       mWritingRegions;
+    bool                mWritingHeader;
+    bool                mScheduled; // a job is posted to the "General" thread pool
+    bool                mDraining;  // writePending() is running
+};
+
+// Reports a failed write to the main thread, which drops the region cache
+static void on_region_write_failed(U64 handle, bool extras)
+{
+    LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+    if (!main_queue)
+    {
+        return;
+    }
+    // Without waiting: the main thread may be waiting for this write
+    main_queue->tryPost([handle, extras]()
+        {
+            if (LLVOCache::instanceExists())
+            {
+                if (extras)
+                {
+                    LLVOCache::instance().removeGenericExtrasForHandle(handle);
+                }
+                else
+                {
+                    LLVOCache::instance().removeEntry(handle);
+                }
+            }
+        });
+}
+
+void LLVOCache::WriteQueue::setHeaderFilename(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHeaderFilename = filename;
+}
+
+void LLVOCache::WriteQueue::queue(U64 handle, RegionWrite& write)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    RegionWrite& pending = mPendingRegions[handle];
+    if (write.mWriteObjects)
+    {
+        pending.mWriteObjects = true;
+        pending.mObjectsFilename.swap(write.mObjectsFilename);
+        pending.mObjects.swap(write.mObjects);
+    }
+    if (write.mWriteExtras)
+    {
+        pending.mWriteExtras = true;
+        pending.mExtrasFilename.swap(write.mExtrasFilename);
+        pending.mExtras.swap(write.mExtras);
+    }
+    schedule(lock);
+}
+
+void LLVOCache::WriteQueue::queueHeaderEntry(const HeaderEntryInfo& entry)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mPendingHeaderEntries[entry.mIndex] = entry;
+    schedule(lock);
+}
+
+void LLVOCache::WriteQueue::cancel(U64 handle)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mPendingRegions.erase(handle);
+    mWriteDone.wait(lock, [this, handle]() { return mWritingRegions.find(handle) == mWritingRegions.end(); });
+}
+
+void LLVOCache::WriteQueue::cancelAll()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mPendingRegions.clear();
+    mPendingHeaderEntries.clear();
+    mWriteDone.wait(lock, [this]() { return mWritingRegions.empty() && !mWritingHeader; });
+}
+
+void LLVOCache::WriteQueue::cancelHeaderEntries()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mPendingHeaderEntries.clear();
+    mWriteDone.wait(lock, [this]() { return !mWritingHeader; });
+}
+
+void LLVOCache::WriteQueue::flush(U64 handle)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mWriteDone.wait(lock, [this, handle]() { return mWritingRegions.find(handle) == mWritingRegions.end(); });
+    region_write_map_t::iterator iter = mPendingRegions.find(handle);
+    if (iter == mPendingRegions.end())
+    {
+        return;
+    }
+    RegionWrite write;
+    std::swap(write, iter->second);
+    mPendingRegions.erase(iter);
+    mWritingRegions.insert(handle);
+    lock.unlock();
+
+    writeRegion(handle, write);
+
+    lock.lock();
+    mWritingRegions.erase(handle);
+    mWriteDone.notify_all();
+}
+
+void LLVOCache::WriteQueue::flushAll()
+{
+    // Returns at once when a job is writing, which goes on until done
+    writePending();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mWriteDone.wait(lock, [this]() { return !mDraining && mWritingRegions.empty(); });
+}
+
+void LLVOCache::WriteQueue::schedule(std::unique_lock<std::mutex>& lock)
+{
+    if (mScheduled)
+    {
+        return;
+    }
+    mScheduled = true;
+
+    std::shared_ptr<WriteQueue> self = shared_from_this();
+    LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+    lock.unlock();
+    if (!general_queue || !general_queue->post([self]() { self->writePending(); }))
+    {
+        // No worker threads (yet or any more)
+        writePending();
+    }
+    lock.lock();
+}
+
+void LLVOCache::WriteQueue::writePending()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    std::unique_lock<std::mutex> lock(mMutex);
+    mScheduled = false;
+    if (mDraining)
+    {
+        // The other job also writes whatever gets queued meanwhile
+        return;
+    }
+    mDraining = true;
+    while (!mPendingRegions.empty() || !mPendingHeaderEntries.empty())
+    {
+        region_write_map_t regions;
+        regions.swap(mPendingRegions);
+        header_entry_map_t header_entries;
+        header_entries.swap(mPendingHeaderEntries);
+        for (region_write_map_t::const_iterator iter = regions.begin(); iter != regions.end(); ++iter)
+        {
+            mWritingRegions.insert(iter->first);
+        }
+        mWritingHeader = !header_entries.empty();
+        std::string header_filename = mHeaderFilename;
+        lock.unlock();
+
+        for (region_write_map_t::const_iterator iter = regions.begin(); iter != regions.end(); ++iter)
+        {
+            writeRegion(iter->first, iter->second);
+        }
+        if (!header_entries.empty() && !writeHeaderEntries(header_filename, header_entries))
+        {
+            LL_WARNS() << "Failed to update the object cache header " << header_filename << LL_ENDL;
+        }
+
+        lock.lock();
+        for (region_write_map_t::const_iterator iter = regions.begin(); iter != regions.end(); ++iter)
+        {
+            mWritingRegions.erase(iter->first);
+        }
+        mWritingHeader = false;
+        mWriteDone.notify_all();
+    }
+    mDraining = false;
+    mWriteDone.notify_all();
+}
+
+void LLVOCache::WriteQueue::writeRegion(U64 handle, const RegionWrite& write)
+{
+    if (write.mWriteObjects)
+    {
+        // Entries of the current file may still map it, so the new one is
+        // written next to it and swapped in
+        std::string temp_filename = write.mObjectsFilename + ".tmp";
+        bool success = writeFile(temp_filename, write.mObjects.data(), write.mObjects.size());
+        if (success)
+        {
+#if LL_WINDOWS
+            LLFile::remove(write.mObjectsFilename, ENOENT);
+#endif
+            success = LLFile::rename(temp_filename, write.mObjectsFilename) == 0;
+        }
+        if (!success)
+        {
+            LL_WARNS() << "Failed to write cache to disk " << write.mObjectsFilename << LL_ENDL;
+            LLFile::remove(temp_filename, ENOENT);
+            on_region_write_failed(handle, false);
+            return;
+        }
+    }
+
+    if (write.mWriteExtras && !writeFile(write.mExtrasFilename, write.mExtras.data(), write.mExtras.size()))
+    {
+        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
+        on_region_write_failed(handle, true);
+    }
+}
+
+//static
+bool LLVOCache::WriteQueue::writeHeaderEntries(const std::string& filename, const header_entry_map_t& entries)
+{
+    LLFILE* fp = LLFile::fopen(filename, "r+b");
+    if (!fp)
+    {
+        return false;
+    }
+
+    bool success = true;
+    for (header_entry_map_t::const_iterator iter = entries.begin(); success && iter != entries.end(); ++iter)
+    {
+        long offset = (long)(iter->first * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo));
+        success = fseek(fp, offset, SEEK_SET) == 0
+            && fwrite(&iter->second, sizeof(HeaderEntryInfo), 1, fp) == 1;
+    }
+    success = fflush(fp) == 0 && success;
+    // Once per batch, rather than once per region
+#if LL_WINDOWS
+    success = _commit(_fileno(fp)) == 0 && success;
+#else
+    success = fsync(fileno(fp)) == 0 && success;
+#endif
+    fclose(fp);
+    return success;
+}
+
+//static
+bool LLVOCache::WriteQueue::writeFile(const std::string& filename, const void* data, size_t size)
+{
+    LLFILE* fp = LLFile::fopen(filename, "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    bool success = fwrite(data, 1, size, fp) == size;
+    return fclose(fp) == 0 && success;
+}
+
+//-------------------------------------------------------------------
+//LLVOCache
+//-------------------------------------------------------------------
+
 
 LLVOCache::LLVOCache(bool read_only) :
     mInitialized(false),
@@ -1154,12 +1512,14 @@ LLVOCache::LLVOCache(bool read_only) :
     mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
 #endif
     mLocalAPRFilePoolp = new LLVolatileAPRPool() ;
+    mWriteQueue = std::make_shared<WriteQueue>();
 }
 
 LLVOCache::~LLVOCache()
 {
     if(mEnabled)
     {
+        mWriteQueue->flushAll();
         writeCacheHeader();
         clearCacheInMemory();
     }
@@ -1170,6 +1530,7 @@ void LLVOCache::setDirNames(ELLPath location)
 {
     mHeaderFileName = gDirUtilp->getExpandedFilename(location, object_cache_dirname, header_filename);
     mObjectCacheDirName = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
+    mWriteQueue->setHeaderFilename(mHeaderFileName);
 }
 
 void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
@@ -1242,6 +1603,11 @@ void LLVOCache::removeCache(ELLPath location, bool started)
     std::string mask = "*";
     std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
     LL_INFOS() << "Removing cache at " << cache_dir << LL_ENDL;
+    mWriteQueue->cancelAll();
+    while (!mMappings.empty())
+    {
+        releaseMapping(mMappings.begin()->first);
+    }
     gDirUtilp->deleteFilesInDir(cache_dir, mask); //delete all files
     LLFile::rmdir(cache_dir);
 
@@ -1265,6 +1631,11 @@ void LLVOCache::removeCache()
 
     std::string mask = "*";
     LL_INFOS() << "Removing object cache at " << mObjectCacheDirName << LL_ENDL;
+    mWriteQueue->cancelAll();
+    while (!mMappings.empty())
+    {
+        releaseMapping(mMappings.begin()->first);
+    }
     gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask);
 
     clearCacheInMemory() ;
@@ -1360,6 +1731,10 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
         return ;
     }
 
+    // A pending write would bring the files back
+    mWriteQueue->cancel(entry->mHandle);
+    releaseMapping(entry->mHandle);
+
     std::string filename;
     getObjectCacheFilename(entry->mHandle, filename);
     LL_WARNS("GLTF", "VOCache") << "Removing object cache for handle " << entry->mHandle << "Filename: " << filename << LL_ENDL;
@@ -1375,6 +1750,25 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
     updateEntry(entry) ; //update the head file.
 }
 
+void LLVOCache::releaseMapping(U64 handle)
+{
+    std::map<U64, std::weak_ptr<LLVOCacheMapping> >::iterator iter = mMappings.find(handle);
+    if (iter == mMappings.end())
+    {
+        return;
+    }
+#if LL_WINDOWS
+    // A mapped file cannot be removed or replaced. Besides the entries of
+    // the region, this includes the ones it dropped which are still alive.
+    std::shared_ptr<LLVOCacheMapping> mapping = iter->second.lock();
+    if (mapping)
+    {
+        LLVOCacheEntry::materializeAll(*mapping);
+    }
+#endif
+    mMappings.erase(iter);
+}
+
 void LLVOCache::readCacheHeader()
 {
     if(!mEnabled)
@@ -1472,6 +1866,9 @@ void LLVOCache::writeCacheHeader()
         return;
     }
 
+    // Pending entries are older than the ones in memory
+    mWriteQueue->cancelHeaderEntries();
+
     bool success = true ;
     {
         LLAPRFile apr_file(mHeaderFileName, APR_CREATE|APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
@@ -1510,12 +1907,9 @@ void LLVOCache::writeCacheHeader()
     return ;
 }
 
-bool LLVOCache::updateEntry(const HeaderEntryInfo* entry)
+void LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 {
-    LLAPRFile apr_file(mHeaderFileName, APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
-    apr_file.seek(APR_SET, entry->mIndex * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo)) ;
-
-    return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
+    mWriteQueue->queueHeaderEntry(*entry);
 }
 
 // we now return bool to trigger dirty cache
@@ -1536,45 +1930,78 @@ bool LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
         return false; // arguably no a problem, but we'll mark this as dirty anyway.
     }
 
+    // The region may be entered again before its files got written
+    mWriteQueue->flush(handle);
+    releaseMapping(handle);
+
     bool success = true ;
-    S32 num_entries = 0 ; // lifted out of inner loop.
-    std::string filename; // lifted out of loop
+    S32 num_entries = 0 ;
+    std::string filename;
+    getObjectCacheFilename(handle, filename);
+
+    // The entries are created from the index at the start of the file, and
+    // keep the mapping until their data is first used (or until it gets
+    // rewritten). In read-only mode, the file belongs to another viewer
+    // which may replace it: copy everything right away.
+    std::shared_ptr<LLVOCacheMapping> mapping = std::make_shared<LLVOCacheMapping>();
+    llstat file_stat;
+    if (LLFile::stat(filename, &file_stat) != 0 || file_stat.st_size < CACHE_HEADER_SIZE)
+    {
+        LL_WARNS() << "Missing or truncated cache file " << filename << LL_ENDL;
+        success = false;
+    }
+    else if (!mapping->mFile.map(filename, (size_t)file_stat.st_size))
     {
+        success = false;
+    }
+    else
+    {
+        const U8* data = mapping->mFile.getAddress();
+        const size_t file_size = mapping->mFile.getSize();
+
         LLUUID cache_id;
-        getObjectCacheFilename(handle, filename);
-        LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
+        memcpy(cache_id.mData, data, UUID_BYTES);
+        memcpy(&num_entries, data + UUID_BYTES, sizeof(S32));
+        size_t data_offset = CACHE_HEADER_SIZE + (size_t)llmax(num_entries, 0) * ENTRY_HEADER_SIZE;
 
-        success = check_read(&apr_file, cache_id.mData, UUID_BYTES);
+        if(cache_id != id)
+        {
+            LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+            success = false ;
+        }
+        else if (num_entries < 0 || data_offset > file_size)
+        {
+            LL_WARNS() << "Bogus cache index, " << num_entries << " entries, aborting!" << LL_ENDL;
+            success = false;
+        }
 
-        if(success)
+        for (S32 i = 0; success && i < num_entries; i++)
         {
-            if(cache_id != id)
+            const U8* header = data + CACHE_HEADER_SIZE + (size_t)i * ENTRY_HEADER_SIZE;
+            U32 local_id = 0;
+            S32 size = -1;
+            memcpy(&local_id, header, sizeof(U32));
+            memcpy(&size, header + (5 * sizeof(U32)), sizeof(S32));
+            if (!local_id || size < 1 || size > MAX_ENTRY_BODY_SIZE || (size_t)size > file_size - data_offset)
             {
-                LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-                success = false ;
+                LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
+                success = false;
+                break;
             }
 
-            if(success)
+            LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(header, data + data_offset, mapping);
+            if (mReadOnly)
             {
-                success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-
-                if(success)
-                {
-                    for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-                    {
-                        LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-                        if (!entry->getLocalID())
-                        {
-                            LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-                            success = false ;
-                            break ;
-                        }
-                        cache_entry_map[entry->getLocalID()] = entry;
-                    }
-                }
+                entry->materialize();
             }
+            cache_entry_map[local_id] = entry;
+            data_offset += size;
         }
     }
+    if (!mapping->mEntries.empty())
+    {
+        mMappings[handle] = mapping;
+    }
 
     if(!success)
     {
@@ -1609,6 +2036,8 @@ void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCac
         return;
     }
 
+    mWriteQueue->flush(handle);
+
     std::string filename(getObjectCacheExtrasFilename(handle));
     llifstream in(filename, std::ios::in | std::ios::binary);
 
@@ -1686,7 +2115,7 @@ void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCac
     for (U32 i = 0; i < num_entries && !in.eof(); i++)
     {
         static const U32 max_size = 4096;
-        bool success = LLSDSerialize::deserialize(entry_llsd, in, max_size);
+        bool success = LLSDSerialize::fromBinary(entry_llsd, in, max_size) > 0;
         // check bool(in) this time since eof is not a failure condition here
         if(!success || !in)
         {
@@ -1780,11 +2209,7 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
     }
 
     //update cache header
-    if(!updateEntry(entry))
-    {
-        LL_WARNS() << "Failed to update cache header index " << entry->mIndex << ". " << filename << " handle = " << handle << LL_ENDL;
-        return ; //update failed.
-    }
+    updateEntry(entry);
 
     if(!dirty_cache)
     {
@@ -1792,78 +2217,46 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
         return ; //nothing changed, no need to update.
     }
 
-    //write to cache file
-    bool success = true ;
+    // The file image is put together here, and written by the WriteQueue
+    std::vector<LLVOCacheEntry*> entries;
+    entries.reserve(cache_entry_map.size());
+    size_t data_size = 0;
+    for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
     {
-        std::string filename;
-        getObjectCacheFilename(handle, filename);
-        LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY|APR_TRUNCATE, mLocalAPRFilePoolp);
-
-        success = check_write(&apr_file, (void*)id.mData, UUID_BYTES);
-
-        if(success)
+        if (!removal_enabled || iter->second->isValid())
         {
-            S32 num_entries = static_cast<S32>(cache_entry_map.size()); // if removal is enabled num_entries might be wrong
-            success = check_write(&apr_file, &num_entries, sizeof(S32));
-            if (success)
+            S32 size = iter->second->getSize();
+            if (size < 1 || size > MAX_ENTRY_BODY_SIZE)
             {
-                const S32 buffer_size = 32768; //should be large enough for couple MAX_ENTRY_BODY_SIZE
-                U8 data_buffer[buffer_size]; // generaly entries are fairly small, so collect them and drop onto disk in one go
-                S32 size_in_buffer = 0;
-
-                // This can have a lot of entries, so might be better to dump them into buffer first and write in one go.
-                for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-                {
-                    if (!removal_enabled || iter->second->isValid())
-                    {
-                        S32 size = iter->second->writeToBuffer(data_buffer + size_in_buffer);
-
-                        if (size > ENTRY_HEADER_SIZE) // body is minimum of 1
-                        {
-                            size_in_buffer += size;
-                        }
-                        else
-                        {
-                            LL_WARNS() << "Failed to write cache entry to buffer for " << filename << ", entry number " << iter->second->getLocalID() << LL_ENDL;
-                            success = false;
-                            break;
-                        }
-
-                        // Make sure we have space in buffer for next element
-                        if (buffer_size - size_in_buffer < MAX_ENTRY_BODY_SIZE + ENTRY_HEADER_SIZE)
-                        {
-                            success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                            size_in_buffer = 0;
-                            if (!success)
-                            {
-                                LL_WARNS() << "Failed to write cache to disk " << filename << LL_ENDL;
-                                break;
-                            }
-                        }
-                    }
-                }
-
-                if (success && size_in_buffer > 0)
-                {
-                    // final write
-                    success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                    if(!success)
-                    {
-                        LL_WARNS() << "Failed to write cache entry to disk " << filename << LL_ENDL;
-                    }
-                    size_in_buffer = 0;
-                }
-                LL_DEBUGS("VOCache") << "Wrote " << num_entries << " entries to the primary VOCache file " << filename << ". success = " << (success ? "True":"False") << LL_ENDL;
+                LL_WARNS() << "Failed to write cache entry to buffer for " << filename << ", entry number " << iter->second->getLocalID() << LL_ENDL;
+                removeEntry(entry);
+                return;
             }
+            entries.push_back(iter->second);
+            data_size += size;
         }
     }
 
-    if(!success)
+    WriteQueue::RegionWrite write;
+    write.mWriteObjects = true;
+    write.mObjectsFilename = filename;
+
+    // Header and index, then the data in index order
+    S32 num_entries = static_cast<S32>(entries.size());
+    size_t data_offset = CACHE_HEADER_SIZE + entries.size() * ENTRY_HEADER_SIZE;
+    write.mObjects.resize(data_offset + data_size);
+    U8* image = write.mObjects.data();
+    memcpy(image, id.mData, UUID_BYTES);
+    memcpy(image + UUID_BYTES, &num_entries, sizeof(S32));
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        removeEntry(entry) ;
+        entries[i]->writeHeader(image + CACHE_HEADER_SIZE + i * ENTRY_HEADER_SIZE);
+        data_offset += entries[i]->writeToBuffer(image + data_offset);
     }
 
-    return ;
+    releaseMapping(handle);
+    mWriteQueue->queue(handle, write);
+    LL_DEBUGS("VOCache") << "Queued " << num_entries << " entries for the primary VOCache file " << filename << LL_ENDL;
 }
 
 void LLVOCache::removeGenericExtrasForHandle(U64 handle)
@@ -1884,6 +2277,7 @@ void LLVOCache::removeGenericExtrasForHandle(U64 handle)
     else
     {
         //shouldn't happen, but if it does, we should remove the extras file since it's orphaned
+        mWriteQueue->cancel(handle);
         LLFile::remove(getObjectCacheExtrasFilename(handle));
     }
 }
@@ -1903,38 +2297,11 @@ void LLVOCache::writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LL
         return;
     }
 
-    std::string filename = getObjectCacheExtrasFilename(handle);
-    llofstream out(filename, std::ios::out | std::ios::binary);
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
-    }
-    // It is good practice to version file formats so let's add one.
-    // legacy versions will be treated as version 0.
-    out << LLGLTFOverrideCacheEntry::VERSION_LABEL << ":" << LLGLTFOverrideCacheEntry::VERSION << '\n';
-
-    out << id << '\n';
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
-    }
-    // Because we don't write out all the entries we need to record a placeholder and rewrite this later
-    auto num_entries_placeholder = out.tellp();
-    out << std::setw(10) << std::setfill('0') << 0 << '\n';
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
-    }
-
     // get ViewerRegion pointer from handle
     LLViewerRegion* pRegion = LLWorld::getInstance()->getRegionFromHandle(handle);
 
+    // The entries are serialized here, LLSD is not thread-safe
+    std::ostringstream entries_out(std::ios::out | std::ios::binary);
     U32 num_entries = 0;
     U32 skipped = 0;
     size_t inmem_entries = cache_extras_entry_map.size();
@@ -1956,15 +2323,7 @@ void LLVOCache::writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LL
         {
             LLSD entry_llsd = entry.toLLSD();
             entry_llsd["local_id"] = (S32)local_id;
-            LLSDSerialize::serialize(entry_llsd, out, LLSDSerialize::LLSD_XML);
-            out << '\n';
-            if(!out.good())
-            {
-                // We're not in a good place when this happens so we might as well nuke the file.
-                LL_WARNS() << "Failed writing extras cache for handle " << handle << ". Corrupted cache file " << filename << " removed." << LL_ENDL;
-                removeGenericExtrasForHandle(handle);
-                return;
-            }
+            LLSDSerialize::toBinary(entry_llsd, entries_out);
             num_entries++;
         }
         else
@@ -1972,14 +2331,20 @@ void LLVOCache::writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LL
             skipped++;
         }
     }
-    // Rewrite the placeholder
-    out.seekp(num_entries_placeholder);
+
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    // It is good practice to version file formats so let's add one.
+    // legacy versions will be treated as version 0.
+    out << LLGLTFOverrideCacheEntry::VERSION_LABEL << ":" << LLGLTFOverrideCacheEntry::VERSION << '\n';
+    out << id << '\n';
     out << std::setw(10) << std::setfill('0') << num_entries << '\n';
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        removeGenericExtrasForHandle(handle);
-        return;
-    }
-    LL_DEBUGS("GLTF") << "Completed writing extras cache for handle " << handle << ", " << num_entries << " entries. Total in RAM: " << inmem_entries << " skipped (no persist): " << skipped << LL_ENDL;
+    out << entries_out.str();
+
+    WriteQueue::RegionWrite write;
+    write.mWriteExtras = true;
+    write.mExtrasFilename = getObjectCacheExtrasFilename(handle);
+    write.mExtras = out.str();
+    mWriteQueue->queue(handle, write);
+
+    LL_DEBUGS("GLTF") << "Queued extras cache for handle " << handle << ", " << num_entries << " entries. Total in RAM: " << inmem_entries << " skipped (no persist): " << skipped << LL_ENDL;
 }
@@ -34,11 +34,13 @@
 #include "llapr.h"
 #include "llgltfmaterial.h"
 
+#include <memory>
 #include <unordered_map>
 
 //---------------------------------------------------------------------------
 // Cache entries
 class LLCamera;
+struct LLVOCacheMapping;
 
 class LLGLTFOverrideCacheEntry
 {
@@ -102,7 +104,9 @@ protected:
     ~LLVOCacheEntry();
 public:
     LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-    LLVOCacheEntry(LLAPRFile* apr_file);
+    // Entry of a mapped cache file, from its index record. The data stays
+    // in the mapping until the first getDP().
+    LLVOCacheEntry(const U8* header, const U8* data, const std::shared_ptr<LLVOCacheMapping>& mapping);
     LLVOCacheEntry();
 
     void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -125,8 +129,15 @@ public:
     F32 getSceneContribution() const             { return mSceneContrib;}
 
     void dump() const;
+    // Index record and data of the entry in a cache file
+    void writeHeader(U8 *data_buffer) const;
     S32 writeToBuffer(U8 *data_buffer) const;
+    S32 getSize() const;
     LLDataPackerBinaryBuffer *getDP();
+    // Copies the data out of the cache file mapping, if still there
+    void materialize();
+    // Same for all the entries still in the mapping, so that it gets unmapped
+    static void materializeAll(LLVOCacheMapping& mapping);
     void recordHit();
     void recordDupe() { mDupeCount++; }
 
@@ -157,6 +168,7 @@ public:
 
 private:
     void updateParentBoundingInfo(const LLVOCacheEntry* child);
+    void releaseMapping();
 
 public:
     typedef std::map<U32, LLPointer<LLVOCacheEntry> >      vocache_entry_map_t;
@@ -176,6 +188,10 @@ protected:
     S32                         mCRCChangeCount;
     LLDataPackerBinaryBuffer    mDP;
     U8                          *mBuffer;
+    // Data still in the cache file, see materialize()
+    std::shared_ptr<LLVOCacheMapping> mMapping;
+    const U8                    *mMappedData;
+    S32                         mMappedSize;
 
     F32                         mSceneContrib; //projected scene contributuion of this object.
     U32                         mState; //high 16 bits reserved for special use.
@@ -241,7 +257,7 @@ private:
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is not thread-safe, its files are written by a WriteQueue
 //
 class LLVOCache : public LLParamSingleton<LLVOCache>
 {
@@ -280,6 +296,8 @@ private:
     typedef std::set<HeaderEntryInfo*, header_entry_less> header_entry_queue_t;
     typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
 
+    class WriteQueue;
+
 public:
     // We need this init to be separate from constructor, since we might construct cache, purge it, then init.
     void initCache(ELLPath location, U32 size, U32 cache_version);
@@ -308,7 +326,8 @@ private:
     void removeCache() ;
     void removeEntry(HeaderEntryInfo* entry) ;
     void purgeEntries(U32 size);
-    bool updateEntry(const HeaderEntryInfo* entry);
+    void updateEntry(const HeaderEntryInfo* entry);
+    void releaseMapping(U64 handle);
 
 private:
     bool                 mEnabled;
@@ -322,6 +341,9 @@ private:
     LLVolatileAPRPool*   mLocalAPRFilePoolp ;
     header_entry_queue_t mHeaderEntryQueue;
     handle_entry_map_t   mHandleEntryMap;
+    std::shared_ptr<WriteQueue> mWriteQueue;
+    // Cache files still mapped by entries of the regions, see readFromCache()
+    std::map<U64, std::weak_ptr<LLVOCacheMapping> > mMappings;
 };
 
 #endif
@@ -1035,11 +1035,8 @@ void LLTerrainPartition::getGeometry(LLSpatialGroup* group)
     U32 index_offset = 0;
 
     {
-        LLStrider<LLVector3> vertices = vertices_start;
-        LLStrider<LLVector3> normals = normals_start;
-        LLStrider<LLVector2> texcoords2 = texcoords2_start;
-        LLStrider<U16> indices = indices_start;
-
+        // Give each face its range of the buffer first, so that the patches
+        // can then fill theirs at once on the terrain threads.
         for (std::vector<LLFace*>::iterator i = mFaceList.begin(); i != mFaceList.end(); ++i)
         {
             LLFace* facep = *i;
@@ -1048,12 +1045,27 @@ void LLTerrainPartition::getGeometry(LLSpatialGroup* group)
             facep->setGeomIndex(index_offset);
             facep->setVertexBuffer(buffer);
 
-            LLVOSurfacePatch* patchp = (LLVOSurfacePatch*) facep->getViewerObject();
-            patchp->getTerrainGeometry(vertices, normals, texcoords2, indices);
-
             indices_index += facep->getIndicesCount();
             index_offset += facep->getGeomCount();
         }
+
+        LLSurface::runPatchJobs((S32)mFaceList.size(),
+            [this, &vertices_start, &normals_start, &texcoords2_start, &indices_start](S32 i)
+            {
+                LLFace* facep = mFaceList[i];
+
+                LLStrider<LLVector3> vertices = vertices_start;
+                LLStrider<LLVector3> normals = normals_start;
+                LLStrider<LLVector2> texcoords2 = texcoords2_start;
+                LLStrider<U16> indices = indices_start;
+                vertices.skip(facep->getGeomIndex());
+                normals.skip(facep->getGeomIndex());
+                texcoords2.skip(facep->getGeomIndex());
+                indices.skip(facep->getIndicesIndex());
+
+                LLVOSurfacePatch* patchp = (LLVOSurfacePatch*) facep->getViewerObject();
+                patchp->getTerrainGeometry(vertices, normals, texcoords2, indices);
+            });
     }
 
     const bool has_tangents = tangents_start.get() != nullptr;
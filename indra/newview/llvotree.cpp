@@ -277,10 +277,10 @@ void LLVOTree::cleanupClass()
 U32 LLVOTree::processUpdateMessage(LLMessageSystem *mesgsys,
                                           void **user_data,
                                           U32 block_num, EObjectUpdateType update_type,
-                                          LLDataPacker *dp)
+                                          const LLObjectUpdateData* update)
 {
     // Do base class updates...
-    U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, dp);
+    U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, update);
 
     if (  (getVelocity().lengthSquared() > 0.f)
         ||(getAcceleration().lengthSquared() > 0.f)
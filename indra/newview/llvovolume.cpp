@@ -38,6 +38,7 @@
 #include "llfloatertools.h"
 #include "llmaterialid.h"
 #include "llmaterialtable.h"
+#include "llobjectupdatedata.h"
 #include "llprimitive.h"
 #include "llvolume.h"
 #include "llvolumeoctree.h"
@@ -56,6 +57,7 @@
 #include "llflexibleobject.h"
 #include "llskinningutil.h"
 #include "llsky.h"
+#include "threadpool.h"
 #include "lltexturefetch.h"
 #include "llvector4a.h"
 #include "llviewercamera.h"
@@ -337,7 +339,7 @@ void LLVOVolume::cleanupClass()
 U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
                                           void **user_data,
                                           U32 block_num, EObjectUpdateType update_type,
-                                          LLDataPacker *dp)
+                                          const LLObjectUpdateData* update)
 {
 
     LLColor4U color;
@@ -347,7 +349,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
     const bool previously_color_changed = mColorChanged;
 
     // Do base class updates...
-    U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, dp);
+    U32 retval = LLViewerObject::processUpdateMessage(mesgsys, user_data, block_num, update_type, update);
 
     LLUUID sculpt_id;
     U8 sculpt_type = 0;
@@ -360,7 +362,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
         LL_DEBUGS("ObjectUpdate") << "uuid " << mID << " set sculpt_id " << sculpt_id << LL_ENDL;
     }
 
-    if (!dp)
+    if (!update)
     {
         if (update_type == OUT_FULL)
         {
@@ -439,9 +441,8 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
     {
         if (update_type != OUT_TERSE_IMPROVED)
         {
-            LLVolumeParams volume_params;
-            bool res = LLVolumeMessage::unpackVolumeParams(&volume_params, *dp);
-            if (!res)
+            LLVolumeParams volume_params = update->mVolumeParams;
+            if (!update->mVolumeParamsValid)
             {
                 LL_WARNS() << "Bogus volume parameters in object " << getID() << LL_ENDL;
                 LL_WARNS() << getRegion()->getOriginGlobal() << LL_ENDL;
@@ -453,11 +454,15 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
             {
                 markForUpdate();
             }
-            S32 res2 = unpackTEMessage(*dp);
+            S32 res2 = TEM_INVALID;
+            if (update->mTextureEntryValid)
+            {
+                res2 = applyParsedTEMessage(*update->mTextureEntry);
+            }
             if (TEM_INVALID == res2)
             {
                 // There's something bogus in the data that we're unpacking.
-                dp->dumpBufferToLog();
+                update->getDataPacker().dumpBufferToLog();
                 LL_WARNS() << "Flushing cache files" << LL_ENDL;
 
                 if(LLVOCache::instanceExists() && getRegion())
@@ -475,7 +480,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
                 }
             }
 
-            U32 value = dp->getPassFlags();
+            U32 value = update->mSpecialCode;
 
             if (value & 0x40)
             {
@@ -491,7 +496,8 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
                     }
                 }
                 mTexAnimMode = 0;
-                mTextureAnimp->unpackTAMessage(*dp);
+                LLDataPackerBinaryBuffer tadp = update->getDataPacker(update->mTextureAnim);
+                mTextureAnimp->unpackTAMessage(tadp);
             }
             else if (mTextureAnimp)
             {
@@ -516,18 +522,20 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 
             if (value & 0x400)
             { //particle system (new)
-                unpackParticleSource(*dp, mOwnerID, false);
+                LLDataPackerBinaryBuffer pdp = update->getDataPacker(update->mParticles);
+                unpackParticleSource(pdp, mOwnerID, false);
             }
         }
         else
         {
-            S32 texture_length = mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_TextureEntry);
-            if (texture_length)
+            // The TextureEntry field of the message, see LLObjectUpdateData::unpackTerseTextureEntry()
+            if (update->mHasTextureEntry)
             {
-                U8                          tdpbuffer[1024];
-                LLDataPackerBinaryBuffer    tdp(tdpbuffer, 1024);
-                mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_TextureEntry, tdpbuffer, 0, block_num, 1024);
-                S32 result = unpackTEMessage(tdp);
+                S32 result = TEM_INVALID;
+                if (update->mTextureEntryValid)
+                {
+                    result = applyParsedTEMessage(*update->mTextureEntry);
+                }
                 if (result & teDirtyBits)
                 {
                     if (mDrawable)
@@ -4950,11 +4958,16 @@ void LLRiggedVolume::update(
     LLMatrix4a mat[kMaxJoints];
     U32 maxJoints = LLSkinningUtil::getMeshJointCount(skin);
     LLSkinningUtil::initSkinningMatrixPalette(mat, maxJoints, skin, avatar);
-    const LLMatrix4a bind_shape_matrix = skin->mBindShapeMatrix;
+
+    // Fold the bind shape matrix into the palette so that each vertex is
+    // transformed once per joint
+    LLSkinningUtil::applyBindShapeMatrix(skin->mBindShapeMatrix, mat, maxJoints);
 
     S32 rigged_vert_count = 0;
     S32 rigged_face_count = 0;
     LLVector4a box_min, box_max;
+    box_min.clear();
+    box_max.clear();
     S32 face_begin;
     S32 face_end;
     if (face_index == DO_NOT_UPDATE_FACES)
@@ -4972,93 +4985,74 @@ void LLRiggedVolume::update(
         face_begin = face_index;
         face_end = face_begin + 1;
     }
+
+    std::vector<LLSkinningUtil::SkinningBatch> batches;
+
     for (S32 i = face_begin; i < face_end; ++i)
     {
         const LLVolumeFace& vol_face = volume->getVolumeFace(i);
-
         LLVolumeFace& dst_face = mVolumeFaces[i];
-
         LLVector4a* weight = vol_face.mWeights;
 
-        if ( weight )
+        if (weight)
         {
             LLSkinningUtil::checkSkinWeights(weight, dst_face.mNumVertices, skin);
 
-            LLVector4a* pos = dst_face.mPositions;
-
-            if (pos && dst_face.mExtents)
+            if (dst_face.mPositions && dst_face.mExtents && dst_face.mNumVertices > 0)
             {
-                U32 max_joints = LLSkinningUtil::getMaxJointCount();
                 rigged_vert_count += dst_face.mNumVertices;
                 rigged_face_count++;
+                LLSkinningUtil::addSkinningBatches(i, dst_face.mNumVertices, batches);
+            }
+        }
+    }
 
-            #if USE_SEPARATE_JOINT_INDICES_AND_WEIGHTS
-                if (vol_face.mJointIndices) // fast path with preconditioned joint indices
-                {
-                    LLMatrix4a src[4];
-                    U8* joint_indices_cursor = vol_face.mJointIndices;
-                    LLVector4a* just_weights = vol_face.mJustWeights;
-                    for (U32 j = 0; j < dst_face.mNumVertices; ++j)
-                    {
-                        LLMatrix4a final_mat;
-                        F32* w = just_weights[j].getF32ptr();
-                        LLSkinningUtil::getPerVertexSkinMatrixWithIndices(w, joint_indices_cursor, mat, final_mat, src);
-                        joint_indices_cursor += 4;
-
-                        LLVector4a& v = vol_face.mPositions[j];
-                        LLVector4a t;
-                        LLVector4a dst;
-                        bind_shape_matrix.affineTransform(v, t);
-                        final_mat.affineTransform(t, dst);
-                        pos[j] = dst;
-                    }
-                }
-                else
-            #endif
-                {
-                    for (S32 j = 0; j < dst_face.mNumVertices; ++j)
-                    {
-                        LLMatrix4a final_mat;
-                        LLSkinningUtil::getPerVertexSkinMatrix(weight[j].getF32ptr(), mat, false, final_mat, max_joints);
-
-                        LLVector4a& v = vol_face.mPositions[j];
-                        LLVector4a t;
-                        LLVector4a dst;
-                        bind_shape_matrix.affineTransform(v, t);
-                        final_mat.affineTransform(t, dst);
-                        pos[j] = dst;
-                    }
-                }
-
-                //update bounding box
-                // VFExtents change
-                LLVector4a& min = dst_face.mExtents[0];
-                LLVector4a& max = dst_face.mExtents[1];
-
-                min = pos[0];
-                max = pos[1];
-                if (i==0)
-                {
-                    box_min = min;
-                    box_max = max;
-                }
-
-                for (S32 j = 1; j < dst_face.mNumVertices; ++j)
-                {
-                    min.setMin(min, pos[j]);
-                    max.setMax(max, pos[j]);
-                }
+    const S32 max_joints = LLSkinningUtil::getMaxJointCount();
+    LL::runJobs("Jobs", batches.size(), [this, volume, &mat, &batches, max_joints](size_t n)
+    {
+        LLSkinningUtil::SkinningBatch& batch = batches[n];
+        const LLVolumeFace& vol_face = volume->getVolumeFace(batch.mFace);
+        LLVector4a* pos = mVolumeFaces[batch.mFace].mPositions;
 
-                box_min.setMin(min,box_min);
-                box_max.setMax(max,box_max);
+    #if USE_SEPARATE_JOINT_INDICES_AND_WEIGHTS
+        if (vol_face.mJointIndices) // fast path with preconditioned joint indices
+        {
+            LLMatrix4a src[4];
+            U8* joint_indices_cursor = vol_face.mJointIndices + batch.mBegin * 4;
+            LLVector4a* just_weights = vol_face.mJustWeights;
+            for (S32 j = batch.mBegin; j < batch.mEnd; ++j)
+            {
+                LLMatrix4a final_mat;
+                F32* w = just_weights[j].getF32ptr();
+                LLSkinningUtil::getPerVertexSkinMatrixWithIndices(w, joint_indices_cursor, mat, final_mat, src);
+                joint_indices_cursor += 4;
+                final_mat.affineTransform(vol_face.mPositions[j], pos[j]);
+            }
+        }
+        else
+    #endif
+        {
+            const LLVector4a* weight = vol_face.mWeights;
+            for (S32 j = batch.mBegin; j < batch.mEnd; ++j)
+            {
+                LLSkinningUtil::skinPosition(weight[j], vol_face.mPositions[j], mat, max_joints, pos[j]);
+            }
+        }
 
-                dst_face.mCenter->setAdd(dst_face.mExtents[0], dst_face.mExtents[1]);
-                dst_face.mCenter->mul(0.5f);
+        LLSkinningUtil::boundSkinningBatch(batch, pos);
+    });
 
-            }
+    //update bounding boxes
+    // VFExtents change
+    LLSkinningUtil::updateSkinnedExtents(batches, mVolumeFaces, box_min, box_max);
 
-            if (rebuild_face_octrees)
+    if (rebuild_face_octrees)
+    {
+        for (S32 i = face_begin; i < face_end; ++i)
+        {
+            if (volume->getVolumeFace(i).mWeights)
             {
+                LLVolumeFace& dst_face = mVolumeFaces[i];
                 dst_face.destroyOctree();
                 dst_face.createOctree();
             }
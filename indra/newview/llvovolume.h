@@ -193,7 +193,7 @@ public:
     /*virtual*/ U32     processUpdateMessage(LLMessageSystem *mesgsys,
                                             void **user_data,
                                             U32 block_num, const EObjectUpdateType update_type,
-                                            LLDataPacker *dp) override;
+                                            const LLObjectUpdateData* update) override;
 
     /*virtual*/ void    setSelected(bool sel) override;
     /*virtual*/ bool    setDrawableParent(LLDrawable* parentp) override;
@@ -0,0 +1,400 @@
+/**
+ * @file llskinningutil_test.cpp
+ * @brief LLSkinningUtil test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "../llviewerprecompiledheaders.h"
+#include "../test/lltut.h"
+
+#include "../llskinningutil.h"
+
+#include "llmatrix4a.h"
+#include "lltimer.h"
+#include "threadpool.h"
+
+#include <memory>
+#include <thread>
+
+namespace
+{
+    // As many joints as a mesh may be rigged to
+    const S32 NUM_JOINTS = 110;
+
+    // The same made up numbers every time
+    class LLTestRandom
+    {
+    public:
+        LLTestRandom() : mSeed(1) {}
+        F32 next()
+        {
+            mSeed = mSeed * 1664525 + 1013904223;
+            return (F32)(mSeed >> 8) / (F32)(1 << 24);
+        }
+    private:
+        U32 mSeed;
+    };
+
+    void make_matrix(LLTestRandom& random, LLMatrix4a& mat)
+    {
+        LLMatrix4 mat4;
+        mat4.initAll(LLVector3(0.9f + 0.2f * random.next(), 0.9f + 0.2f * random.next(), 0.9f + 0.2f * random.next()),
+                     LLQuaternion(random.next() * F_PI, LLVector3(random.next(), random.next(), random.next() + 0.1f)),
+                     LLVector3(random.next() - 0.5f, random.next() - 0.5f, random.next() * 2.f));
+        mat.loadu(mat4);
+    }
+
+    // A face of a mesh body as LLVolumeFace::unpackVolumeFaces() leaves it:
+    // each vertex weighted to one to four joints, the joint index in the
+    // integer part of a weight and the weight in the fraction.
+    struct LLTestFace
+    {
+        LLTestFace(LLTestRandom& random, S32 num_vertices)
+            : mPositions(num_vertices), mWeights(num_vertices), mSkinned(num_vertices)
+        {
+            for (S32 i = 0; i < num_vertices; ++i)
+            {
+                const F32 angle = random.next() * F_TWO_PI;
+                mPositions[i].set(0.2f * cosf(angle), 0.15f * sinf(angle), 1.8f * random.next(), 1.f);
+
+                F32 weights[4] = { 0.f, 0.f, 0.f, 0.f };
+                const S32 influences = 1 + (S32)(random.next() * 4.f) % 4;
+                for (S32 k = 0; k < influences; ++k)
+                {
+                    weights[k] = (F32)(S32)(random.next() * NUM_JOINTS) + 0.05f + 0.9f * random.next();
+                }
+                mWeights[i].loadua(weights);
+            }
+        }
+
+        std::vector<LLVector4a> mPositions;
+        std::vector<LLVector4a> mWeights;
+        std::vector<LLVector4a> mSkinned;
+    };
+
+    struct LLTestMesh
+    {
+        LLTestMesh(S32 num_faces, S32 vertices_per_face)
+        {
+            for (S32 j = 0; j < NUM_JOINTS; ++j)
+            {
+                make_matrix(mRandom, mPalette[j]);
+            }
+            make_matrix(mRandom, mBindShapeMatrix);
+            std::copy(mPalette, mPalette + NUM_JOINTS, mBoundPalette);
+            LLSkinningUtil::applyBindShapeMatrix(mBindShapeMatrix, mBoundPalette, NUM_JOINTS);
+            for (S32 i = 0; i < num_faces; ++i)
+            {
+                addFace(vertices_per_face);
+            }
+        }
+
+        void addFace(S32 num_vertices)
+        {
+            mFaces.emplace_back(new LLTestFace(mRandom, num_vertices));
+        }
+
+        LLTestRandom mRandom;
+        LLMatrix4a mPalette[NUM_JOINTS];
+        LLMatrix4a mBindShapeMatrix;
+        // mPalette multiplied by the bind shape matrix
+        LLMatrix4a mBoundPalette[NUM_JOINTS];
+        std::vector<std::unique_ptr<LLTestFace> > mFaces;
+    };
+
+    // As LLRiggedVolume::update() used to, with
+    // LLSkinningUtil::getPerVertexSkinMatrix()
+    void skin_matrices(const LLTestMesh& mesh, LLTestFace& face, S32 begin, S32 end)
+    {
+        for (S32 i = begin; i < end; ++i)
+        {
+            const F32* weights = face.mWeights[i].getF32ptr();
+            S32 idx[4];
+            LLVector4 wght;
+            F32 scale = 0.f;
+            for (U32 k = 0; k < 4; k++)
+            {
+                F32 w = weights[k];
+                idx[k] = llclamp((S32) floorf(w), (S32)0, NUM_JOINTS - 1);
+                wght[k] = w - floorf(w);
+                scale += wght[k];
+            }
+            wght *= 1.f / scale;
+
+            LLMatrix4a final_mat;
+            final_mat.clear();
+            for (U32 k = 0; k < 4; k++)
+            {
+                LLMatrix4a src;
+                src.setMul(mesh.mPalette[idx[k]], wght[k]);
+                final_mat.add(src);
+            }
+
+            LLVector4a t;
+            mesh.mBindShapeMatrix.affineTransform(face.mPositions[i], t);
+            final_mat.affineTransform(t, face.mSkinned[i]);
+        }
+    }
+
+    void skin_positions(const LLTestMesh& mesh, const LLTestFace& face, S32 begin, S32 end, LLVector4a* skinned)
+    {
+        for (S32 i = begin; i < end; ++i)
+        {
+            LLSkinningUtil::skinPosition(face.mWeights[i], face.mPositions[i], mesh.mBoundPalette, NUM_JOINTS, skinned[i]);
+        }
+    }
+
+    void skin_positions(const LLTestMesh& mesh, LLTestFace& face, S32 begin, S32 end)
+    {
+        skin_positions(mesh, face, begin, end, face.mSkinned.data());
+    }
+
+    std::vector<LLSkinningUtil::SkinningBatch> make_batches(const LLTestMesh& mesh)
+    {
+        std::vector<LLSkinningUtil::SkinningBatch> batches;
+        for (size_t i = 0; i < mesh.mFaces.size(); ++i)
+        {
+            LLSkinningUtil::addSkinningBatches((S32)i, (S32)mesh.mFaces[i]->mPositions.size(), batches);
+        }
+        return batches;
+    }
+
+    // Milliseconds to skin the whole mesh, in batches as LLRiggedVolume::update() does
+    F64 time_skinning(LLTestMesh& mesh, bool blend_matrices, bool threaded)
+    {
+        const std::vector<LLSkinningUtil::SkinningBatch> batches = make_batches(mesh);
+
+        auto skin = [&mesh, &batches, blend_matrices](size_t n)
+        {
+            const LLSkinningUtil::SkinningBatch& batch = batches[n];
+            LLTestFace& face = *mesh.mFaces[batch.mFace];
+            if (blend_matrices)
+            {
+                skin_matrices(mesh, face, batch.mBegin, batch.mEnd);
+            }
+            else
+            {
+                skin_positions(mesh, face, batch.mBegin, batch.mEnd);
+            }
+        };
+
+        const S32 ROUNDS = 20;
+        LLTimer timer;
+        for (S32 round = 0; round < ROUNDS; ++round)
+        {
+            if (threaded)
+            {
+                LL::runJobs("Jobs", batches.size(), skin);
+            }
+            else
+            {
+                for (size_t n = 0; n < batches.size(); ++n)
+                {
+                    skin(n);
+                }
+            }
+        }
+        return timer.getElapsedTimeF64() * 1000.0 / ROUNDS;
+    }
+}
+
+namespace tut
+{
+    struct skinningutil_data
+    {
+    };
+    typedef test_group<skinningutil_data> skinningutil_test;
+    typedef skinningutil_test::object skinningutil_object;
+    tut::skinningutil_test skinningutil_testcase("LLSkinningUtil");
+
+    template<> template<>
+    void skinningutil_object::test<1>()
+    {
+        // skinPosition() with the palette applyBindShapeMatrix() folded the
+        // bind shape into skins as blending the joint matrices then applying
+        // the bind shape and the blend does
+        LLTestMesh mesh(1, 5000);
+        LLTestFace& face = *mesh.mFaces[0];
+        const S32 count = (S32)face.mPositions.size();
+        skin_matrices(mesh, face, 0, count);
+        std::vector<LLVector4a> expected = face.mSkinned;
+        skin_positions(mesh, face, 0, count);
+
+        for (S32 i = 0; i < count; ++i)
+        {
+            for (S32 k = 0; k < 3; ++k)
+            {
+                ensure_approximately_equals(llformat("vertex %d", i).c_str(),
+                                            face.mSkinned[i][k], expected[i][k], 14);
+            }
+        }
+    }
+
+    template<> template<>
+    void skinningutil_object::test<2>()
+    {
+        // Milliseconds to skin a mesh body, blending matrices as before,
+        // blending positions, and blending positions with increasing
+        // numbers of threads. Set LL_SKINNING_BENCHMARK_VERTICES for
+        // another number of vertices per face. Not a pass/fail test.
+        skip_unless_benchmarking();
+        S32 vertices = 40000;
+        if (const char* count = getenv("LL_SKINNING_BENCHMARK_VERTICES"))
+        {
+            vertices = llmax(1, atoi(count));
+        }
+        // upper body, lower body, hands, feet, head
+        LLTestMesh mesh(5, vertices);
+
+        LL_INFOS() << mesh.mFaces.size() << " faces of " << vertices << " vertices, matrix blend: "
+                   << llformat("%.3f ms", time_skinning(mesh, true, false))
+                   << ", position blend: " << llformat("%.3f ms", time_skinning(mesh, false, false)) << LL_ENDL;
+
+        const S32 max_threads = llmax(1, (S32)std::thread::hardware_concurrency());
+        for (S32 threads = 2; threads <= max_threads; threads *= 2)
+        {
+            // the calling thread takes its share
+            LL::ThreadPool pool("Jobs", threads - 1);
+            pool.start();
+            LL_INFOS() << "position blend, " << threads << " threads: "
+                       << llformat("%.3f ms", time_skinning(mesh, false, true)) << LL_ENDL;
+        }
+    }
+
+    template<> template<>
+    void skinningutil_object::test<3>()
+    {
+        // Faces skinned in batches on the "Jobs" pool, as
+        // LLRiggedVolume::update() does, get the extents and centers of all
+        // of their vertices, however many batches they span, and the box
+        // bounds all of the faces
+        const S32 BATCH = LLSkinningUtil::SKINNING_BATCH_VERTICES;
+        const S32 sizes[] = { 100, 2 * BATCH + 1000, BATCH, BATCH + 1 };
+        LLTestMesh mesh(0, 0);
+        LLVolume::face_list_t faces(LL_ARRAY_SIZE(sizes));
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            mesh.addFace(sizes[i]);
+            faces[i].resizeVertices(sizes[i]);
+        }
+
+        std::vector<LLSkinningUtil::SkinningBatch> batches = make_batches(mesh);
+        ensure_equals("batches", batches.size(), (size_t)(1 + 3 + 1 + 2));
+        for (const LLSkinningUtil::SkinningBatch& batch : batches)
+        {
+            ensure("batch size", batch.mEnd > batch.mBegin && batch.mEnd - batch.mBegin <= BATCH);
+        }
+
+        LL::ThreadPool pool("Jobs", 3);
+        pool.start();
+        LL::runJobs("Jobs", batches.size(), [&mesh, &faces, &batches](size_t n)
+        {
+            LLSkinningUtil::SkinningBatch& batch = batches[n];
+            LLVector4a* pos = faces[batch.mFace].mPositions;
+            skin_positions(mesh, *mesh.mFaces[batch.mFace], batch.mBegin, batch.mEnd, pos);
+            LLSkinningUtil::boundSkinningBatch(batch, pos);
+        });
+
+        LLVector4a box_min, box_max;
+        box_min.clear();
+        box_max.clear();
+        LLSkinningUtil::updateSkinnedExtents(batches, faces, box_min, box_max);
+
+        LLVector4a expected_box_min, expected_box_max;
+        expected_box_min = expected_box_max = faces[0].mPositions[0];
+        for (size_t i = 0; i < faces.size(); ++i)
+        {
+            const LLVolumeFace& face = faces[i];
+            LLVector4a min = face.mPositions[0];
+            LLVector4a max = face.mPositions[0];
+            for (S32 j = 1; j < face.mNumVertices; ++j)
+            {
+                min.setMin(min, face.mPositions[j]);
+                max.setMax(max, face.mPositions[j]);
+            }
+            expected_box_min.setMin(expected_box_min, min);
+            expected_box_max.setMax(expected_box_max, max);
+
+            for (S32 k = 0; k < 3; ++k)
+            {
+                const std::string msg = llformat("face %d axis %d", (S32)i, k);
+                ensure_equals(msg + " min", face.mExtents[0][k], min[k]);
+                ensure_equals(msg + " max", face.mExtents[1][k], max[k]);
+                ensure_equals(msg + " center", (*face.mCenter)[k], (min[k] + max[k]) * 0.5f);
+            }
+        }
+        for (S32 k = 0; k < 3; ++k)
+        {
+            ensure_equals(llformat("box min %d", k), box_min[k], expected_box_min[k]);
+            ensure_equals(llformat("box max %d", k), box_max[k], expected_box_max[k]);
+        }
+    }
+
+    template<> template<>
+    void skinningutil_object::test<4>()
+    {
+        // The first batch of a face replaces the extents it had before
+        // skinning and the first face the box, so neither the old extents
+        // nor the cleared box reach out to the origin
+        LLVolume::face_list_t faces(3);
+        faces[0].resizeVertices(LLSkinningUtil::SKINNING_BATCH_VERTICES + 1);
+        faces[1].resizeVertices(10);
+        faces[2].resizeVertices(10);
+
+        // face 2 is not rigged
+        std::vector<LLSkinningUtil::SkinningBatch> batches;
+        LLSkinningUtil::addSkinningBatches(0, faces[0].mNumVertices, batches);
+        LLSkinningUtil::addSkinningBatches(1, faces[1].mNumVertices, batches);
+        ensure_equals("batches", batches.size(), (size_t)3);
+        batches[0].mMin.set(3.f, 3.f, 3.f);
+        batches[0].mMax.set(4.f, 4.f, 4.f);
+        batches[1].mMin.set(2.f, 3.5f, 3.5f);
+        batches[1].mMax.set(3.5f, 5.f, 3.5f);
+        batches[2].mMin.set(6.f, 6.f, 6.f);
+        batches[2].mMax.set(7.f, 7.f, 8.f);
+
+        LLVector4a box_min, box_max;
+        box_min.clear();
+        box_max.clear();
+        LLSkinningUtil::updateSkinnedExtents(batches, faces, box_min, box_max);
+
+        const F32 expected[][3] =
+        {
+            { 2.f, 3.f, 3.f }, { 4.f, 5.f, 4.f },   // face 0
+            { 6.f, 6.f, 6.f }, { 7.f, 7.f, 8.f },   // face 1
+            { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f }, // face 2, as LLVolumeFace() left it
+            { 2.f, 3.f, 3.f }, { 7.f, 7.f, 8.f }    // box
+        };
+        for (S32 k = 0; k < 3; ++k)
+        {
+            for (S32 i = 0; i < 3; ++i)
+            {
+                const std::string msg = llformat("face %d axis %d", i, k);
+                ensure_equals(msg + " min", faces[i].mExtents[0][k], expected[i * 2][k]);
+                ensure_equals(msg + " max", faces[i].mExtents[1][k], expected[i * 2 + 1][k]);
+            }
+            ensure_equals(llformat("center axis %d", k), (*faces[0].mCenter)[k], (expected[0][k] + expected[1][k]) * 0.5f);
+            ensure_equals(llformat("box min %d", k), box_min[k], expected[6][k]);
+            ensure_equals(llformat("box max %d", k), box_max[k], expected[7][k]);
+        }
+    }
+}
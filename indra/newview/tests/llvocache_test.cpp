@@ -35,9 +35,11 @@
 #include "llregionhandle.h"
 #include "llsdutil.h"
 #include "llsdserialize.h"
+#include "workqueue.h"
 
 #include "../llviewerobjectlist.h"
 #include "../llviewerregion.h"
+#include "../llworld.h"
 
 #include "lldir_stub.cpp"
 #include "llvieweroctree_stub.cpp"
@@ -58,11 +60,15 @@ LLDebugBeacon::~LLDebugBeacon() = default;
 LLViewerObjectList gObjectList{};
 LLViewerCamera::eCameraID LLViewerCamera::sCurCameraID{};
 void LLViewerObject::unpackUUID(LLDataPackerBinaryBuffer *dp, LLUUID &value, std::string name) {}
+void LLViewerObjectList::getUUIDFromLocal(LLUUID &id, const U32 local_id, const U32 ip, const U32 port) {}
 
 bool LLViewerRegion::addVisibleGroup(LLViewerOctreeGroup*) { return false; }
 U32 LLViewerRegion::getNumOfVisibleGroups() const { return 0; }
 LLVector3 LLViewerRegion::getOriginAgent() const { return LLVector3::zero; }
 S32 LLViewerRegion::sLastCameraUpdated{};
+void LLViewerRegion::clearVOCacheFromMemory() {}
+
+LLViewerRegion* LLWorld::getRegionFromHandle(const U64 &handle) { return nullptr; }
 
 // -------------------------------------------------------------------------------------------
 // TUT
@@ -142,6 +148,144 @@ namespace tut
         U64 region_handle = to_region_handle(140, 81);
         LLUUID region_id = LLUUID::generateNewID();
 
-        LLVOCache::instance().readGenericExtrasFromCache(region_handle, region_id, extras);
+        LLVOCacheEntry::vocache_entry_map_t entries;
+        LLVOCache::instance().readGenericExtrasFromCache(region_handle, region_id, extras, entries);
+    }
+
+    template<> template<>
+    void vocacheTestObject::test<3>()
+    {
+        // Writes then reads back the cache of a 15,000 object region,
+        // reporting the read time. Not a pass/fail test for the time.
+        const S32 NUM_OBJECTS = 15000;
+        const S32 REPEATS = 10;
+        U64 region_handle = to_region_handle(141, 81);
+        LLUUID region_id = LLUUID::generateNewID();
+
+        LLVOCacheEntry::vocache_entry_map_t written;
+        U8 data[400];
+        for (S32 i = 0; i < NUM_OBJECTS; ++i)
+        {
+            // Typical compressed update sizes
+            const S32 size = 100 + (i * 37) % 300;
+            memset(data, i & 0xff, size);
+            LLDataPackerBinaryBuffer dp(data, size);
+            written[i + 1] = new LLVOCacheEntry(i + 1, i * 7, dp);
+        }
+        LLVOCache::instance().writeToCache(region_handle, region_id, written, true, false);
+
+        F64 seconds = 0.0;
+        LLTimer timer;
+        for (S32 repeat = 0; repeat < REPEATS; ++repeat)
+        {
+            LLVOCacheEntry::vocache_entry_map_t read;
+            timer.reset();
+            bool success = LLVOCache::instance().readFromCache(region_handle, region_id, read);
+            seconds += timer.getElapsedTimeF64();
+
+            ensure("read succeeds", success);
+            ensure_equals("entries read", read.size(), written.size());
+            LLVOCacheEntry* entry = read[1234].get();
+            ensure_equals("crc", entry->getCRC(), (U32)(1233 * 7));
+            ensure_equals("size", entry->getDP()->getBufferSize(), written[1234]->getDP()->getBufferSize());
+            ensure("data", !memcmp(entry->getDP()->getBuffer(), written[1234]->getDP()->getBuffer(), entry->getDP()->getBufferSize()));
+        }
+
+        LL_INFOS() << "Read " << NUM_OBJECTS << " cached objects in "
+                   << llformat("%.2f ms", 1000.0 * seconds / REPEATS) << LL_ENDL;
+        LLVOCache::instance().removeEntry(region_handle);
+    }
+
+    template<> template<>
+    void vocacheTestObject::test<4>()
+    {
+        // Writes go to the "General" queue, which only runs them when told
+        LL::WorkQueue general_queue("General");
+        U64 region_handle = to_region_handle(142, 81);
+        LLUUID region_id = LLUUID::generateNewID();
+        std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "objectcache", "objects_142_81.slc");
+
+        LLVOCacheEntry::vocache_entry_map_t written;
+        U8 data[100];
+        for (S32 i = 0; i < 20; ++i)
+        {
+            memset(data, i, sizeof(data));
+            LLDataPackerBinaryBuffer dp(data, sizeof(data));
+            written[i + 1] = new LLVOCacheEntry(i + 1, i, dp);
+            if (i == 9)
+            {
+                LLVOCacheEntry::vocache_entry_map_t first(written);
+                LLVOCache::instance().writeToCache(region_handle, region_id, first, true, false);
+            }
+        }
+        // Replaces the pending write of the first 10 entries
+        LLVOCache::instance().writeToCache(region_handle, region_id, written, true, false);
+        ensure("write pending", !LLFile::isfile(filename));
+
+        // Entering the region again gets the latest write
+        LLVOCacheEntry::vocache_entry_map_t read;
+        ensure("read succeeds", LLVOCache::instance().readFromCache(region_handle, region_id, read));
+        ensure("write flushed", LLFile::isfile(filename));
+        ensure_equals("entries read", read.size(), written.size());
+
+        // The queued job writes what is pending. Entries read from a file
+        // map it, which would keep Windows from deleting it.
+        read.clear();
+        LLVOCache::instance().removeEntry(region_handle);
+        ensure("file removed", !LLFile::isfile(filename));
+        LLVOCache::instance().writeToCache(region_handle, region_id, written, true, false);
+        ensure("write queued", !LLFile::isfile(filename));
+        general_queue.runPending();
+        ensure("write done", LLFile::isfile(filename));
+        read.clear();
+        ensure("read back", LLVOCache::instance().readFromCache(region_handle, region_id, read));
+        ensure_equals("entries read back", read.size(), written.size());
+        read.clear();
+
+        // A removed entry stays removed
+        LLVOCache::instance().writeToCache(region_handle, region_id, written, true, false);
+        LLVOCache::instance().removeEntry(region_handle);
+        general_queue.runPending();
+        ensure("write dropped", !LLFile::isfile(filename));
+    }
+
+    template<> template<>
+    void vocacheTestObject::test<5>()
+    {
+        // An entry the region dropped may still be alive when its file gets
+        // rewritten: it must not keep the file mapped.
+        LL::WorkQueue general_queue("General");
+        U64 region_handle = to_region_handle(143, 81);
+        LLUUID region_id = LLUUID::generateNewID();
+        std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "objectcache", "objects_143_81.slc");
+
+        LLVOCacheEntry::vocache_entry_map_t written;
+        U8 data[100];
+        for (S32 i = 0; i < 10; ++i)
+        {
+            memset(data, i + 1, sizeof(data));
+            LLDataPackerBinaryBuffer dp(data, sizeof(data));
+            written[i + 1] = new LLVOCacheEntry(i + 1, i, dp);
+        }
+        LLVOCache::instance().writeToCache(region_handle, region_id, written, true, false);
+        general_queue.runPending();
+
+        LLVOCacheEntry::vocache_entry_map_t read;
+        ensure("read succeeds", LLVOCache::instance().readFromCache(region_handle, region_id, read));
+        LLPointer<LLVOCacheEntry> dropped = read[1];
+        read.erase(1);
+        LLVOCache::instance().writeToCache(region_handle, region_id, read, true, false);
+        general_queue.runPending();
+
+        read.clear();
+        ensure("read back", LLVOCache::instance().readFromCache(region_handle, region_id, read));
+        ensure_equals("entries read back", read.size(), written.size() - 1);
+        ensure("dropped entry rewritten", read.find(1) == read.end());
+        ensure_equals("dropped entry size", dropped->getDP()->getBufferSize(), (S32)sizeof(data));
+        ensure_equals("dropped entry data", (S32)dropped->getDP()->getBuffer()[sizeof(data) - 1], 1);
+
+        read.clear();
+        LLVOCache::instance().removeEntry(region_handle);
+        ensure("file removed", !LLFile::isfile(filename));
     }
 }
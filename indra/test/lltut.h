@@ -31,6 +31,7 @@
 
 #include "is_approx_equal_fraction.h" // instead of llmath.h
 #include "stringize.h"
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #include <string_view>
@@ -145,6 +146,16 @@ namespace tut
     {
         ensure_not_equals("", actual, expected);
     }
+
+    // Benchmarks only report numbers, they are skipped unless
+    // LL_RUN_BENCHMARKS is set in the environment
+    inline void skip_unless_benchmarking()
+    {
+        if (!std::getenv("LL_RUN_BENCHMARKS"))
+        {
+            skip("benchmark, set LL_RUN_BENCHMARKS to run it");
+        }
+    }
 }
 
 #endif // LL_LLTUT_H